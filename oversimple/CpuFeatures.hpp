@@ -0,0 +1,197 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "avec/Avec.hpp"
+#include <cstdint>
+
+#if AVEC_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace oversimple {
+
+/**
+ * The SIMD instruction sets that the HIIR stages can be compiled for, from the narrowest to the widest.
+ */
+enum class InstructionSet
+{
+  none,
+  neon,
+  neon64,
+  sse2,
+  avx,
+  avx2,
+  avx512
+};
+
+/**
+ * @return a human readable name of an instruction set.
+ */
+inline char const* getInstructionSetName(InstructionSet instructionSet)
+{
+  switch (instructionSet) {
+    case InstructionSet::neon:
+      return "NEON";
+    case InstructionSet::neon64:
+      return "NEON64";
+    case InstructionSet::sse2:
+      return "SSE2";
+    case InstructionSet::avx:
+      return "AVX";
+    case InstructionSet::avx2:
+      return "AVX2";
+    case InstructionSet::avx512:
+      return "AVX512";
+    case InstructionSet::none:
+    default:
+      return "none";
+  }
+}
+
+/**
+ * @return the widest instruction set that the IIR re-samplers have been compiled for. The layout of the interleaved
+ * buffers, and so the HIIR stages, are chosen at compile time by avec, according to the architecture flags.
+ */
+constexpr InstructionSet getCompiledInstructionSet()
+{
+  if constexpr (AVEC_AVX512) {
+    return InstructionSet::avx512;
+  }
+  else if constexpr (AVEC_AVX) {
+#if defined(__AVX2__) && defined(__FMA__)
+    return InstructionSet::avx2;
+#else
+    return InstructionSet::avx;
+#endif
+  }
+  else if constexpr (AVEC_SSE2) {
+    return InstructionSet::sse2;
+  }
+  else if constexpr (AVEC_NEON_64) {
+    return InstructionSet::neon64;
+  }
+  else if constexpr (AVEC_NEON) {
+    return InstructionSet::neon;
+  }
+  else {
+    return InstructionSet::none;
+  }
+}
+
+namespace detail {
+
+#if AVEC_X86
+
+inline void cpuid(uint32_t leaf, uint32_t subLeaf, uint32_t registers[4])
+{
+#ifdef _MSC_VER
+  int result[4];
+  __cpuidex(result, static_cast<int>(leaf), static_cast<int>(subLeaf));
+  for (int i = 0; i < 4; ++i) {
+    registers[i] = static_cast<uint32_t>(result[i]);
+  }
+#else
+  __cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// reads the extended control register 0, which tells which register states the operating system saves
+inline uint64_t readXcr0()
+{
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+#endif
+
+} // namespace detail
+
+/**
+ * Detects the widest instruction set supported by the CPU and by the operating system which is running the program.
+ * @return the detected instruction set
+ */
+inline InstructionSet detectInstructionSet()
+{
+#if AVEC_X86
+  uint32_t registers[4] = { 0, 0, 0, 0 };
+  detail::cpuid(0, 0, registers);
+  auto const maxLeaf = registers[0];
+  if (maxLeaf < 1) {
+    return InstructionSet::none;
+  }
+  detail::cpuid(1, 0, registers);
+  bool const hasSse2 = (registers[3] >> 26) & 1;
+  bool const hasOsxsave = (registers[2] >> 27) & 1;
+  bool const hasAvx = (registers[2] >> 28) & 1;
+  if (!hasSse2) {
+    return InstructionSet::none;
+  }
+  if (!hasAvx || !hasOsxsave) {
+    return InstructionSet::sse2;
+  }
+  auto const xcr0 = detail::readXcr0();
+  bool const isAvxStateEnabled = (xcr0 & 0x6) == 0x6;
+  bool const isAvx512StateEnabled = (xcr0 & 0xe6) == 0xe6;
+  if (!isAvxStateEnabled) {
+    return InstructionSet::sse2;
+  }
+  bool const hasFma = (registers[2] >> 12) & 1;
+  if (maxLeaf < 7 || !hasFma) {
+    return InstructionSet::avx;
+  }
+  detail::cpuid(7, 0, registers);
+  bool const hasAvx2 = (registers[1] >> 5) & 1;
+  bool const hasAvx512f = (registers[1] >> 16) & 1;
+  bool const hasAvx512dq = (registers[1] >> 17) & 1;
+  if (!hasAvx2) {
+    return InstructionSet::avx;
+  }
+  if (hasAvx512f && hasAvx512dq && isAvx512StateEnabled) {
+    return InstructionSet::avx512;
+  }
+  return InstructionSet::avx2;
+#elif AVEC_NEON_64
+  return InstructionSet::neon64;
+#elif AVEC_NEON
+  return InstructionSet::neon;
+#else
+  return InstructionSet::none;
+#endif
+}
+
+/**
+ * @return true if the CPU running the program supports the instruction set that the IIR re-samplers have been
+ * compiled for. A host that ships a build of the library for each instruction set can use this, or
+ * detectInstructionSet, to choose which one to load. The re-samplers of oversimple/IirDispatch.hpp do not need it, as
+ * they choose the instruction set at runtime.
+ */
+inline bool isCompiledInstructionSetSupported()
+{
+  return static_cast<int>(detectInstructionSet()) >= static_cast<int>(getCompiledInstructionSet());
+}
+
+} // namespace oversimple
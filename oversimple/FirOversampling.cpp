@@ -16,6 +16,12 @@ limitations under the License.
 
 #include "oversimple/FirOversampling.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 namespace oversimple::fir {
 
@@ -36,110 +42,672 @@ void DownSampler::processBlock(Buffer<double> const& input,
 }
 
 uint32_t UpSampler::processBlock(double* const* input, uint32_t numSamples)
+{
+  return upSample(input, numSamples, output);
+}
+
+uint32_t UpSampler::processBlockWithoutCopy(double* const* input, uint32_t numSamples)
+{
+  assert(outputView.size() == numChannels);
+  if (numSamples > fftSamplesPerBlock) {
+    auto const numUpSampledSamples = processBlock(input, numSamples);
+    std::copy(output.get(), output.get() + numChannels, outputView.begin());
+    return numUpSampledSamples;
+  }
+  int numUpSampledSamples = 0;
+  auto upSampleChannel = [&](uint32_t c) {
+    OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firUpSampling, numSamples);
+    auto const numChannelSamples = reSamplers[c]->process(input[c], (int)numSamples, outputView[c]);
+    if (c == 0) {
+      numUpSampledSamples = numChannelSamples;
+    }
+  };
+  forEachChannel(upSampleChannel);
+  return (uint32_t)numUpSampledSamples;
+}
+
+void DownSampler::processBlock(double* const* input, uint32_t numSamples, double** output, uint32_t requiredSamples)
+{
+  downSample(input, numSamples, output, requiredSamples);
+}
+
+namespace {
+
+void writeToCircularBuffer(double* circularBuffer,
+                           int bufferSize,
+                           int position,
+                           double const* samples,
+                           int numSamples)
+{
+  assert(position < bufferSize && numSamples <= bufferSize);
+  auto const samplesBeforeWrapping = std::min(numSamples, bufferSize - position);
+  std::copy(samples, samples + samplesBeforeWrapping, circularBuffer + position);
+  std::copy(samples + samplesBeforeWrapping, samples + numSamples, circularBuffer);
+}
+
+template<typename Float>
+void readFromCircularBuffer(double const* circularBuffer,
+                            int bufferSize,
+                            int position,
+                            Float* output,
+                            int numSamples)
+{
+  assert(position < bufferSize && numSamples <= bufferSize);
+  auto const samplesBeforeWrapping = std::min(numSamples, bufferSize - position);
+  std::copy(circularBuffer + position, circularBuffer + position + samplesBeforeWrapping, output);
+  std::copy(circularBuffer, circularBuffer + numSamples - samplesBeforeWrapping, output + samplesBeforeWrapping);
+}
+
+class R8brainReSampler final : public detail::ChannelReSampler
+{
+public:
+  R8brainReSampler(double oversamplingRate, uint32_t fftSamplesPerBlock, double transitionBand)
+    : reSampler(1.0, oversamplingRate, (int)fftSamplesPerBlock, transitionBand)
+    , silence(fftSamplesPerBlock, 0.0)
+  {
+    // r8brain computes the latency from the state of a cleared resampler, and may change it doing so, so it is queried
+    // once, before any processing, and the resampler is cleared again
+    inLenBeforeOutStart = reSampler.getInLenBeforeOutStart();
+    reSampler.clear();
+  }
+
+  int process(double* input, int numSamples, double*& output) override
+  {
+    return reSampler.process(input, numSamples, output);
+  }
+
+  void clear() override
+  {
+    reSampler.clear();
+  }
+
+  void prime() override
+  {
+    // r8brain does not expose its state, so the silence is processed, one fft block at a time and without copying the
+    // output, which is discarded
+    reSampler.clear();
+    auto numSamplesToPrime = inLenBeforeOutStart;
+    while (numSamplesToPrime > 0) {
+      auto const samplesToProcess = std::min(numSamplesToPrime, (int)silence.size());
+      double* output;
+      reSampler.process(silence.data(), samplesToProcess, output);
+      numSamplesToPrime -= samplesToProcess;
+    }
+  }
+
+  int getInLenBeforeOutStart() const override
+  {
+    return inLenBeforeOutStart;
+  }
+
+  int getMaxOutLen(int maxInputLength) override
+  {
+    return reSampler.getMaxOutLen(maxInputLength);
+  }
+
+private:
+  r8b::CDSPResampler24 reSampler;
+  std::vector<double> silence;
+  int inLenBeforeOutStart = 0;
+};
+
+// the same stopband attenuation as r8b::CDSPResampler24
+constexpr double partitionedAttenuation = 180.15;
+// the shortest fft supported by all the fft implementations r8brain can use
+constexpr int minPartitionedFftLengthBits = 6;
+constexpr double pi = 3.14159265358979323846;
+
+double besselI0(double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 1000 && term > 1.0e-21 * sum; ++k) {
+    auto const factor = x / (2.0 * k);
+    term *= factor * factor;
+    sum += term;
+  }
+  return sum;
+}
+
+/**
+ * @return true if all the samples are zeros, of either sign. The bits of the samples are or-ed, in a loop the compiler
+ * turns into SIMD instructions.
+ */
+bool isSilent(double const* samples, int numSamples)
+{
+  uint64_t bits = 0;
+  for (int i = 0; i < numSamples; ++i) {
+    uint64_t sampleBits;
+    std::memcpy(&sampleBits, samples + i, sizeof(double));
+    bits |= sampleBits;
+  }
+  return (bits << 1) == 0;
+}
+
+uint32_t getNextPowerOfTwo(uint32_t value)
+{
+  uint32_t powerOfTwo = 1;
+  while (powerOfTwo < value) {
+    powerOfTwo <<= 1;
+  }
+  return powerOfTwo;
+}
+
+/**
+ * The antialiasing filter of a uniformly partitioned re-sampler, and the spectra of its partitions, which are shared
+ * by all the channels. The filter is a Kaiser windowed sinc at the convolution rate, which is the higher of the two
+ * rates, with its transition band ending at the Nyquist frequency of the lower rate, and a group delay which is a
+ * whole number of samples at the lower rate.
+ */
+struct PartitionedKernel final
+{
+  PartitionedKernel(double oversamplingRate, double transitionBand, uint32_t partitionBlockSize)
+    : isUpSampling(oversamplingRate >= 1.0)
+    , rate((uint32_t)std::lround(isUpSampling ? oversamplingRate : 1.0 / oversamplingRate))
+  {
+    assert(rate >= 1);
+    assert(partitionBlockSize >= 1);
+    // the partition block size is at the lower rate, so the partitions of the input of a down-sampler hold a whole
+    // number of output samples. It is not rounded to a power of two, so that calls of partitionBlockSize samples
+    // complete exactly one partition each: only the fft length is.
+    inputPartitionSize = isUpSampling ? partitionBlockSize : partitionBlockSize * rate;
+    partitionSize = isUpSampling ? inputPartitionSize * rate : inputPartitionSize;
+    outputPartitionSize = isUpSampling ? partitionSize : partitionSize / rate;
+    auto const fftLength = std::max(getNextPowerOfTwo(2 * partitionSize), 1u << minPartitionedFftLengthBits);
+    int fftLengthBits = 0;
+    while ((1u << fftLengthBits) < fftLength) {
+      ++fftLengthBits;
+    }
+    fft.init(fftLengthBits);
+    spectrumLength = fftLength;
+
+    auto const transition = 0.005 * transitionBand / rate;
+    auto const cutoff = 0.5 / rate - 0.5 * transition;
+    auto const beta = 0.1102 * (partitionedAttenuation - 8.7);
+    auto const minLength = (partitionedAttenuation - 7.95) / (14.36 * transition) + 1.0;
+    groupDelay = (uint32_t)std::ceil(minLength / (2.0 * rate));
+    auto const halfLength = (int)(groupDelay * rate);
+    auto const length = 2 * halfLength + 1;
+    auto const gain = isUpSampling ? (double)rate : 1.0;
+    auto const windowNormalization = 1.0 / besselI0(beta);
+
+    auto const numPartitions = (uint32_t)((length + partitionSize - 1) / partitionSize);
+    spectra.setNumChannels(numPartitions);
+    spectra.setNumSamples(spectrumLength);
+    spectra.fill(0.0);
+    for (int i = 0; i < length; ++i) {
+      auto const n = i - halfLength;
+      auto const x = 2.0 * cutoff * n;
+      auto const sinc = n == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+      auto const position = (double)n / halfLength;
+      auto const window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - position * position))) * windowNormalization;
+      spectra[i / partitionSize][i % partitionSize] = gain * 2.0 * cutoff * sinc * window;
+    }
+    for (uint32_t k = 0; k < numPartitions; ++k) {
+      fft->forward(&spectra[k][0]);
+    }
+  }
+
+  uint32_t getNumPartitions() const
+  {
+    return spectra.getNumChannels();
+  }
+
+  /**
+   * @return the latency in input samples: the partition of input samples that are buffered before being convolved,
+   * and the group delay of the filter.
+   */
+  uint32_t getLatency() const
+  {
+    return inputPartitionSize + (isUpSampling ? groupDelay : groupDelay * rate);
+  }
+
+  bool const isUpSampling;
+  uint32_t const rate;
+  // the number of input samples of each partition
+  uint32_t inputPartitionSize;
+  // the number of samples of each partition at the convolution rate
+  uint32_t partitionSize;
+  uint32_t outputPartitionSize;
+  uint32_t spectrumLength;
+  // the group delay of the filter, in samples at the lower rate
+  uint32_t groupDelay;
+  r8b::CDSPRealFFTKeeper fft;
+  Buffer<double> spectra;
+};
+
+/**
+ * A single channel uniformly partitioned overlap-save re-sampler. The up-samplers convolve the input padded with zeros,
+ * the down-samplers keep one of every rate samples of the convolution. The output is delayed by one partition, so that
+ * each call produces as many samples as its input corresponds to.
+ * Once the input has been digital silence for long enough that the window and the spectra of the past partitions are
+ * all zeros, silent input is not convolved: the partitions are counted and zeros are queued, which is exactly what the
+ * convolution would produce. Before that, as when a tail of silence drains the re-sampler, the partitions whose window
+ * is all zeros are not transformed, and only the products of the spectra of the past partitions that are not zeros are
+ * accumulated and transformed back.
+ */
+/**
+ * @return the maximum number of samples produced by a uniformly partitioned re-sampler for maxInputLength input samples
+ */
+int getPartitionedMaxOutLen(bool isUpSampling, uint32_t rate, int maxInputLength)
+{
+  return isUpSampling ? maxInputLength * (int)rate : maxInputLength / (int)rate + 1;
+}
+
+class PartitionedReSampler final : public detail::ChannelReSampler
+{
+public:
+  explicit PartitionedReSampler(std::shared_ptr<PartitionedKernel const> kernel_)
+    : kernel(std::move(kernel_))
+  {
+    auto const spectrumLength = kernel->spectrumLength;
+    window.setNumChannels(1);
+    window.setNumSamples(spectrumLength);
+    workBuffers.setNumChannels(2);
+    workBuffers.setNumSamples(spectrumLength);
+    inputSpectra.setNumChannels(kernel->getNumPartitions());
+    inputSpectra.setNumSamples(spectrumLength);
+    // the output queue holds at most one partition of delay, one produced partition and the rounding of the
+    // down-sampling
+    outputQueue.setNumChannels(1);
+    outputQueue.setNumSamples(3 * kernel->outputPartitionSize + 1);
+    // the input samples held by the window, by the spectra of the past partitions, and by the partition being received
+    silenceLength = (int)((kernel->spectrumLength / kernel->partitionSize + kernel->getNumPartitions() + 1) *
+                          kernel->inputPartitionSize);
+    // the input samples of the partitions the window overlaps
+    windowLength = (int)(((kernel->spectrumLength + kernel->partitionSize - 1) / kernel->partitionSize) *
+                         kernel->inputPartitionSize);
+    isInputSpectrumZero.resize(kernel->getNumPartitions());
+    clear();
+  }
+
+  int process(double* input, int numSamples, double*& output) override
+  {
+    auto const rate = (int)kernel->rate;
+    auto const inputPartitionSize = (int)kernel->inputPartitionSize;
+    auto queue = &outputQueue[0][0];
+    // discard the samples returned by the previous call
+    std::copy(queue + numOutputSamplesReturned, queue + numQueuedSamples, queue);
+    numQueuedSamples -= numOutputSamplesReturned;
+
+    auto const isInputSilent = isSilent(input, numSamples);
+    isStateSilent = isInputSilent && numSamplesToSilence == 0;
+    numSamplesToSilence = isInputSilent ? std::max(numSamplesToSilence - numSamples, 0) : silenceLength;
+
+    auto const partition = &window[0][kernel->spectrumLength - kernel->partitionSize];
+    int numConsumedSamples = 0;
+    while (numConsumedSamples < numSamples) {
+      auto const samplesToCopy = std::min(numSamples - numConsumedSamples, inputPartitionSize - numInputSamples);
+      if (isStateSilent) {
+        // the window is all zeros already
+      }
+      else if (kernel->isUpSampling) {
+        for (int i = 0; i < samplesToCopy; ++i) {
+          partition[(numInputSamples + i) * rate] = input[numConsumedSamples + i];
+        }
+      }
+      else {
+        std::copy(input + numConsumedSamples, input + numConsumedSamples + samplesToCopy, partition + numInputSamples);
+      }
+      numConsumedSamples += samplesToCopy;
+      numInputSamples += samplesToCopy;
+      numTrailingSilentSamples = isInputSilent ? numTrailingSilentSamples + samplesToCopy : 0;
+      if (numInputSamples == inputPartitionSize) {
+        processPartition();
+        numInputSamples = 0;
+      }
+    }
+    accumulatePastPartitions(numInputSamples);
+
+    int numOutputSamples = 0;
+    if (kernel->isUpSampling) {
+      numOutputSamples = numSamples * rate;
+    }
+    else {
+      numOutputSamples = (downSamplingPhase + numSamples) / rate;
+      downSamplingPhase = (downSamplingPhase + numSamples) % rate;
+    }
+    assert(numOutputSamples <= numQueuedSamples);
+    numOutputSamplesReturned = numOutputSamples;
+    output = queue;
+    return numOutputSamples;
+  }
+
+  void clear() override
+  {
+    window.fill(0.0);
+    inputSpectra.fill(0.0);
+    workBuffers.fill(0.0);
+    numInputSamples = 0;
+    downSamplingPhase = 0;
+    newestSpectrum = 0;
+    numPartitionsAccumulated = 1;
+    numOutputSamplesReturned = 0;
+    numSamplesToSilence = 0;
+    numTrailingSilentSamples = windowLength;
+    std::fill(isInputSpectrumZero.begin(), isInputSpectrumZero.end(), true);
+    isAccumulatorZero = true;
+    // the latency of the partition
+    numQueuedSamples = (int)kernel->outputPartitionSize;
+    std::fill_n(&outputQueue[0][0], numQueuedSamples, 0.0);
+  }
+
+  void prime() override
+  {
+    // the output queue starts with a partition of silence, so the output starts from the first call
+    clear();
+  }
+
+  int getInLenBeforeOutStart() const override
+  {
+    return (int)kernel->getLatency();
+  }
+
+  std::shared_ptr<PartitionedKernel const> const& getKernel() const
+  {
+    return kernel;
+  }
+
+  int getMaxOutLen(int maxInputLength) override
+  {
+    return getPartitionedMaxOutLen(kernel->isUpSampling, kernel->rate, maxInputLength);
+  }
+
+private:
+  void multiplyAccumulate(double const* inputSpectrum, double const* filterSpectrum)
+  {
+    isAccumulatorZero = false;
+    auto const accumulator = &workBuffers[0][0];
+    auto const product = &workBuffers[1][0];
+    kernel->fft->multiplyBlocks(inputSpectrum, filterSpectrum, product);
+    for (uint32_t i = 0; i < kernel->spectrumLength; ++i) {
+      accumulator[i] += product[i];
+    }
+  }
+
+  /**
+   * Accumulates the products of the spectra of the past input partitions with the partitions of the filter after the
+   * first, in proportion to the samples of the current input partition received so far.
+   */
+  void accumulatePastPartitions(int numReceivedInputSamples)
+  {
+    auto const numPartitions = (int)kernel->getNumPartitions();
+    auto const targetNumPartitions =
+      1 + ((numPartitions - 1) * numReceivedInputSamples + (int)kernel->inputPartitionSize - 1) /
+            (int)kernel->inputPartitionSize;
+    if (isStateSilent) {
+      numPartitionsAccumulated = std::max(numPartitionsAccumulated, std::min(targetNumPartitions, numPartitions));
+      return;
+    }
+    for (; numPartitionsAccumulated < std::min(targetNumPartitions, numPartitions); ++numPartitionsAccumulated) {
+      auto const k = numPartitionsAccumulated;
+      // the spectrum of the partition k partitions older than the one being received
+      auto const inputSpectrum = (newestSpectrum + numPartitions + 1 - k) % numPartitions;
+      if (!isInputSpectrumZero[inputSpectrum]) {
+        multiplyAccumulate(&inputSpectra[inputSpectrum][0], &kernel->spectra[k][0]);
+      }
+    }
+  }
+
+  void processPartition()
+  {
+    auto const numPartitions = (int)kernel->getNumPartitions();
+    auto const partitionSize = (int)kernel->partitionSize;
+    auto const spectrumLength = (int)kernel->spectrumLength;
+    accumulatePastPartitions((int)kernel->inputPartitionSize);
+
+    newestSpectrum = (newestSpectrum + 1) % numPartitions;
+    // the window holds no input sample that is not zero, so neither does the spectrum of the partition
+    auto const isWindowZero = numTrailingSilentSamples >= windowLength;
+    isInputSpectrumZero[newestSpectrum] = isStateSilent || isWindowZero;
+    if (isStateSilent || (isWindowZero && isAccumulatorZero)) {
+      // the spectrum of the partition and the accumulated spectrum are zeros, and so is the convolution
+      assert(numQueuedSamples + (int)kernel->outputPartitionSize <= (int)outputQueue.getNumSamples());
+      std::fill_n(&outputQueue[0][0] + numQueuedSamples, kernel->outputPartitionSize, 0.0);
+      numQueuedSamples += (int)kernel->outputPartitionSize;
+      numPartitionsAccumulated = 1;
+      return;
+    }
+    auto const windowSamples = &window[0][0];
+    if (!isWindowZero) {
+      auto const spectrum = &inputSpectra[newestSpectrum][0];
+      std::copy(windowSamples, windowSamples + spectrumLength, spectrum);
+      kernel->fft->forward(spectrum);
+      multiplyAccumulate(spectrum, &kernel->spectra[0][0]);
+    }
+
+    auto const accumulator = &workBuffers[0][0];
+    kernel->fft->inverse(accumulator);
+    auto const scale = kernel->fft->getInvMulConst();
+    auto const convolved = accumulator + spectrumLength - partitionSize;
+    auto const step = kernel->isUpSampling ? 1 : (int)kernel->rate;
+    auto queue = &outputQueue[0][0] + numQueuedSamples;
+    assert(numQueuedSamples + (int)kernel->outputPartitionSize <= (int)outputQueue.getNumSamples());
+    for (int i = 0; i < partitionSize; i += step) {
+      *queue++ = convolved[i] * scale;
+    }
+    numQueuedSamples += (int)kernel->outputPartitionSize;
+    std::fill_n(accumulator, spectrumLength, 0.0);
+    isAccumulatorZero = true;
+    numPartitionsAccumulated = 1;
+
+    // shift the window by a partition, the up-samplers rely on the new partition being cleared
+    if (!isWindowZero) {
+      std::copy(windowSamples + partitionSize, windowSamples + spectrumLength, windowSamples);
+      std::fill(windowSamples + spectrumLength - partitionSize, windowSamples + spectrumLength, 0.0);
+    }
+  }
+
+  std::shared_ptr<PartitionedKernel const> kernel;
+  // the last fft length samples of the input at the convolution rate, ending with the partition being received
+  Buffer<double> window;
+  // the spectra of the last numPartitions partitions of the input, newestSpectrum being the last one
+  Buffer<double> inputSpectra;
+  // the accumulated spectrum of the output, and the product being added to it
+  Buffer<double> workBuffers;
+  Buffer<double> outputQueue;
+  int numInputSamples = 0;
+  int downSamplingPhase = 0;
+  int newestSpectrum = 0;
+  int numPartitionsAccumulated = 1;
+  int numQueuedSamples = 0;
+  int numOutputSamplesReturned = 0;
+  // the number of silent input samples after which the state is all zeros, the number of silent input samples still
+  // needed, and whether the state and the input of the current call are all zeros
+  int silenceLength = 0;
+  int numSamplesToSilence = 0;
+  bool isStateSilent = false;
+  // the number of input samples held by the window, and the number of silent input samples received last, so that
+  // the window is all zeros if there are at least as many as it holds
+  int windowLength = 0;
+  int numTrailingSilentSamples = 0;
+  // whether the spectrum of each past partition is all zeros, in which case it is not computed nor multiplied
+  std::vector<bool> isInputSpectrumZero;
+  // whether no product has been accumulated since the last partition
+  bool isAccumulatorZero = true;
+};
+
+/**
+ * The maximum number of samples produced by an r8brain resampler for one fft block of input, for each rate, transition
+ * band and fft block size, shared by the whole process. r8brain only exposes it through a resampler, so a resampler
+ * is built the first time a setting is queried, and never again.
+ */
+class R8brainMaxOutLenCache final
+{
+public:
+  int get(double oversamplingRate, double transitionBand, uint32_t fftSamplesPerBlock)
+  {
+    auto const key = std::make_tuple(oversamplingRate, transitionBand, fftSamplesPerBlock);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto const it = maxOutLens.find(key);
+    if (it != maxOutLens.end()) {
+      return it->second;
+    }
+    r8b::CDSPResampler24 reSampler(1.0, oversamplingRate, (int)fftSamplesPerBlock, transitionBand);
+    auto const maxOutLen = reSampler.getMaxOutLen((int)fftSamplesPerBlock);
+    maxOutLens.emplace(key, maxOutLen);
+    return maxOutLen;
+  }
+
+private:
+  std::mutex mutex;
+  std::map<std::tuple<double, double, uint32_t>, int> maxOutLens;
+};
+
+R8brainMaxOutLenCache r8brainMaxOutLenCache;
+
+/**
+ * @return the maximum number of samples produced by a processBlock call with at most maxInputLength samples, which
+ * are processed fftSamplesPerBlock samples at a time, each producing at most maxFftBlockOutputLength samples.
+ */
+uint32_t getMaxOutputLength(uint32_t maxInputLength, uint32_t fftSamplesPerBlock, uint32_t maxFftBlockOutputLength)
+{
+  auto const numFftBlocks = maxInputLength / fftSamplesPerBlock + (maxInputLength % fftSamplesPerBlock > 0 ? 1 : 0);
+  return numFftBlocks * maxFftBlockOutputLength;
+}
+
+} // namespace
+
+template<typename Float>
+double* ReSamplerBase::getDoubleInput(Float const* channel, uint32_t samplesToProcess, uint32_t channelIndex)
+{
+  if constexpr (std::is_same_v<Float, double>) {
+    return const_cast<double*>(channel);
+  }
+  else {
+    auto const numConversionChannels = conversionBuffer.getNumChannels();
+    assert(numConversionChannels == 1 || numConversionChannels > channelIndex);
+    assert(conversionBuffer.getNumSamples() >= samplesToProcess);
+    auto const doubleInput = conversionBuffer.get()[numConversionChannels == 1 ? 0 : channelIndex];
+    OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firInputConversion, samplesToProcess);
+    std::copy(channel, channel + samplesToProcess, doubleInput);
+    return doubleInput;
+  }
+}
+
+template<typename Float>
+uint32_t UpSampler::upSample(Float* const* input, uint32_t numSamples, Buffer<Float>& output)
 {
   assert(output.getNumChannels() == numChannels);
   assert(output.getCapacity() >= maxOutputLength);
   output.setNumSamples(maxOutputLength);
 
   uint32_t totalUpSampledSamples = 0;
-  for (uint32_t c = 0; c < numChannels; ++c) {
+  auto upSampleChannel = [&](uint32_t c) {
     double* outPtr;
     int numInputSamples = (int)numSamples;
     int inputCounter = 0;
     int outputCounter = 0;
     while (numInputSamples > 0) {
       int samplesToProcess = std::min(numInputSamples, (int)fftSamplesPerBlock);
-      int numUpSampledSamples = reSamplers[c]->process(&input[c][inputCounter], (int)samplesToProcess, outPtr);
+      auto const doubleInput = getDoubleInput(&input[c][inputCounter], samplesToProcess, c);
+      int numUpSampledSamples = 0;
+      {
+        OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firUpSampling, samplesToProcess);
+        numUpSampledSamples = reSamplers[c]->process(doubleInput, (int)samplesToProcess, outPtr);
+      }
       inputCounter += samplesToProcess;
       numInputSamples -= (int)samplesToProcess;
       if (numUpSampledSamples > 0) {
         auto const totUpSampledSamples = outputCounter + numUpSampledSamples;
         assert(output.getNumSamples() >= totUpSampledSamples);
+        OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firOutputConversion, numUpSampledSamples);
         std::copy(outPtr, outPtr + numUpSampledSamples, &output[c][outputCounter]);
         outputCounter += numUpSampledSamples;
       }
     }
-    totalUpSampledSamples = outputCounter;
-  }
+    if (c == 0) {
+      totalUpSampledSamples = outputCounter;
+    }
+  };
+  forEachChannel(upSampleChannel);
   output.setNumSamples(totalUpSampledSamples);
   return totalUpSampledSamples;
 }
 
-void DownSampler::processBlock(double* const* input, uint32_t numSamples, double** output, uint32_t requiredSamples)
+template<typename Float>
+void DownSampler::downSample(Float* const* input, uint32_t numSamples, Float** output, uint32_t requiredSamples)
 {
+  int const bufferSize = (int)buffer.getNumSamples();
+  assert(bufferSize > 0);
+  // the channels are processed independently, and all of them update the buffer state in the same way, so it is
+  // committed after they all have been processed, using the values computed for the first channel.
   int newBufferCounter = bufferCounter;
+  int newBufferStart = bufferStart;
   if (numSamples <= fftSamplesPerBlock) {
-    for (uint32_t c = 0; c < numChannels; ++c) {
+    auto downSampleChannel = [&](uint32_t c) {
       double* outPtr;
-      int const numUpSampledSamples = reSamplers[c]->process(const_cast<double*>(&input[c][0]), numSamples, outPtr);
-      int diff = (int)requiredSamples - numUpSampledSamples - bufferCounter;
-      if (diff >= 0) {
-        std::fill_n(&output[c][0], diff, 0.0);
-        std::copy(&buffer[c][0], &buffer[c][0] + bufferCounter, &output[c][diff]);
-        std::copy(outPtr, outPtr + numUpSampledSamples, &output[c][diff + bufferCounter]);
-        newBufferCounter = 0;
+      auto const doubleInput = getDoubleInput(&input[c][0], numSamples, c);
+      int numUpSampledSamples = 0;
+      {
+        OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firDownSampling, numSamples);
+        numUpSampledSamples = reSamplers[c]->process(doubleInput, numSamples, outPtr);
       }
-      else { // diff < 0
-        int const samplesFromBuffer = std::min(bufferCounter, (int)requiredSamples);
-        std::copy(&buffer[c][0], &buffer[c][0] + samplesFromBuffer, &output[c][0]);
-        std::copy(&buffer[c][0] + samplesFromBuffer, &buffer[c][0] + bufferCounter, &buffer[c][0]);
-        newBufferCounter = bufferCounter - samplesFromBuffer;
-        int const wantedSamplesFromReSampler = (int)requiredSamples - samplesFromBuffer;
-        int const samplesFromReSampler = std::min(wantedSamplesFromReSampler, numUpSampledSamples);
-        std::copy(outPtr, outPtr + samplesFromReSampler, &output[c][samplesFromBuffer]);
-        // check buffer size
-        auto const neededBufferSize = (uint32_t)(newBufferCounter + numUpSampledSamples - samplesFromReSampler);
-        assert(buffer.getCapacity() >= neededBufferSize);
-        if (buffer.getNumSamples() < neededBufferSize) {
-          buffer.setNumSamples(neededBufferSize);
-        }
-        // copy tail to buffer
-        std::copy(outPtr + samplesFromReSampler, outPtr + numUpSampledSamples, &buffer[c][newBufferCounter]);
+      OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firOutputBuffering, requiredSamples);
+      // the oldest samples come from the buffer, then from the resampler, and if they are not enough, the output is
+      // padded with zeros at the beginning
+      int const samplesFromBuffer = std::min(bufferCounter, (int)requiredSamples);
+      int const samplesFromReSampler = std::min((int)requiredSamples - samplesFromBuffer, numUpSampledSamples);
+      int const numZeros = (int)requiredSamples - samplesFromBuffer - samplesFromReSampler;
+      std::fill_n(&output[c][0], numZeros, (Float)0.0);
+      readFromCircularBuffer(&buffer[c][0], bufferSize, bufferStart, &output[c][numZeros], samplesFromBuffer);
+      std::copy(outPtr, outPtr + samplesFromReSampler, &output[c][numZeros + samplesFromBuffer]);
+      int const channelBufferCounter = bufferCounter - samplesFromBuffer;
+      int const channelBufferStart = (bufferStart + samplesFromBuffer) % bufferSize;
+      // store the tail in the buffer
+      int const samplesToBuffer = numUpSampledSamples - samplesFromReSampler;
+      assert(channelBufferCounter + samplesToBuffer <= bufferSize);
+      writeToCircularBuffer(&buffer[c][0],
+                            bufferSize,
+                            (channelBufferStart + channelBufferCounter) % bufferSize,
+                            outPtr + samplesFromReSampler,
+                            samplesToBuffer);
+      if (c == 0) {
+        newBufferCounter = channelBufferCounter + samplesToBuffer;
+        newBufferStart = channelBufferStart;
       }
-    }
-    bufferCounter = newBufferCounter;
+    };
+    forEachChannel(downSampleChannel);
   }
   else { // numSamples > fftSamplesPerBlock
-    for (uint32_t c = 0; c < numChannels; ++c) {
+    auto downSampleChannel = [&](uint32_t c) {
       int inputCounter = 0;
-      int outputCounter = 0;
+      int numBufferedSamples = bufferCounter;
       int numInputSamples = (int)numSamples;
       while (numInputSamples > 0) {
         int samplesToProcess = std::min(numInputSamples, (int)fftSamplesPerBlock);
         double* outPtr;
-        int const numUpSampledSamples =
-          reSamplers[c]->process(const_cast<double*>(&input[c][inputCounter]), samplesToProcess, outPtr);
+        auto const doubleInput = getDoubleInput(&input[c][inputCounter], samplesToProcess, c);
+        int numUpSampledSamples = 0;
+        {
+          OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firDownSampling, samplesToProcess);
+          numUpSampledSamples = reSamplers[c]->process(doubleInput, samplesToProcess, outPtr);
+        }
         inputCounter += samplesToProcess;
         numInputSamples -= samplesToProcess;
-        auto const neededBufferSize = (uint32_t)(bufferCounter + outputCounter + numUpSampledSamples);
-        assert(buffer.getCapacity() >= neededBufferSize);
-        if (buffer.getNumSamples() < neededBufferSize) {
-          buffer.setNumSamples(neededBufferSize);
-        }
-        if (numUpSampledSamples > 0) {
-          std::copy(outPtr, outPtr + numUpSampledSamples, &buffer[c][bufferCounter + outputCounter]);
-          outputCounter += numUpSampledSamples;
-        }
+        assert(numBufferedSamples + numUpSampledSamples <= bufferSize);
+        OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firOutputBuffering, numUpSampledSamples);
+        writeToCircularBuffer(&buffer[c][0],
+                              bufferSize,
+                              (bufferStart + numBufferedSamples) % bufferSize,
+                              outPtr,
+                              numUpSampledSamples);
+        numBufferedSamples += numUpSampledSamples;
       }
-      newBufferCounter = outputCounter + bufferCounter;
-    }
-    bufferCounter = newBufferCounter;
-
-    int diff = (int)requiredSamples - bufferCounter;
-    if (diff >= 0) {
-      for (uint32_t c = 0; c < numChannels; ++c) {
-        std::fill_n(&output[c][0], diff, 0.0);
-        std::copy(&buffer[c][0], &buffer[c][0] + bufferCounter, &output[c][diff]);
+      OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::firOutputBuffering, requiredSamples);
+      int const samplesFromBuffer = std::min(numBufferedSamples, (int)requiredSamples);
+      int const numZeros = (int)requiredSamples - samplesFromBuffer;
+      std::fill_n(&output[c][0], numZeros, (Float)0.0);
+      readFromCircularBuffer(&buffer[c][0], bufferSize, bufferStart, &output[c][numZeros], samplesFromBuffer);
+      if (c == 0) {
+        newBufferCounter = numBufferedSamples - samplesFromBuffer;
+        newBufferStart = (bufferStart + samplesFromBuffer) % bufferSize;
       }
-      bufferCounter = 0;
-    }
-    else { // diff < 0
-      for (uint32_t c = 0; c < numChannels; ++c) {
-        std::copy(&buffer[c][0], &buffer[c][0] + requiredSamples, &output[c][0]);
-        std::copy(&buffer[c][0] + requiredSamples, &buffer[c][0] + bufferCounter, &buffer[c][0]);
-      }
-    }
+    };
+    forEachChannel(downSampleChannel);
   }
+  bufferCounter = newBufferCounter;
+  bufferStart = newBufferStart;
 }
 
 void DownSampler::processBlock(Buffer<double> const& input, double** output, uint32_t requiredSamples)
@@ -149,37 +717,84 @@ void DownSampler::processBlock(Buffer<double> const& input, double** output, uin
 
 void ReSamplerBase::setup()
 {
-  reSamplers.clear();
+  // r8brain keeps process-wide caches of the filter kernels and of the fft objects, so resamplers with the same
+  // settings already share them, and each resampler only allocates its own state. The resamplers are rebuilt only if
+  // their settings changed, otherwise only the ones for new channels are created.
+  // The uniformly partitioned resamplers share the spectra of the filter, which are computed again only if the
+  // settings or the partition block size changed.
+  assert(engine != Engine::halfBand);
+  bool const isReSamplerSetupChanged = reSamplersOversamplingRate != oversamplingRate ||
+                                       reSamplersTransitionBand != transitionBand ||
+                                       reSamplersFftSamplesPerBlock != fftSamplesPerBlock ||
+                                       reSamplersEngine != engine || isPartitionBlockSizeChanged();
+  if (isReSamplerSetupChanged) {
+    reSamplers.clear();
+    reSamplersOversamplingRate = oversamplingRate;
+    reSamplersTransitionBand = transitionBand;
+    reSamplersFftSamplesPerBlock = fftSamplesPerBlock;
+    reSamplersPartitionBlockSize = getPartitionBlockSize();
+    reSamplersEngine = engine;
+  }
+  else if (reSamplers.size() > numChannels) {
+    reSamplers.resize(numChannels);
+  }
 
-  for (uint32_t c = 0; c < numChannels; ++c) {
-    reSamplers.push_back(
-      std::make_unique<r8b::CDSPResampler24>(1.0, oversamplingRate, fftSamplesPerBlock, transitionBand));
+  std::shared_ptr<PartitionedKernel const> partitionedKernel;
+  for (auto c = (uint32_t)reSamplers.size(); c < numChannels; ++c) {
+    if (engine == Engine::uniformPartitioned) {
+      if (!partitionedKernel) {
+        partitionedKernel = c > 0 ? static_cast<PartitionedReSampler&>(*reSamplers[0]).getKernel()
+                                  : std::make_shared<PartitionedKernel const>(
+                                      oversamplingRate, transitionBand, reSamplersPartitionBlockSize);
+      }
+      reSamplers.push_back(std::make_unique<PartitionedReSampler>(partitionedKernel));
+    }
+    else {
+      reSamplers.push_back(std::make_unique<R8brainReSampler>(oversamplingRate, fftSamplesPerBlock, transitionBand));
+    }
   }
 }
 
 ReSamplerBase::ReSamplerBase(uint32_t numChannels,
                              double transitionBand,
                              uint32_t fftSamplesPerBlock,
-                             double oversamplingRate)
+                             double oversamplingRate,
+                             Engine engine)
   : numChannels(numChannels)
   , fftSamplesPerBlock(fftSamplesPerBlock)
   , maxInputLength(fftSamplesPerBlock)
   , transitionBand(transitionBand)
   , oversamplingRate(oversamplingRate)
+  , engine(engine)
 {}
 
 DownSampler::DownSampler(uint32_t numChannels,
                          double transitionBand,
                          uint32_t fftSamplesPerBlock,
-                         double oversamplingRate)
-  : ReSamplerBase(numChannels, transitionBand, fftSamplesPerBlock, 1.f / oversamplingRate)
+                         double oversamplingRate,
+                         Engine engine)
+  : ReSamplerBase(numChannels, transitionBand, fftSamplesPerBlock, 1.f / oversamplingRate, engine)
   , maxRequiredOutputLength(fftSamplesPerBlock)
 {
   DownSampler::setup();
 }
 
-UpSampler::UpSampler(uint32_t numChannels, double transitionBand, uint32_t fftSamplesPerBlock, double oversamplingRate)
-  : ReSamplerBase(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate)
+UpSampler::UpSampler(uint32_t numChannels,
+                     double transitionBand,
+                     uint32_t fftSamplesPerBlock,
+                     double oversamplingRate,
+                     Engine engine)
+  : UpSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate, true, engine)
+{}
+
+UpSampler::UpSampler(uint32_t numChannels,
+                     double transitionBand,
+                     uint32_t fftSamplesPerBlock,
+                     double oversamplingRate,
+                     bool useDoubleOutput,
+                     Engine engine)
+  : ReSamplerBase(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate, engine)
+  , useDoubleOutput(useDoubleOutput)
 {
   UpSampler::setup();
 }
@@ -202,6 +817,12 @@ void ReSamplerBase::setTransitionBand(double value)
   setup();
 }
 
+void ReSamplerBase::setEngine(Engine value)
+{
+  engine = value;
+  setup();
+}
+
 void ReSamplerBase::resetBase()
 {
   for (auto& reSampler : reSamplers) {
@@ -209,23 +830,80 @@ void ReSamplerBase::resetBase()
   }
 }
 
+void ReSamplerBase::primeBase()
+{
+  auto primeChannel = [&](uint32_t c) { reSamplers[c]->prime(); };
+  forEachChannel(primeChannel);
+}
+
+void ReSamplerBase::setExecutor(TaskExecutor* value)
+{
+  executor = value;
+  // only the single precision processors have a conversion buffer, which depends on the executor
+  if (conversionBuffer.getNumChannels() > 0) {
+    prepareConversionBuffer();
+  }
+}
+
+void ReSamplerBase::prepareConversionBuffer()
+{
+  conversionBuffer.setNumChannels(executor ? std::max(numChannels, 1u) : 1);
+  conversionBuffer.setNumSamples(fftSamplesPerBlock);
+}
+
+uint32_t ReSamplerBase::getPartitionBlockSize() const
+{
+  return std::max(std::min(maxInputLength, fftSamplesPerBlock), 1u);
+}
+
+uint32_t DownSampler::getPartitionBlockSize() const
+{
+  auto const rate = (uint32_t)std::lround(1.0 / oversamplingRate);
+  return std::max(std::min(maxRequiredOutputLength, fftSamplesPerBlock / rate), 1u);
+}
+
+bool ReSamplerBase::isPartitionBlockSizeChanged() const
+{
+  return engine == Engine::uniformPartitioned && reSamplersPartitionBlockSize != getPartitionBlockSize();
+}
+
 void ReSamplerBase::prepareBuffersBase(uint32_t numSamples)
 {
   maxInputLength = numSamples;
-  auto const quot = maxInputLength / fftSamplesPerBlock;
-  auto const rem = maxInputLength % fftSamplesPerBlock;
   if (!reSamplers.empty()) {
     auto const maxReSamplerOutputLength = (uint32_t)reSamplers[0]->getMaxOutLen((int)fftSamplesPerBlock);
-    maxOutputLength = (quot + (rem > 0 ? 1 : 0)) * maxReSamplerOutputLength;
+    maxOutputLength = getMaxOutputLength(maxInputLength, fftSamplesPerBlock, maxReSamplerOutputLength);
   }
   else {
     maxOutputLength = fftSamplesPerBlock * oversamplingRate;
   }
 }
 
+uint32_t ReSamplerBase::computeMaxNumOutputSamples(Engine engine,
+                                                   double oversamplingRate,
+                                                   double transitionBand,
+                                                   uint32_t fftSamplesPerBlock,
+                                                   uint32_t maxInputLength)
+{
+  auto const isUpSampling = oversamplingRate >= 1.0;
+  auto const rate = (uint32_t)std::lround(isUpSampling ? oversamplingRate : 1.0 / oversamplingRate);
+  auto const maxFftBlockOutputLength =
+    engine == Engine::uniformPartitioned
+      ? getPartitionedMaxOutLen(isUpSampling, rate, (int)fftSamplesPerBlock)
+      : r8brainMaxOutLenCache.get(oversamplingRate, transitionBand, fftSamplesPerBlock);
+  return getMaxOutputLength(maxInputLength, fftSamplesPerBlock, (uint32_t)maxFftBlockOutputLength);
+}
+
 void DownSampler::prepareBuffers(uint32_t numInputSamples, uint32_t requiredOutputSamples)
 {
   prepareBuffersBase(numInputSamples);
+  maxRequiredOutputLength = requiredOutputSamples;
+  if (isPartitionBlockSizeChanged()) {
+    // the partitions follow the number of output samples of each call: setup builds them again, and prepares the
+    // buffers for them
+    setup();
+    return;
+  }
   updateBuffer(requiredOutputSamples);
 }
 
@@ -234,6 +912,13 @@ void DownSampler::updateBuffer(uint32_t requiredOutputSamples)
   maxRequiredOutputLength = requiredOutputSamples;
   auto const neededBufferSize = maxOutputLength + std::max(maxOutputLength, requiredOutputSamples);
   if (buffer.getNumSamples() < neededBufferSize) {
+    // move the buffered samples to the beginning of the circular buffer, so that they stay contiguous after resizing it
+    if (bufferStart > 0) {
+      for (uint32_t c = 0; c < numChannels; ++c) {
+        std::rotate(&buffer[c][0], &buffer[c][0] + bufferStart, &buffer[c][0] + buffer.getNumSamples());
+      }
+      bufferStart = 0;
+    }
     buffer.setNumSamples(neededBufferSize);
   }
 }
@@ -242,6 +927,7 @@ void DownSampler::prepareBuffersAndSetFftBlockSize(uint32_t numInputSamples,
                                                    uint32_t fftBlockSize)
 {
   maxInputLength = numInputSamples;
+  maxRequiredOutputLength = requiredOutputSamples;
   setFftSamplesPerBlock(fftBlockSize);
   updateBuffer(requiredOutputSamples);
 }
@@ -249,7 +935,8 @@ void DownSampler::prepareBuffersAndSetFftBlockSize(uint32_t numInputSamples,
 void UpSampler::setup()
 {
   ReSamplerBase::setup();
-  output.setNumChannels(numChannels);
+  output.setNumChannels(useDoubleOutput ? numChannels : 0);
+  outputView.assign(numChannels, nullptr);
   prepareBuffers(maxInputLength);
   reset();
 }
@@ -264,20 +951,27 @@ void DownSampler::setup()
   reset();
 }
 
-uint32_t ReSamplerBase::getNumSamplesBeforeOutputStarts()
+uint32_t ReSamplerBase::getNumSamplesBeforeOutputStarts() const
 {
   if (reSamplers.empty()) {
     assert(false);
     return 0;
   }
-  reSamplers[0]->clear();
   return reSamplers[0]->getInLenBeforeOutStart();
 }
 
 void UpSampler::prepareBuffers(uint32_t numSamples)
 {
   prepareBuffersBase(numSamples);
-  output.setNumSamples(maxOutputLength);
+  if (isPartitionBlockSizeChanged()) {
+    // the partitions follow the number of samples of each call: setup builds them again, and prepares the buffers for
+    // them
+    setup();
+    return;
+  }
+  if (useDoubleOutput) {
+    output.setNumSamples(maxOutputLength);
+  }
 }
 
 void UpSampler::prepareBuffersAndSetFftBlockSize(uint32_t numSamples, uint32_t fftBlockSize)
@@ -286,4 +980,15 @@ void UpSampler::prepareBuffersAndSetFftBlockSize(uint32_t numSamples, uint32_t f
   setFftSamplesPerBlock(fftBlockSize);
 }
 
+template uint32_t UpSampler::upSample(float* const* input, uint32_t numSamples, Buffer<float>& output);
+template uint32_t UpSampler::upSample(double* const* input, uint32_t numSamples, Buffer<double>& output);
+template void DownSampler::downSample(float* const* input,
+                                      uint32_t numSamples,
+                                      float** output,
+                                      uint32_t requiredSamples);
+template void DownSampler::downSample(double* const* input,
+                                      uint32_t numSamples,
+                                      double** output,
+                                      uint32_t requiredSamples);
+
 } // namespace oversimple::fir
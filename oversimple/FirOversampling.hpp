@@ -31,9 +31,82 @@ limitations under the License.
 #endif
 
 #include "avec/Avec.hpp"
+#include "oversimple/Instrumentation.hpp"
+#include "oversimple/TaskExecutor.hpp"
 
 namespace oversimple::fir {
 
+/**
+ * The engine used by the FIR re-samplers to convolve each channel with the antialiasing filter.
+ */
+enum class Engine
+{
+  /**
+   * The r8brain resamplers. Each fft call processes fftSamplesPerBlock samples, and the call that completes a block does
+   * all of its work, so the cost of the processing calls is bursty if they are shorter than the block.
+   */
+  r8brain,
+  /**
+   * A uniformly partitioned overlap-save convolution. The partitions are as long as the processing calls passed to
+   * prepareBuffers, at the lower of the two rates, capped by fftSamplesPerBlock, and they are also the latency added by
+   * the engine, so it adds one call of latency. The filter is split in partitions of the same length, and the products
+   * of the spectra of the past partitions are spread across the calls that fill the next one, so that the call that
+   * completes a partition only computes two ffts and one product. When the calls are as long as the partitions, each
+   * of them completes exactly one partition and does the same work; shorter calls complete at most one.
+   */
+  uniformPartitioned,
+  /**
+   * The linear phase half-band filters of HalfBandUpSampler and HalfBandDownSampler, which re-sample by powers of two
+   * with a latency of a whole number of samples and no fft blocks, and ignore the transition band and the fft block
+   * size. They are not single channel convolutions, so the re-samplers of this file do not support it: it is selected
+   * through the settings of TOversampling and of the classes built on it, which use them instead.
+   */
+  halfBand
+};
+
+namespace detail {
+
+/**
+ * The interface of the single channel re-samplers used by ReSamplerBase: the part of the interface of the r8brain
+ * resamplers that ReSamplerBase uses.
+ */
+class ChannelReSampler
+{
+public:
+  /**
+   * Re-samples numSamples samples.
+   * @param output set to point to the re-sampled samples, which are valid until the next call.
+   * @return the number of re-sampled samples.
+   */
+  virtual int process(double* input, int numSamples, double*& output) = 0;
+
+  /**
+   * Clears the state of the re-sampler.
+   */
+  virtual void clear() = 0;
+
+  /**
+   * Clears the state of the re-sampler and brings it where it would be after processing silence until its output
+   * started, so that it produces output from the first call.
+   */
+  virtual void prime() = 0;
+
+  /**
+   * @return the number of input samples after which the output corresponding to the first input sample is produced.
+   * It does not depend on, nor change, the state of the re-sampler.
+   */
+  virtual int getInLenBeforeOutStart() const = 0;
+
+  /**
+   * @return the maximum number of samples produced by a call to process with maxInputLength samples.
+   */
+  virtual int getMaxOutLen(int maxInputLength) = 0;
+
+  virtual ~ChannelReSampler() = default;
+};
+
+} // namespace detail
+
 /**
  * Base class for FIR ReSamplers, implementing getters, setters, filters and buffers management.
  */
@@ -85,11 +158,25 @@ public:
     return transitionBand;
   }
 
+  /**
+   * Sets the engine used to convolve each channel with the antialiasing filter.
+   * @param value the new engine
+   */
+  void setEngine(Engine value);
+
+  /**
+   * @return the engine used to convolve each channel with the antialiasing filter.
+   */
+  Engine getEngine() const
+  {
+    return engine;
+  }
+
   /**
    * @return the number of input samples needed before a first output sample is
-   * produced.
+   * produced. It does not change the state of the processor.
    */
-  uint32_t getNumSamplesBeforeOutputStarts();
+  uint32_t getNumSamplesBeforeOutputStarts() const;
 
   /**
    * @return the maximum number of samples that can be produced by a
@@ -101,24 +188,141 @@ public:
     return maxOutputLength;
   }
 
+  /**
+   * Computes the value getMaxNumOutputSamples would return for a re-sampler with the supplied settings, after
+   * prepareBuffers(maxInputLength), without building it. The uniformly partitioned engine computes it from the
+   * settings. r8brain only exposes it through a resampler, so for each rate, transition band and fft block size a
+   * single channel r8brain resampler is built the first time it is queried, and the result is kept in a process-wide
+   * cache, so it allocates at most once for each setting, and should not be called from the audio thread.
+   * @param engine the engine used to convolve each channel with the antialiasing filter
+   * @param oversamplingRate the ratio between the output and the input rates, less than one for a down-sampler
+   * @param transitionBand the antialiasing filter transition band, in percentage of the sample rate
+   * @param fftSamplesPerBlock the number of samples processed by each fft call
+   * @param maxInputLength the maximum number of samples passed to each processBlock call
+   * @return the maximum number of samples produced by a processBlock call
+   */
+  static uint32_t computeMaxNumOutputSamples(Engine engine,
+                                             double oversamplingRate,
+                                             double transitionBand,
+                                             uint32_t fftSamplesPerBlock,
+                                             uint32_t maxInputLength);
+
+  /**
+   * Sets the executor used to process the channels in parallel. Each channel has its own resampler, so the channels
+   * are independent and can be processed by different threads.
+   * @param value the executor to use, or nullptr to process the channels serially on the calling thread. It must
+   * outlive its use by the processor.
+   */
+  void setExecutor(TaskExecutor* value);
+
+  /**
+   * @return the executor used to process the channels in parallel, or nullptr if they are processed serially.
+   */
+  TaskExecutor* getExecutor() const
+  {
+    return executor;
+  }
+
+  /**
+   * Sets the Instrumentation that collects the time spent in the convolutions, in the conversions to and from double
+   * precision, and in the buffering of the output. Only has an effect if OVERSIMPLE_INSTRUMENTATION is 1.
+   * @param value the Instrumentation to use, or nullptr to not collect anything. It must outlive its use by the
+   * processor.
+   */
+  void setInstrumentation(Instrumentation* value)
+  {
+    instrumentation = value;
+  }
+
+  /**
+   * @return the Instrumentation that collects the time spent by the processor, or nullptr if there is none
+   */
+  Instrumentation* getInstrumentation() const
+  {
+    return instrumentation;
+  }
+
   virtual ~ReSamplerBase() = default;
 
 protected:
-  ReSamplerBase(uint32_t numChannels, double transitionBand, uint32_t fftSamplesPerBlock, double oversamplingRate);
+  ReSamplerBase(uint32_t numChannels,
+                double transitionBand,
+                uint32_t fftSamplesPerBlock,
+                double oversamplingRate,
+                Engine engine);
 
   virtual void setup();
 
   void prepareBuffersBase(uint32_t numSamples);
 
+  /**
+   * @return the number of samples, at the lower of the two rates, of each partition of the uniformly partitioned
+   * engine: the number of samples of each call at that rate, capped by fftSamplesPerBlock.
+   */
+  virtual uint32_t getPartitionBlockSize() const;
+
+  /**
+   * @return true if the uniformly partitioned re-samplers were built for a partition block size different from the
+   * current one, in which case they need to be set up again.
+   */
+  bool isPartitionBlockSizeChanged() const;
+
   void resetBase();
 
+  void primeBase();
+
+  /**
+   * Allocates the buffer used to convert to double precision one fft block of single precision input at a time. Only
+   * the single precision processors need it. It has a single channel, or one channel for each channel if an executor
+   * is set, as the channels can then be converted concurrently.
+   */
+  void prepareConversionBuffer();
+
+  /**
+   * @return a pointer to samplesToProcess samples of the channel, in double precision. If Float is float, the samples
+   * are converted into the conversion buffer, which must have been prepared.
+   * @param channelIndex the index of the channel, used to pick its conversion buffer if the channels have one each.
+   */
+  template<typename Float>
+  double* getDoubleInput(Float const* channel, uint32_t samplesToProcess, uint32_t channelIndex);
+
+  /**
+   * Calls task(c) for each channel c, using the executor if there is one.
+   */
+  template<class ChannelTask>
+  void forEachChannel(ChannelTask& task)
+  {
+    if (executor && numChannels > 1) {
+      executor->run(
+        numChannels,
+        [](void* context, uint32_t channel) { (*static_cast<ChannelTask*>(context))(channel); },
+        &task);
+    }
+    else {
+      for (uint32_t c = 0; c < numChannels; ++c) {
+        task(c);
+      }
+    }
+  }
+
   double oversamplingRate = 1.0;
   uint32_t numChannels;
   uint32_t fftSamplesPerBlock = 1024;
   double transitionBand = 4.0;
-  std::vector<std::unique_ptr<r8b::CDSPResampler24>> reSamplers;
+  Engine engine = Engine::r8brain;
+  std::vector<std::unique_ptr<detail::ChannelReSampler>> reSamplers;
   uint32_t maxOutputLength = 0;
   uint32_t maxInputLength = 256;
+  Buffer<double> conversionBuffer;
+  TaskExecutor* executor = nullptr;
+  Instrumentation* instrumentation = nullptr;
+
+private:
+  double reSamplersOversamplingRate = 0.0;
+  double reSamplersTransitionBand = 0.0;
+  uint32_t reSamplersFftSamplesPerBlock = 0;
+  uint32_t reSamplersPartitionBlockSize = 0;
+  Engine reSamplersEngine = Engine::r8brain;
 };
 
 /**
@@ -139,11 +343,13 @@ public:
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
    * @param oversamplingRate the oversampling factor
+   * @param engine the engine used to convolve each channel with the antialiasing filter
    */
   explicit UpSampler(uint32_t numChannels,
                      double transitionBand = 4.0,
                      uint32_t fftSamplesPerBlock = 256,
-                     double oversamplingRate = 1.0);
+                     double oversamplingRate = 1.0,
+                     Engine engine = Engine::r8brain);
 
   /**
    * Up-samples a multi channel input buffer.
@@ -161,6 +367,30 @@ public:
    */
   uint32_t processBlock(Buffer<double> const& input);
 
+  /**
+   * Up-samples a multi channel input buffer without copying the output of the
+   * r8brain resamplers: if numSamples is not greater than the number of samples
+   * processed by each fft call, the output view will point directly to the
+   * memory of the resamplers, otherwise the output is copied to the output
+   * buffer as in processBlock, and the output view points to it.
+   * @param input pointer to the input buffer.
+   * @param numSamples the number of samples of each channel of the input
+   * buffer.
+   * @return number of up-sampled samples
+   * @see getOutputView
+   */
+  uint32_t processBlockWithoutCopy(double* const* input, uint32_t numSamples);
+
+  /**
+   * @return pointers to each channel of the output of the last call to
+   * processBlockWithoutCopy. They are only valid until the next processing or
+   * reset call.
+   */
+  double* const* getOutputView() const
+  {
+    return outputView.data();
+  }
+
   Buffer<double>& getOutputBuffer()
   {
     return output;
@@ -214,16 +444,61 @@ public:
     resetBase();
   }
 
+  /**
+   * Resets the state of the processor and primes the antialiasing filters with silence, so that the output starts
+   * from the first call and each call produces the samples corresponding to its input, delayed by the latency, instead
+   * of nothing until getNumSamplesBeforeOutputStarts samples have been processed. Only the filters process the
+   * silence, and only when the engine needs it: the uniformly partitioned engine is primed by clearing it.
+   */
+  void prime()
+  {
+    primeBase();
+  }
+
 protected:
+  /**
+   * Constructor for derived classes that store the up-sampled samples in a buffer of their own, in which case the
+   * double precision output buffer is never allocated.
+   * @param numChannels the number of channels the processor will be ready to
+   * work with.
+   * @param transitionBand value the antialiasing filter transition band, in
+   * percentage of the sample rate.
+   * @param fftSamplesPerBlock the number of samples that will be processed
+   * by each fft call.
+   * @param oversamplingRate the oversampling factor
+   * @param useDoubleOutput false if the derived class stores the output itself
+   * @param engine the engine used to convolve each channel with the antialiasing filter
+   */
+  UpSampler(uint32_t numChannels,
+            double transitionBand,
+            uint32_t fftSamplesPerBlock,
+            double oversamplingRate,
+            bool useDoubleOutput,
+            Engine engine);
+
+  /**
+   * Up-samples a multi channel input buffer, writing the output of r8brain directly to the supplied buffer, converting
+   * it to the precision of the buffer if needed.
+   * @param input pointer to the input buffer.
+   * @param numSamples the number of samples of each channel of the input
+   * buffer.
+   * @param output the buffer in which to store the up-sampled samples.
+   * @return number of up-sampled samples
+   */
+  template<typename Float>
+  uint32_t upSample(Float* const* input, uint32_t numSamples, Buffer<Float>& output);
+
   void setup() override;
 
   Buffer<double> output;
+  std::vector<double*> outputView;
+  bool const useDoubleOutput = true;
 };
 
 /**
  * DownSampler using a FIR antialiasing filter. Its processing method takes a
  * number of requested samples, and will output either output that much samples,
- * or no samples at all. It uses a buffer to store the samples produced.
+ * or no samples at all. It uses a circular buffer to store the samples produced.
  * @see TUnbufferedReSampler for a template that can work with single
  * precision.
  */
@@ -239,11 +514,13 @@ public:
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
    * @param oversamplingRate the oversampling factor
+   * @param engine the engine used to convolve each channel with the antialiasing filter
    */
   explicit DownSampler(uint32_t numChannels,
                        double transitionBand = 4.0,
                        uint32_t fftSamplesPerBlock = 256,
-                       double oversamplingRate = 1.0);
+                       double oversamplingRate = 1.0,
+                       Engine engine = Engine::r8brain);
 
   /**
    * Down-samples a multi channel input buffer.
@@ -297,6 +574,16 @@ public:
   {
     resetBase();
     bufferCounter = 0;
+    bufferStart = 0;
+  }
+
+  /**
+   * Resets the state of the processor. The down-sampler pads the beginning of its output with zeros until the
+   * antialiasing filters produce it, so it always outputs the required samples, and priming it is resetting it.
+   */
+  void prime()
+  {
+    reset();
   }
 
   /**
@@ -320,11 +607,24 @@ public:
 private:
   Buffer<double> buffer;
   int bufferCounter = 0;
+  int bufferStart = 0;
   uint32_t maxRequiredOutputLength;
 
 protected:
+  /**
+   * Down-samples a multi channel input buffer, converting the input to double precision one fft block at a time and
+   * the output of r8brain directly to the precision of the output if needed.
+   * @param input pointer to the input buffers.
+   * @param numSamples the number of samples of each channel of the input
+   * @param output pointer to the memory in which to store the down-sampled data.
+   * @param requiredSamples the number of samples needed as output
+   */
+  template<typename Float>
+  void downSample(Float* const* input, uint32_t numSamples, Float** output, uint32_t requiredSamples);
+
   void setup() override;
   void updateBuffer(uint32_t requiredOutputSamples);
+  uint32_t getPartitionBlockSize() const override;
 };
 
 /**
@@ -344,12 +644,14 @@ public:
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
    * @param oversamplingRate the oversampling factor
+   * @param engine the engine used to convolve each channel with the antialiasing filter
    */
   explicit TUpSampler(uint32_t numChannels,
                       double transitionBand = 4.0,
                       uint32_t fftSamplesPerBlock = 256,
-                      double oversamplingRate = 1.0)
-    : UpSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate)
+                      double oversamplingRate = 1.0,
+                      Engine engine = Engine::r8brain)
+    : UpSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate, engine)
   {}
 
   Buffer<Float>& getOutput()
@@ -366,8 +668,7 @@ public:
 template<>
 class TUpSampler<float> final : public UpSampler
 {
-  Buffer<double> floatToDoubleBuffer;
-  Buffer<float> doubleToFloatBuffer;
+  Buffer<float> floatOutput;
 
 public:
   /**
@@ -379,15 +680,18 @@ public:
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
    * @param oversamplingRate the oversampling factor
+   * @param engine the engine used to convolve each channel with the antialiasing filter
    */
   explicit TUpSampler(uint32_t numChannels,
                       double transitionBand = 4.0,
                       uint32_t fftSamplesPerBlock = 256,
-                      double oversamplingRate = 1.0)
-    : UpSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate)
-    , floatToDoubleBuffer(numChannels, fftSamplesPerBlock)
-    , doubleToFloatBuffer(numChannels, (uint32_t)std::ceil(fftSamplesPerBlock * oversamplingRate))
-  {}
+                      double oversamplingRate = 1.0,
+                      Engine engine = Engine::r8brain)
+    : UpSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate, false, engine)
+    , floatOutput(numChannels, maxOutputLength)
+  {
+    prepareConversionBuffer();
+  }
 
   /**
    * Up-samples a multi channel input buffer.
@@ -398,19 +702,30 @@ public:
    */
   uint32_t processBlock(float* const* input, uint32_t numSamples)
   {
-    auto const numUpSampledSamples = (uint32_t)std::ceil(numSamples * oversamplingRate);
-    assert(floatToDoubleBuffer.getCapacity() >= numSamples);
-    assert(doubleToFloatBuffer.getCapacity() >= numUpSampledSamples);
-    floatToDoubleBuffer.setNumSamples(numSamples);
-    doubleToFloatBuffer.setNumSamples(numUpSampledSamples);
-    for (uint32_t c = 0; c < numChannels; ++c) {
-      for (uint32_t i = 0; i < numSamples; ++i) {
-        floatToDoubleBuffer[c][i] = (double)input[c][i];
-      }
-    }
-    auto const samples = UpSampler::processBlock(floatToDoubleBuffer.get(), numSamples);
-    copyBuffer(output, doubleToFloatBuffer);
-    return samples;
+    return upSample(input, numSamples, floatOutput);
+  }
+
+  /**
+   * The output of the r8brain resamplers is in double precision, so in single
+   * precision the output is always converted to the output buffer; this method
+   * is the same as processBlock, and it is provided for consistency with the
+   * double precision interface.
+   * @param input pointer to the input buffer.
+   * @param numSamples the number of samples of each channel of the input
+   * buffer.
+   * @return number of up-sampled samples
+   */
+  uint32_t processBlockWithoutCopy(float* const* input, uint32_t numSamples)
+  {
+    return processBlock(input, numSamples);
+  }
+
+  /**
+   * @return pointers to each channel of the output buffer.
+   */
+  float* const* getOutputView()
+  {
+    return floatOutput.get();
   }
 
   /**
@@ -420,6 +735,7 @@ public:
    */
   uint32_t processBlock(Buffer<float> const& input)
   {
+    assert(input.getNumChannels() == numChannels);
     return processBlock(input.get(), input.getNumSamples());
   }
 
@@ -431,7 +747,7 @@ public:
   void prepareBuffersAndSetFftBlockSize(uint32_t numSamples, uint32_t fftBlockSize) override
   {
     UpSampler::prepareBuffersAndSetFftBlockSize(numSamples, fftBlockSize);
-    updateBuffers(numSamples);
+    floatOutput.setNumSamples(maxOutputLength);
   }
 
   /**
@@ -441,32 +757,26 @@ public:
   void prepareBuffers(uint32_t numSamples) override
   {
     UpSampler::prepareBuffers(numSamples);
-    updateBuffers(numSamples);
+    floatOutput.setNumSamples(maxOutputLength);
   }
 
   Buffer<float>& getOutput()
   {
-    return doubleToFloatBuffer;
+    return floatOutput;
   }
 
   Buffer<float> const& getOutput() const
   {
-    return doubleToFloatBuffer;
+    return floatOutput;
   }
 
 private:
   void setup() override
   {
-    floatToDoubleBuffer.setNumChannels(this->numChannels);
-    doubleToFloatBuffer.setNumChannels(this->numChannels);
+    prepareConversionBuffer();
+    floatOutput.setNumChannels(this->numChannels);
     UpSampler::setup();
   }
-
-  void updateBuffers(uint32_t numSamples)
-  {
-    floatToDoubleBuffer.setNumSamples(numSamples);
-    doubleToFloatBuffer.setNumSamples((uint32_t)std::ceil(numSamples * oversamplingRate));
-  }
 };
 
 /**
@@ -483,9 +793,6 @@ public:
 template<>
 class TDownSampler<float> : public DownSampler
 {
-  Buffer<double> floatToDoubleBuffer;
-  Buffer<double> doubleToFloatBuffer;
-
 public:
   /**
    * Constructor.
@@ -496,15 +803,17 @@ public:
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
    * @param oversamplingRate the oversampling factor
+   * @param engine the engine used to convolve each channel with the antialiasing filter
    */
   explicit TDownSampler(uint32_t numChannels,
                         double transitionBand = 4.0,
                         uint32_t fftSamplesPerBlock = 256,
-                        double oversamplingRate_ = 1.0)
-    : DownSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate_)
-    , floatToDoubleBuffer(numChannels, fftSamplesPerBlock)
-    , doubleToFloatBuffer(numChannels, (uint32_t)std::ceil(fftSamplesPerBlock * oversamplingRate))
-  {}
+                        double oversamplingRate_ = 1.0,
+                        Engine engine = Engine::r8brain)
+    : DownSampler(numChannels, transitionBand, fftSamplesPerBlock, oversamplingRate_, engine)
+  {
+    prepareConversionBuffer();
+  }
 
   /**
    * Down-samples a multi channel input buffer.
@@ -514,21 +823,7 @@ public:
    */
   void processBlock(float* const* input, uint32_t numSamples, float** output, uint32_t requiredSamples)
   {
-    assert(floatToDoubleBuffer.getCapacity() >= numSamples);
-    assert(doubleToFloatBuffer.getCapacity() >= requiredSamples);
-    floatToDoubleBuffer.setNumSamples(numSamples);
-    doubleToFloatBuffer.setNumSamples(requiredSamples);
-    if (numSamples > 0) {
-      for (uint32_t c = 0; c < numChannels; ++c) {
-        std::copy(&input[c][0], &input[c][0] + numSamples, &floatToDoubleBuffer[c][0]);
-      }
-    }
-    DownSampler::processBlock(floatToDoubleBuffer.get(), numSamples, doubleToFloatBuffer.get(), requiredSamples);
-    for (uint32_t c = 0; c < numChannels; ++c) {
-      for (uint32_t i = 0; i < requiredSamples; ++i) {
-        output[c][i] = (float)doubleToFloatBuffer[c][i];
-      }
-    }
+    downSample(input, numSamples, output, requiredSamples);
   }
 
   /**
@@ -539,17 +834,7 @@ public:
    */
   void processBlock(Buffer<float> const& input, float** output, uint32_t requiredSamples)
   {
-    assert(floatToDoubleBuffer.getCapacity() >= input.getNumSamples());
-    assert(doubleToFloatBuffer.getCapacity() >= requiredSamples);
-    copyBuffer(input, floatToDoubleBuffer);
-    doubleToFloatBuffer.setNumSamples(requiredSamples);
-    DownSampler::processBlock(
-      floatToDoubleBuffer.get(), floatToDoubleBuffer.getNumSamples(), doubleToFloatBuffer.get(), requiredSamples);
-    for (uint32_t c = 0; c < numChannels; ++c) {
-      for (uint32_t i = 0; i < requiredSamples; ++i) {
-        output[c][i] = (float)doubleToFloatBuffer[c][i];
-      }
-    }
+    downSample(input.get(), input.getNumSamples(), output, requiredSamples);
   }
 
   /**
@@ -560,71 +845,159 @@ public:
    */
   void processBlock(Buffer<float> const& input, Buffer<float>& output, uint32_t requiredSamples)
   {
+    assert(output.getNumChannels() == input.getNumChannels());
+    assert(output.getCapacity() >= requiredSamples);
+    output.setNumSamples(requiredSamples);
     processBlock(input, output.get(), requiredSamples);
   }
 
+protected:
+  void setup() override
+  {
+    prepareConversionBuffer();
+    DownSampler::setup();
+  }
+};
+
+/**
+ * How the pre-allocated re-samplers allocate the resources needed by each order of oversampling they support.
+ */
+enum class AllocationPolicy
+{
   /**
-   * Allocates resources to process up to numInputSamples input samples and
-   * produce requiredOutputSamples output samples.
-   * @param numInputSamples the expected maximum number input samples
-   * @param requiredOutputSamples the required number of output samples
-   * @param fftBlockSize the new number of samples that will be processed by each fft call.
+   * The resources for all the orders up to the maximum one are allocated by setMaxOrder.
    */
-  void prepareBuffersAndSetFftBlockSize(uint32_t numInputSamples,
-                                        uint32_t requiredOutputSamples,
-                                        uint32_t fftBlockSize) override
+  allOrders,
+  /**
+   * Only the resources for the order in use are allocated by setMaxOrder. The other orders are allocated by
+   * prepareOrder, which must be called before setting them.
+   */
+  activeOrderOnly
+};
+
+/**
+ * Base class for the re-samplers that hold a FIR re-sampler for each order of oversampling they support, so that the
+ * order can be changed without allocating, as long as the order has been prepared.
+ * @see AllocationPolicy
+ */
+template<class ReSampler>
+class TReSamplerPreAllocatedBase
+{
+public:
+  virtual ~TReSamplerPreAllocatedBase() = default;
+
+  /**
+   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set, and it must be
+   * ready: it never allocates nor waits, so it can be called from the audio thread, and if the order has not been
+   * prepared, or is still being prepared by another thread, the order in use does not change.
+   * @value the order to set
+   * @return true if the order was set, false if it is out of range or not ready
+   * @see prepareOrder
+   * @see isOrderReady
+   */
+  bool setOrder(uint32_t value)
   {
-    DownSampler::prepareBuffersAndSetFftBlockSize(numInputSamples, requiredOutputSamples, fftBlockSize);
-    updateBuffers(numInputSamples, requiredOutputSamples);
+    if (value < 1 || value > static_cast<uint32_t>(reSamplers.size())) {
+      assert(false);
+      return false;
+    }
+    if (!isOrderReady(value)) {
+      return false;
+    }
+    order = value;
+    return true;
   }
 
   /**
-   * Allocates resources to process up to numInputSamples input samples and
-   * produce requiredOutputSamples output samples.
-   * @param numInputSamples the expected maximum number input samples
-   * @param requiredOutputSamples the required number of output samples
+   * Sets the maximum order of oversampling supported, and allocates the resources required by the allocation policy:
+   * all the orders, or only the one in use.
+   * @param value the maximum order of oversampling
    */
-  void prepareBuffers(uint32_t numInputSamples, uint32_t requiredOutputSamples) override
+  void setMaxOrder(uint32_t value)
   {
-    DownSampler::prepareBuffers(numInputSamples, requiredOutputSamples);
-    updateBuffers(numInputSamples, requiredOutputSamples);
+    reSamplers.resize(static_cast<std::size_t>(value));
+    orderStates = std::vector<std::atomic<OrderState>>(static_cast<std::size_t>(value));
+    for (uint32_t i = 0; i < value; ++i) {
+      orderStates[i].store(reSamplers[i] != nullptr ? OrderState::ready : OrderState::notAllocated,
+                           std::memory_order_relaxed);
+    }
+    if (allocationPolicy == AllocationPolicy::allOrders) {
+      for (uint32_t i = 1; i <= value; ++i) {
+        prepareOrder(i);
+      }
+    }
+    else if (order <= value) {
+      prepareOrder(order);
+    }
   }
 
-protected:
-  void setup() override
+  /**
+   * @return the maximum order of oversampling supported.
+   */
+  uint32_t getMaxOrder() const
   {
-    floatToDoubleBuffer.setNumChannels(this->numChannels);
-    doubleToFloatBuffer.setNumChannels(this->numChannels);
-    DownSampler::setup();
+    return static_cast<uint32_t>(reSamplers.size());
   }
 
-private:
-  void updateBuffers(uint32_t numInputSamples, uint32_t requiredOutputSamples)
+  /**
+   * Sets the allocation policy. If it is AllocationPolicy::allOrders, the orders that were not prepared are allocated.
+   * @param value the allocation policy to use
+   */
+  void setAllocationPolicy(AllocationPolicy value)
   {
-    floatToDoubleBuffer.setNumSamples(numInputSamples);
-    doubleToFloatBuffer.setNumSamples(requiredOutputSamples);
+    allocationPolicy = value;
+    if (allocationPolicy == AllocationPolicy::allOrders) {
+      for (uint32_t i = 1; i <= getMaxOrder(); ++i) {
+        prepareOrder(i);
+      }
+    }
   }
-};
 
-template<class ReSampler>
-class TReSamplerPreAllocatedBase
-{
-public:
-  virtual ~TReSamplerPreAllocatedBase() = default;
+  /**
+   * @return the allocation policy in use
+   */
+  AllocationPolicy getAllocationPolicy() const
+  {
+    return allocationPolicy;
+  }
 
   /**
-   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set
-   * @value the order to set
-   * @return true if the order was set correctly, false otherwise
+   * Allocates the resources needed to work with the supplied order, if they have not been allocated yet. It can be
+   * called from a background thread while the processor is working with another order, and concurrently with
+   * setOrder and with itself, but not concurrently with any other method that changes the settings of the processor.
+   * The order is claimed atomically by the first thread preparing it, and the others wait for it to be ready.
+   * @param value the order to prepare
+   * @return true if the order is ready, false if it is greater than the maximum order
    */
-  bool setOrder(uint32_t value)
+  bool prepareOrder(uint32_t value)
   {
-    if (value >= 1 && value <= static_cast<uint32_t>(reSamplers.size())) {
-      order = value;
-      return true;
+    if (value < 1 || value > getMaxOrder()) {
+      assert(false);
+      return false;
+    }
+    auto& state = orderStates[value - 1];
+    auto expected = OrderState::notAllocated;
+    if (state.compare_exchange_strong(expected, OrderState::building, std::memory_order_acq_rel)) {
+      reSamplers[value - 1] = makeReSampler(value);
+      state.store(OrderState::ready, std::memory_order_release);
     }
-    assert(false);
-    return false;
+    else {
+      while (state.load(std::memory_order_acquire) != OrderState::ready) {
+        std::this_thread::yield();
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @return true if the resources for the supplied order have been allocated, so that it can be set without
+   * allocating. It can be called while prepareOrder is running on another thread.
+   * @param value the order to query
+   */
+  bool isOrderReady(uint32_t value) const
+  {
+    return value >= 1 && value <= orderStates.size() &&
+           orderStates[value - 1].load(std::memory_order_acquire) == OrderState::ready;
   }
 
   /**
@@ -649,9 +1022,14 @@ public:
    */
   void setNumChannels(uint32_t value)
   {
+    if (numChannels == value) {
+      return;
+    }
     numChannels = value;
     for (auto& reSampler : reSamplers) {
-      reSampler->setNumChannels(value);
+      if (reSampler) {
+        reSampler->setNumChannels(value);
+      }
     }
   }
 
@@ -670,9 +1048,14 @@ public:
    */
   void setTransitionBand(double value)
   {
+    if (transitionBand == value) {
+      return;
+    }
     transitionBand = value;
     for (auto& reSampler : reSamplers) {
-      reSampler->setTransitionBand(value);
+      if (reSampler) {
+        reSampler->setTransitionBand(value);
+      }
     }
   }
 
@@ -685,15 +1068,45 @@ public:
     return transitionBand;
   }
 
+  /**
+   * Sets the engine used to convolve each channel with the antialiasing filter.
+   * @param value the new engine
+   */
+  void setEngine(Engine value)
+  {
+    if (engine == value) {
+      return;
+    }
+    engine = value;
+    for (auto& reSampler : reSamplers) {
+      if (reSampler) {
+        reSampler->setEngine(value);
+      }
+    }
+  }
+
+  /**
+   * @return the engine used to convolve each channel with the antialiasing filter.
+   */
+  Engine getEngine() const
+  {
+    return engine;
+  }
+
   /**
    * Sets the number of samples that are processed by each fft call.
    * @param value the new number of samples that will be processed by each fft call.
    */
   void setFftSamplesPerBlock(uint32_t value)
   {
+    if (fftSamplesPerBlock == value) {
+      return;
+    }
     fftSamplesPerBlock = value;
     for (auto& reSampler : reSamplers) {
-      reSampler->setFftSamplesPerBlock(value);
+      if (reSampler) {
+        reSampler->setFftSamplesPerBlock(value);
+      }
     }
   }
 
@@ -707,24 +1120,29 @@ public:
 
   /**
    * @return the number of input samples needed before a first output sample is
-   * produced.
+   * produced. It does not change the state of the processor.
    */
-  uint32_t getNumSamplesBeforeOutputStarts()
+  uint32_t getNumSamplesBeforeOutputStarts() const
   {
     return get().getNumSamplesBeforeOutputStarts();
   }
 
   /**
    * Gets the number of input samples needed before a first output sample is
-   * produced, when the oversampling order is set to the supplied value.
+   * produced, when the oversampling order is set to the supplied value. The order must be ready.
    * @param order the order for which to compute the latency
    * @return the latency for the specified order
+   * @see isOrderReady
    */
-  uint32_t getNumSamplesBeforeOutputStarts(uint32_t order)
+  uint32_t getNumSamplesBeforeOutputStarts(uint32_t order) const
   {
     if (order == 0)
       return 0;
     assert(order <= reSamplers.size());
+    if (!isOrderReady(order)) {
+      assert(false);
+      return 0;
+    }
     return reSamplers[order - 1]->getNumSamplesBeforeOutputStarts();
   }
 
@@ -732,11 +1150,18 @@ public:
    * @return the maximum number of samples that can be produced by a
    * processBlock call, assuming it is never called with more samples than those
    * passed to prepareBuffers. If prepareBuffers has not been called, then no
-   * more samples than fftSamplesPerBlock should be passed to processBlock.
+   * more samples than fftSamplesPerBlock should be passed to processBlock. Only the orders that have been prepared
+   * are taken into account.
    */
   uint32_t getMaxNumOutputSamples() const
   {
-    return reSamplers.back()->getMaxNumOutputSamples();
+    uint32_t maxNumOutputSamples = 0;
+    for (uint32_t i = 1; i <= getMaxOrder(); ++i) {
+      if (isOrderReady(i)) {
+        maxNumOutputSamples = std::max(maxNumOutputSamples, reSamplers[i - 1]->getMaxNumOutputSamples());
+      }
+    }
+    return maxNumOutputSamples;
   }
 
   /**
@@ -747,15 +1172,84 @@ public:
     get().reset();
   }
 
+  /**
+   * Resets the state of the processor and primes the antialiasing filters with silence.
+   * @see UpSampler::prime
+   * @see DownSampler::prime
+   */
+  void prime()
+  {
+    get().prime();
+  }
+
+  /**
+   * Sets the executor used to process the channels in parallel.
+   * @param value the executor to use, or nullptr to process the channels serially on the calling thread. It must
+   * outlive its use by the processor.
+   * @see ReSamplerBase::setExecutor
+   */
+  void setExecutor(TaskExecutor* value)
+  {
+    executor = value;
+    for (auto& reSampler : reSamplers) {
+      if (reSampler) {
+        reSampler->setExecutor(value);
+      }
+    }
+  }
+
+  /**
+   * @return the executor used to process the channels in parallel, or nullptr if they are processed serially.
+   */
+  TaskExecutor* getExecutor() const
+  {
+    return executor;
+  }
+
+  /**
+   * Sets the Instrumentation that collects the time spent by the re-samplers of all the orders.
+   * @param value the Instrumentation to use, or nullptr to not collect anything. It must outlive its use by the
+   * processor.
+   * @see ReSamplerBase::setInstrumentation
+   */
+  void setInstrumentation(Instrumentation* value)
+  {
+    instrumentation = value;
+    for (auto& reSampler : reSamplers) {
+      if (reSampler) {
+        reSampler->setInstrumentation(value);
+      }
+    }
+  }
+
+  /**
+   * @return the Instrumentation that collects the time spent by the re-samplers, or nullptr if there is none
+   */
+  Instrumentation* getInstrumentation() const
+  {
+    return instrumentation;
+  }
+
 protected:
   explicit TReSamplerPreAllocatedBase(uint32_t numChannels,
                                       double transitionBand = 4.0,
-                                      uint32_t fftSamplesPerBlock = 1024)
+                                      uint32_t fftSamplesPerBlock = 1024,
+                                      AllocationPolicy allocationPolicy = AllocationPolicy::allOrders,
+                                      Engine engine = Engine::r8brain,
+                                      uint32_t order = 1)
     : numChannels{ numChannels }
     , transitionBand{ transitionBand }
     , fftSamplesPerBlock{ fftSamplesPerBlock }
+    , order{ order }
+    , allocationPolicy{ allocationPolicy }
+    , engine{ engine }
   {}
 
+  /**
+   * @return a new re-sampler for the supplied order, set up with the current settings.
+   */
+  virtual std::unique_ptr<ReSampler> makeReSampler(uint32_t order) const = 0;
+
   ReSampler& get()
   {
     return *reSamplers[order - 1];
@@ -772,6 +1266,18 @@ protected:
   uint32_t fftSamplesPerBlock = 1024;
   double transitionBand = 4.0;
   uint32_t order = 1;
+  TaskExecutor* executor = nullptr;
+  Instrumentation* instrumentation = nullptr;
+  AllocationPolicy allocationPolicy = AllocationPolicy::allOrders;
+  Engine engine = Engine::r8brain;
+  // the orders are claimed by the thread that builds them, so that they are not built twice
+  enum class OrderState : uint8_t
+  {
+    notAllocated,
+    building,
+    ready
+  };
+  std::vector<std::atomic<OrderState>> orderStates;
 };
 
 template<typename Float>
@@ -787,14 +1293,25 @@ public:
    * percentage of the sample rate.
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
+   * @param allocationPolicy the policy used to allocate the resources for each order
+   * @param engine the engine used to convolve each channel with the antialiasing filter
+   * @param order the order of oversampling to use, the only one allocated with AllocationPolicy::activeOrderOnly
    */
   explicit TUpSamplerPreAllocated(uint32_t maxOrder,
                                   uint32_t numChannels,
                                   double transitionBand = 4.0,
-                                  uint32_t fftSamplesPerBlock = 1024)
-    : TReSamplerPreAllocatedBase<TUpSampler<Float>>(numChannels, transitionBand, fftSamplesPerBlock)
+                                  uint32_t fftSamplesPerBlock = 1024,
+                                  AllocationPolicy allocationPolicy = AllocationPolicy::allOrders,
+                                  Engine engine = Engine::r8brain,
+                                  uint32_t order = 1)
+    : TReSamplerPreAllocatedBase<TUpSampler<Float>>(numChannels,
+                                                    transitionBand,
+                                                    fftSamplesPerBlock,
+                                                    allocationPolicy,
+                                                    engine,
+                                                    order)
   {
-    setMaxOrder(maxOrder);
+    this->setMaxOrder(maxOrder);
   }
 
   /**
@@ -813,25 +1330,6 @@ public:
     return this->get().getOutput();
   }
 
-  /**
-   * Sets the maximum order of oversampling supported, and allocates the necessary resources
-   * @param value the maximum order of oversampling
-   */
-  void setMaxOrder(uint32_t value)
-  {
-    this->reSamplers.resize(static_cast<std::size_t>(value));
-    uint32_t instanceOrder = 1;
-    for (auto& reSampler : this->reSamplers) {
-      if (!reSampler) {
-        auto const rate = static_cast<double>(1 << instanceOrder);
-        reSampler =
-          std::make_unique<TUpSampler<Float>>(this->numChannels, this->transitionBand, this->fftSamplesPerBlock, rate);
-        reSampler->prepareBuffers(this->maxInputSamples);
-      }
-      ++instanceOrder;
-    }
-  }
-
   /**
    * Allocates resources to process up to numInputSamples input.
    * @param numInputSamples the expected maximum number input samples
@@ -842,7 +1340,9 @@ public:
     this->maxInputSamples = numInputSamples;
     this->fftSamplesPerBlock = fftBlockSize;
     for (auto& reSampler : this->reSamplers) {
-      reSampler->prepareBuffersAndSetFftBlockSize(numInputSamples, fftBlockSize);
+      if (reSampler) {
+        reSampler->prepareBuffersAndSetFftBlockSize(numInputSamples, fftBlockSize);
+      }
     }
   }
 
@@ -854,7 +1354,9 @@ public:
   {
     this->maxInputSamples = numInputSamples;
     for (auto& reSampler : this->reSamplers) {
-      reSampler->prepareBuffers(numInputSamples);
+      if (reSampler) {
+        reSampler->prepareBuffers(numInputSamples);
+      }
     }
   }
 
@@ -879,6 +1381,83 @@ public:
   {
     return this->get().processBlock(input);
   }
+
+  /**
+   * Up-samples a multi channel input buffer, avoiding to copy the output of the
+   * r8brain resamplers when possible.
+   * @param input pointer to the input buffer.
+   * @param numSamples the number of samples of each channel of the input
+   * buffer.
+   * @return number of up-sampled samples
+   * @see getOutputView
+   */
+  uint32_t processBlockWithoutCopy(Float* const* input, uint32_t numSamples)
+  {
+    return this->get().processBlockWithoutCopy(input, numSamples);
+  }
+
+  /**
+   * @return pointers to each channel of the output of the last call to
+   * processBlockWithoutCopy, valid until the next processing or reset call.
+   */
+  Float* const* getOutputView()
+  {
+    return this->get().getOutputView();
+  }
+
+  /**
+   * @return the maximum number of samples that can be produced by a processBlock call with any order up to the
+   * maximum one, allocated or not, assuming it is never called with more samples than those passed to prepareBuffers,
+   * so that the buffers receiving the output can be sized for all the orders before they are allocated. The orders
+   * that are not allocated are not built to compute it.
+   * @see computeMaxNumOutputSamplesOfAllOrders
+   */
+  uint32_t getMaxNumOutputSamplesOfAllOrders() const
+  {
+    return computeMaxNumOutputSamplesOfAllOrders(
+      this->getMaxOrder(), this->transitionBand, this->fftSamplesPerBlock, this->engine, this->maxInputSamples);
+  }
+
+  /**
+   * Computes the value getMaxNumOutputSamplesOfAllOrders would return for an up-sampler with the supplied settings,
+   * after prepareBuffers(maxInputLength), without building it.
+   * @param maxOrder the maximum order of oversampling
+   * @param transitionBand the antialiasing filter transition band, in percentage of the sample rate
+   * @param fftSamplesPerBlock the number of samples processed by each fft call
+   * @param engine the engine used to convolve each channel with the antialiasing filter
+   * @param maxInputLength the maximum number of samples passed to each processBlock call
+   * @return the maximum number of samples produced by a processBlock call with any order up to maxOrder
+   * @see ReSamplerBase::computeMaxNumOutputSamples
+   */
+  static uint32_t computeMaxNumOutputSamplesOfAllOrders(uint32_t maxOrder,
+                                                        double transitionBand,
+                                                        uint32_t fftSamplesPerBlock,
+                                                        Engine engine,
+                                                        uint32_t maxInputLength)
+  {
+    uint32_t maxNumOutputSamples = 0;
+    for (uint32_t order = 1; order <= maxOrder; ++order) {
+      maxNumOutputSamples = std::max(maxNumOutputSamples,
+                                     ReSamplerBase::computeMaxNumOutputSamples(engine,
+                                                                               static_cast<double>(1 << order),
+                                                                               transitionBand,
+                                                                               fftSamplesPerBlock,
+                                                                               maxInputLength));
+    }
+    return maxNumOutputSamples;
+  }
+
+private:
+  std::unique_ptr<TUpSampler<Float>> makeReSampler(uint32_t order) const override
+  {
+    auto const rate = static_cast<double>(1 << order);
+    auto reSampler = std::make_unique<TUpSampler<Float>>(
+      this->numChannels, this->transitionBand, this->fftSamplesPerBlock, rate, this->engine);
+    reSampler->setExecutor(this->executor);
+    reSampler->setInstrumentation(this->instrumentation);
+    reSampler->prepareBuffers(this->maxInputSamples);
+    return reSampler;
+  }
 };
 
 template<typename Float>
@@ -894,14 +1473,25 @@ public:
    * percentage of the sample rate.
    * @param fftSamplesPerBlock the number of samples that will be processed
    * by each fft call.
+   * @param allocationPolicy the policy used to allocate the resources for each order
+   * @param engine the engine used to convolve each channel with the antialiasing filter
+   * @param order the order of oversampling to use, the only one allocated with AllocationPolicy::activeOrderOnly
    */
   explicit TDownSamplerPreAllocated(uint32_t maxOrder,
                                     uint32_t numChannels,
                                     double transitionBand = 4.0,
-                                    uint32_t fftSamplesPerBlock = 1024)
-    : TReSamplerPreAllocatedBase<TDownSampler<Float>>(numChannels, transitionBand, fftSamplesPerBlock)
+                                    uint32_t fftSamplesPerBlock = 1024,
+                                    AllocationPolicy allocationPolicy = AllocationPolicy::allOrders,
+                                    Engine engine = Engine::r8brain,
+                                    uint32_t order = 1)
+    : TReSamplerPreAllocatedBase<TDownSampler<Float>>(numChannels,
+                                                      transitionBand,
+                                                      fftSamplesPerBlock,
+                                                      allocationPolicy,
+                                                      engine,
+                                                      order)
   {
-    setMaxOrder(maxOrder);
+    this->setMaxOrder(maxOrder);
   }
 
   /**
@@ -937,25 +1527,6 @@ public:
     return this->get().processBlock(input, output, requiredSamples);
   }
 
-  /**
-   * Sets the maximum order of oversampling supported, and allocates the necessary resources
-   * @param value the maximum order of oversampling
-   */
-  void setMaxOrder(uint32_t value)
-  {
-    this->reSamplers.resize(static_cast<std::size_t>(value));
-    uint32_t instanceOrder = 1;
-    for (auto& reSampler : this->reSamplers) {
-      if (!reSampler) {
-        auto const rate = static_cast<double>(1 << instanceOrder);
-        reSampler = std::make_unique<TDownSampler<Float>>(
-          this->numChannels, this->transitionBand, this->fftSamplesPerBlock, rate);
-        reSampler->prepareBuffers(this->maxInputSamples, maxRequiredOutputSamples);
-      }
-      ++instanceOrder;
-    }
-  }
-
   /**
    * Allocates resources to process up to numInputSamples input samples and
    * produce requiredOutputSamples output samples.
@@ -971,7 +1542,9 @@ public:
     this->maxInputSamples = numInputSamples;
     this->fftSamplesPerBlock = fftBlockSize;
     for (auto& reSampler : this->reSamplers) {
-      reSampler->prepareBuffersAndSetFftBlockSize(numInputSamples, maxRequiredOutputSamples, fftBlockSize);
+      if (reSampler) {
+        reSampler->prepareBuffersAndSetFftBlockSize(numInputSamples, maxRequiredOutputSamples, fftBlockSize);
+      }
     }
   }
 
@@ -986,11 +1559,24 @@ public:
     maxRequiredOutputSamples = requiredOutputSamples_;
     this->maxInputSamples = numInputSamples;
     for (auto& reSampler : this->reSamplers) {
-      reSampler->prepareBuffers(numInputSamples, maxRequiredOutputSamples);
+      if (reSampler) {
+        reSampler->prepareBuffers(numInputSamples, maxRequiredOutputSamples);
+      }
     }
   }
 
 private:
+  std::unique_ptr<TDownSampler<Float>> makeReSampler(uint32_t order) const override
+  {
+    auto const rate = static_cast<double>(1 << order);
+    auto reSampler = std::make_unique<TDownSampler<Float>>(
+      this->numChannels, this->transitionBand, this->fftSamplesPerBlock, rate, this->engine);
+    reSampler->setExecutor(this->executor);
+    reSampler->setInstrumentation(this->instrumentation);
+    reSampler->prepareBuffers(this->maxInputSamples, maxRequiredOutputSamples);
+    return reSampler;
+  }
+
   uint32_t maxRequiredOutputSamples = 256;
 };
 
@@ -0,0 +1,432 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "oversimple/Oversampling.hpp"
+#include "oversimple/TaskExecutor.hpp"
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace oversimple {
+
+/**
+ * A group of consecutive channels of a TGroupedOversampling, oversampled with the same order and phase.
+ */
+struct ChannelGroup final
+{
+  uint32_t numChannels = 1;
+  uint32_t order = 1;
+  bool isUsingLinearPhase = false;
+};
+
+/**
+ * A class that oversamples groups of channels with different orders and phases in a single object, for example the
+ * mid and the side channels, or the bands of a multiband processor, with different needs.
+ * The channels of all the groups with the same order and phase are oversampled by the same TOversampling object, which
+ * we call a configuration, so that they are packed in the same SIMD lanes by the IIR re-samplers and share the buffers
+ * and the tasks of the FIR ones. All the configurations are processed by a single call, serially or in parallel if an
+ * executor is set. The output of each channel is delayed so that all the channels have the latency of the slowest
+ * configuration, and stay aligned. When the configurations are processed serially, they share the buffer in which the
+ * FIR down-samplers deinterleave their input.
+ */
+template<typename Float>
+class TGroupedOversampling final
+{
+public:
+  /**
+   * Constructor.
+   * @param settings the settings of the oversampling, shared by all the groups. The order, the phase, the maximum
+   * order and the number of channels are set by the groups. The input and output buffer types are always plain, and
+   * the down-sampler input buffer type is the same as the up-sampler output one.
+   * @param groups_ the groups of channels, in the order of the channels of the input and of the output
+   */
+  TGroupedOversampling(OversamplingSettings settings, std::vector<ChannelGroup> groups_)
+    : groups{ std::move(groups_) }
+  {
+    assert(!groups.empty());
+    settings.upSampleInputBufferType = BufferType::plain;
+    settings.downSampleOutputBufferType = BufferType::plain;
+    settings.downSampleInputBufferType = settings.upSampleOutputBufferType;
+    // the order of each configuration never changes, so only its resources are allocated
+    settings.firAllocationPolicy = fir::AllocationPolicy::activeOrderOnly;
+    for (auto const& group : groups) {
+      assert(group.order > 0 && group.order <= maxOversamplingOrder);
+      auto const configuration = findOrAddConfiguration(group.order, group.isUsingLinearPhase);
+      for (uint32_t c = 0; c < group.numChannels; ++c) {
+        channelConfigurations.push_back(configuration);
+        configurations[configuration].channels.push_back(numChannels++);
+      }
+    }
+    uint32_t maxNumConfigurationChannels = 0;
+    uint32_t maxNumUpSampledSamples = 0;
+    for (auto& configuration : configurations) {
+      auto configurationSettings = settings;
+      configurationSettings.maxOrder = configuration.order;
+      configurationSettings.order = configuration.order;
+      configurationSettings.isUsingLinearPhase = configuration.isUsingLinearPhase;
+      configurationSettings.numUpSampledChannels = (uint32_t)configuration.channels.size();
+      configurationSettings.numDownSampledChannels = (uint32_t)configuration.channels.size();
+      configuration.oversampling = std::make_unique<TOversampling<Float>>(configurationSettings);
+      configuration.input.resize(configuration.channels.size());
+      configuration.output.resize(configuration.channels.size());
+      configuration.latency = configuration.oversampling->getLatency();
+      latency = std::max(latency, configuration.latency);
+      maxNumConfigurationChannels = std::max(maxNumConfigurationChannels, (uint32_t)configuration.channels.size());
+      maxNumUpSampledSamples = std::max(maxNumUpSampledSamples, configuration.oversampling->getMaxNumOutputSamples());
+    }
+    // only the linear phase configurations with an interleaved up-sampled signal deinterleave the input of the
+    // down-sampling, but the buffer is not worth sizing for them alone
+    if (settings.upSampleOutputBufferType == BufferType::interleaved) {
+      sharedDownSampleInput.setNumChannels(maxNumConfigurationChannels);
+      sharedDownSampleInput.reserve(maxNumUpSampledSamples);
+    }
+    shareDownSampleInput(true);
+    // the delay lines compensating the latency of each channel, sized for the largest difference
+    delays.resize(numChannels);
+    delayPositions.assign(numChannels, 0);
+    uint32_t maxDelay = 0;
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      delays[c] = latency - configurations[channelConfigurations[c]].latency;
+      maxDelay = std::max(maxDelay, delays[c]);
+    }
+    delayLines.setNumChannels(numChannels);
+    delayLines.setNumSamples(maxDelay);
+    delayLines.fill((Float)0.0);
+  }
+
+  TGroupedOversampling(TGroupedOversampling const&) = delete;
+  TGroupedOversampling& operator=(TGroupedOversampling const&) = delete;
+
+  /**
+   * @return the groups of channels of the object
+   */
+  std::vector<ChannelGroup> const& getGroups() const
+  {
+    return groups;
+  }
+
+  /**
+   * @return the number of channels of all the groups
+   */
+  uint32_t getNumChannels() const
+  {
+    return numChannels;
+  }
+
+  /**
+   * @return the number of configurations, which is the number of distinct pairs of order and phase of the groups
+   */
+  uint32_t getNumConfigurations() const
+  {
+    return (uint32_t)configurations.size();
+  }
+
+  /**
+   * @return the TOversampling object of a configuration, to up-sample and down-sample its channels without the
+   * latency compensation of process
+   */
+  TOversampling<Float>& getConfiguration(uint32_t configuration)
+  {
+    return *configurations[configuration].oversampling;
+  }
+
+  TOversampling<Float> const& getConfiguration(uint32_t configuration) const
+  {
+    return *configurations[configuration].oversampling;
+  }
+
+  /**
+   * @return the channels of the object oversampled by a configuration, in the order of the channels of its
+   * TOversampling object
+   */
+  std::vector<uint32_t> const& getConfigurationChannels(uint32_t configuration) const
+  {
+    return configurations[configuration].channels;
+  }
+
+  /**
+   * @return the configuration that oversamples a channel
+   */
+  uint32_t getChannelConfiguration(uint32_t channel) const
+  {
+    return channelConfigurations[channel];
+  }
+
+  /**
+   * @return the order of oversampling of a channel
+   */
+  uint32_t getChannelOrder(uint32_t channel) const
+  {
+    return configurations[channelConfigurations[channel]].order;
+  }
+
+  /**
+   * @return true if a channel uses the linear phase re-samplers, false otherwise
+   */
+  bool isChannelUsingLinearPhase(uint32_t channel) const
+  {
+    return configurations[channelConfigurations[channel]].isUsingLinearPhase;
+  }
+
+  /**
+   * @return the latency of the output of process, the same for all the channels, which is the one of the slowest
+   * configuration
+   */
+  uint32_t getLatency() const
+  {
+    return latency;
+  }
+
+  /**
+   * Sets the executor used to process the configurations in parallel. The processor is then called concurrently for
+   * different configurations, from the threads of the executor, and each configuration uses its own buffer to
+   * deinterleave the input of the FIR down-sampling, as they cannot share one anymore. It allocates or frees those
+   * buffers, so it must not be called from the audio thread. The executor can be the same one set by setFirExecutor:
+   * the jobs of the FIR re-samplers are then started from within its tasks, and WorkerPool runs them serially on the
+   * calling thread while it is busy.
+   * @param value the executor to use, or nullptr to process the configurations serially on the calling thread. It
+   * must outlive its use by the object.
+   */
+  void setExecutor(TaskExecutor* value)
+  {
+    if ((executor == nullptr) != (value == nullptr)) {
+      shareDownSampleInput(value == nullptr);
+    }
+    executor = value;
+  }
+
+  /**
+   * @return the executor used to process the configurations in parallel, or nullptr if they are processed serially.
+   */
+  TaskExecutor* getExecutor() const
+  {
+    return executor;
+  }
+
+  /**
+   * Sets the executor used by the FIR re-samplers of all the configurations to process the channels in parallel.
+   * @param executor the executor to use, or nullptr to process the channels serially on the calling thread. It must
+   * outlive its use by the object.
+   */
+  void setFirExecutor(TaskExecutor* executor)
+  {
+    for (auto& configuration : configurations) {
+      configuration.oversampling->setFirExecutor(executor);
+    }
+  }
+
+  /**
+   * Sets the Instrumentation that collects the time spent by all the configurations.
+   * @param value the Instrumentation to use, or nullptr to not collect anything. It must outlive its use by the object.
+   */
+  void setInstrumentation(Instrumentation* value)
+  {
+    for (auto& configuration : configurations) {
+      configuration.oversampling->setInstrumentation(value);
+    }
+  }
+
+  /**
+   * Resets the state of the processor, clearing the buffers and the delay lines.
+   */
+  void reset()
+  {
+    for (auto& configuration : configurations) {
+      configuration.oversampling->reset();
+    }
+    clearDelayLines();
+  }
+
+  /**
+   * Resets the state of the processor and primes the re-samplers of all the configurations.
+   * @see TOversampling::prime
+   */
+  void prime()
+  {
+    for (auto& configuration : configurations) {
+      configuration.oversampling->prime();
+    }
+    clearDelayLines();
+  }
+
+  /**
+   * Up-samples the input of each configuration, lets the processor work on it, and down-samples it to the output, as
+   * TOversampling::process does, then delays the output of the channels of the configurations with less latency than
+   * getLatency().
+   * @param input pointer to the input buffers, one for each channel of the object
+   * @param output pointer to the output buffers, one for each channel of the object
+   * @param numSamples the number of samples in each channel of the input and output buffers
+   * @param processor a callable taking the up-sampled signal of a configuration, accepting both a Buffer<Float>& and
+   * an InterleavedBuffer<Float>& like the processor of TOversampling::process, the number of up-sampled samples as an
+   * uint32_t, and the channels of the object held by the up-sampled signal as a std::vector<uint32_t> const&. It is
+   * called once for each sub-block of each configuration, concurrently for different configurations if an executor is
+   * set.
+   */
+  template<class Processor>
+  void process(Float* const* input, Float** output, uint32_t numSamples, Processor&& processor)
+  {
+    static_assert(std::is_invocable_v<Processor, Buffer<Float>&, uint32_t, std::vector<uint32_t> const&> &&
+                    std::is_invocable_v<Processor, InterleavedBuffer<Float>&, uint32_t, std::vector<uint32_t> const&>,
+                  "the processor must accept both a Buffer<Float>& and an InterleavedBuffer<Float>&, as the up-sampler "
+                  "output buffer type is only known at runtime");
+    auto processConfiguration = [&](uint32_t index) {
+      auto& configuration = configurations[index];
+      auto const numConfigurationChannels = (uint32_t)configuration.channels.size();
+      for (uint32_t c = 0; c < numConfigurationChannels; ++c) {
+        configuration.input[c] = input[configuration.channels[c]];
+        configuration.output[c] = output[configuration.channels[c]];
+      }
+      auto const& channels = configuration.channels;
+      auto configurationProcessor = [&](auto& upSampled, uint32_t n) { processor(upSampled, n, channels); };
+      configuration.oversampling->process(
+        configuration.input.data(), configuration.output.data(), numSamples, configurationProcessor);
+    };
+    auto const numConfigurations = (uint32_t)configurations.size();
+    if (executor && numConfigurations > 1) {
+      using ConfigurationTask = decltype(processConfiguration);
+      executor->run(
+        numConfigurations,
+        [](void* context, uint32_t index) { (*static_cast<ConfigurationTask*>(context))(index); },
+        &processConfiguration);
+    }
+    else {
+      for (uint32_t index = 0; index < numConfigurations; ++index) {
+        processConfiguration(index);
+      }
+    }
+    compensateLatency(output, numSamples);
+  }
+
+  /**
+   * Outputs the last getLatency() samples of the processed signal. Each configuration drains its re-samplers as
+   * TOversampling::flush does, the processor working only on the up-sampled end of the signal, and the rest of the
+   * tail of its channels is pushed out of their delay lines.
+   * @param output pointer to the output buffers, each with room for getLatency() samples
+   * @param processor a callable working on the up-sampled signal, as the one passed to process
+   * @return the number of samples written in each channel of the output, which is getLatency()
+   * @see TOversampling::flush
+   */
+  template<class Processor>
+  uint32_t flush(Float** output, Processor&& processor)
+  {
+    for (auto& configuration : configurations) {
+      auto const numConfigurationChannels = (uint32_t)configuration.channels.size();
+      for (uint32_t c = 0; c < numConfigurationChannels; ++c) {
+        configuration.output[c] = output[configuration.channels[c]];
+      }
+      auto const& channels = configuration.channels;
+      auto configurationProcessor = [&](auto& upSampled, uint32_t n) { processor(upSampled, n, channels); };
+      auto const numFlushedSamples =
+        configuration.oversampling->flush(configuration.output.data(), configurationProcessor);
+      // the delay line of the channels holds the rest of their tail, and is fed silence
+      for (uint32_t c = 0; c < numConfigurationChannels; ++c) {
+        std::fill(configuration.output[c] + numFlushedSamples, configuration.output[c] + latency, (Float)0.0);
+      }
+    }
+    compensateLatency(output, latency);
+    return latency;
+  }
+
+  /**
+   * Outputs the last getLatency() samples of the up-sampled and down-sampled signal, without processing it.
+   * @see flush(Float**, Processor&&)
+   */
+  uint32_t flush(Float** output)
+  {
+    return flush(output, [](auto&, uint32_t, std::vector<uint32_t> const&) {});
+  }
+
+private:
+  struct Configuration final
+  {
+    uint32_t order = 1;
+    bool isUsingLinearPhase = false;
+    std::vector<uint32_t> channels;
+    std::unique_ptr<TOversampling<Float>> oversampling;
+    uint32_t latency = 0;
+    std::vector<Float*> input;
+    std::vector<Float*> output;
+  };
+
+  uint32_t findOrAddConfiguration(uint32_t order, bool isUsingLinearPhase)
+  {
+    auto const it = std::find_if(configurations.begin(), configurations.end(), [&](Configuration const& c) {
+      return c.order == order && c.isUsingLinearPhase == isUsingLinearPhase;
+    });
+    if (it != configurations.end()) {
+      return (uint32_t)(it - configurations.begin());
+    }
+    auto& configuration = configurations.emplace_back();
+    configuration.order = order;
+    configuration.isUsingLinearPhase = isUsingLinearPhase;
+    return (uint32_t)configurations.size() - 1;
+  }
+
+  /**
+   * Makes the configurations deinterleave the input of their FIR down-sampling into the shared buffer, or each into
+   * its own one.
+   */
+  void shareDownSampleInput(bool isShared)
+  {
+    auto const buffer = isShared && sharedDownSampleInput.getNumChannels() > 0 ? &sharedDownSampleInput : nullptr;
+    for (auto& configuration : configurations) {
+      configuration.oversampling->setSharedDownSampleInputBuffer(buffer);
+    }
+  }
+
+  void compensateLatency(Float** output, uint32_t numSamples)
+  {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      auto const delay = delays[c];
+      if (delay == 0) {
+        continue;
+      }
+      auto line = &delayLines[c][0];
+      auto position = delayPositions[c];
+      for (uint32_t i = 0; i < numSamples; ++i) {
+        auto const delayed = line[position];
+        line[position] = output[c][i];
+        output[c][i] = delayed;
+        if (++position == delay) {
+          position = 0;
+        }
+      }
+      delayPositions[c] = position;
+    }
+  }
+
+  void clearDelayLines()
+  {
+    delayLines.fill((Float)0.0);
+    std::fill(delayPositions.begin(), delayPositions.end(), 0u);
+  }
+
+  std::vector<ChannelGroup> groups;
+  std::vector<Configuration> configurations;
+  std::vector<uint32_t> channelConfigurations;
+  uint32_t numChannels = 0;
+  uint32_t latency = 0;
+  std::vector<uint32_t> delays;
+  std::vector<uint32_t> delayPositions;
+  Buffer<Float> delayLines;
+  TaskExecutor* executor = nullptr;
+  // the deinterleaved input of the FIR down-sampling of all the configurations, when they are processed serially
+  Buffer<Float> sharedDownSampleInput;
+};
+
+} // namespace oversimple
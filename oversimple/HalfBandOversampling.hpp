@@ -0,0 +1,478 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "oversimple/IirOversampling.hpp"
+#include <array>
+#include <cmath>
+
+namespace oversimple::fir {
+
+/**
+ * Class to design the linear phase half-band antialiasing filters of HalfBandUpSampler and HalfBandDownSampler.
+ * Each stage is a Kaiser windowed sinc with its cutoff at a quarter of the sample rate, so that every other
+ * coefficient but the central one is zero, and only the nonzero coefficients on one side of the center are stored.
+ */
+class HalfBandDesigner final
+{
+  class Stage final
+  {
+    uint32_t numCoefs;
+    double transition;
+    std::vector<double> coefs;
+
+  public:
+    Stage(double attenuation, uint32_t numCoefs_)
+      : numCoefs(numCoefs_)
+      , transition(getTransition(attenuation, numCoefs_))
+      , coefs(designCoefs(attenuation, numCoefs_))
+    {}
+
+    /**
+     * @return the coefficients at the odd distances 1, 3, 5... from the center. The central one is 0.5.
+     */
+    std::vector<double> const& getCoefs() const
+    {
+      return coefs;
+    }
+
+    uint32_t getNumCoefs() const
+    {
+      return numCoefs;
+    }
+
+    /**
+     * @return the normalized transition bandwidth, estimated with the Kaiser formula.
+     */
+    double getTransition() const
+    {
+      return transition;
+    }
+
+    /**
+     * @return the delay of the stage, in samples at its higher sample rate
+     */
+    uint32_t getLatency() const
+    {
+      return 2 * numCoefs - 1;
+    }
+
+  private:
+    static double getTransition(double attenuation, uint32_t numCoefs)
+    {
+      auto const length = 4 * numCoefs - 1;
+      return (attenuation - 7.95) / (14.36 * (length - 1));
+    }
+
+    static double besselI0(double x)
+    {
+      double sum = 1.0;
+      double term = 1.0;
+      for (int k = 1; term > sum * 1e-17; ++k) {
+        auto const factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+      }
+      return sum;
+    }
+
+    static std::vector<double> designCoefs(double attenuation, uint32_t numCoefs)
+    {
+      constexpr double pi = 3.14159265358979323846;
+      auto const beta = attenuation > 50.0 ? 0.1102 * (attenuation - 8.7)
+                                           : 0.5842 * std::pow(attenuation - 21.0, 0.4) + 0.07886 * (attenuation - 21.0);
+      auto const halfLength = (double)(2 * numCoefs - 1);
+      auto designed = std::vector<double>(numCoefs);
+      double sum = 0.0;
+      for (uint32_t i = 0; i < numCoefs; ++i) {
+        auto const distance = (double)(2 * i + 1);
+        auto const ratio = distance / halfLength;
+        auto const window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / besselI0(beta);
+        auto const sinc = (i % 2 == 0 ? 1.0 : -1.0) / (pi * distance);
+        designed[i] = sinc * window;
+        sum += designed[i];
+      }
+      // the gain at DC is 0.5 + 2 * sum, normalized to exactly one
+      for (auto& coef : designed) {
+        coef *= 0.25 / sum;
+      }
+      return designed;
+    }
+  };
+
+  double attenuation;
+  std::vector<Stage> stages;
+
+public:
+  /**
+   * Constructor.
+   * @param attenuation stopband attenuation in dB
+   * @param numCoefs the number of nonzero coefficients on each side of the center of each stage
+   * @param numStages number of oversampling stages
+   */
+  HalfBandDesigner(double attenuation_, int const* numCoefs, uint32_t numStages)
+    : attenuation(attenuation_)
+  {
+    stages.reserve(numStages);
+    for (uint32_t i = 0; i < numStages; ++i) {
+      stages.emplace_back(attenuation, (uint32_t)numCoefs[i]);
+    }
+  }
+
+  /**
+   * @return a reference to the vector with the information specific to each stage.
+   */
+  std::vector<Stage> const& getStages() const
+  {
+    return stages;
+  }
+
+  /**
+   * @return the stopband attenuation in dB
+   */
+  double getAttenuation() const
+  {
+    return attenuation;
+  }
+
+  /**
+   * @param order the oversampling order
+   * @return the delay of the stages used by the order, in samples at the oversampled rate
+   */
+  uint32_t getStagesLatency(uint32_t order) const
+  {
+    assert(order <= stages.size());
+    uint32_t latency = 0;
+    for (uint32_t k = 0; k < order; ++k) {
+      latency += stages[k].getLatency() << (order - 1 - k);
+    }
+    return latency;
+  }
+
+  /**
+   * @param order the oversampling order
+   * @return the delay, in samples at the oversampled rate, to add to the one of the stages to make the latency a
+   * whole number of samples at the original rate
+   */
+  uint32_t getAlignmentDelay(uint32_t order) const
+  {
+    auto const rate = 1u << order;
+    return (rate - getStagesLatency(order) % rate) % rate;
+  }
+
+  /**
+   * @return the alignment delays of the orders from 1 to numOrders
+   */
+  template<uint32_t numOrders>
+  std::array<uint32_t, numOrders> getAlignmentDelays() const
+  {
+    auto delays = std::array<uint32_t, numOrders>{};
+    for (uint32_t k = 0; k < numOrders; ++k) {
+      delays[k] = getAlignmentDelay(k + 1);
+    }
+    return delays;
+  }
+
+  /**
+   * @param order the oversampling order
+   * @return the latency of an up-sampler or a down-sampler, in samples at the original rate. The latency of an
+   * up-sampler followed by a down-sampler is twice as much.
+   */
+  uint32_t getLatency(uint32_t order) const
+  {
+    return (getStagesLatency(order) + getAlignmentDelay(order)) >> order;
+  }
+
+  /**
+   * @param attenuation the stopband attenuation in dB
+   * @param transition the normalized transition bandwidth
+   * @return the number of nonzero coefficients on each side of the center needed by a stage, estimated with the Kaiser
+   * formula
+   */
+  static constexpr int getMinNumCoefs(double attenuation, double transition)
+  {
+    auto const minLength = (attenuation - 7.95) / (14.36 * transition) + 1.0;
+    auto const minNumCoefs = (minLength + 1.0) / 4.0;
+    auto const truncated = (int)minNumCoefs;
+    return truncated < minNumCoefs ? truncated + 1 : truncated;
+  }
+};
+
+namespace detail {
+
+/**
+ * Half-band FIR up-sampling stage with the interface of the HIIR ones, filtering vecSize interleaved channels. The
+ * even output samples are the input filtered by the nonzero side coefficients, folded as they are symmetric, and the
+ * odd ones are the input delayed, as the central coefficient is the only other nonzero one. The loops over the lanes
+ * have a length known at compile time, so that they are compiled to SIMD instructions. The state is stored as arrays
+ * of one value per lane, like the one of the HIIR stages.
+ */
+template<typename Float, uint32_t vecSize, int numCoefs>
+class alignas(vecSize * sizeof(Float)) HalfBandUpStage final
+{
+  static constexpr uint32_t numHistorySamples = 2 * numCoefs - 1;
+  static constexpr uint32_t blockSize = 64;
+
+  Float coefs[numCoefs][vecSize];
+  // the last numHistorySamples input samples, followed by the ones being processed
+  Float window[numHistorySamples + blockSize][vecSize];
+
+public:
+  void set_coefs(double const coefArray[])
+  {
+    for (int i = 0; i < numCoefs; ++i) {
+      std::fill_n(coefs[i], vecSize, (Float)(2.0 * coefArray[i]));
+    }
+  }
+
+  void clear_buffers()
+  {
+    std::fill_n(&window[0][0], (numHistorySamples + blockSize) * vecSize, (Float)0.0);
+  }
+
+  void process_block(Float* output, Float const* input, long numSamples)
+  {
+    while (numSamples > 0) {
+      auto const numBlockSamples = (uint32_t)std::min<long>(numSamples, blockSize);
+      std::copy(input, input + numBlockSamples * vecSize, window[numHistorySamples]);
+      for (uint32_t i = 0; i < numBlockSamples; ++i) {
+        // x[0] is the input sample delayed by numCoefs - 1 samples, which is at the center of the filter
+        auto const x = window + i + numCoefs;
+        Float even[vecSize] = {};
+        for (int c = 0; c < numCoefs; ++c) {
+          for (uint32_t lane = 0; lane < vecSize; ++lane) {
+            even[lane] += coefs[c][lane] * (x[-1 - c][lane] + x[c][lane]);
+          }
+        }
+        std::copy(even, even + vecSize, output);
+        std::copy(x[0], x[0] + vecSize, output + vecSize);
+        output += 2 * vecSize;
+      }
+      std::copy(window[numBlockSamples], window[numBlockSamples + numHistorySamples], window[0]);
+      input += numBlockSamples * vecSize;
+      numSamples -= numBlockSamples;
+    }
+  }
+};
+
+/**
+ * Half-band FIR down-sampling stage with the interface of the HIIR ones, filtering vecSize interleaved channels. Each
+ * output sample is the sum of the even input samples filtered by the nonzero side coefficients, folded as they are
+ * symmetric, and of the odd input sample at the center of the filter, weighted by the central coefficient.
+ * @see HalfBandUpStage
+ */
+template<typename Float, uint32_t vecSize, int numCoefs>
+class alignas(vecSize * sizeof(Float)) HalfBandDownStage final
+{
+  static constexpr uint32_t numHistorySamples = 4 * numCoefs - 2;
+  static constexpr uint32_t blockSize = 64;
+
+  Float coefs[numCoefs][vecSize];
+  // the last numHistorySamples input samples, followed by the ones being processed
+  Float window[numHistorySamples + 2 * blockSize][vecSize];
+
+public:
+  void set_coefs(double const coefArray[])
+  {
+    for (int i = 0; i < numCoefs; ++i) {
+      std::fill_n(coefs[i], vecSize, (Float)coefArray[i]);
+    }
+  }
+
+  void clear_buffers()
+  {
+    std::fill_n(&window[0][0], (numHistorySamples + 2 * blockSize) * vecSize, (Float)0.0);
+  }
+
+  // numSamples is the number of output samples, like for the HIIR down-samplers
+  void process_block(Float* output, Float const* input, long numSamples)
+  {
+    while (numSamples > 0) {
+      auto const numBlockSamples = (uint32_t)std::min<long>(numSamples, blockSize);
+      std::copy(input, input + 2 * numBlockSamples * vecSize, window[numHistorySamples]);
+      for (uint32_t i = 0; i < numBlockSamples; ++i) {
+        // x[0] is the input sample at the center of the filter
+        auto const x = window + 2 * (i + numCoefs) - 1;
+        Float sum[vecSize];
+        for (uint32_t lane = 0; lane < vecSize; ++lane) {
+          sum[lane] = (Float)0.5 * x[0][lane];
+        }
+        for (int c = 0; c < numCoefs; ++c) {
+          for (uint32_t lane = 0; lane < vecSize; ++lane) {
+            sum[lane] += coefs[c][lane] * (x[-1 - 2 * c][lane] + x[1 + 2 * c][lane]);
+          }
+        }
+        std::copy(sum, sum + vecSize, output);
+        output += vecSize;
+      }
+      std::copy(window[2 * numBlockSamples], window[2 * numBlockSamples + numHistorySamples], window[0]);
+      input += 2 * numBlockSamples * vecSize;
+      numSamples -= numBlockSamples;
+    }
+  }
+};
+
+inline constexpr uint32_t halfBandNumStages = 5;
+inline constexpr double halfBandAttenuation = 140.0;
+inline constexpr double halfBandTransition = 0.0443;
+// the number of nonzero coefficients on each side of the center of each stage: the smallest ones reaching the
+// attenuation, which is checked by the tests, as the Kaiser formula underestimates them for short filters
+inline constexpr int halfBandNumCoefs[halfBandNumStages] = { 56, 12, 11, 7, 7 };
+
+// like the HIIR stages, each stage after the first one has a wider transition band, as the signal it filters holds
+// no frequencies above the transition band of the first one. The Kaiser formula is used as a lower bound.
+constexpr bool areHalfBandNumCoefsEnough()
+{
+  auto transition = halfBandTransition;
+  for (uint32_t stage = 0; stage < halfBandNumStages; ++stage) {
+    if (halfBandNumCoefs[stage] < HalfBandDesigner::getMinNumCoefs(halfBandAttenuation, transition)) {
+      return false;
+    }
+    transition = 0.5 * (0.5 + transition);
+  }
+  return true;
+}
+
+static_assert(areHalfBandNumCoefsEnough(), "too few coefficients for the attenuation of the half-band filters");
+
+inline HalfBandDesigner getHalfBandDesigner()
+{
+  return HalfBandDesigner(halfBandAttenuation, halfBandNumCoefs, halfBandNumStages);
+}
+
+template<typename Float>
+struct HalfBandStages final
+{
+  template<int NC>
+  using UpStage8 = HalfBandUpStage<Float, 8, NC>;
+  template<int NC>
+  using UpStage4 = HalfBandUpStage<Float, 4, NC>;
+  template<int NC>
+  using UpStage2 = HalfBandUpStage<Float, 2, NC>;
+  template<int NC>
+  using DownStage8 = HalfBandDownStage<Float, 8, NC>;
+  template<int NC>
+  using DownStage4 = HalfBandDownStage<Float, 4, NC>;
+  template<int NC>
+  using DownStage2 = HalfBandDownStage<Float, 2, NC>;
+};
+
+template<typename Float, class StageIndices>
+struct HalfBandChains;
+
+template<typename Float, std::size_t... stageIndex>
+struct HalfBandChains<Float, std::index_sequence<stageIndex...>> final
+{
+  using Stages = HalfBandStages<Float>;
+
+  using UpSampler = iir::detail::TUpSampler<Float,
+                                            HalfBandDesigner,
+                                            Stages::template UpStage8,
+                                            Stages::template UpStage4,
+                                            Stages::template UpStage2,
+                                            halfBandNumCoefs[stageIndex]...>;
+
+  using DownSampler = iir::detail::TDownSampler<Float,
+                                                HalfBandDesigner,
+                                                Stages::template DownStage8,
+                                                Stages::template DownStage4,
+                                                Stages::template DownStage2,
+                                                halfBandNumCoefs[stageIndex]...>;
+};
+
+template<typename Float>
+using HalfBandChainsWithAllStages = HalfBandChains<Float, std::make_index_sequence<halfBandNumStages>>;
+
+} // namespace detail
+
+/**
+ * UpSampler with linear phase half-band FIR antialiasing filters, for oversampling orders from 1 to 5. It has the same
+ * interface and the same packing of the channels into SIMD lanes as iir::UpSampler, and a latency of a whole number of
+ * samples, given by getLatency. The filters have 140dB of attenuation and a transition band of 0.0443. The signals of
+ * the taps are not delayed to align them.
+ * Compared to the r8brain re-samplers, the cost grows with the filter length instead of with its logarithm, but the
+ * filters needed by power of two re-sampling are short enough for it to be lower.
+ */
+template<typename Float>
+class HalfBandUpSampler final : public detail::HalfBandChainsWithAllStages<Float>::UpSampler
+{
+  using Chain = typename detail::HalfBandChainsWithAllStages<Float>::UpSampler;
+
+public:
+  explicit HalfBandUpSampler(uint32_t numChannels, uint32_t orderToPreallocateFor = 1)
+    : Chain(detail::getHalfBandDesigner(), numChannels, orderToPreallocateFor)
+  {
+    this->setAlignmentDelays(this->getDesigner().template getAlignmentDelays<detail::halfBandNumStages>());
+  }
+
+  /**
+   * @return the latency of the current order, in samples at the original rate
+   */
+  uint32_t getLatency() const
+  {
+    return getLatency(this->order);
+  }
+
+  /**
+   * @param order the oversampling order
+   * @return the latency of the supplied order, in samples at the original rate. It does not depend on the state of the
+   * re-sampler.
+   */
+  uint32_t getLatency(uint32_t order) const
+  {
+    return this->getDesigner().getLatency(order);
+  }
+};
+
+/**
+ * DownSampler with linear phase half-band FIR antialiasing filters, for oversampling orders from 1 to 5. It has the
+ * same interface and the same packing of the channels into SIMD lanes as iir::DownSampler, and a latency of a whole
+ * number of samples, given by getLatency. The tap inputs are not delayed to align them.
+ * @see HalfBandUpSampler
+ */
+template<typename Float>
+class HalfBandDownSampler final : public detail::HalfBandChainsWithAllStages<Float>::DownSampler
+{
+  using Chain = typename detail::HalfBandChainsWithAllStages<Float>::DownSampler;
+
+public:
+  explicit HalfBandDownSampler(uint32_t numChannels, uint32_t orderToPreallocateFor = 1)
+    : Chain(detail::getHalfBandDesigner(), numChannels, orderToPreallocateFor)
+  {
+    this->setAlignmentDelays(this->getDesigner().template getAlignmentDelays<detail::halfBandNumStages>());
+  }
+
+  /**
+   * @return the latency of the current order, in samples at the original rate
+   */
+  uint32_t getLatency() const
+  {
+    return getLatency(this->order);
+  }
+
+  /**
+   * @param order the oversampling order
+   * @return the latency of the supplied order, in samples at the original rate. It does not depend on the state of the
+   * re-sampler.
+   */
+  uint32_t getLatency(uint32_t order) const
+  {
+    return this->getDesigner().getLatency(order);
+  }
+};
+
+} // namespace oversimple::fir
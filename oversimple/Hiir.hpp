@@ -17,6 +17,8 @@ limitations under the License.
 #pragma once
 
 #include "oversimple/IirOversamplingDesigner.hpp"
+#include "oversimple/IirPresets.hpp"
+#include <iterator>
 
 namespace hiir {
 struct FakeInterface
@@ -35,16 +37,16 @@ struct FakeInterface
 #else
 namespace hiir {
 template<int NC>
-class Downsampler2x8F64Avx final : public FakeInterface
+class Downsampler2x8F64Avx512 final : public FakeInterface
 {};
 template<int NC>
-class Downsampler2x16Avx final : public FakeInterface
+class Downsampler2x16Avx512 final : public FakeInterface
 {};
 template<int NC>
-class Upsampler2x8F64Avx final : public FakeInterface
+class Upsampler2x8F64Avx512 final : public FakeInterface
 {};
 template<int NC>
-class Upsampler2x16Avx final : public FakeInterface
+class Upsampler2x16Avx512 final : public FakeInterface
 {};
 } // namespace hiir
 #endif
@@ -122,21 +124,62 @@ class Upsampler2x4Neon final : public FakeInterface
 #endif
 
 namespace oversimple::iir::detail {
+
+struct PresetDesignParameters
+{
+  double attenuation;
+  double transition;
+};
+
+/**
+ * The stopband attenuation and the transition bandwidth of the first stage of each quality preset. The stages designed
+ * from them are precomputed in IirPresets.hpp, which has to be regenerated running iir-design --write-presets after
+ * any change. The presets 2, 0 and 3 are used by the low, standard and high iir::Quality tiers.
+ */
+inline constexpr PresetDesignParameters presetDesignParameters[] = { { 140.0, 0.0443 },
+                                                                    { 142.0, 0.0464 },
+                                                                    { 90.0, 0.045 },
+                                                                    { 160.0, 0.0443 } };
+
+constexpr bool arePrecomputedPresetsUpToDate()
+{
+  if (std::size(precomputedPresets) != std::size(presetDesignParameters)) {
+    return false;
+  }
+  for (size_t i = 0; i < std::size(presetDesignParameters); ++i) {
+    if (precomputedPresets[i][0].attenuation != presetDesignParameters[i].attenuation ||
+        precomputedPresets[i][0].transition != presetDesignParameters[i].transition) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// iir-design defines OVERSIMPLE_WRITING_IIR_PRESETS, as it must build to regenerate the tables when they are out of date
+#ifndef OVERSIMPLE_WRITING_IIR_PRESETS
+static_assert(arePrecomputedPresetsUpToDate(), "IirPresets.hpp is out of date, regenerate it with iir-design");
+#endif
+
 /**
  * Returns an OversamplingDesigner object implementing a quality preset for
- *  Oversampling.
+ *  Oversampling. The stages are taken from the precomputed tables, so no filter design is done at runtime unless more
+ *  stages than the precomputed ones are requested.
  * @param presetIndex an index identifying the preset
+ * @param numStages the number of stages to design
  * @return the OversamplingDesigner corresponding to the index
  */
-inline OversamplingDesigner getOversamplingPreset(int presetIndex = 0)
+inline OversamplingDesigner getOversamplingPreset(int presetIndex = 0, uint32_t numStages = 5)
 {
-  switch (presetIndex) {
-    case 0:
-    default:
-      return { 140.0, 0.0443 };
-    case 1:
-      return { 142.0, 0.0464 };
+  constexpr auto numPresets = static_cast<int>(std::size(presetDesignParameters));
+  constexpr auto numPrecomputedStages = static_cast<uint32_t>(std::size(precomputedPresets[0]));
+  if (presetIndex < 0 || presetIndex >= numPresets) {
+    presetIndex = 0;
+  }
+  if (numStages <= numPrecomputedStages && presetIndex < static_cast<int>(std::size(precomputedPresets))) {
+    return { precomputedPresets[presetIndex], numStages };
   }
+  auto const& parameters = presetDesignParameters[presetIndex];
+  return { parameters.attenuation, parameters.transition, numStages };
 }
 
 /**
@@ -154,4 +197,19 @@ inline double getOversamplingMinGroupDelay(uint32_t order, int presetIndex = 0)
   return getOversamplingPreset(presetIndex).getMinGroupDelay(order);
 }
 
+/**
+ * Returns the number of samples after which the impulse response of the IIR antialiasing filters used when
+ * oversampling with a specific oversampling order and quality preset has decayed below their stopband attenuation.
+ * @param order the oversampling order
+ * @param presetIndex the oversampling quality preset
+ * @return the decay length, in samples at the original rate
+ */
+inline double getOversamplingDecayLength(uint32_t order, int presetIndex = 0)
+{
+  if (order == 0) {
+    return 0.0;
+  }
+  return getOversamplingPreset(presetIndex).getDecayLength(order);
+}
+
 } // namespace oversimple::iir::detail
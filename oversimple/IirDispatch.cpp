@@ -0,0 +1,130 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "oversimple/IirDispatch.hpp"
+#include "oversimple/IirOversampling.hpp"
+
+#if OVERSIMPLE_IIR_DISPATCH
+
+// the IIR engines built for each instruction set, see IirEngine.hpp
+#define OVERSIMPLE_DECLARE_IIR_ENGINE(isaNamespace)                                                                    \
+  namespace oversimple::isa::isaNamespace {                                                                            \
+  template<typename Float>                                                                                             \
+  std::unique_ptr<iir::detail::PlainUpSamplerInterface<Float>> makeUpSampler(iir::Quality quality,                     \
+                                                                             uint32_t numChannels,                     \
+                                                                             uint32_t orderToPreallocateFor);          \
+  template<typename Float>                                                                                             \
+  std::unique_ptr<iir::detail::PlainDownSamplerInterface<Float>> makeDownSampler(iir::Quality quality,                 \
+                                                                                 uint32_t numChannels,                 \
+                                                                                 uint32_t orderToPreallocateFor);      \
+  }
+
+OVERSIMPLE_DECLARE_IIR_ENGINE(sse2)
+OVERSIMPLE_DECLARE_IIR_ENGINE(avx)
+OVERSIMPLE_DECLARE_IIR_ENGINE(avx2)
+OVERSIMPLE_DECLARE_IIR_ENGINE(avx512)
+
+#undef OVERSIMPLE_DECLARE_IIR_ENGINE
+
+#endif
+
+namespace oversimple::iir {
+
+InstructionSet getDispatchedInstructionSet(InstructionSet instructionSet)
+{
+#if OVERSIMPLE_IIR_DISPATCH
+  switch (instructionSet) {
+    case InstructionSet::sse2:
+    case InstructionSet::avx:
+    case InstructionSet::avx2:
+    case InstructionSet::avx512:
+      return instructionSet;
+    default:
+      break;
+  }
+#endif
+  return getCompiledInstructionSet();
+}
+
+namespace detail {
+
+template<typename Float>
+std::unique_ptr<PlainUpSamplerInterface<Float>> makeDispatchedUpSampler(InstructionSet instructionSet,
+                                                                         Quality quality,
+                                                                         uint32_t numChannels,
+                                                                         uint32_t orderToPreallocateFor)
+{
+  switch (instructionSet) {
+#if OVERSIMPLE_IIR_DISPATCH
+    case InstructionSet::sse2:
+      return isa::sse2::makeUpSampler<Float>(quality, numChannels, orderToPreallocateFor);
+    case InstructionSet::avx:
+      return isa::avx::makeUpSampler<Float>(quality, numChannels, orderToPreallocateFor);
+    case InstructionSet::avx2:
+      return isa::avx2::makeUpSampler<Float>(quality, numChannels, orderToPreallocateFor);
+    case InstructionSet::avx512:
+      return isa::avx512::makeUpSampler<Float>(quality, numChannels, orderToPreallocateFor);
+#endif
+    default:
+      return makePlainUpSampler<Float, UpSampler>(quality, numChannels, orderToPreallocateFor);
+  }
+}
+
+template<typename Float>
+std::unique_ptr<PlainDownSamplerInterface<Float>> makeDispatchedDownSampler(InstructionSet instructionSet,
+                                                                             Quality quality,
+                                                                             uint32_t numChannels,
+                                                                             uint32_t orderToPreallocateFor)
+{
+  switch (instructionSet) {
+#if OVERSIMPLE_IIR_DISPATCH
+    case InstructionSet::sse2:
+      return isa::sse2::makeDownSampler<Float>(quality, numChannels, orderToPreallocateFor);
+    case InstructionSet::avx:
+      return isa::avx::makeDownSampler<Float>(quality, numChannels, orderToPreallocateFor);
+    case InstructionSet::avx2:
+      return isa::avx2::makeDownSampler<Float>(quality, numChannels, orderToPreallocateFor);
+    case InstructionSet::avx512:
+      return isa::avx512::makeDownSampler<Float>(quality, numChannels, orderToPreallocateFor);
+#endif
+    default:
+      return makePlainDownSampler<Float, DownSampler>(quality, numChannels, orderToPreallocateFor);
+  }
+}
+
+template std::unique_ptr<PlainUpSamplerInterface<float>> makeDispatchedUpSampler<float>(InstructionSet,
+                                                                                         Quality,
+                                                                                         uint32_t,
+                                                                                         uint32_t);
+
+template std::unique_ptr<PlainUpSamplerInterface<double>> makeDispatchedUpSampler<double>(InstructionSet,
+                                                                                           Quality,
+                                                                                           uint32_t,
+                                                                                           uint32_t);
+
+template std::unique_ptr<PlainDownSamplerInterface<float>> makeDispatchedDownSampler<float>(InstructionSet,
+                                                                                             Quality,
+                                                                                             uint32_t,
+                                                                                             uint32_t);
+
+template std::unique_ptr<PlainDownSamplerInterface<double>> makeDispatchedDownSampler<double>(InstructionSet,
+                                                                                               Quality,
+                                                                                               uint32_t,
+                                                                                               uint32_t);
+
+} // namespace detail
+
+} // namespace oversimple::iir
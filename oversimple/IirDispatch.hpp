@@ -0,0 +1,294 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "oversimple/CpuFeatures.hpp"
+#include "oversimple/IirInterface.hpp"
+#include <memory>
+
+namespace oversimple::iir {
+
+/**
+ * Chooses the instruction set of the IIR engine used by DispatchedUpSampler and DispatchedDownSampler. With the
+ * oversimple_runtime_dispatch option of CMakeLists.txt, on x86 the IIR engine is built for SSE2, AVX, AVX2/FMA and
+ * AVX-512, and the widest of them not wider than instructionSet is chosen. Otherwise, it is the instruction set that
+ * UpSampler and DownSampler have been compiled for.
+ * @param instructionSet the widest instruction set that can be used
+ * @return the chosen instruction set
+ */
+InstructionSet getDispatchedInstructionSet(InstructionSet instructionSet = detectInstructionSet());
+
+namespace detail {
+
+template<typename Float>
+std::unique_ptr<PlainUpSamplerInterface<Float>> makeDispatchedUpSampler(InstructionSet instructionSet,
+                                                                         Quality quality,
+                                                                         uint32_t numChannels,
+                                                                         uint32_t orderToPreallocateFor);
+
+template<typename Float>
+std::unique_ptr<PlainDownSamplerInterface<Float>> makeDispatchedDownSampler(InstructionSet instructionSet,
+                                                                             Quality quality,
+                                                                             uint32_t numChannels,
+                                                                             uint32_t orderToPreallocateFor);
+
+} // namespace detail
+
+/**
+ * UpSampler with IIR antialiasing filters working on plain buffers, whose HIIR stages are chosen at construction
+ * according to the CPU running the program, see getDispatchedInstructionSet. It has the same filters as UpSampler, and
+ * it is a bit slower only because of a virtual call per method.
+ */
+template<typename Float>
+class DispatchedUpSampler final
+{
+  InstructionSet instructionSet;
+  std::unique_ptr<detail::PlainUpSamplerInterface<Float>> upSampler;
+
+public:
+  /**
+   * Constructor.
+   * @param numChannels the number of channels to up-sample
+   * @param orderToPreallocateFor the maximum order of oversampling to allocate the buffers for
+   * @param quality the quality tier of the antialiasing filters
+   * @param maxInstructionSet the widest instruction set that can be used, by default the one detected on the CPU
+   */
+  explicit DispatchedUpSampler(uint32_t numChannels,
+                               uint32_t orderToPreallocateFor = 1,
+                               Quality quality = Quality::standard,
+                               InstructionSet maxInstructionSet = detectInstructionSet())
+    : instructionSet{ getDispatchedInstructionSet(maxInstructionSet) }
+    , upSampler{ detail::makeDispatchedUpSampler<Float>(instructionSet,
+                                                        quality,
+                                                        numChannels,
+                                                        orderToPreallocateFor) }
+  {}
+
+  /**
+   * @return the instruction set the HIIR stages are compiled for
+   */
+  InstructionSet getInstructionSet() const
+  {
+    return instructionSet;
+  }
+
+  /**
+   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set
+   * @value the order to set
+   * @return true if the order was set correctly, false otherwise
+   */
+  bool setOrder(uint32_t value)
+  {
+    return upSampler->setOrder(value);
+  }
+
+  /**
+   * @return the order of oversampling currently in use
+   */
+  uint32_t getOrder() const
+  {
+    return upSampler->getOrder();
+  }
+
+  /**
+   * Sets the maximum order of oversampling that can be used. Allocates internal buffers accordingly.
+   * @value the maximum order to set
+   * @return true if the order was set correctly, false otherwise
+   */
+  bool setMaxOrder(uint32_t value)
+  {
+    return upSampler->setMaxOrder(value);
+  }
+
+  /**
+   * Prepares the internal buffers to receive the specified amount of samples.
+   * @param maxNumInputSamples the maximum number of samples that can be processed by a single call
+   */
+  void prepareBuffers(uint32_t maxNumInputSamples)
+  {
+    upSampler->prepareBuffers(maxNumInputSamples);
+  }
+
+  /**
+   * Sets the number of channels that the resampler can work with
+   * @value the number of channels the resampler will be able to work with
+   */
+  void setNumChannels(uint32_t value)
+  {
+    upSampler->setNumChannels(value);
+  }
+
+  /**
+   * @return the number of channels the resampler is able to work with
+   */
+  uint32_t getNumChannels() const
+  {
+    return upSampler->getNumChannels();
+  }
+
+  /**
+   * @return how the channels are packed into the SIMD lanes of the antialiasing filters
+   */
+  ChannelLayout getChannelLayout() const
+  {
+    return upSampler->getChannelLayout();
+  }
+
+  /**
+   * Resets the state of the antialiasing filters
+   */
+  void reset()
+  {
+    upSampler->reset();
+  }
+
+  /**
+   * Up-samples the input.
+   * @param input pointers to the memory holding each channel of the input
+   * @param numInputSamples the number of samples in each channel of the input
+   * @param output pointers to the memory in which to store each channel of the up-sampled signal, with room for
+   * numInputSamples * 2^order samples.
+   */
+  void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output)
+  {
+    upSampler->processBlock(input, numInputSamples, output);
+  }
+};
+
+/**
+ * DownSampler with IIR antialiasing filters working on plain buffers, whose HIIR stages are chosen at construction
+ * according to the CPU running the program, see getDispatchedInstructionSet. It has the same filters as DownSampler,
+ * and it is a bit slower only because of a virtual call per method.
+ */
+template<typename Float>
+class DispatchedDownSampler final
+{
+  InstructionSet instructionSet;
+  std::unique_ptr<detail::PlainDownSamplerInterface<Float>> downSampler;
+
+public:
+  /**
+   * Constructor.
+   * @param numChannels the number of channels to down-sample
+   * @param orderToPreallocateFor the maximum order of oversampling to allocate the buffers for
+   * @param quality the quality tier of the antialiasing filters
+   * @param maxInstructionSet the widest instruction set that can be used, by default the one detected on the CPU
+   */
+  explicit DispatchedDownSampler(uint32_t numChannels,
+                                 uint32_t orderToPreallocateFor = 1,
+                                 Quality quality = Quality::standard,
+                                 InstructionSet maxInstructionSet = detectInstructionSet())
+    : instructionSet{ getDispatchedInstructionSet(maxInstructionSet) }
+    , downSampler{ detail::makeDispatchedDownSampler<Float>(instructionSet,
+                                                            quality,
+                                                            numChannels,
+                                                            orderToPreallocateFor) }
+  {}
+
+  /**
+   * @return the instruction set the HIIR stages are compiled for
+   */
+  InstructionSet getInstructionSet() const
+  {
+    return instructionSet;
+  }
+
+  /**
+   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set
+   * @value the order to set
+   * @return true if the order was set correctly, false otherwise
+   */
+  bool setOrder(uint32_t value)
+  {
+    return downSampler->setOrder(value);
+  }
+
+  /**
+   * @return the order of oversampling currently in use
+   */
+  uint32_t getOrder() const
+  {
+    return downSampler->getOrder();
+  }
+
+  /**
+   * Sets the maximum order of oversampling that can be used. Allocates internal buffers accordingly.
+   * @value the maximum order to set
+   * @return true if the order was set correctly, false otherwise
+   */
+  bool setMaxOrder(uint32_t value)
+  {
+    return downSampler->setMaxOrder(value);
+  }
+
+  /**
+   * Prepares the internal buffers to receive the specified amount of samples.
+   * @param maxNumOutputSamples the maximum number of down-sampled samples that can be produced by a single call
+   */
+  void prepareBuffers(uint32_t maxNumOutputSamples)
+  {
+    downSampler->prepareBuffers(maxNumOutputSamples);
+  }
+
+  /**
+   * Sets the number of channels that the resampler can work with
+   * @value the number of channels the resampler will be able to work with
+   */
+  void setNumChannels(uint32_t value)
+  {
+    downSampler->setNumChannels(value);
+  }
+
+  /**
+   * @return the number of channels the resampler is able to work with
+   */
+  uint32_t getNumChannels() const
+  {
+    return downSampler->getNumChannels();
+  }
+
+  /**
+   * @return how the channels are packed into the SIMD lanes of the antialiasing filters
+   */
+  ChannelLayout getChannelLayout() const
+  {
+    return downSampler->getChannelLayout();
+  }
+
+  /**
+   * Resets the state of the antialiasing filters
+   */
+  void reset()
+  {
+    downSampler->reset();
+  }
+
+  /**
+   * Down-samples the input.
+   * @param input pointers to the memory holding each channel of the up-sampled input
+   * @param numInputSamples the number of samples in each channel of the input, which should be a multiple of the
+   * oversampling rate.
+   * @param output pointers to the memory in which to store each channel of the down-sampled signal, with room for
+   * numInputSamples / 2^order samples.
+   */
+  void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output)
+  {
+    downSampler->processBlock(input, numInputSamples, output);
+  }
+};
+
+} // namespace oversimple::iir
@@ -0,0 +1,126 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+/*
+ * Builds the IIR engine for the instruction set of the translation unit including this file, which is compiled with the
+ * architecture flags of that instruction set, see CMakeLists.txt, and defines OVERSIMPLE_ISA_NAMESPACE to its name.
+ * avec, HIIR and the IIR re-samplers are included inside the namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE, so
+ * that each instruction set has its own instantiations of their templates and inline functions, which the linker can not
+ * mix up. The headers that do not depend on the instruction set are included before, out of that namespace, and the
+ * re-samplers are exposed through the plain buffer interfaces of IirInterface.hpp.
+ * The instantiations of the standard containers on fundamental types, such as std::vector<uint32_t>, are the only code
+ * these translation units share with the rest of the library. IirDispatch.cpp, built for the architecture of the
+ * library, instantiates the same ones for its fallback engine, and the linker reaches the engines only through it, so
+ * that its copies are the ones kept.
+ */
+
+#ifndef OVERSIMPLE_ISA_NAMESPACE
+#error "OVERSIMPLE_ISA_NAMESPACE must name the instruction set the IIR engine is built for"
+#endif
+
+#include "oversimple/IirInterface.hpp"
+#include "oversimple/Instrumentation.hpp"
+#include "oversimple/TaskExecutor.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// the types shared by all the instruction sets, which the IIR engine looks for in its own namespace
+namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE::oversimple::iir {
+using ::oversimple::iir::ChannelLayout;
+using ::oversimple::iir::Quality;
+} // namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE::oversimple::iir
+
+namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE {
+#include "oversimple/IirOversampling.hpp"
+} // namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE
+
+namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE {
+
+// in this namespace, oversimple::iir is the IIR engine of the instruction set, while ::oversimple::iir holds the types
+// shared by all of them
+
+template<typename Float>
+std::unique_ptr<::oversimple::iir::detail::PlainUpSamplerInterface<Float>> makeUpSampler(
+  ::oversimple::iir::Quality quality,
+  uint32_t numChannels,
+  uint32_t orderToPreallocateFor)
+{
+  return ::oversimple::iir::detail::makePlainUpSampler<Float, oversimple::iir::UpSampler>(
+    quality, numChannels, orderToPreallocateFor);
+}
+
+template<typename Float>
+std::unique_ptr<::oversimple::iir::detail::PlainDownSamplerInterface<Float>> makeDownSampler(
+  ::oversimple::iir::Quality quality,
+  uint32_t numChannels,
+  uint32_t orderToPreallocateFor)
+{
+  return ::oversimple::iir::detail::makePlainDownSampler<Float, oversimple::iir::DownSampler>(
+    quality, numChannels, orderToPreallocateFor);
+}
+
+template std::unique_ptr<::oversimple::iir::detail::PlainUpSamplerInterface<float>> makeUpSampler<float>(
+  ::oversimple::iir::Quality,
+  uint32_t,
+  uint32_t);
+
+template std::unique_ptr<::oversimple::iir::detail::PlainUpSamplerInterface<double>> makeUpSampler<double>(
+  ::oversimple::iir::Quality,
+  uint32_t,
+  uint32_t);
+
+template std::unique_ptr<::oversimple::iir::detail::PlainDownSamplerInterface<float>> makeDownSampler<float>(
+  ::oversimple::iir::Quality,
+  uint32_t,
+  uint32_t);
+
+template std::unique_ptr<::oversimple::iir::detail::PlainDownSamplerInterface<double>> makeDownSampler<double>(
+  ::oversimple::iir::Quality,
+  uint32_t,
+  uint32_t);
+
+} // namespace oversimple::isa::OVERSIMPLE_ISA_NAMESPACE
@@ -0,0 +1,19 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// the IIR engine built with the SSE2 flags set in CMakeLists.txt, see IirEngine.hpp
+#define OVERSIMPLE_ISA_NAMESPACE sse2
+#include "oversimple/IirEngine.hpp"
@@ -0,0 +1,288 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+/*
+ * The types shared by the IIR re-samplers built for every instruction set. This file does not depend on avec or on
+ * HIIR, so that the translation units building the IIR engine for an instruction set, see IirEngine.hpp, can include it
+ * out of their namespace.
+ */
+
+#include <cstdint>
+#include <memory>
+
+namespace oversimple::iir {
+
+/**
+ * The quality tiers of the IIR antialiasing filters. Each tier is a distinct instantiation of the re-samplers, with its
+ * own number of coefficients for each stage: a lower tier trades stopband attenuation for CPU.
+ * - low: at least 90dB of attenuation, with a transition band of 0.045, and 7, 3, 2, 2, 1 coefficients.
+ * - standard: at least 140dB of attenuation, with a transition band of 0.0443, and 11, 5, 3, 3, 2 coefficients.
+ * - high: at least 160dB of attenuation, with a transition band of 0.0443, and 13, 6, 4, 3, 3 coefficients.
+ */
+enum class Quality
+{
+  low,
+  standard,
+  high
+};
+
+/**
+ * Describes how avec packs the channels of an interleaved buffer into vec buffers of 2, 4 and 8 channels, which are
+ * filtered using the SIMD lanes of the HIIR stages. The lanes that do not hold a channel are still filtered, as
+ * padding.
+ */
+struct ChannelLayout final
+{
+  uint32_t numChannels = 0;
+  uint32_t numVecBuffers2 = 0;
+  uint32_t numVecBuffers4 = 0;
+  uint32_t numVecBuffers8 = 0;
+
+  /**
+   * @return the number of SIMD lanes used to filter the channels, padding included.
+   */
+  uint32_t getNumLanes() const
+  {
+    return 2 * numVecBuffers2 + 4 * numVecBuffers4 + 8 * numVecBuffers8;
+  }
+
+  /**
+   * @return the number of SIMD lanes that are filtered without holding a channel.
+   */
+  uint32_t getNumPaddingLanes() const
+  {
+    return getNumLanes() - numChannels;
+  }
+
+  /**
+   * @return the ratio between the number of channels and the number of SIMD lanes used to filter them.
+   */
+  double getLaneUtilization() const
+  {
+    auto const numLanes = getNumLanes();
+    return numLanes > 0 ? (double)numChannels / (double)numLanes : 1.0;
+  }
+};
+
+namespace detail {
+
+/**
+ * Plain buffer interface of an UpSampler, used to hide the instruction set its HIIR stages are compiled for.
+ */
+template<typename Float>
+class PlainUpSamplerInterface
+{
+public:
+  virtual ~PlainUpSamplerInterface() = default;
+  virtual bool setOrder(uint32_t value) = 0;
+  virtual uint32_t getOrder() const = 0;
+  virtual bool setMaxOrder(uint32_t value) = 0;
+  virtual void prepareBuffers(uint32_t maxNumInputSamples) = 0;
+  virtual void setNumChannels(uint32_t value) = 0;
+  virtual uint32_t getNumChannels() const = 0;
+  virtual ChannelLayout getChannelLayout() const = 0;
+  virtual void reset() = 0;
+  virtual void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output) = 0;
+};
+
+/**
+ * Plain buffer interface of a DownSampler, used to hide the instruction set its HIIR stages are compiled for.
+ */
+template<typename Float>
+class PlainDownSamplerInterface
+{
+public:
+  virtual ~PlainDownSamplerInterface() = default;
+  virtual bool setOrder(uint32_t value) = 0;
+  virtual uint32_t getOrder() const = 0;
+  virtual bool setMaxOrder(uint32_t value) = 0;
+  virtual void prepareBuffers(uint32_t maxNumOutputSamples) = 0;
+  virtual void setNumChannels(uint32_t value) = 0;
+  virtual uint32_t getNumChannels() const = 0;
+  virtual ChannelLayout getChannelLayout() const = 0;
+  virtual void reset() = 0;
+  virtual void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output) = 0;
+};
+
+/**
+ * Implements PlainUpSamplerInterface with the UpSampler of an instruction set.
+ */
+template<typename Float, class UpSampler>
+class PlainUpSampler final : public PlainUpSamplerInterface<Float>
+{
+  UpSampler upSampler;
+
+public:
+  PlainUpSampler(uint32_t numChannels, uint32_t orderToPreallocateFor)
+    : upSampler{ numChannels, orderToPreallocateFor }
+  {}
+
+  bool setOrder(uint32_t value) override
+  {
+    return upSampler.setOrder(value);
+  }
+
+  uint32_t getOrder() const override
+  {
+    return upSampler.getOrder();
+  }
+
+  bool setMaxOrder(uint32_t value) override
+  {
+    return upSampler.setMaxOrder(value);
+  }
+
+  void prepareBuffers(uint32_t maxNumInputSamples) override
+  {
+    upSampler.prepareBuffers(maxNumInputSamples);
+  }
+
+  void setNumChannels(uint32_t value) override
+  {
+    upSampler.setNumChannels(value);
+  }
+
+  uint32_t getNumChannels() const override
+  {
+    return upSampler.getNumChannels();
+  }
+
+  ChannelLayout getChannelLayout() const override
+  {
+    return upSampler.getChannelLayout();
+  }
+
+  void reset() override
+  {
+    upSampler.reset();
+  }
+
+  void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output) override
+  {
+    upSampler.processBlock(input, numInputSamples, output);
+  }
+};
+
+/**
+ * Implements PlainDownSamplerInterface with the DownSampler of an instruction set.
+ */
+template<typename Float, class DownSampler>
+class PlainDownSampler final : public PlainDownSamplerInterface<Float>
+{
+  DownSampler downSampler;
+
+public:
+  PlainDownSampler(uint32_t numChannels, uint32_t orderToPreallocateFor)
+    : downSampler{ numChannels, orderToPreallocateFor }
+  {}
+
+  bool setOrder(uint32_t value) override
+  {
+    return downSampler.setOrder(value);
+  }
+
+  uint32_t getOrder() const override
+  {
+    return downSampler.getOrder();
+  }
+
+  bool setMaxOrder(uint32_t value) override
+  {
+    return downSampler.setMaxOrder(value);
+  }
+
+  void prepareBuffers(uint32_t maxNumOutputSamples) override
+  {
+    downSampler.prepareBuffers(maxNumOutputSamples);
+  }
+
+  void setNumChannels(uint32_t value) override
+  {
+    downSampler.setNumChannels(value);
+  }
+
+  uint32_t getNumChannels() const override
+  {
+    return downSampler.getNumChannels();
+  }
+
+  ChannelLayout getChannelLayout() const override
+  {
+    return downSampler.getChannelLayout();
+  }
+
+  void reset() override
+  {
+    downSampler.reset();
+  }
+
+  void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output) override
+  {
+    downSampler.processBlock(input, numInputSamples);
+    auto& interleavedOutput = downSampler.getOutput();
+    interleavedOutput.deinterleave(output, downSampler.getNumChannels(), interleavedOutput.getNumSamples());
+  }
+};
+
+/**
+ * Creates a PlainUpSampler of the UpSampler template of an instruction set, for a quality known at runtime.
+ */
+template<typename Float, template<typename, Quality> class UpSampler>
+std::unique_ptr<PlainUpSamplerInterface<Float>> makePlainUpSampler(Quality quality,
+                                                                    uint32_t numChannels,
+                                                                    uint32_t orderToPreallocateFor)
+{
+  switch (quality) {
+    case Quality::low:
+      return std::make_unique<PlainUpSampler<Float, UpSampler<Float, Quality::low>>>(numChannels,
+                                                                                       orderToPreallocateFor);
+    case Quality::high:
+      return std::make_unique<PlainUpSampler<Float, UpSampler<Float, Quality::high>>>(numChannels,
+                                                                                        orderToPreallocateFor);
+    case Quality::standard:
+    default:
+      return std::make_unique<PlainUpSampler<Float, UpSampler<Float, Quality::standard>>>(numChannels,
+                                                                                            orderToPreallocateFor);
+  }
+}
+
+/**
+ * Creates a PlainDownSampler of the DownSampler template of an instruction set, for a quality known at runtime.
+ */
+template<typename Float, template<typename, Quality> class DownSampler>
+std::unique_ptr<PlainDownSamplerInterface<Float>> makePlainDownSampler(Quality quality,
+                                                                        uint32_t numChannels,
+                                                                        uint32_t orderToPreallocateFor)
+{
+  switch (quality) {
+    case Quality::low:
+      return std::make_unique<PlainDownSampler<Float, DownSampler<Float, Quality::low>>>(numChannels,
+                                                                                           orderToPreallocateFor);
+    case Quality::high:
+      return std::make_unique<PlainDownSampler<Float, DownSampler<Float, Quality::high>>>(numChannels,
+                                                                                            orderToPreallocateFor);
+    case Quality::standard:
+    default:
+      return std::make_unique<PlainDownSampler<Float, DownSampler<Float, Quality::standard>>>(
+        numChannels, orderToPreallocateFor);
+  }
+}
+
+} // namespace detail
+
+} // namespace oversimple::iir
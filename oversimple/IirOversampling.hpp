@@ -16,402 +16,907 @@ limitations under the License.
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "avec/Avec.hpp"
 #include "oversimple/Hiir.hpp"
+#include "oversimple/IirInterface.hpp"
+#include "oversimple/Instrumentation.hpp"
 
 namespace oversimple::iir {
 
+/**
+ * Computes the layout used by the IIR re-samplers for a number of channels.
+ * @param numChannels the number of channels
+ * @return the layout of the channels
+ */
+template<typename Float>
+ChannelLayout getChannelLayout(uint32_t numChannels)
+{
+  auto layout = ChannelLayout{};
+  layout.numChannels = numChannels;
+  avec::getNumOfVecBuffersUsedByInterleavedBuffer<Float>(
+    numChannels, layout.numVecBuffers2, layout.numVecBuffers4, layout.numVecBuffers8);
+  if constexpr (!SimdTypes<Float>::VEC2_AVAILABLE) {
+    layout.numVecBuffers2 = 0;
+  }
+  if constexpr (!SimdTypes<Float>::VEC4_AVAILABLE) {
+    layout.numVecBuffers4 = 0;
+  }
+  if constexpr (!SimdTypes<Float>::VEC8_AVAILABLE) {
+    layout.numVecBuffers8 = 0;
+  }
+  return layout;
+}
+
 namespace detail {
 
 /**
  * A class implementing common functionality for the IIR resamplers.
+ * The antialiasing filters are a cascade of half-band stages, one for each coefficient count in numCoefs, from the
+ * stage working at the lowest sample rate to the one working at the highest. Consecutive stages are run on tiles
+ * small enough for their intermediate results to stay in the L1 cache, and only the last stage of the cascade writes
+ * to the output buffer.
+ * The stages only need the interface of the HIIR ones: the half-band FIR re-samplers of HalfBandOversampling.hpp use
+ * the same chain, with their own Designer, which provides the coefficients of each stage through getStages().
  */
 template<typename Float,
-         int numCoefsStage0,
-         int numCoefsStage1,
-         int numCoefsStage2,
-         int numCoefsStage3,
-         int numCoefsStage4,
+         class Designer,
          template<int>
          class StageVec8,
          template<int>
          class StageVec4,
          template<int>
-         class StageVec2>
+         class StageVec2,
+         int... numCoefs>
 class OversamplingChain
 {
 protected:
+  static constexpr uint32_t numStages = sizeof...(numCoefs);
+  static_assert(numStages > 0, "an OversamplingChain needs at least one stage");
+
   static constexpr bool VEC8_AVAILABLE = SimdTypes<Float>::VEC8_AVAILABLE;
   static constexpr bool VEC4_AVAILABLE = SimdTypes<Float>::VEC4_AVAILABLE;
   static constexpr bool VEC2_AVAILABLE = SimdTypes<Float>::VEC2_AVAILABLE;
 
+  // the number of samples held by each of the buffers used for the intermediate results of a tile
+  static constexpr uint32_t tileCapacity = 8192 / sizeof(Float);
+  // the number of up-sampled samples of each tile when the up-sampled signal is read from or written to plain buffers
+  static constexpr uint32_t layoutTileCapacity = tileCapacity / 8;
+
   template<class T>
   using aligned_vector = aligned_vector<T>;
 
-  aligned_vector<StageVec8<numCoefsStage0>> stage8_0;
-  aligned_vector<StageVec8<numCoefsStage1>> stage8_1;
-  aligned_vector<StageVec8<numCoefsStage2>> stage8_2;
-  aligned_vector<StageVec8<numCoefsStage3>> stage8_3;
-  aligned_vector<StageVec8<numCoefsStage4>> stage8_4;
-
-  aligned_vector<StageVec4<numCoefsStage0>> stage4_0;
-  aligned_vector<StageVec4<numCoefsStage1>> stage4_1;
-  aligned_vector<StageVec4<numCoefsStage2>> stage4_2;
-  aligned_vector<StageVec4<numCoefsStage3>> stage4_3;
-  aligned_vector<StageVec4<numCoefsStage4>> stage4_4;
-
-  aligned_vector<StageVec2<numCoefsStage0>> stage2_0;
-  aligned_vector<StageVec2<numCoefsStage1>> stage2_1;
-  aligned_vector<StageVec2<numCoefsStage2>> stage2_2;
-  aligned_vector<StageVec2<numCoefsStage3>> stage2_3;
-  aligned_vector<StageVec2<numCoefsStage4>> stage2_4;
-
-  OversamplingDesigner designer;
+  // for each stage, one filter for each interleaved buffer of 8, 4 and 2 channels
+  std::tuple<aligned_vector<StageVec8<numCoefs>>...> stages8;
+  std::tuple<aligned_vector<StageVec4<numCoefs>>...> stages4;
+  std::tuple<aligned_vector<StageVec2<numCoefs>>...> stages2;
+
+  Designer designer;
   uint32_t numChannels;
   uint32_t order;
   uint32_t maxOrder;
   uint32_t maxDownSampledSamples;
+  // buffer[0] holds samples at the original rate: the interleaved input of the up-sampler, or the output of the
+  // down-sampler; buffer[1] holds the output of the up-sampler, and is not allocated by the down-sampler
   InterleavedBuffer<Float> buffer[2];
+  bool const isUpSampler;
+  aligned_vector<Float> tile[2];
+  InterleavedBuffer<Float> layoutTile;
+  std::vector<Float*> planarPointers;
+
+  // the signals at the intermediate rates: tapBuffers[k - 1] holds the output of the up-sampler at the rate 2^k, if
+  // isTapBufferEnabled[k - 1], and tapInputs[k - 1], if not null, is added by the down-sampler to its signal at the rate 2^k
+  InterleavedBuffer<Float> tapBuffers[numStages];
+  bool isTapBufferEnabled[numStages] = {};
+  InterleavedBuffer<Float> const* tapInputs[numStages] = {};
+
+  // where each channel is stored in the interleaved buffers
+  struct ChannelLocation final
+  {
+    uint32_t vecSize = 0;
+    uint32_t vecBufferIndex = 0;
+    uint32_t lane = 0;
+  };
+  std::vector<ChannelLocation> channelLocations;
+  std::vector<uint8_t> channelActivity;
+  std::vector<uint32_t> numActiveChannels2;
+  std::vector<uint32_t> numActiveChannels4;
+  std::vector<uint32_t> numActiveChannels8;
+
+  // the silence bypass: a channel whose input is digital silence, and whose output has decayed to silenceThreshold,
+  // is bypassed until its input is not silent anymore. Its state is cleared, and the filters of the SIMD registers
+  // holding only bypassed or inactive channels are not run, so numActiveChannels counts the channels that are both
+  // active and not bypassed. nonZeroLanes holds, for each SIMD register, a mask of the lanes with a non zero input.
+  bool isBypassingSilence = false;
+  Float silenceThreshold = (Float)1.0e-7;
+  uint32_t numBypassedChannels = 0;
+  std::vector<uint8_t> channelBypass;
+  std::vector<uint8_t> isChannelInputSilent;
+  std::vector<uint32_t> nonZeroLanes2;
+  std::vector<uint32_t> nonZeroLanes4;
+  std::vector<uint32_t> nonZeroLanes8;
+
+  // delays of the up-sampled signal, at the rate 2^order, indexed by order - 1, which make the latency of the
+  // re-sampler a whole number of samples at the original rate. They are zero unless set with setAlignmentDelays, as
+  // the group delay of the IIR filters is not constant anyway. alignmentLine holds the delayed samples, and
+  // alignmentTile the up-sampled samples of a single sample at the original rate.
+  uint32_t alignmentDelays[numStages] = {};
+  InterleavedBuffer<Float> alignmentLine;
+  InterleavedBuffer<Float> alignmentTile;
+
+  Instrumentation* instrumentation = nullptr;
+  // the stages run once for each tile and each vec buffer, and the conversions of the plain buffers once for each
+  // tile, so their sections are summed over a call and recorded at its end
+  SectionAccumulator sectionAccumulator;
+#if OVERSIMPLE_INSTRUMENTATION
+  static_assert(numStages <= numInstrumentedStages, "the stages of the chain do not all have an instrumented section");
+#endif
 
-  OversamplingChain(OversamplingDesigner designer_, uint32_t numChannels_, uint32_t orderToPreallocateFor = 1)
+  OversamplingChain(Designer designer_,
+                    uint32_t numChannels_,
+                    uint32_t orderToPreallocateFor,
+                    bool isUpSampler_)
     : designer(std::move(designer_))
     , numChannels(numChannels_)
     , maxDownSampledSamples(256)
     , order(1)
     , maxOrder(orderToPreallocateFor)
+    , isUpSampler(isUpSampler_)
   {
-    assert(designer.getStages().size() == 5);
+    assert(designer.getStages().size() == numStages);
+    for (auto& t : tile) {
+      t.resize(tileCapacity);
+    }
     setupStages();
+    setupLayoutTile();
   }
 
-  void setupStages()
+  template<uint32_t vecSize>
+  auto& getStages()
   {
-    uint32_t num2, num4, num8;
-    avec::getNumOfVecBuffersUsedByInterleavedBuffer<Float>(numChannels, num2, num4, num8);
-    stage2_0.resize(num2);
-    stage2_1.resize(num2);
-    stage2_2.resize(num2);
-    stage2_3.resize(num2);
-    stage2_4.resize(num2);
-    stage4_0.resize(num4);
-    stage4_1.resize(num4);
-    stage4_2.resize(num4);
-    stage4_3.resize(num4);
-    stage4_4.resize(num4);
-    stage8_0.resize(num8);
-    stage8_1.resize(num8);
-    stage8_2.resize(num8);
-    stage8_3.resize(num8);
-    stage8_4.resize(num8);
-
-    auto& stages = designer.getStages();
-    std::vector<double> coefs;
-
-    stages[0].computeCoefs(coefs);
-    for (auto& stage : stage4_0) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_0) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_0) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    stages[1].computeCoefs(coefs);
-    for (auto& stage : stage4_1) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_1) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_1) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    stages[2].computeCoefs(coefs);
-    for (auto& stage : stage4_2) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_2) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_2) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    stages[3].computeCoefs(coefs);
-    for (auto& stage : stage4_3) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_3) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_3) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    stages[4].computeCoefs(coefs);
-    for (auto& stage : stage4_4) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_4) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_4) {
-      stage.set_coefs(&coefs[0]);
-      stage.clear_buffers();
+    static_assert(vecSize == 2 || vecSize == 4 || vecSize == 8, "unsupported vec size");
+    if constexpr (vecSize == 8) {
+      return stages8;
+    }
+    else if constexpr (vecSize == 4) {
+      return stages4;
+    }
+    else {
+      return stages2;
     }
   }
 
+  template<class Function, std::size_t... stageIndex>
+  static void forEachStageIndex(Function& function, std::index_sequence<stageIndex...>)
+  {
+    (function(std::integral_constant<std::size_t, stageIndex>{}), ...);
+  }
+
+  /**
+   * Calls function(std::integral_constant<std::size_t, stageIndex>{}) for each stage of the chain.
+   */
+  template<class Function>
+  static void forEachStageIndex(Function&& function)
+  {
+    forEachStageIndex(function, std::make_index_sequence<numStages>{});
+  }
+
+  template<class Function>
+  void forEachStage(Function&& function)
+  {
+    forEachStageIndex([&](auto stageIndex) {
+      for (auto& stage : std::get<stageIndex>(stages8)) {
+        function(stage);
+      }
+      for (auto& stage : std::get<stageIndex>(stages4)) {
+        function(stage);
+      }
+      for (auto& stage : std::get<stageIndex>(stages2)) {
+        function(stage);
+      }
+    });
+  }
+
+  void setupStages()
+  {
+    auto const layout = iir::getChannelLayout<Float>(numChannels);
+    auto& designedStages = designer.getStages();
+    forEachStageIndex([&](auto stageIndex) {
+      auto& coefs = designedStages[stageIndex].getCoefs();
+      auto const setup = [&](auto& stages, uint32_t numVecBuffers) {
+        stages.resize(numVecBuffers);
+        for (auto& stage : stages) {
+          stage.set_coefs(&coefs[0]);
+          stage.clear_buffers();
+        }
+      };
+      setup(std::get<stageIndex>(stages8), layout.numVecBuffers8);
+      setup(std::get<stageIndex>(stages4), layout.numVecBuffers4);
+      setup(std::get<stageIndex>(stages2), layout.numVecBuffers2);
+    });
+  }
+
   void setupBuffer()
   {
-    auto const maxFactor = 1 << maxOrder;
-    auto const factor = 1 << order;
-    auto const maxNumUpSampledSamples = maxDownSampledSamples * maxFactor;
-    auto const numUpSampledSamples = maxDownSampledSamples * factor;
+    auto const maxNumUpSampledSamples = maxDownSampledSamples * (1 << maxOrder);
+    buffer[0].setNumChannels(numChannels);
+    buffer[0].reserve(maxDownSampledSamples);
+    buffer[1].setNumChannels(isUpSampler ? numChannels : 0);
+    buffer[1].reserve(isUpSampler ? maxNumUpSampledSamples : 0);
     for (auto& b : buffer) {
-      b.setNumChannels(numChannels);
-      b.reserve(maxNumUpSampledSamples);
-      b.setNumSamples(numUpSampledSamples);
+      b.setNumSamples(0);
     }
+    for (uint32_t k = 1; k <= numStages; ++k) {
+      setupTapBuffer(k);
+    }
+    setupAlignmentBuffers();
   }
 
-  OversamplingDesigner const& getDesigner() const
+  bool isAligning() const
   {
-    return designer;
+    return std::any_of(std::begin(alignmentDelays), std::end(alignmentDelays), [](uint32_t d) { return d > 0; });
   }
 
-  void applyStage0(InterleavedBuffer<Float>& output, InterleavedBuffer<Float> const& input, uint32_t numSamples)
+  /**
+   * Sets the delays that make the latency a whole number of samples at the original rate, and allocates the buffers
+   * needed to apply them.
+   * @param delays the delay for each order, in samples at the rate of that order, lower than the oversampling rate
+   */
+  void setAlignmentDelays(std::array<uint32_t, numStages> const& delays)
   {
-    auto numChannelsToProcess = numChannels;
-    if constexpr (VEC2_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage2_0) {
-        auto& out = output.getBuffer2(i);
-        auto& in = input.getBuffer2(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 2;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
-      }
+    for (uint32_t k = 0; k < numStages; ++k) {
+      assert(delays[k] < (1u << (k + 1)));
+      alignmentDelays[k] = delays[k];
     }
-    if constexpr (VEC4_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage4_0) {
-        auto& out = output.getBuffer4(i);
-        auto& in = input.getBuffer4(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 4;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+    setupAlignmentBuffers();
+  }
+
+  void setupAlignmentBuffers()
+  {
+    auto const numAlignmentSamples = isAligning() ? 1u << maxOrder : 0u;
+    for (auto alignmentBuffer : { &alignmentLine, &alignmentTile }) {
+      alignmentBuffer->setNumChannels(numAlignmentSamples > 0 ? numChannels : 0);
+      alignmentBuffer->reserve(numAlignmentSamples);
+      alignmentBuffer->setNumSamples(numAlignmentSamples);
+    }
+    clearAlignmentLine();
+  }
+
+  void clearAlignmentLine()
+  {
+    if (alignmentLine.getNumChannels() == 0) {
+      return;
+    }
+    auto const numValues = alignmentLine.getNumSamples();
+    forEachVecBuffer([&](auto vecSize, uint32_t i) {
+      std::fill_n(getVecBuffer<vecSize>(alignmentLine, i), numValues * vecSize, (Float)0.0);
+    });
+  }
+
+  void setupTapBuffer(uint32_t tapOrder)
+  {
+    auto& tapBuffer = tapBuffers[tapOrder - 1];
+    if (isTapBufferEnabled[tapOrder - 1]) {
+      tapBuffer.setNumChannels(numChannels);
+      tapBuffer.reserve(maxDownSampledSamples * (1 << tapOrder));
+    }
+    else {
+      tapBuffer.setNumChannels(0);
+    }
+    tapBuffer.setNumSamples(0);
+  }
+
+  void setTapNumSamples(uint32_t numInputSamples)
+  {
+    for (uint32_t k = 1; k <= numStages; ++k) {
+      if (isTapBufferEnabled[k - 1]) {
+        assert(k >= order || tapBuffers[k - 1].getCapacity() >= (numInputSamples << k));
+        tapBuffers[k - 1].setNumSamples(k < order ? numInputSamples << k : 0);
       }
     }
-    if constexpr (VEC8_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage8_0) {
-        auto& out = output.getBuffer8(i);
-        auto& in = input.getBuffer8(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 8;
-        if (numChannelsToProcess <= 0) {
-          return;
+  }
+
+  void setupLayoutTile()
+  {
+    layoutTile.setNumChannels(numChannels);
+    layoutTile.reserve(layoutTileCapacity);
+    layoutTile.setNumSamples(0);
+    planarPointers.resize(numChannels);
+    setupChannelLocations();
+  }
+
+  // finds the lane of each channel looking at where avec stores its first sample
+  void setupChannelLocations()
+  {
+    channelLocations.assign(numChannels, ChannelLocation{});
+    channelActivity.assign(numChannels, 1);
+    channelBypass.assign(numChannels, 0);
+    isChannelInputSilent.assign(numChannels, 0);
+    numBypassedChannels = 0;
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      Float const* const sample = layoutTile.at(c, 0);
+      bool isFound = false;
+      forEachVecBuffer([&](auto vecSize, uint32_t i) {
+        Float const* const vecBuffer = getVecBuffer<vecSize>(layoutTile, i);
+        if (!std::less<Float const*>{}(sample, vecBuffer) && std::less<Float const*>{}(sample, vecBuffer + vecSize)) {
+          channelLocations[c] = ChannelLocation{ vecSize, i, static_cast<uint32_t>(sample - vecBuffer) };
+          isFound = true;
         }
+      });
+      assert(isFound);
+    }
+    numActiveChannels2.assign(std::get<0>(stages2).size(), 0);
+    numActiveChannels4.assign(std::get<0>(stages4).size(), 0);
+    numActiveChannels8.assign(std::get<0>(stages8).size(), 0);
+    nonZeroLanes2.assign(std::get<0>(stages2).size(), 0);
+    nonZeroLanes4.assign(std::get<0>(stages4).size(), 0);
+    nonZeroLanes8.assign(std::get<0>(stages8).size(), 0);
+    for (auto const& location : channelLocations) {
+      ++getNumActiveChannels(location.vecSize)[location.vecBufferIndex];
+    }
+  }
+
+  std::vector<uint32_t>& getNumActiveChannels(uint32_t vecSize)
+  {
+    assert(vecSize == 2 || vecSize == 4 || vecSize == 8);
+    return vecSize == 8 ? numActiveChannels8 : (vecSize == 4 ? numActiveChannels4 : numActiveChannels2);
+  }
+
+  std::vector<uint32_t>& getNonZeroLanes(uint32_t vecSize)
+  {
+    assert(vecSize == 2 || vecSize == 4 || vecSize == 8);
+    return vecSize == 8 ? nonZeroLanes8 : (vecSize == 4 ? nonZeroLanes4 : nonZeroLanes2);
+  }
+
+  using SampleBits = std::conditional_t<sizeof(Float) == 8, uint64_t, uint32_t>;
+
+  /**
+   * @return a mask with a bit set for each lane of an interleaved buffer of vecSize channels that holds a non zero
+   * sample. The bits of the samples are or-ed lane by lane, in a loop the compiler turns into SIMD instructions, and
+   * the sign bit is ignored, so that negative zeros are silence too.
+   */
+  template<uint32_t vecSize>
+  static uint32_t findNonZeroLanes(Float const* samples, uint32_t numSamples)
+  {
+    SampleBits bits[vecSize] = {};
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      for (uint32_t lane = 0; lane < vecSize; ++lane) {
+        SampleBits sampleBits;
+        std::memcpy(&sampleBits, samples + i * vecSize + lane, sizeof(Float));
+        bits[lane] |= sampleBits;
       }
     }
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < vecSize; ++lane) {
+      mask |= (bits[lane] << 1) != 0 ? 1u << lane : 0u;
+    }
+    return mask;
   }
 
-  void applyStage1(InterleavedBuffer<Float>& output, InterleavedBuffer<Float> const& input, uint32_t numSamples)
+  /**
+   * @return true if a plain buffer holds a non zero sample
+   * @see findNonZeroLanes
+   */
+  static bool isNonZero(Float const* samples, uint32_t numSamples)
   {
-    auto numChannelsToProcess = numChannels;
-    if constexpr (VEC2_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage2_1) {
-        auto& out = output.getBuffer2(i);
-        auto& in = input.getBuffer2(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 2;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+    SampleBits bits = 0;
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      SampleBits sampleBits;
+      std::memcpy(&sampleBits, samples + i, sizeof(Float));
+      bits |= sampleBits;
+    }
+    return (bits << 1) != 0;
+  }
+
+  /**
+   * @return true if a buffer, read with the supplied stride, holds a sample louder than the threshold
+   */
+  static bool isAboveThreshold(Float const* samples, uint32_t stride, uint32_t numSamples, Float threshold)
+  {
+    Float peak = 0.0;
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      peak = std::max(peak, std::abs(samples[i * stride]));
+    }
+    return peak > threshold;
+  }
+
+  bool canBypassSilence() const
+  {
+    return isBypassingSilence &&
+           std::none_of(std::begin(isTapBufferEnabled), std::end(isTapBufferEnabled), [](bool b) { return b; }) &&
+           std::none_of(std::begin(tapInputs), std::end(tapInputs), [](auto tapInput) { return tapInput != nullptr; });
+  }
+
+  /**
+   * Bypasses a channel, clearing its state, or stops bypassing it.
+   */
+  void setChannelBypassed(uint32_t channel, bool isBypassed)
+  {
+    if ((channelBypass[channel] != 0) == isBypassed) {
+      return;
+    }
+    channelBypass[channel] = isBypassed ? 1 : 0;
+    numBypassedChannels = isBypassed ? numBypassedChannels + 1 : numBypassedChannels - 1;
+    if (isBypassed) {
+      resetChannel(channel);
+    }
+    if (channelActivity[channel] != 0) {
+      auto const location = channelLocations[channel];
+      auto& numActive = getNumActiveChannels(location.vecSize)[location.vecBufferIndex];
+      numActive = isBypassed ? numActive - 1 : numActive + 1;
+    }
+  }
+
+  void stopBypassingChannels()
+  {
+    for (uint32_t c = 0; numBypassedChannels > 0 && c < numChannels; ++c) {
+      setChannelBypassed(c, false);
+    }
+  }
+
+  /**
+   * Before processing a block, finds the channels whose input is digital silence, and stops bypassing the others. The
+   * state of a bypassed channel is clear, so it resumes processing exactly as a reset channel would.
+   */
+  void scanInputForSilence(InterleavedBuffer<Float> const& input, uint32_t numSamples)
+  {
+    if (!canBypassSilence()) {
+      stopBypassingChannels();
+      return;
+    }
+    forEachVecBuffer([&](auto vecSize, uint32_t i) {
+      getNonZeroLanes(vecSize)[i] = findNonZeroLanes<vecSize>(getVecBuffer<vecSize>(input, i), numSamples);
+    });
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      auto const location = channelLocations[c];
+      bool const isSilent = ((getNonZeroLanes(location.vecSize)[location.vecBufferIndex] >> location.lane) & 1u) == 0;
+      isChannelInputSilent[c] = isSilent ? 1 : 0;
+      if (!isSilent) {
+        setChannelBypassed(c, false);
       }
     }
-    if constexpr (VEC4_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage4_1) {
-        auto& out = output.getBuffer4(i);
-        auto& in = input.getBuffer4(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 4;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+  }
+
+  void scanInputForSilence(Float* const* input, uint32_t numSamples)
+  {
+    if (!canBypassSilence()) {
+      stopBypassingChannels();
+      return;
+    }
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      bool const isSilent = !isNonZero(input[c], numSamples);
+      isChannelInputSilent[c] = isSilent ? 1 : 0;
+      if (!isSilent) {
+        setChannelBypassed(c, false);
       }
     }
-    if constexpr (VEC8_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage8_1) {
-        auto& out = output.getBuffer8(i);
-        auto& in = input.getBuffer8(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 8;
-        if (numChannelsToProcess <= 0) {
-          return;
+  }
+
+  /**
+   * After processing a block, bypasses the channels whose input was silent and whose output is not louder than the
+   * silence threshold.
+   * @param getChannelOutput a callable returning a pointer to the first output sample of a channel and the distance
+   * between its samples
+   */
+  template<class GetChannelOutput>
+  void bypassDecayedChannels(uint32_t numOutputSamples, GetChannelOutput&& getChannelOutput)
+  {
+    if (!canBypassSilence()) {
+      return;
+    }
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      if (isChannelInputSilent[c] != 0 && channelBypass[c] == 0 && channelActivity[c] != 0) {
+        auto const [samples, stride] = getChannelOutput(c);
+        if (!isAboveThreshold(samples, stride, numOutputSamples, silenceThreshold)) {
+          setChannelBypassed(c, true);
         }
       }
     }
   }
 
-  void applyStage2(InterleavedBuffer<Float>& output, InterleavedBuffer<Float> const& input, uint32_t numSamples)
+  void bypassDecayedChannels(InterleavedBuffer<Float> const& output, uint32_t numOutputSamples)
   {
-    auto numChannelsToProcess = numChannels;
-    if constexpr (VEC2_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage2_2) {
-        auto& out = output.getBuffer2(i);
-        auto& in = input.getBuffer2(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 2;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+    bypassDecayedChannels(numOutputSamples, [&](uint32_t c) {
+      auto const location = channelLocations[c];
+      return std::make_pair(getLaneSamples(output, location), location.vecSize);
+    });
+  }
+
+  /**
+   * @return a pointer to the first sample of a channel in an interleaved buffer, whose samples are vecSize apart
+   */
+  static Float const* getLaneSamples(InterleavedBuffer<Float> const& interleavedBuffer, ChannelLocation location)
+  {
+    if constexpr (VEC8_AVAILABLE) {
+      if (location.vecSize == 8) {
+        return getVecBuffer<8>(interleavedBuffer, location.vecBufferIndex) + location.lane;
       }
     }
     if constexpr (VEC4_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage4_2) {
-        auto& out = output.getBuffer4(i);
-        auto& in = input.getBuffer4(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 4;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+      if (location.vecSize == 4) {
+        return getVecBuffer<4>(interleavedBuffer, location.vecBufferIndex) + location.lane;
       }
     }
-    if constexpr (VEC8_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage8_2) {
-        auto& out = output.getBuffer8(i);
-        auto& in = input.getBuffer8(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 8;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+    if constexpr (VEC2_AVAILABLE) {
+      if (location.vecSize == 2) {
+        return getVecBuffer<2>(interleavedBuffer, location.vecBufferIndex) + location.lane;
+      }
+    }
+    assert(false);
+    return nullptr;
+  }
+
+  /**
+   * Writes zeros to the interleaved buffers of an output that hold no active channel, if any channel is bypassed, as
+   * the filters that would have written them were not run.
+   */
+  void clearSkippedVecBuffers(InterleavedBuffer<Float>& output, uint32_t firstSample, uint32_t numSamples)
+  {
+    if (numBypassedChannels == 0) {
+      return;
+    }
+    forEachVecBuffer([&](auto vecSize, uint32_t i) {
+      if (getNumActiveChannels(vecSize)[i] == 0) {
+        std::fill_n(getVecBuffer<vecSize>(output, i) + firstSample * vecSize, numSamples * vecSize, (Float)0.0);
       }
+    });
+  }
+
+  /**
+   * Clears the state of one lane of a HIIR stage. The HIIR stages hold their coefficients and their state as arrays of
+   * SIMD vectors, with one value per lane, and the coefficients are the same in every lane: copying a lane from a
+   * cleared copy of the stage clears the state of that lane only.
+   */
+  template<uint32_t vecSize, class Stage>
+  static void clearLane(Stage& stage, uint32_t lane)
+  {
+    static_assert(std::is_trivially_copyable_v<Stage>, "the HIIR stages should be trivially copyable");
+    static_assert(sizeof(Stage) % (vecSize * sizeof(Float)) == 0, "the HIIR stages should be arrays of vectors");
+    assert(lane < vecSize);
+    auto cleared = stage;
+    cleared.clear_buffers();
+    auto const destination = reinterpret_cast<unsigned char*>(&stage);
+    auto const source = reinterpret_cast<unsigned char const*>(&cleared);
+    for (std::size_t offset = lane * sizeof(Float); offset < sizeof(Stage); offset += vecSize * sizeof(Float)) {
+      std::memcpy(destination + offset, source + offset, sizeof(Float));
+    }
+  }
+
+  Designer const& getDesigner() const
+  {
+    return designer;
+  }
+
+  template<uint32_t vecSize>
+  static Float* getVecBuffer(InterleavedBuffer<Float>& interleavedBuffer, uint32_t vecBufferIndex)
+  {
+    if constexpr (vecSize == 8) {
+      return interleavedBuffer.getBuffer8(vecBufferIndex);
+    }
+    else if constexpr (vecSize == 4) {
+      return interleavedBuffer.getBuffer4(vecBufferIndex);
+    }
+    else {
+      return interleavedBuffer.getBuffer2(vecBufferIndex);
     }
   }
 
-  void applyStage3(InterleavedBuffer<Float>& output, InterleavedBuffer<Float> const& input, uint32_t numSamples)
+  template<uint32_t vecSize>
+  static Float const* getVecBuffer(InterleavedBuffer<Float> const& interleavedBuffer, uint32_t vecBufferIndex)
+  {
+    if constexpr (vecSize == 8) {
+      return interleavedBuffer.getBuffer8(vecBufferIndex);
+    }
+    else if constexpr (vecSize == 4) {
+      return interleavedBuffer.getBuffer4(vecBufferIndex);
+    }
+    else {
+      return interleavedBuffer.getBuffer2(vecBufferIndex);
+    }
+  }
+
+  /**
+   * Calls function(std::integral_constant<uint32_t, vecSize>{}, vecBufferIndex) for each vec buffer of the
+   * interleaved buffers.
+   */
+  template<class Function>
+  void forEachVecBuffer(Function&& function)
   {
-    auto numChannelsToProcess = numChannels;
     if constexpr (VEC2_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage2_3) {
-        auto& out = output.getBuffer2(i);
-        auto& in = input.getBuffer2(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 2;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+      for (uint32_t i = 0; i < std::get<0>(stages2).size(); ++i) {
+        function(std::integral_constant<uint32_t, 2>{}, i);
       }
     }
     if constexpr (VEC4_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage4_3) {
-        auto& out = output.getBuffer4(i);
-        auto& in = input.getBuffer4(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 4;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+      for (uint32_t i = 0; i < std::get<0>(stages4).size(); ++i) {
+        function(std::integral_constant<uint32_t, 4>{}, i);
       }
     }
     if constexpr (VEC8_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage8_3) {
-        auto& out = output.getBuffer8(i);
-        auto& in = input.getBuffer8(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 8;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+      for (uint32_t i = 0; i < std::get<0>(stages8).size(); ++i) {
+        function(std::integral_constant<uint32_t, 8>{}, i);
       }
     }
   }
 
-  void applyStage4(InterleavedBuffer<Float>& output, InterleavedBuffer<Float> const& input, uint32_t numSamples)
+  /**
+   * Like forEachVecBuffer, but skips the vec buffers that hold no active channel.
+   */
+  template<class Function>
+  void forEachActiveVecBuffer(Function&& function)
   {
-    auto numChannelsToProcess = numChannels;
-    if constexpr (VEC2_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage2_4) {
-        auto& out = output.getBuffer2(i);
-        auto& in = input.getBuffer2(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 2;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+    forEachVecBuffer([&](auto vecSize, uint32_t i) {
+      if (getNumActiveChannels(vecSize)[i] > 0) {
+        function(vecSize, i);
       }
+    });
+  }
+
+  template<uint32_t vecSize, std::size_t stageIndex>
+  auto& getStage(uint32_t vecBufferIndex)
+  {
+    return std::get<stageIndex>(getStages<vecSize>())[vecBufferIndex];
+  }
+
+  /**
+   * Up-samples an interleaved buffer of vecSize channels through the stages from 0 to order - 1. The outputs of the
+   * stages at the enabled taps are written to the tap buffers, instead of to the tiles.
+   * @param vecBufferIndex the index of the interleaved buffer
+   * @param output the interleaved output, with room for numInputSamples * 2^order samples
+   * @param input the interleaved input
+   * @param numInputSamples the number of samples to up-sample
+   * @param firstSample the position of the first input sample in the block, used to write to the tap buffers
+   */
+  template<uint32_t vecSize>
+  void upSampleVecBuffer(uint32_t vecBufferIndex,
+                         Float* output,
+                         Float const* input,
+                         uint32_t numInputSamples,
+                         uint32_t firstSample = 0)
+  {
+    // the biggest intermediate result of a tile is the input of the last stage
+    auto const maxTileSamples =
+      order == 1 ? numInputSamples : std::max(1u, tileCapacity / (vecSize << (order - 1)));
+    for (uint32_t start = 0; start < numInputSamples; start += maxTileSamples) {
+      auto numStageSamples = std::min(maxTileSamples, numInputSamples - start);
+      auto stageInput = input + start * vecSize;
+      // the stages are unrolled at compile time, so that each of them is called directly and can be inlined
+      forEachStageIndex([&](auto stage) {
+        if (stage < order) {
+          auto const stageOutput =
+            stage == order - 1
+              ? output + ((start * vecSize) << order)
+              : (isTapBufferEnabled[stage]
+                   ? getVecBuffer<vecSize>(tapBuffers[stage], vecBufferIndex) + (((firstSample + start) * vecSize) << (stage + 1))
+                   : tile[stage & 1].data());
+          OVERSIMPLE_ACCUMULATED_SECTION(
+            instrumentation, sectionAccumulator, getStageSection(true, stage), numStageSamples * vecSize);
+          getStage<vecSize, stage>(vecBufferIndex).process_block(stageOutput, stageInput, numStageSamples);
+          stageInput = stageOutput;
+          numStageSamples *= 2;
+        }
+      });
     }
-    if constexpr (VEC4_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage4_4) {
-        auto& out = output.getBuffer4(i);
-        auto& in = input.getBuffer4(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 4;
-        if (numChannelsToProcess <= 0) {
-          return;
+  }
+
+  /**
+   * Down-samples an interleaved buffer of vecSize channels through the stages from inputOrder - 1 to 0. The tap inputs
+   * are added to the outputs of the stages at their rates.
+   * @param vecBufferIndex the index of the interleaved buffer
+   * @param output the interleaved output
+   * @param input the interleaved input, holding numOutputSamples * 2^inputOrder samples
+   * @param numOutputSamples the number of samples to output
+   * @param inputOrder the order of the sample rate of the input
+   * @param firstSample the position of the first output sample in the block, used to read from the tap inputs
+   */
+  template<uint32_t vecSize>
+  void downSampleVecBuffer(uint32_t vecBufferIndex,
+                           Float* output,
+                           Float const* input,
+                           uint32_t numOutputSamples,
+                           uint32_t inputOrder,
+                           uint32_t firstSample = 0)
+  {
+    // the biggest intermediate result of a tile is the output of the first stage
+    auto const maxTileSamples =
+      inputOrder == 1 ? numOutputSamples : std::max(1u, tileCapacity / (vecSize << (inputOrder - 1)));
+    for (uint32_t start = 0; start < numOutputSamples; start += maxTileSamples) {
+      auto const numTileSamples = std::min(maxTileSamples, numOutputSamples - start);
+      Float const* stageInput = input + ((start * vecSize) << inputOrder);
+      forEachStageIndex([&](auto reverseStage) {
+        constexpr std::size_t stage = numStages - 1 - reverseStage;
+        if (stage < inputOrder) {
+          auto const pass = inputOrder - 1 - stage;
+          auto const stageOutput = stage == 0 ? output + start * vecSize : tile[pass & 1].data();
+          OVERSIMPLE_ACCUMULATED_SECTION(instrumentation,
+                                         sectionAccumulator,
+                                         getStageSection(false, stage),
+                                         (numTileSamples * vecSize) << (stage + 1));
+          getStage<vecSize, stage>(vecBufferIndex).process_block(stageOutput, stageInput, numTileSamples << stage);
+          if constexpr (stage > 0) {
+            if (auto const tapInput = tapInputs[stage - 1]) {
+              auto const tap = getVecBuffer<vecSize>(*tapInput, vecBufferIndex) +
+                               (((firstSample + start) * vecSize) << stage);
+              assert(tapInput->getNumSamples() >= ((firstSample + start + numTileSamples) << stage));
+              auto const numTapValues = (numTileSamples * vecSize) << stage;
+              for (uint32_t i = 0; i < numTapValues; ++i) {
+                stageOutput[i] += tap[i];
+              }
+            }
+          }
+          stageInput = stageOutput;
         }
+      });
+    }
+  }
+
+  /**
+   * Up-samples an interleaved buffer of vecSize channels like upSampleVecBuffer, delaying the output by the alignment
+   * delay of the current order. The up-sampled samples of all the input samples but the last are written to the output
+   * right after the delayed samples of the previous call, and the ones of the last input sample are split between the
+   * output and the delay line, so the output is never copied as a whole.
+   */
+  template<uint32_t vecSize>
+  void upSampleVecBufferAligned(uint32_t vecBufferIndex,
+                                Float* output,
+                                Float const* input,
+                                uint32_t numInputSamples,
+                                uint32_t firstSample = 0)
+  {
+    auto const delay = alignmentDelays[order - 1];
+    if (delay == 0 || numInputSamples == 0) {
+      upSampleVecBuffer<vecSize>(vecBufferIndex, output, input, numInputSamples, firstSample);
+      return;
+    }
+    auto const rate = 1u << order;
+    auto const lastSample = numInputSamples - 1;
+    auto const line = getVecBuffer<vecSize>(alignmentLine, vecBufferIndex);
+    auto const lastTile = getVecBuffer<vecSize>(alignmentTile, vecBufferIndex);
+    std::copy(line, line + delay * vecSize, output);
+    upSampleVecBuffer<vecSize>(vecBufferIndex, output + delay * vecSize, input, lastSample, firstSample);
+    upSampleVecBuffer<vecSize>(vecBufferIndex, lastTile, input + lastSample * vecSize, 1, firstSample + lastSample);
+    std::copy(lastTile, lastTile + (rate - delay) * vecSize, output + (lastSample * rate + delay) * vecSize);
+    std::copy(lastTile + (rate - delay) * vecSize, lastTile + rate * vecSize, line);
+  }
+
+  /**
+   * Down-samples an interleaved buffer of vecSize channels like downSampleVecBuffer, delaying the input by the
+   * alignment delay of inputOrder. Only the first output sample is computed from a copy of its input, which holds the
+   * delayed samples of the previous call.
+   */
+  template<uint32_t vecSize>
+  void downSampleVecBufferAligned(uint32_t vecBufferIndex,
+                                  Float* output,
+                                  Float const* input,
+                                  uint32_t numOutputSamples,
+                                  uint32_t inputOrder,
+                                  uint32_t firstSample = 0)
+  {
+    auto const delay = alignmentDelays[inputOrder - 1];
+    if (delay == 0 || numOutputSamples == 0) {
+      downSampleVecBuffer<vecSize>(vecBufferIndex, output, input, numOutputSamples, inputOrder, firstSample);
+      return;
+    }
+    auto const rate = 1u << inputOrder;
+    auto const line = getVecBuffer<vecSize>(alignmentLine, vecBufferIndex);
+    auto const firstTile = getVecBuffer<vecSize>(alignmentTile, vecBufferIndex);
+    std::copy(line, line + delay * vecSize, firstTile);
+    std::copy(input, input + (rate - delay) * vecSize, firstTile + delay * vecSize);
+    downSampleVecBuffer<vecSize>(vecBufferIndex, output, firstTile, 1, inputOrder, firstSample);
+    downSampleVecBuffer<vecSize>(vecBufferIndex,
+                                 output + vecSize,
+                                 input + (rate - delay) * vecSize,
+                                 numOutputSamples - 1,
+                                 inputOrder,
+                                 firstSample + 1);
+    auto const end = input + numOutputSamples * rate * vecSize;
+    std::copy(end - delay * vecSize, end, line);
+  }
+
+  void upSample(InterleavedBuffer<Float>& output, InterleavedBuffer<Float> const& input, uint32_t numInputSamples)
+  {
+    OVERSIMPLE_SCOPED_ACCUMULATION(instrumentation, sectionAccumulator);
+    scanInputForSilence(input, numInputSamples);
+    forEachActiveVecBuffer([&](auto vecSize, uint32_t i) {
+      upSampleVecBufferAligned<vecSize>(
+        i, getVecBuffer<vecSize>(output, i), getVecBuffer<vecSize>(input, i), numInputSamples);
+    });
+    clearSkippedVecBuffers(output, 0, numInputSamples << order);
+    bypassDecayedChannels(output, numInputSamples << order);
+  }
+
+  void downSample(InterleavedBuffer<Float>& output,
+                  InterleavedBuffer<Float> const& input,
+                  uint32_t numOutputSamples,
+                  uint32_t inputOrder)
+  {
+    OVERSIMPLE_SCOPED_ACCUMULATION(instrumentation, sectionAccumulator);
+    scanInputForSilence(input, numOutputSamples << inputOrder);
+    forEachActiveVecBuffer([&](auto vecSize, uint32_t i) {
+      downSampleVecBufferAligned<vecSize>(
+        i, getVecBuffer<vecSize>(output, i), getVecBuffer<vecSize>(input, i), numOutputSamples, inputOrder);
+    });
+    clearSkippedVecBuffers(output, 0, numOutputSamples);
+    bypassDecayedChannels(output, numOutputSamples);
+  }
+
+  /**
+   * Up-samples to plain buffers. Each tile of the up-sampled signal is deinterleaved to the output while it is still
+   * in cache, so the up-sampled signal is never written to an interleaved buffer of the size of the whole block.
+   */
+  void upSample(Float* const* output, InterleavedBuffer<Float> const& input, uint32_t numInputSamples)
+  {
+    OVERSIMPLE_SCOPED_ACCUMULATION(instrumentation, sectionAccumulator);
+    scanInputForSilence(input, numInputSamples);
+    auto const maxTileSamples = std::max(layoutTileCapacity >> order, 1u);
+    for (uint32_t start = 0; start < numInputSamples; start += maxTileSamples) {
+      auto const numTileSamples = std::min(maxTileSamples, numInputSamples - start);
+      auto const numUpSampledTileSamples = numTileSamples << order;
+      layoutTile.setNumSamples(numUpSampledTileSamples);
+      forEachActiveVecBuffer([&](auto vecSize, uint32_t i) {
+        upSampleVecBufferAligned<vecSize>(i,
+                                          getVecBuffer<vecSize>(layoutTile, i),
+                                          getVecBuffer<vecSize>(input, i) + start * vecSize,
+                                          numTileSamples,
+                                          start);
+      });
+      clearSkippedVecBuffers(layoutTile, 0, numUpSampledTileSamples);
+      for (uint32_t c = 0; c < numChannels; ++c) {
+        planarPointers[c] = output[c] + (start << order);
       }
+      OVERSIMPLE_ACCUMULATED_SECTION(
+        instrumentation, sectionAccumulator, Section::interleaving, numUpSampledTileSamples * numChannels);
+      bool const ok = layoutTile.deinterleave(planarPointers.data(), numChannels, numUpSampledTileSamples);
+      assert(ok);
     }
-    if constexpr (VEC8_AVAILABLE) {
-      uint32_t i = 0;
-      for (auto& stage : stage8_4) {
-        auto& out = output.getBuffer8(i);
-        auto& in = input.getBuffer8(i);
-        stage.process_block(out, in, numSamples);
-        ++i;
-        numChannelsToProcess -= 8;
-        if (numChannelsToProcess <= 0) {
-          return;
-        }
+    bypassDecayedChannels(numInputSamples << order,
+                          [&](uint32_t c) { return std::make_pair(static_cast<Float const*>(output[c]), 1u); });
+  }
+
+  /**
+   * Down-samples from plain buffers. Each tile of the input is interleaved right before being filtered, so the
+   * up-sampled signal is never written to an interleaved buffer of the size of the whole block.
+   */
+  void downSample(InterleavedBuffer<Float>& output, Float* const* input, uint32_t numOutputSamples)
+  {
+    OVERSIMPLE_SCOPED_ACCUMULATION(instrumentation, sectionAccumulator);
+    scanInputForSilence(input, numOutputSamples << order);
+    auto const maxTileSamples = std::max(layoutTileCapacity >> order, 1u);
+    for (uint32_t start = 0; start < numOutputSamples; start += maxTileSamples) {
+      auto const numTileSamples = std::min(maxTileSamples, numOutputSamples - start);
+      auto const numUpSampledTileSamples = numTileSamples << order;
+      for (uint32_t c = 0; c < numChannels; ++c) {
+        planarPointers[c] = input[c] + (start << order);
+      }
+      layoutTile.setNumSamples(numUpSampledTileSamples);
+      {
+        OVERSIMPLE_ACCUMULATED_SECTION(
+          instrumentation, sectionAccumulator, Section::interleaving, numUpSampledTileSamples * numChannels);
+        bool const ok = layoutTile.interleave(planarPointers.data(), numChannels, numUpSampledTileSamples);
+        assert(ok);
       }
+      forEachActiveVecBuffer([&](auto vecSize, uint32_t i) {
+        downSampleVecBufferAligned<vecSize>(i,
+                                            getVecBuffer<vecSize>(output, i) + start * vecSize,
+                                            getVecBuffer<vecSize>(layoutTile, i),
+                                            numTileSamples,
+                                            order,
+                                            start);
+      });
     }
+    clearSkippedVecBuffers(output, 0, numOutputSamples);
+    bypassDecayedChannels(output, numOutputSamples);
   }
 
 public:
@@ -430,7 +935,7 @@ public:
    */
   bool setOrder(uint32_t value)
   {
-    if (value < 1 || value > 5) {
+    if (value < 1 || value > numStages) {
       return false;
     }
     order = value;
@@ -444,7 +949,7 @@ public:
    */
   bool setMaxOrder(uint32_t value)
   {
-    if (value < 1 || value > 5) {
+    if (value < 1 || value > numStages) {
       return false;
     }
     maxOrder = value;
@@ -470,8 +975,9 @@ public:
   void setNumChannels(uint32_t value)
   {
     numChannels = value;
-    setupBuffer();
     setupStages();
+    setupBuffer();
+    setupLayoutTile();
   }
 
   /**
@@ -482,85 +988,187 @@ public:
     return numChannels;
   }
 
+  /**
+   * @return how the channels are packed into the SIMD lanes of the antialiasing filters
+   */
+  ChannelLayout getChannelLayout() const
+  {
+    auto layout = ChannelLayout{};
+    layout.numChannels = numChannels;
+    layout.numVecBuffers2 = (uint32_t)std::get<0>(stages2).size();
+    layout.numVecBuffers4 = (uint32_t)std::get<0>(stages4).size();
+    layout.numVecBuffers8 = (uint32_t)std::get<0>(stages8).size();
+    return layout;
+  }
+
   /**
    * Resets the state of the antialiasing filters
    */
   void reset()
   {
-    for (auto& stage : stage8_0) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_1) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_2) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_3) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage8_4) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage4_0) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage4_1) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage4_2) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage4_3) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage4_4) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_0) {
-      stage.clear_buffers();
-    }
-    for (auto& stage : stage2_1) {
-      stage.clear_buffers();
+    forEachStage([](auto& stage) { stage.clear_buffers(); });
+    clearAlignmentLine();
+  }
+
+  /**
+   * Resets the state of the antialiasing filters. After processing silence their state decays to zero, which is what
+   * reset sets it to, so priming them does not require processing anything.
+   */
+  void prime()
+  {
+    reset();
+  }
+
+  /**
+   * Resets the state of the antialiasing filters of a single channel, leaving the other channels untouched.
+   * @param channel the channel to reset
+   */
+  void resetChannel(uint32_t channel)
+  {
+    assert(channel < numChannels);
+    auto const location = channelLocations[channel];
+    forEachStageIndex([&](auto stageIndex) {
+      if constexpr (VEC2_AVAILABLE) {
+        if (location.vecSize == 2) {
+          clearLane<2>(std::get<stageIndex>(stages2)[location.vecBufferIndex], location.lane);
+        }
+      }
+      if constexpr (VEC4_AVAILABLE) {
+        if (location.vecSize == 4) {
+          clearLane<4>(std::get<stageIndex>(stages4)[location.vecBufferIndex], location.lane);
+        }
+      }
+      if constexpr (VEC8_AVAILABLE) {
+        if (location.vecSize == 8) {
+          clearLane<8>(std::get<stageIndex>(stages8)[location.vecBufferIndex], location.lane);
+        }
+      }
+    });
+    if (alignmentLine.getNumChannels() > 0) {
+      for (uint32_t s = 0; s < alignmentLine.getNumSamples(); ++s) {
+        *alignmentLine.at(channel, s) = 0.0;
+      }
     }
-    for (auto& stage : stage2_2) {
-      stage.clear_buffers();
+  }
+
+  /**
+   * Marks a channel as active or inactive. The antialiasing filters of the SIMD registers holding only inactive
+   * channels are not run, and the output of an inactive channel is unspecified. All the channels are active after a
+   * call to setNumChannels.
+   * @param channel the channel to activate or deactivate
+   * @param isActive true to activate the channel, false to deactivate it
+   */
+  void setChannelActive(uint32_t channel, bool isActive)
+  {
+    assert(channel < numChannels);
+    if (isChannelActive(channel) == isActive) {
+      return;
     }
-    for (auto& stage : stage2_3) {
-      stage.clear_buffers();
+    channelActivity[channel] = isActive ? 1 : 0;
+    if (channelBypass[channel] != 0) {
+      return;
     }
-    for (auto& stage : stage2_4) {
-      stage.clear_buffers();
+    auto const location = channelLocations[channel];
+    auto& numActive = getNumActiveChannels(location.vecSize)[location.vecBufferIndex];
+    numActive = isActive ? numActive + 1 : numActive - 1;
+  }
+
+  /**
+   * @return true if the channel is active, false otherwise
+   */
+  bool isChannelActive(uint32_t channel) const
+  {
+    assert(channel < numChannels);
+    return channelActivity[channel] != 0;
+  }
+
+  /**
+   * Enables or disables the silence bypass. When it is enabled, the input of each channel is scanned for digital
+   * silence before processing each block, and a channel whose input is silent and whose output has decayed to the
+   * silence threshold is bypassed: its state is cleared, its output is zeros, and the filters of the SIMD registers
+   * holding only bypassed or inactive channels are not run. As soon as the input of a bypassed channel has a non zero
+   * sample, it is processed again from the beginning of that block, as a reset channel, so it only differs from the
+   * processing without the bypass by the tail below the threshold that was cleared. Channels are never bypassed while
+   * a tap is enabled or a tap input is set.
+   * @param value true to enable the bypass, false to disable it
+   */
+  void setBypassingSilence(bool value)
+  {
+    isBypassingSilence = value;
+    if (!value) {
+      stopBypassingChannels();
     }
   }
+
+  /**
+   * @return true if the silence bypass is enabled, false otherwise
+   */
+  bool getBypassingSilence() const
+  {
+    return isBypassingSilence;
+  }
+
+  /**
+   * Sets the level to which the output of a channel with a silent input has to decay before bypassing it.
+   * @param value the threshold, as an absolute sample value
+   */
+  void setSilenceThreshold(Float value)
+  {
+    silenceThreshold = value;
+  }
+
+  /**
+   * @return the level to which the output of a channel with a silent input has to decay before bypassing it
+   */
+  Float getSilenceThreshold() const
+  {
+    return silenceThreshold;
+  }
+
+  /**
+   * @return true if the channel is bypassed because of its silence, false otherwise
+   */
+  bool isChannelBypassed(uint32_t channel) const
+  {
+    assert(channel < numChannels);
+    return channelBypass[channel] != 0;
+  }
+
+  /**
+   * Sets the Instrumentation that collects the time spent in each stage and in the interleaving. Only has an effect
+   * if OVERSIMPLE_INSTRUMENTATION is 1.
+   * @param value the Instrumentation to use, or nullptr to not collect anything. It must outlive its use by the object.
+   */
+  void setInstrumentation(Instrumentation* value)
+  {
+    instrumentation = value;
+  }
+
+  /**
+   * @return the Instrumentation that collects the time spent in each stage, or nullptr if there is none
+   */
+  Instrumentation* getInstrumentation() const
+  {
+    return instrumentation;
+  }
 };
 
 /**
  * DownSampler with IIR antialiasing filters.
  */
 template<typename Float,
-         int numCoefsStage0,
-         int numCoefsStage1,
-         int numCoefsStage2,
-         int numCoefsStage3,
-         int numCoefsStage4,
+         class Designer,
          template<int>
          class StageVec8,
          template<int>
          class StageVec4,
          template<int>
-         class StageVec2>
-class TDownSampler
-  : public OversamplingChain<Float,
-                             numCoefsStage0,
-                             numCoefsStage1,
-                             numCoefsStage2,
-                             numCoefsStage3,
-                             numCoefsStage4,
-                             StageVec8,
-                             StageVec4,
-                             StageVec2>
+         class StageVec2,
+         int... numCoefs>
+class TDownSampler : public OversamplingChain<Float, Designer, StageVec8, StageVec4, StageVec2, numCoefs...>
 {
+  using Chain = OversamplingChain<Float, Designer, StageVec8, StageVec4, StageVec2, numCoefs...>;
+
 public:
   /**
    * Constructor.
@@ -570,107 +1178,127 @@ public:
    * with
    * @param orderToPreallocateFor the maximum order of oversampling for which to allocate resources for
    */
-  TDownSampler(OversamplingDesigner const& designer, uint32_t numChannels, uint32_t orderToPreallocateFor = 1)
-    : OversamplingChain<Float,
-                        numCoefsStage0,
-                        numCoefsStage1,
-                        numCoefsStage2,
-                        numCoefsStage3,
-                        numCoefsStage4,
-                        StageVec8,
-                        StageVec4,
-                        StageVec2>(designer, numChannels, orderToPreallocateFor)
-  {}
+  TDownSampler(Designer const& designer, uint32_t numChannels, uint32_t orderToPreallocateFor = 1)
+    : Chain(designer, numChannels, orderToPreallocateFor, false)
+  {}
+
+  /**
+   * Down-samples an input at an intermediate rate, running only the stages below it. The stages above the input rate
+   * keep their state, so an input at the full rate of the current order can be processed by the next call.
+   * @param input an InterleavedBuffer holding the input, at the rate 2^inputOrder. Its number of samples should be a
+   * multiple of 2^inputOrder.
+   * @param inputOrder the order of the rate of the input, from 1 to the maximum order
+   * @see setTapInput
+   */
+  void processBlock(InterleavedBuffer<Float> const& input, uint32_t inputOrder)
+  {
+    assert(inputOrder >= 1 && inputOrder <= this->maxOrder);
+    assert(this->numChannels == input.getNumChannels());
+    auto const numSamples = input.getNumSamples();
+    assert(numSamples <= this->maxDownSampledSamples * (1 << inputOrder));
+    auto const numOutputSamples = numSamples >> inputOrder;
+    auto& output = this->buffer[0];
+    assert(output.getCapacity() >= numOutputSamples);
+    output.setNumSamples(numOutputSamples);
+    this->downSample(output, input, numOutputSamples, inputOrder);
+  }
+
+  /**
+   * Sets a signal at an intermediate rate to be added to the signal being down-sampled, right before the stages
+   * below that rate, so that the signals at different rates share the lower stages. For example, the output of a
+   * processor working at 2x can be mixed with the output of one working at 8x, and the two down-sampled with a
+   * single call.
+   * @param tapOrder the order of the rate of the tap input, lower than the order of the rate of the input of the
+   * processing calls, which ignore it otherwise
+   * @param tapInput an InterleavedBuffer holding, for each processing call, numOutputSamples * 2^tapOrder samples at
+   * the rate 2^tapOrder, with the same number of channels as the DownSampler; or nullptr to remove the tap input. It
+   * must outlive its use by the DownSampler.
+   * @return true if tapOrder is valid, false otherwise
+   */
+  bool setTapInput(uint32_t tapOrder, InterleavedBuffer<Float> const* tapInput)
+  {
+    if (tapOrder < 1 || tapOrder >= Chain::numStages) {
+      return false;
+    }
+    assert(!tapInput || tapInput->getNumChannels() == this->numChannels);
+    this->tapInputs[tapOrder - 1] = tapInput;
+    return true;
+  }
+
+  /**
+   * @return the tap input at the rate 2^tapOrder, or nullptr if there is none
+   */
+  InterleavedBuffer<Float> const* getTapInput(uint32_t tapOrder) const
+  {
+    assert(tapOrder >= 1 && tapOrder <= Chain::numStages);
+    return this->tapInputs[tapOrder - 1];
+  }
 
   /**
    * Down-samples the input.
-   * @param input an InterleavedBuffer holding the input
+   * @param input an InterleavedBuffer holding the input. Its number of samples should be a multiple of the
+   * oversampling rate.
    */
   void processBlock(InterleavedBuffer<Float> const& input)
   {
     assert(this->numChannels == input.getNumChannels());
     auto const numSamples = input.getNumSamples();
-    auto const numUpSampledSamples = this->maxDownSampledSamples * (1 << this->order);
-    assert(numSamples <= numUpSampledSamples);
+    assert(numSamples <= this->maxDownSampledSamples * (1 << this->order));
+    auto const numOutputSamples = numSamples >> this->order;
+    auto& output = this->buffer[0];
+    assert(output.getCapacity() >= numOutputSamples);
+    output.setNumSamples(numOutputSamples);
+    this->downSample(output, input, numOutputSamples, this->order);
+  }
 
+  /**
+   * Down-samples the input.
+   * @param input pointers to the memory holding each channel of the input
+   * @param numSamples the number of samples in each channel of the input, which should be a multiple of the
+   * oversampling rate.
+   */
+  void processBlock(Float* const* input, uint32_t numSamples)
+  {
+    assert(numSamples <= this->maxDownSampledSamples * (1 << this->order));
+    auto const numOutputSamples = numSamples >> this->order;
     auto& output = this->buffer[0];
-    auto& temp = this->buffer[1];
-
-    switch (this->order) {
-      case 1: {
-        this->applyStage0(output, input, numSamples / 2);
-      } break;
-      case 2: {
-        this->applyStage1(temp, input, numSamples / 2);
-        this->applyStage0(output, temp, numSamples / 4);
-      } break;
-      case 3: {
-        this->applyStage2(output, input, numSamples / 2);
-        this->applyStage1(temp, output, numSamples / 4);
-        this->applyStage0(output, temp, numSamples / 8);
-      } break;
-      case 4: {
-        this->applyStage3(temp, input, numSamples / 2);
-        this->applyStage2(output, temp, numSamples / 4);
-        this->applyStage1(temp, output, numSamples / 8);
-        this->applyStage0(output, temp, numSamples / 16);
-      } break;
-      case 5: {
-        this->applyStage4(output, input, numSamples / 2);
-        this->applyStage3(temp, output, numSamples / 4);
-        this->applyStage2(output, temp, numSamples / 8);
-        this->applyStage1(temp, output, numSamples / 16);
-        this->applyStage0(output, temp, numSamples / 32);
-      } break;
-      default:
-        assert(false);
-    }
-  }
-
-  /**
-   * @return an InterleavedBuffer holding the output
+    assert(output.getCapacity() >= numOutputSamples);
+    output.setNumSamples(numOutputSamples);
+    this->downSample(output, input, numOutputSamples);
+  }
+
+  /**
+   * @return an InterleavedBuffer holding the output, with as many samples as the last processed block produced
    */
   InterleavedBuffer<Float>& getOutput()
   {
     return this->buffer[0];
   }
+
+  /**
+   * @return a const InterleavedBuffer holding the output, with as many samples as the last processed block produced
+   */
+  InterleavedBuffer<Float> const& getOutput() const
+  {
+    return this->buffer[0];
+  }
 };
 
 /**
  * UpSampler with IIR antialiasing filters.
  */
 template<typename Float,
-         int numCoefsStage0,
-         int numCoefsStage1,
-         int numCoefsStage2,
-         int numCoefsStage3,
-         int numCoefsStage4,
+         class Designer,
          template<int>
          class StageVec8,
          template<int>
          class StageVec4,
          template<int>
-         class StageVec2>
-class TUpSampler
-  : public OversamplingChain<Float,
-                             numCoefsStage0,
-                             numCoefsStage1,
-                             numCoefsStage2,
-                             numCoefsStage3,
-                             numCoefsStage4,
-                             StageVec8,
-                             StageVec4,
-                             StageVec2>
+         class StageVec2,
+         int... numCoefs>
+class TUpSampler : public OversamplingChain<Float, Designer, StageVec8, StageVec4, StageVec2, numCoefs...>
 {
-  using Chain = OversamplingChain<Float,
-                                  numCoefsStage0,
-                                  numCoefsStage1,
-                                  numCoefsStage2,
-                                  numCoefsStage3,
-                                  numCoefsStage4,
-                                  StageVec8,
-                                  StageVec4,
-                                  StageVec2>;
+  using Chain = OversamplingChain<Float, Designer, StageVec8, StageVec4, StageVec2, numCoefs...>;
 
 public:
   /**
@@ -681,9 +1309,48 @@ public:
    * with
    * @param orderToPreallocateFor the maximum order of oversampling for which to allocate resources for
    */
-  TUpSampler(OversamplingDesigner const& designer, uint32_t numChannels, uint32_t orderToPreallocateFor)
-    : Chain(designer, numChannels, orderToPreallocateFor)
+  TUpSampler(Designer const& designer, uint32_t numChannels, uint32_t orderToPreallocateFor)
+    : Chain(designer, numChannels, orderToPreallocateFor, true)
   {}
+
+  /**
+   * Enables or disables the tap at an intermediate rate. The signal at the rate 2^tapOrder is computed anyway by the
+   * stages of the orders higher than tapOrder: when the tap is enabled, it is written to a buffer, which can be read
+   * with getTapOutput, so that the signals at different rates can be obtained from a single processing call.
+   * Allocates the buffer.
+   * @param tapOrder the order of the rate of the tap
+   * @param isEnabled true to enable the tap, false to disable it
+   * @return true if tapOrder is valid, false otherwise
+   */
+  bool setTapEnabled(uint32_t tapOrder, bool isEnabled)
+  {
+    if (tapOrder < 1 || tapOrder >= Chain::numStages) {
+      return false;
+    }
+    this->isTapBufferEnabled[tapOrder - 1] = isEnabled;
+    this->setupTapBuffer(tapOrder);
+    return true;
+  }
+
+  /**
+   * @return true if the tap at the rate 2^tapOrder is enabled, false otherwise
+   */
+  bool isTapEnabled(uint32_t tapOrder) const
+  {
+    assert(tapOrder >= 1 && tapOrder <= Chain::numStages);
+    return this->isTapBufferEnabled[tapOrder - 1];
+  }
+
+  /**
+   * @return an InterleavedBuffer holding the signal at the rate 2^tapOrder of the last processed block. It holds no
+   * samples if tapOrder is not lower than the current order, as the signal at that rate is the output.
+   * @see setTapEnabled
+   */
+  InterleavedBuffer<Float> const& getTapOutput(uint32_t tapOrder) const
+  {
+    assert(isTapEnabled(tapOrder));
+    return this->tapBuffers[tapOrder - 1];
+  }
   /**
    * Up-samples an already interleaved input.
    * @param input an InterleavedBuffer<Float> holding the input samples
@@ -696,43 +1363,13 @@ public:
     assert(numInputSamples <= this->maxDownSampledSamples);
 
     auto& output = this->buffer[1];
-    auto& temp = this->buffer[0];
 
-    auto const numUpSampledSamples = this->maxDownSampledSamples * (1 << this->order);
+    auto const numUpSampledSamples = numInputSamples << this->order;
     assert(output.getCapacity() >= numUpSampledSamples);
-    assert(temp.getCapacity() >= numUpSampledSamples);
-    temp.setNumSamples(numUpSampledSamples);
     output.setNumSamples(numUpSampledSamples);
 
-    switch (this->order) {
-      case 1: {
-        this->applyStage0(output, input, numInputSamples);
-      } break;
-      case 2: {
-        this->applyStage0(temp, input, numInputSamples);
-        this->applyStage1(output, temp, numInputSamples * 2);
-      } break;
-      case 3: {
-        this->applyStage0(output, input, numInputSamples);
-        this->applyStage1(temp, output, numInputSamples * 2);
-        this->applyStage2(output, temp, numInputSamples * 4);
-      } break;
-      case 4: {
-        this->applyStage0(temp, input, numInputSamples);
-        this->applyStage1(output, temp, numInputSamples * 2);
-        this->applyStage2(temp, output, numInputSamples * 4);
-        this->applyStage3(output, temp, numInputSamples * 8);
-      } break;
-      case 5: {
-        this->applyStage0(output, input, numInputSamples);
-        this->applyStage1(temp, output, numInputSamples * 2);
-        this->applyStage2(output, temp, numInputSamples * 4);
-        this->applyStage3(temp, output, numInputSamples * 8);
-        this->applyStage4(output, temp, numInputSamples * 16);
-      } break;
-      default:
-        assert(false);
-    }
+    this->setTapNumSamples(numInputSamples);
+    this->upSample(output, input, numInputSamples);
   }
 
   /**
@@ -745,46 +1382,17 @@ public:
   {
     assert(numInputSamples <= this->maxDownSampledSamples);
 
-    auto const numUpSampledSamples = this->maxDownSampledSamples * (1 << this->order);
-    assert(this->buffer[0].getCapacity() >= numUpSampledSamples);
+    auto const numUpSampledSamples = numInputSamples << this->order;
     assert(this->buffer[1].getCapacity() >= numUpSampledSamples);
-    this->buffer[0].setNumSamples(numUpSampledSamples);
+    this->buffer[0].setNumSamples(numInputSamples);
     this->buffer[1].setNumSamples(numUpSampledSamples);
 
-    switch (this->order) {
-      case 1: {
-        this->buffer[0].interleave(inputs, this->numChannels, numInputSamples);
-        this->applyStage0(this->buffer[1], this->buffer[0], numInputSamples);
-      } break;
-      case 2: {
-        this->buffer[1].interleave(inputs, this->numChannels, numInputSamples);
-        this->applyStage0(this->buffer[0], this->buffer[1], numInputSamples);
-        this->applyStage1(this->buffer[1], this->buffer[0], numInputSamples * 2);
-      } break;
-      case 3: {
-        this->buffer[0].interleave(inputs, this->numChannels, numInputSamples);
-        this->applyStage0(this->buffer[1], this->buffer[0], numInputSamples);
-        this->applyStage1(this->buffer[0], this->buffer[1], numInputSamples * 2);
-        this->applyStage2(this->buffer[1], this->buffer[0], numInputSamples * 4);
-      } break;
-      case 4: {
-        this->buffer[1].interleave(inputs, this->numChannels, numInputSamples);
-        this->applyStage0(this->buffer[0], this->buffer[1], numInputSamples);
-        this->applyStage1(this->buffer[1], this->buffer[0], numInputSamples * 2);
-        this->applyStage2(this->buffer[0], this->buffer[1], numInputSamples * 4);
-        this->applyStage3(this->buffer[1], this->buffer[0], numInputSamples * 8);
-      } break;
-      case 5: {
-        this->buffer[0].interleave(inputs, this->numChannels, numInputSamples);
-        this->applyStage0(this->buffer[1], this->buffer[0], numInputSamples);
-        this->applyStage1(this->buffer[0], this->buffer[1], numInputSamples * 2);
-        this->applyStage2(this->buffer[1], this->buffer[0], numInputSamples * 4);
-        this->applyStage3(this->buffer[0], this->buffer[1], numInputSamples * 8);
-        this->applyStage4(this->buffer[1], this->buffer[0], numInputSamples * 16);
-      } break;
-      default:
-        assert(false);
+    {
+      OVERSIMPLE_SCOPED_SECTION(this->instrumentation, Section::interleaving, numInputSamples * this->numChannels);
+      this->buffer[0].interleave(inputs, this->numChannels, numInputSamples);
     }
+    this->setTapNumSamples(numInputSamples);
+    this->upSample(this->buffer[1], this->buffer[0], numInputSamples);
   }
   /**
    * Up-samples the input.
@@ -797,14 +1405,87 @@ public:
   }
 
   /**
-   * @return an InterleavedBuffer holding the output
+   * Up-samples an already interleaved input to plain buffers. Faster than processBlock followed by a deinterleave of
+   * the output.
+   * @param input an InterleavedBuffer<Float> holding the input samples
+   * @param output pointers to the memory in which to store each channel of the up-sampled signal, with room for
+   * input.getNumSamples() * 2^order samples.
+   */
+  void processBlock(InterleavedBuffer<Float> const& input, Float* const* output)
+  {
+    assert(input.getNumChannels() == this->numChannels);
+    assert(input.getNumSamples() <= this->maxDownSampledSamples);
+    this->setTapNumSamples(input.getNumSamples());
+    this->upSample(output, input, input.getNumSamples());
+  }
+
+  /**
+   * Up-samples the input to plain buffers. Faster than processBlock followed by a deinterleave of the output.
+   * @param input a pointer to the memory holding the input samples.
+   * @param numInputSamples the number of samples in each channel of the input buffer
+   * @param output pointers to the memory in which to store each channel of the up-sampled signal, with room for
+   * numInputSamples * 2^order samples.
+   */
+  void processBlock(Float* const* inputs, uint32_t numInputSamples, Float* const* output)
+  {
+    assert(numInputSamples <= this->maxDownSampledSamples);
+    assert(this->buffer[0].getCapacity() >= numInputSamples);
+    this->buffer[0].setNumSamples(numInputSamples);
+    {
+      OVERSIMPLE_SCOPED_SECTION(this->instrumentation, Section::interleaving, numInputSamples * this->numChannels);
+      this->buffer[0].interleave(inputs, this->numChannels, numInputSamples);
+    }
+    this->setTapNumSamples(numInputSamples);
+    this->upSample(output, this->buffer[0], numInputSamples);
+  }
+
+  /**
+   * @return an InterleavedBuffer holding the output, with as many samples as the last processed block produced
    */
   InterleavedBuffer<Float>& getOutput()
   {
     return this->buffer[1];
   }
+
+  /**
+   * @return a const InterleavedBuffer holding the output, with as many samples as the last processed block produced
+   */
+  InterleavedBuffer<Float> const& getOutput() const
+  {
+    return this->buffer[1];
+  }
 };
 
+inline constexpr uint32_t presetNumStages = 5;
+
+// the number of coefficients of each stage of the antialiasing filters, and the preset they are designed with, for
+// each quality
+inline constexpr int qualityNumCoefs[][presetNumStages] = { { 7, 3, 2, 2, 1 },
+                                                            { 11, 5, 3, 3, 2 },
+                                                            { 13, 6, 4, 3, 3 } };
+inline constexpr int qualityPresetIndices[] = { 2, 0, 3 };
+
+constexpr int getPresetIndex(Quality quality)
+{
+  return qualityPresetIndices[static_cast<int>(quality)];
+}
+
+// the HIIR stages read as many coefficients as their template argument, so it must match the designed filters
+constexpr bool doQualitiesMatchPresets()
+{
+  for (size_t quality = 0; quality < std::size(qualityPresetIndices); ++quality) {
+    for (uint32_t stage = 0; stage < presetNumStages; ++stage) {
+      auto const& precomputedStage = precomputedPresets[qualityPresetIndices[quality]][stage];
+      if (precomputedStage.numCoefs != (uint32_t)qualityNumCoefs[quality][stage]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(doQualitiesMatchPresets(), "the number of coefficients of a quality does not match its preset");
+
 /**
  * Static class used to deduce the right SIMD implementation for the current architecture
  */
@@ -818,10 +1499,16 @@ class UpSamplerFactory final
 
 #if AVEC_X86
 
+private:
+  // with AVX-512, avec packs 8 double precision channels in each of the biggest interleaved buffers
+  template<int NC>
+  using UpSamplerStage8Double =
+    typename std::conditional<AVEC_AVX512, hiir::Upsampler2x8F64Avx512<NC>, FakeUpSamplerStage8Double<NC>>::type;
+
 public:
   template<int NC>
   using Stage8 = typename std::
-    conditional<std::is_same<Float, float>::value, hiir::Upsampler2x8Avx<NC>, FakeUpSamplerStage8Double<NC>>::type;
+    conditional<std::is_same<Float, float>::value, hiir::Upsampler2x8Avx<NC>, UpSamplerStage8Double<NC>>::type;
   template<int NC>
   using Stage4 = typename std::
     conditional<std::is_same<Float, float>::value, hiir::Upsampler2x4Sse<NC>, hiir::Upsampler2x4F64Avx<NC>>::type;
@@ -851,8 +1538,32 @@ public:
 
 #endif
 
+private:
+  template<class StageIndices>
+  struct WithStages;
+
+  template<std::size_t... stageIndex>
+  struct WithStages<std::index_sequence<stageIndex...>>
+  {
+    template<Quality quality>
+    using type = TUpSampler<Float,
+                            OversamplingDesigner,
+                            Stage8,
+                            Stage4,
+                            Stage2,
+                            qualityNumCoefs[static_cast<int>(quality)][stageIndex]...>;
+  };
+
 public:
-  using UpSampler = TUpSampler<Float, 11, 5, 3, 3, 2, Stage8, Stage4, Stage2>;
+  // an UpSampler holding only the first numStages stages of the filters of a quality
+  template<uint32_t numStages, Quality quality = Quality::standard>
+  using UpSamplerWithStages =
+    typename WithStages<std::make_index_sequence<numStages>>::template type<quality>;
+
+  template<Quality quality>
+  using UpSamplerWithQuality = UpSamplerWithStages<presetNumStages, quality>;
+
+  using UpSampler = UpSamplerWithQuality<Quality::standard>;
 };
 
 /**
@@ -868,10 +1579,16 @@ class DownSamplerFactory final
 
 #if AVEC_X86
 
+private:
+  // with AVX-512, avec packs 8 double precision channels in each of the biggest interleaved buffers
+  template<int NC>
+  using DownSamplerStage8Double =
+    typename std::conditional<AVEC_AVX512, hiir::Downsampler2x8F64Avx512<NC>, FakeDownsamplerStage8Double<NC>>::type;
+
 public:
   template<int NC>
   using Stage8 = typename std::
-    conditional<std::is_same<Float, float>::value, hiir::Downsampler2x8Avx<NC>, FakeDownsamplerStage8Double<NC>>::type;
+    conditional<std::is_same<Float, float>::value, hiir::Downsampler2x8Avx<NC>, DownSamplerStage8Double<NC>>::type;
 
   template<int NC>
   using Stage4 = typename std::
@@ -905,38 +1622,373 @@ public:
 
 #endif
 
+private:
+  template<class StageIndices>
+  struct WithStages;
+
+  template<std::size_t... stageIndex>
+  struct WithStages<std::index_sequence<stageIndex...>>
+  {
+    template<Quality quality>
+    using type = TDownSampler<Float,
+                              OversamplingDesigner,
+                              Stage8,
+                              Stage4,
+                              Stage2,
+                              qualityNumCoefs[static_cast<int>(quality)][stageIndex]...>;
+  };
+
 public:
-  using DownSampler = TDownSampler<Float, 11, 5, 3, 3, 2, Stage8, Stage4, Stage2>;
+  // a DownSampler holding only the first numStages stages of the filters of a quality
+  template<uint32_t numStages, Quality quality = Quality::standard>
+  using DownSamplerWithStages =
+    typename WithStages<std::make_index_sequence<numStages>>::template type<quality>;
+
+  template<Quality quality>
+  using DownSamplerWithQuality = DownSamplerWithStages<presetNumStages, quality>;
+
+  using DownSampler = DownSamplerWithQuality<Quality::standard>;
 };
 
 } // namespace detail
 
 /**
  * DownSampler with IIR antialiasing filters.
- * The filters are setup to achieve 140dB of attenuation and a transition band of 0.0443
+ * By default, the filters are setup to achieve 140dB of attenuation and a transition band of 0.0443.
+ * @see Quality
  */
-template<typename Float>
-class DownSampler final : public detail::DownSamplerFactory<Float>::DownSampler
+template<typename Float, Quality quality = Quality::standard>
+class DownSampler final : public detail::DownSamplerFactory<Float>::template DownSamplerWithQuality<quality>
 {
+  using Chain = typename detail::DownSamplerFactory<Float>::template DownSamplerWithQuality<quality>;
+
 public:
   explicit DownSampler(uint32_t numChannels, uint32_t orderToPreallocateFor = 1)
-    : detail::DownSamplerFactory<Float>::DownSampler(detail::getOversamplingPreset(0),
-                                                     numChannels,
-                                                     orderToPreallocateFor)
+    : Chain(detail::getOversamplingPreset(detail::getPresetIndex(quality)), numChannels, orderToPreallocateFor)
   {}
 };
 
 /**
  * UpSampler with IIR antialiasing filters.
- * The filters are setup to achieve 140dB of attenuation and a transition band of 0.0443
+ * By default, the filters are setup to achieve 140dB of attenuation and a transition band of 0.0443.
+ * @see Quality
  */
-template<typename Float>
-class UpSampler final : public detail::UpSamplerFactory<Float>::UpSampler
+template<typename Float, Quality quality = Quality::standard>
+class UpSampler final : public detail::UpSamplerFactory<Float>::template UpSamplerWithQuality<quality>
 {
+  using Chain = typename detail::UpSamplerFactory<Float>::template UpSamplerWithQuality<quality>;
+
 public:
   explicit UpSampler(uint32_t numChannels, uint32_t orderToPreallocateFor = 1)
-    : detail::UpSamplerFactory<Float>::UpSampler(detail::getOversamplingPreset(0), numChannels, orderToPreallocateFor)
+    : Chain(detail::getOversamplingPreset(detail::getPresetIndex(quality)), numChannels, orderToPreallocateFor)
+  {}
+};
+
+/**
+ * DownSampler with IIR antialiasing filters and a fixed order of oversampling, which only holds the stages that the
+ * order uses. The filters are the same as the ones of DownSampler.
+ */
+template<typename Float, uint32_t order, Quality quality = Quality::standard>
+class FixedOrderDownSampler final
+  : public detail::DownSamplerFactory<Float>::template DownSamplerWithStages<order, quality>
+{
+  static_assert(order >= 1 && order <= detail::presetNumStages, "unsupported order of oversampling");
+  using Chain = typename detail::DownSamplerFactory<Float>::template DownSamplerWithStages<order, quality>;
+
+public:
+  explicit FixedOrderDownSampler(uint32_t numChannels)
+    : Chain(detail::getOversamplingPreset(detail::getPresetIndex(quality), order), numChannels, order)
+  {
+    this->setOrder(order);
+  }
+};
+
+/**
+ * UpSampler with IIR antialiasing filters and a fixed order of oversampling, which only holds the stages that the
+ * order uses. The filters are the same as the ones of UpSampler.
+ */
+template<typename Float, uint32_t order, Quality quality = Quality::standard>
+class FixedOrderUpSampler final
+  : public detail::UpSamplerFactory<Float>::template UpSamplerWithStages<order, quality>
+{
+  static_assert(order >= 1 && order <= detail::presetNumStages, "unsupported order of oversampling");
+  using Chain = typename detail::UpSamplerFactory<Float>::template UpSamplerWithStages<order, quality>;
+
+public:
+  explicit FixedOrderUpSampler(uint32_t numChannels)
+    : Chain(detail::getOversamplingPreset(detail::getPresetIndex(quality), order), numChannels, order)
+  {
+    this->setOrder(order);
+  }
+};
+
+namespace detail {
+
+/**
+ * A class implementing the voice management shared by UpSamplerVoiceBank and DownSamplerVoiceBank. Each voice is a
+ * channel of the underlying re-sampler, so that the voices are packed into the SIMD lanes of its antialiasing filters.
+ */
+template<typename Float, class ReSampler>
+class VoiceBank
+{
+protected:
+  ReSampler reSampler;
+  uint32_t maxOrder;
+  uint32_t maxNumInputSamples;
+  // stands for the input of the voices that are not playing
+  aligned_vector<Float> silence;
+  // receives the output of the voices that are not playing
+  aligned_vector<Float> scratch;
+  std::vector<Float*> inputs;
+  std::vector<Float*> outputs;
+
+  VoiceBank(uint32_t maxNumVoices, uint32_t orderToPreallocateFor)
+    : reSampler(maxNumVoices, orderToPreallocateFor)
+    , maxOrder(orderToPreallocateFor)
+    , maxNumInputSamples(256)
+  {
+    setupVoices();
+    setupBuffers();
+  }
+
+  void setupVoices()
+  {
+    auto const maxNumVoices = getMaxNumVoices();
+    for (uint32_t voice = 0; voice < maxNumVoices; ++voice) {
+      reSampler.setChannelActive(voice, false);
+    }
+    inputs.resize(maxNumVoices);
+    outputs.resize(maxNumVoices);
+  }
+
+  void setupBuffers()
+  {
+    auto const maxNumUpSampledSamples = maxNumInputSamples * (1 << maxOrder);
+    silence.assign(maxNumUpSampledSamples, (Float)0.0);
+    scratch.resize(maxNumUpSampledSamples);
+  }
+
+  // replaces the pointers of the voices that are not playing, including null pointers
+  void setupPointers(Float* const* input, Float* const* output)
+  {
+    auto const maxNumVoices = getMaxNumVoices();
+    for (uint32_t voice = 0; voice < maxNumVoices; ++voice) {
+      bool const isPlaying = isVoiceActive(voice);
+      inputs[voice] = isPlaying && input[voice] ? input[voice] : silence.data();
+      outputs[voice] = isPlaying && output[voice] ? output[voice] : scratch.data();
+    }
+  }
+
+public:
+  /**
+   * Starts a new voice, with the state of its antialiasing filters cleared.
+   * @return the index of the new voice, or -1 if all the voices of the bank are already playing
+   */
+  int addVoice()
+  {
+    auto const maxNumVoices = getMaxNumVoices();
+    for (uint32_t voice = 0; voice < maxNumVoices; ++voice) {
+      if (!isVoiceActive(voice)) {
+        reSampler.setChannelActive(voice, true);
+        reSampler.resetChannel(voice);
+        return (int)voice;
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * Stops a voice. Its slot can be reused by a following call to addVoice.
+   * @param voice the index of the voice to stop
+   */
+  void removeVoice(uint32_t voice)
+  {
+    reSampler.setChannelActive(voice, false);
+  }
+
+  /**
+   * Resets the state of the antialiasing filters of a voice, leaving the other voices untouched.
+   * @param voice the index of the voice to reset
+   */
+  void resetVoice(uint32_t voice)
+  {
+    reSampler.resetChannel(voice);
+  }
+
+  /**
+   * @return true if the voice is playing, false otherwise
+   */
+  bool isVoiceActive(uint32_t voice) const
+  {
+    return reSampler.isChannelActive(voice);
+  }
+
+  /**
+   * @return the number of voices that are playing
+   */
+  uint32_t getNumActiveVoices() const
+  {
+    uint32_t numActiveVoices = 0;
+    for (uint32_t voice = 0; voice < getMaxNumVoices(); ++voice) {
+      numActiveVoices += isVoiceActive(voice) ? 1 : 0;
+    }
+    return numActiveVoices;
+  }
+
+  /**
+   * @return the number of voices that the bank can play at the same time
+   */
+  uint32_t getMaxNumVoices() const
+  {
+    return reSampler.getNumChannels();
+  }
+
+  /**
+   * Sets the number of voices that the bank can play at the same time. Stops all the voices.
+   * @param value the number of voices
+   */
+  void setMaxNumVoices(uint32_t value)
+  {
+    reSampler.setNumChannels(value);
+    setupVoices();
+  }
+
+  /**
+   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set
+   * @value the order to set
+   * @return true if the order was set correctly, false otherwise
+   */
+  bool setOrder(uint32_t value)
+  {
+    return value <= maxOrder && reSampler.setOrder(value);
+  }
+
+  /**
+   * @return the order of oversampling currently in use
+   */
+  uint32_t getOrder() const
+  {
+    return reSampler.getOrder();
+  }
+
+  /**
+   * Sets the maximum order of oversampling that can be used. Allocates internal buffers accordingly.
+   * @value the maximum order to set
+   * @return true if the order was set correctly, false otherwise
+   */
+  bool setMaxOrder(uint32_t value)
+  {
+    if (!reSampler.setMaxOrder(value)) {
+      return false;
+    }
+    maxOrder = value;
+    setupBuffers();
+    return true;
+  }
+
+  /**
+   * Prepares the internal buffers to receive the specified amount of samples.
+   * @param value the maximum amount of samples at the lower sample rate that can be processed by a single call
+   */
+  void prepareBuffers(uint32_t value)
+  {
+    maxNumInputSamples = value;
+    reSampler.prepareBuffers(value);
+    setupBuffers();
+  }
+
+  /**
+   * Resets the state of the antialiasing filters of all the voices
+   */
+  void reset()
+  {
+    reSampler.reset();
+  }
+
+  /**
+   * @return how the voices are packed into the SIMD lanes of the antialiasing filters
+   */
+  ChannelLayout getChannelLayout() const
+  {
+    return reSampler.getChannelLayout();
+  }
+};
+
+} // namespace detail
+
+/**
+ * A bank of independent mono UpSamplers, for example one for each voice of a synthesizer, packed into the SIMD lanes of
+ * a single multichannel UpSampler. Voices are added and removed at runtime, and the filters of the SIMD registers that
+ * hold no playing voice are not run.
+ */
+template<typename Float>
+class UpSamplerVoiceBank final : public detail::VoiceBank<Float, UpSampler<Float>>
+{
+  using Bank = detail::VoiceBank<Float, UpSampler<Float>>;
+
+public:
+  /**
+   * Constructor.
+   * @param maxNumVoices the number of voices that the bank can play at the same time
+   * @param orderToPreallocateFor the maximum order of oversampling for which to allocate resources for
+   */
+  explicit UpSamplerVoiceBank(uint32_t maxNumVoices, uint32_t orderToPreallocateFor = 1)
+    : Bank(maxNumVoices, orderToPreallocateFor)
+  {}
+
+  /**
+   * Up-samples the playing voices.
+   * @param input for each voice slot, a pointer to numInputSamples samples. It can be nullptr for the voices that are
+   * not playing, and for the playing voices that are silent.
+   * @param numInputSamples the number of samples to up-sample
+   * @param output for each voice slot, a pointer to the memory in which to store numInputSamples * 2^order up-sampled
+   * samples. It can be nullptr for the voices that are not playing, and for the voices whose output is not needed.
+   */
+  void processBlock(Float* const* input, uint32_t numInputSamples, Float* const* output)
+  {
+    assert(numInputSamples <= this->maxNumInputSamples);
+    this->setupPointers(input, output);
+    this->reSampler.processBlock(this->inputs.data(), numInputSamples, this->outputs.data());
+  }
+};
+
+/**
+ * A bank of independent mono DownSamplers, for example one for each voice of a synthesizer, packed into the SIMD lanes
+ * of a single multichannel DownSampler. Voices are added and removed at runtime, and the filters of the SIMD registers
+ * that hold no playing voice are not run.
+ */
+template<typename Float>
+class DownSamplerVoiceBank final : public detail::VoiceBank<Float, DownSampler<Float>>
+{
+  using Bank = detail::VoiceBank<Float, DownSampler<Float>>;
+
+public:
+  /**
+   * Constructor.
+   * @param maxNumVoices the number of voices that the bank can play at the same time
+   * @param orderToPreallocateFor the maximum order of oversampling for which to allocate resources for
+   */
+  explicit DownSamplerVoiceBank(uint32_t maxNumVoices, uint32_t orderToPreallocateFor = 1)
+    : Bank(maxNumVoices, orderToPreallocateFor)
   {}
+
+  /**
+   * Down-samples the playing voices.
+   * @param input for each voice slot, a pointer to numSamples up-sampled samples. It can be nullptr for the voices that
+   * are not playing, and for the playing voices that are silent.
+   * @param numSamples the number of up-sampled samples, which should be a multiple of the oversampling rate
+   * @param output for each voice slot, a pointer to the memory in which to store numSamples / 2^order samples. It can be
+   * nullptr for the voices that are not playing, and for the voices whose output is not needed.
+   */
+  void processBlock(Float* const* input, uint32_t numSamples, Float* const* output)
+  {
+    assert(numSamples <= this->maxNumInputSamples * (1 << this->getOrder()));
+    this->setupPointers(input, output);
+    this->reSampler.processBlock(this->inputs.data(), numSamples);
+    auto const& downSampled = this->reSampler.getOutput();
+    bool const ok = downSampled.deinterleave(this->outputs.data(), this->getMaxNumVoices(), downSampled.getNumSamples());
+    assert(ok);
+  }
 };
 
 } // namespace oversimple::iir
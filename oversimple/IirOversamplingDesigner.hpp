@@ -17,7 +17,10 @@ limitations under the License.
 #pragma once
 
 #include "hiir/PolyphaseIir2Designer.h"
+#include "oversimple/TaskExecutor.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <numeric>
 #include <string>
 #include <vector>
@@ -30,32 +33,61 @@ namespace oversimple::iir::detail {
 
 class OversamplingDesigner final
 {
+public:
+  /**
+   * A stage whose coefficients have already been designed, as stored in the precomputed tables of the presets.
+   */
+  struct PrecomputedStage
+  {
+    static constexpr uint32_t maxNumCoefs = 16;
+    double attenuation;
+    double transition;
+    uint32_t numCoefs;
+    double coefs[maxNumCoefs];
+  };
+
+private:
   struct Stage
   {
     double const attenuation;
     double const transition;
     uint32_t const numCoefs;
+    // the coefficients are designed once, by the constructor, and every delay evaluation reuses them
+    std::vector<double> const coefs;
     double getGroupDelay(double normalizedFrequency) const;
+    void addGroupDelay(double const* normalizedFrequencies,
+                       double* groupDelays,
+                       uint32_t numFrequencies,
+                       double coef) const;
     double getPhaseDelay(double normalizedFrequency) const;
     double getMaxGroupDelay() const;
     double getMinGroupDelay() const;
+    double getDecayLength() const;
     Stage(double attenuation, double transition);
+    explicit Stage(PrecomputedStage const& precomputed);
     Stage Next() const
     {
       return Stage(attenuation, 0.5 * (0.5 + transition));
     }
     std::string print() const;
+    std::vector<double> const& getCoefs() const
+    {
+      return coefs;
+    }
     std::vector<double> computeCoefs() const;
     void computeCoefs(std::vector<double>& coefs) const;
+
+  private:
+    static std::vector<double> designCoefs(double attenuation, double transition, uint32_t numCoefs);
   };
 
   class GroupDelayGraph
   {
     std::vector<double> graph;
-    void fromStages(std::vector<Stage> const& stages, uint32_t resolution);
+    void fromStages(std::vector<Stage> const& stages, uint32_t resolution, TaskExecutor* taskExecutor);
 
   public:
-    GroupDelayGraph(std::vector<Stage> const& stages, uint32_t resolution);
+    GroupDelayGraph(std::vector<Stage> const& stages, uint32_t resolution, TaskExecutor* taskExecutor = nullptr);
     double getMean() const;
     std::vector<double> getGraph() const
     {
@@ -74,6 +106,13 @@ public:
    */
   OversamplingDesigner(double attenuation, double transition, uint32_t numStages = 5);
 
+  /**
+   * Constructor that uses stages designed in advance, without doing any filter design.
+   * @param precomputedStages array of at least numStages precomputed stages
+   * @param numStages number of oversampling stages
+   */
+  OversamplingDesigner(PrecomputedStage const* precomputedStages, uint32_t numStages);
+
   /**
    * @return a reference to the vector with the information specific to each
    * stage.
@@ -89,11 +128,13 @@ public:
   std::string print() const;
 
   /**
+   * @param resolution the number of frequencies at which the group delay is evaluated
+   * @param taskExecutor if not null, the frequencies are split in chunks that are evaluated in parallel by it
    * @return data to graph the group delay.
    */
-  GroupDelayGraph getGroupDelayGraph(uint32_t resolution) const
+  GroupDelayGraph getGroupDelayGraph(uint32_t resolution, TaskExecutor* taskExecutor = nullptr) const
   {
-    return GroupDelayGraph(stages, resolution);
+    return GroupDelayGraph(stages, resolution, taskExecutor);
   }
 
   /**
@@ -104,6 +145,18 @@ public:
    */
   double getGroupDelay(double normalizedFrequency, uint32_t oversamplingOrder) const;
 
+  /**
+   * Computes the group delay at many frequencies at once.
+   * @param normalizedFrequencies the normalized frequencies at which to compute the group delay
+   * @param groupDelays array in which to store the group delay at each frequency
+   * @param numFrequencies the number of frequencies
+   * @param oversamplingOrder the oversampling order
+   */
+  void getGroupDelay(double const* normalizedFrequencies,
+                     double* groupDelays,
+                     uint32_t numFrequencies,
+                     uint32_t oversamplingOrder) const;
+
   /**
    * @param normalizedFrequency
    * @param oversamplingOrder
@@ -117,6 +170,13 @@ public:
    * @return the minimum group delay at the specified oversampling order
    */
   double getMinGroupDelay(uint32_t oversamplingOrder) const;
+
+  /**
+   * @param oversamplingOrder
+   * @return the number of samples, at the original rate, after which the impulse response of the up-sampling or of the
+   * down-sampling at the specified oversampling order has decayed below the attenuation of its stages
+   */
+  double getDecayLength(uint32_t oversamplingOrder) const;
 };
 
 // implementation
@@ -130,6 +190,15 @@ inline OversamplingDesigner::OversamplingDesigner(double attenuation, double tra
   }
 }
 
+inline OversamplingDesigner::OversamplingDesigner(PrecomputedStage const* precomputedStages, uint32_t numStages)
+{
+  assert(numStages > 0);
+  stages.reserve(numStages);
+  for (uint32_t i = 0; i < numStages; ++i) {
+    stages.push_back(Stage(precomputedStages[i]));
+  }
+}
+
 inline std::string OversamplingDesigner::print() const
 {
   std::string text;
@@ -175,6 +244,20 @@ inline double OversamplingDesigner::getMinGroupDelay(uint32_t order) const
   return latency;
 }
 
+inline double OversamplingDesigner::getDecayLength(uint32_t order) const
+{
+  assert(order <= stages.size());
+  // each stage runs at twice the rate of the previous one, and the impulse response of the chain is not longer than the
+  // sum of those of its stages
+  double coef = 1.0;
+  double length = 0.0;
+  for (uint32_t i = 0; i < order; ++i) {
+    length += coef * stages[i].getDecayLength();
+    coef *= 0.5;
+  }
+  return length;
+}
+
 inline double OversamplingDesigner::getGroupDelay(double normalizedFrequency, uint32_t order) const
 {
   assert(order <= stages.size());
@@ -187,6 +270,20 @@ inline double OversamplingDesigner::getGroupDelay(double normalizedFrequency, ui
   return groupDelay;
 }
 
+inline void OversamplingDesigner::getGroupDelay(double const* normalizedFrequencies,
+                                                double* groupDelays,
+                                                uint32_t numFrequencies,
+                                                uint32_t order) const
+{
+  assert(order <= stages.size());
+  std::fill(groupDelays, groupDelays + numFrequencies, 0.0);
+  double coef = 0.5;
+  for (uint32_t i = 0; i < order; ++i) {
+    stages[i].addGroupDelay(normalizedFrequencies, groupDelays, numFrequencies, coef);
+    coef *= 0.5;
+  }
+}
+
 inline double OversamplingDesigner::getPhaseDelay(double normalizedFrequency, uint32_t order) const
 {
   assert(order <= stages.size());
@@ -201,15 +298,21 @@ inline double OversamplingDesigner::getPhaseDelay(double normalizedFrequency, ui
 
 inline double OversamplingDesigner::Stage::getGroupDelay(double normalizedFrequency) const
 {
-  std::vector<double> coefs;
-  computeCoefs(coefs);
-  return hiir::PolyphaseIir2Designer::compute_group_delay(&coefs[0], numCoefs, normalizedFrequency, false);
+  return hiir::PolyphaseIir2Designer::compute_group_delay(coefs.data(), numCoefs, normalizedFrequency, false);
+}
+
+inline void OversamplingDesigner::Stage::addGroupDelay(double const* normalizedFrequencies,
+                                                       double* groupDelays,
+                                                       uint32_t numFrequencies,
+                                                       double coef) const
+{
+  for (uint32_t i = 0; i < numFrequencies; ++i) {
+    groupDelays[i] += coef * getGroupDelay(normalizedFrequencies[i]);
+  }
 }
 
 inline double OversamplingDesigner::Stage::getPhaseDelay(double normalizedFrequency) const
 {
-  std::vector<double> coefs;
-  computeCoefs(coefs);
   double delay = 0.0;
   for (uint32_t i = 0; i < coefs.size(); ++i) {
     delay += hiir::PolyphaseIir2Designer::compute_phase_delay(coefs[i], normalizedFrequency);
@@ -227,12 +330,33 @@ inline double OversamplingDesigner::Stage::getMaxGroupDelay() const
   return getGroupDelay(0.25);
 }
 
+inline double OversamplingDesigner::Stage::getDecayLength() const
+{
+  // each coefficient is the opposite of the pole of a first order allpass filter running at the lower rate of the
+  // stage, so the impulse response decays as the largest coefficient raised to the number of samples at that rate
+  auto const maxCoef = coefs.empty() ? 0.0 : *std::max_element(coefs.begin(), coefs.end());
+  if (maxCoef <= 0.0) {
+    return 0.0;
+  }
+  return attenuation * std::log(10.0) / (20.0 * -std::log(maxCoef));
+}
+
 inline OversamplingDesigner::Stage::Stage(double attenuation, double transition)
   : attenuation(attenuation)
   , transition(transition)
   , numCoefs(hiir::PolyphaseIir2Designer::compute_nbr_coefs_from_proto(attenuation, transition))
+  , coefs(designCoefs(attenuation, transition, numCoefs))
 {}
 
+inline OversamplingDesigner::Stage::Stage(PrecomputedStage const& precomputed)
+  : attenuation(precomputed.attenuation)
+  , transition(precomputed.transition)
+  , numCoefs(precomputed.numCoefs)
+  , coefs(precomputed.coefs, precomputed.coefs + precomputed.numCoefs)
+{
+  assert(numCoefs <= PrecomputedStage::maxNumCoefs);
+}
+
 inline std::string OversamplingDesigner::Stage::print() const
 {
   return "transition = " + std::to_string(transition) + ", " + "numCoefs = " + std::to_string(numCoefs) + ", " +
@@ -246,29 +370,66 @@ inline std::vector<double> OversamplingDesigner::Stage::computeCoefs() const
   return coefs;
 }
 
-inline void OversamplingDesigner::Stage::computeCoefs(std::vector<double>& coefs) const
+inline void OversamplingDesigner::Stage::computeCoefs(std::vector<double>& coefs_) const
 {
-  coefs.resize(numCoefs);
+  coefs_ = coefs;
+}
+
+inline std::vector<double> OversamplingDesigner::Stage::designCoefs(double attenuation,
+                                                                    double transition,
+                                                                    uint32_t numCoefs)
+{
+  std::vector<double> coefs(numCoefs);
   hiir::PolyphaseIir2Designer::compute_coefs(&coefs[0], attenuation, transition);
+  return coefs;
 }
 
-inline void OversamplingDesigner::GroupDelayGraph::fromStages(std::vector<Stage> const& stages, uint32_t resolution)
+inline void OversamplingDesigner::GroupDelayGraph::fromStages(std::vector<Stage> const& stages,
+                                                              uint32_t resolution,
+                                                              TaskExecutor* taskExecutor)
 {
-  std::vector<double> coefs;
-  graph.resize(resolution, 0.0);
+  graph.assign(resolution, 0.0);
+  std::vector<double> frequencies(resolution);
   double f = 0.5 / resolution;
-  double coef = 0.5;
-  for (auto& stage : stages) {
-    for (uint32_t i = 0; i < resolution; ++i) {
-      graph[i] += coef * stage.getGroupDelay(i * f);
+  for (uint32_t i = 0; i < resolution; ++i) {
+    frequencies[i] = i * f;
+  }
+  // each chunk of frequencies goes through all the stages, so the sum at each frequency is accumulated in the same
+  // order whether the chunks are evaluated serially or in parallel
+  static constexpr uint32_t chunkSize = 256;
+  struct Context
+  {
+    std::vector<Stage> const& stages;
+    double const* frequencies;
+    double* graph;
+    uint32_t resolution;
+  } context{ stages, frequencies.data(), graph.data(), resolution };
+  auto const evaluateChunk = [](void* context_, uint32_t chunkIndex) {
+    auto& context = *static_cast<Context*>(context_);
+    auto const start = chunkIndex * chunkSize;
+    auto const numFrequencies = std::min(chunkSize, context.resolution - start);
+    double coef = 0.5;
+    for (auto& stage : context.stages) {
+      stage.addGroupDelay(context.frequencies + start, context.graph + start, numFrequencies, coef);
+      coef *= 0.5;
+    }
+  };
+  auto const numChunks = (resolution + chunkSize - 1) / chunkSize;
+  if (taskExecutor) {
+    taskExecutor->run(numChunks, evaluateChunk, &context);
+  }
+  else {
+    for (uint32_t i = 0; i < numChunks; ++i) {
+      evaluateChunk(&context, i);
     }
-    coef *= 0.5;
   }
 }
 
-inline OversamplingDesigner::GroupDelayGraph::GroupDelayGraph(std::vector<Stage> const& stages, uint32_t resolution)
+inline OversamplingDesigner::GroupDelayGraph::GroupDelayGraph(std::vector<Stage> const& stages,
+                                                              uint32_t resolution,
+                                                              TaskExecutor* taskExecutor)
 {
-  fromStages(stages, resolution);
+  fromStages(stages, resolution, taskExecutor);
 }
 
 inline double OversamplingDesigner::GroupDelayGraph::getMean() const
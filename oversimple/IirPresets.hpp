@@ -0,0 +1,229 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// generated by running iir-design --write-presets with the presetDesignParameters of Hiir.hpp, do not edit
+
+#pragma once
+
+#include "oversimple/IirOversamplingDesigner.hpp"
+
+namespace oversimple::iir::detail {
+
+inline constexpr OversamplingDesigner::PrecomputedStage precomputedPresets[][5] = {
+  {
+    { 140,
+      0.044299999999999999,
+      11,
+      {
+        0.021214481049993503,
+        0.081507605820924561,
+        0.17195166501135531,
+        0.280812830795521,
+        0.39663166886384243,
+        0.510447260524441,
+        0.6167381967395601,
+        0.71332373077728228,
+        0.80074291729795044,
+        0.8815745316418887,
+        0.95998770068253203,
+      } },
+    { 140,
+      0.27215,
+      5,
+      {
+        0.026828742053817842,
+        0.10834693362712976,
+        0.24913644591875614,
+        0.46229325249071768,
+        0.78038429617936944,
+      } },
+    { 140,
+      0.386075,
+      3,
+      {
+        0.055233426429849027,
+        0.24149463433196292,
+        0.64521810756115439,
+      } },
+    { 140,
+      0.44303749999999997,
+      3,
+      {
+        0.052854636081796032,
+        0.23424884416343883,
+        0.63824143142947709,
+      } },
+    { 140,
+      0.47151874999999999,
+      2,
+      {
+        0.10591554854709097,
+        0.52851796364568293,
+      } },
+  },
+  {
+    { 142,
+      0.046399999999999997,
+      11,
+      {
+        0.020659180489892497,
+        0.079469478461660734,
+        0.1679658022873646,
+        0.2749561596259123,
+        0.38941215717988642,
+        0.50260131268161823,
+        0.60904064970400873,
+        0.70646804307335509,
+        0.79529898429953449,
+        0.87800451182002104,
+        0.95869618087620601,
+      } },
+    { 142,
+      0.2732,
+      5,
+      {
+        0.026760389309495269,
+        0.10810514212375143,
+        0.24870417394918021,
+        0.46178494531375353,
+        0.78009046600398768,
+      } },
+    { 142,
+      0.3866,
+      4,
+      {
+        0.033028424690192536,
+        0.13916519488041323,
+        0.34422742417624536,
+        0.71199600662611839,
+      } },
+    { 142,
+      0.44330000000000003,
+      3,
+      {
+        0.052847578029597865,
+        0.23422719681176296,
+        0.63822038083765131,
+      } },
+    { 142,
+      0.47165000000000001,
+      2,
+      {
+        0.10591238925541067,
+        0.52851194193214224,
+      } },
+  },
+  {
+    { 90,
+      0.044999999999999998,
+      7,
+      {
+        0.048546186343506006,
+        0.1773721987376328,
+        0.34782724222054628,
+        0.52247422017566236,
+        0.67979258533216758,
+        0.81560750636836454,
+        0.93837102214800494,
+      } },
+    { 90,
+      0.27250000000000002,
+      3,
+      {
+        0.06648718483980251,
+        0.27452903232140841,
+        0.67540456961680073,
+      } },
+    { 90,
+      0.38624999999999998,
+      2,
+      {
+        0.11124824525261777,
+        0.53852760666038169,
+      } },
+    { 90,
+      0.44312499999999999,
+      2,
+      {
+        0.10694967165387712,
+        0.53048308713441528,
+      } },
+    { 90,
+      0.4715625,
+      1,
+      {
+        0.33399967431163341,
+      } },
+  },
+  {
+    { 160,
+      0.044299999999999999,
+      13,
+      {
+        0.015452123704418595,
+        0.060015282443881289,
+        0.12875663832919007,
+        0.21476445753046194,
+        0.31058893803605697,
+        0.40950855543453596,
+        0.50634270492736555,
+        0.59776302149183946,
+        0.68222159682547612,
+        0.75967431479031455,
+        0.83125847420876364,
+        0.89903327296042501,
+        0.96584583260253232,
+      } },
+    { 160,
+      0.27215,
+      6,
+      {
+        0.019193912488646474,
+        0.077269710896816113,
+        0.17624468759493297,
+        0.3213765221349667,
+        0.52456264469867464,
+        0.81094653474847855,
+      } },
+    { 160,
+      0.386075,
+      4,
+      {
+        0.033047216002071451,
+        0.13922973213732895,
+        0.34433160000421664,
+        0.71207082885580797,
+      } },
+    { 160,
+      0.44303749999999997,
+      3,
+      {
+        0.052854636081796032,
+        0.23424884416343883,
+        0.63824143142947709,
+      } },
+    { 160,
+      0.47151874999999999,
+      3,
+      {
+        0.052283466330885923,
+        0.23249414221796519,
+        0.63653102042824572,
+      } },
+  },
+};
+
+} // namespace oversimple::iir::detail
@@ -0,0 +1,496 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+// Set OVERSIMPLE_INSTRUMENTATION to 1 to compile the instrumentation of the hot paths. Otherwise the instrumented
+// sections expand to nothing, and attaching an Instrumentation to a re-sampler has no effect.
+#ifndef OVERSIMPLE_INSTRUMENTATION
+#define OVERSIMPLE_INSTRUMENTATION 0
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define OVERSIMPLE_HAS_RDTSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define OVERSIMPLE_HAS_RDTSC 0
+#endif
+
+namespace oversimple {
+
+/**
+ * The sections of the hot paths measured by an Instrumentation.
+ */
+enum class Section : uint32_t
+{
+  // whole calls to TOversampling::upSample and TOversampling::downSample
+  upSampling,
+  downSampling,
+  // conversions between plain and interleaved buffers
+  interleaving,
+  // the stages of the IIR and half-band re-samplers, from the one at the lowest rate
+  upSamplingStage0,
+  upSamplingStage1,
+  upSamplingStage2,
+  upSamplingStage3,
+  upSamplingStage4,
+  downSamplingStage0,
+  downSamplingStage1,
+  downSamplingStage2,
+  downSamplingStage3,
+  downSamplingStage4,
+  // the convolutions of the FIR re-samplers, by r8brain or by the uniformly partitioned engine
+  firUpSampling,
+  firDownSampling,
+  // the conversion of the input of the FIR re-samplers to double precision
+  firInputConversion,
+  // the copy, and conversion to single precision, of the output of the FIR up-sampler
+  firOutputConversion,
+  // the circular buffer and the zero padding of the output of the FIR down-sampler
+  firOutputBuffering,
+  numSections
+};
+
+/**
+ * The number of stages of the IIR and half-band re-samplers that have their own section.
+ */
+constexpr uint32_t numInstrumentedStages = 5;
+
+/**
+ * @return the section of a stage of the IIR and half-band re-samplers.
+ */
+constexpr Section getStageSection(bool isUpSampling, uint32_t stage)
+{
+  return static_cast<Section>(
+    static_cast<uint32_t>(isUpSampling ? Section::upSamplingStage0 : Section::downSamplingStage0) + stage);
+}
+
+/**
+ * @return a human readable name of a section.
+ */
+inline char const* getSectionName(Section section)
+{
+  switch (section) {
+    case Section::upSampling:
+      return "upSampling";
+    case Section::downSampling:
+      return "downSampling";
+    case Section::interleaving:
+      return "interleaving";
+    case Section::upSamplingStage0:
+      return "upSamplingStage0";
+    case Section::upSamplingStage1:
+      return "upSamplingStage1";
+    case Section::upSamplingStage2:
+      return "upSamplingStage2";
+    case Section::upSamplingStage3:
+      return "upSamplingStage3";
+    case Section::upSamplingStage4:
+      return "upSamplingStage4";
+    case Section::downSamplingStage0:
+      return "downSamplingStage0";
+    case Section::downSamplingStage1:
+      return "downSamplingStage1";
+    case Section::downSamplingStage2:
+      return "downSamplingStage2";
+    case Section::downSamplingStage3:
+      return "downSamplingStage3";
+    case Section::downSamplingStage4:
+      return "downSamplingStage4";
+    case Section::firUpSampling:
+      return "firUpSampling";
+    case Section::firDownSampling:
+      return "firDownSampling";
+    case Section::firInputConversion:
+      return "firInputConversion";
+    case Section::firOutputConversion:
+      return "firOutputConversion";
+    case Section::firOutputBuffering:
+      return "firOutputBuffering";
+    case Section::numSections:
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * The statistics of a section, as read by Instrumentation::getStats.
+ */
+struct SectionStats final
+{
+  // the number of times the section was executed
+  uint64_t numCalls = 0;
+  // the total time spent in the section, in ticks of Instrumentation::readTicks
+  uint64_t numTicks = 0;
+  // the number of samples processed by the section, summed over the channels, or over the SIMD lanes for the stages
+  uint64_t numSamples = 0;
+  // the longest single execution of the section, in ticks
+  uint64_t maxTicks = 0;
+};
+
+/**
+ * Hooks called when an instrumented section begins and ends, on the thread executing it, to forward the sections to a
+ * profiler such as Tracy or Perfetto as scoped markers. The sections of the FIR re-samplers can be executed by the
+ * threads of a TaskExecutor. The hooks are called from the audio thread, so they should not lock or allocate.
+ */
+struct ScopeHooks final
+{
+  using Begin = void (*)(void* context, Section section, char const* name);
+  using End = void (*)(void* context, Section section);
+
+  Begin begin = nullptr;
+  End end = nullptr;
+  void* context = nullptr;
+};
+
+/**
+ * Collects the time spent in each section of the hot paths of the re-samplers it is attached to, while they process
+ * audio. The statistics are stored in relaxed atomics, so they can be read and reset from another thread, such as the
+ * UI one, without locking: each value is consistent, but the values of a section may be from different calls.
+ * Only collects anything if OVERSIMPLE_INSTRUMENTATION is set to 1.
+ */
+class Instrumentation final
+{
+public:
+  /**
+   * true if the instrumentation is compiled, false otherwise.
+   */
+  static constexpr bool isEnabled = OVERSIMPLE_INSTRUMENTATION != 0;
+
+  Instrumentation() = default;
+  Instrumentation(Instrumentation const&) = delete;
+  Instrumentation& operator=(Instrumentation const&) = delete;
+
+  /**
+   * @return the value of the counter used to measure the sections: the time stamp counter on x86, which counts
+   * reference cycles, and a steady clock in nanoseconds elsewhere.
+   */
+  static uint64_t readTicks()
+  {
+#if OVERSIMPLE_HAS_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count());
+#endif
+  }
+
+  /**
+   * Measures how many ticks of readTicks elapse in a second, to convert the statistics to time. Blocks the calling
+   * thread for the duration of the measurement, so do not call it from the audio thread.
+   * @param duration the duration of the measurement
+   * @return the number of ticks per second
+   */
+  static double measureTicksPerSecond(std::chrono::milliseconds duration = std::chrono::milliseconds(20))
+  {
+    auto const startTime = std::chrono::steady_clock::now();
+    auto const startTicks = readTicks();
+    std::this_thread::sleep_for(duration);
+    auto const endTicks = readTicks();
+    auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return static_cast<double>(endTicks - startTicks) / elapsed;
+  }
+
+  /**
+   * Adds an execution of a section to its statistics. Called by the instrumented sections, possibly concurrently.
+   * @param section the section executed
+   * @param numTicks the duration of the execution, in ticks
+   * @param numSamples the number of samples processed
+   */
+  void record(Section section, uint64_t numTicks, uint64_t numSamples)
+  {
+    auto& counters = sections[static_cast<uint32_t>(section)];
+    counters.numCalls.fetch_add(1, std::memory_order_relaxed);
+    counters.numTicks.fetch_add(numTicks, std::memory_order_relaxed);
+    counters.numSamples.fetch_add(numSamples, std::memory_order_relaxed);
+    auto maxTicks = counters.maxTicks.load(std::memory_order_relaxed);
+    while (numTicks > maxTicks &&
+           !counters.maxTicks.compare_exchange_weak(maxTicks, numTicks, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * @return the statistics of a section. Can be called from any thread.
+   */
+  SectionStats getStats(Section section) const
+  {
+    auto const& counters = sections[static_cast<uint32_t>(section)];
+    SectionStats stats;
+    stats.numCalls = counters.numCalls.load(std::memory_order_relaxed);
+    stats.numTicks = counters.numTicks.load(std::memory_order_relaxed);
+    stats.numSamples = counters.numSamples.load(std::memory_order_relaxed);
+    stats.maxTicks = counters.maxTicks.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /**
+   * Clears the statistics of all the sections. Can be called from any thread, for example to measure the longest
+   * execution of each section in a time window.
+   */
+  void reset()
+  {
+    for (auto& counters : sections) {
+      counters.numCalls.store(0, std::memory_order_relaxed);
+      counters.numTicks.store(0, std::memory_order_relaxed);
+      counters.numSamples.store(0, std::memory_order_relaxed);
+      counters.maxTicks.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Sets the hooks called when a section begins and ends. Not thread safe: set them before processing audio.
+   */
+  void setScopeHooks(ScopeHooks const& value)
+  {
+    hooks = value;
+  }
+
+  ScopeHooks const& getScopeHooks() const
+  {
+    return hooks;
+  }
+
+  /**
+   * Marks the beginning of a section, calling the begin hook if there is one.
+   */
+  void beginSection(Section section) const
+  {
+    if (hooks.begin) {
+      hooks.begin(hooks.context, section, getSectionName(section));
+    }
+  }
+
+  /**
+   * Marks the end of a section, calling the end hook if there is one.
+   */
+  void endSection(Section section) const
+  {
+    if (hooks.end) {
+      hooks.end(hooks.context, section);
+    }
+  }
+
+private:
+  struct Counters final
+  {
+    std::atomic<uint64_t> numCalls{ 0 };
+    std::atomic<uint64_t> numTicks{ 0 };
+    std::atomic<uint64_t> numSamples{ 0 };
+    std::atomic<uint64_t> maxTicks{ 0 };
+  };
+
+  std::array<Counters, static_cast<uint32_t>(Section::numSections)> sections;
+  ScopeHooks hooks;
+};
+
+/**
+ * Measures a section from its construction to its destruction, if the Instrumentation is not null. Use it through
+ * OVERSIMPLE_SCOPED_SECTION, so that it is removed when the instrumentation is not compiled.
+ */
+class ScopedSection final
+{
+public:
+  ScopedSection(Instrumentation* instrumentation, Section section, uint64_t numSamples)
+    : instrumentation{ instrumentation }
+    , section{ section }
+    , numSamples{ numSamples }
+  {
+    if (instrumentation) {
+      instrumentation->beginSection(section);
+      startTicks = Instrumentation::readTicks();
+    }
+  }
+
+  ~ScopedSection()
+  {
+    if (instrumentation) {
+      auto const numTicks = Instrumentation::readTicks() - startTicks;
+      instrumentation->endSection(section);
+      instrumentation->record(section, numTicks, numSamples);
+    }
+  }
+
+  ScopedSection(ScopedSection const&) = delete;
+  ScopedSection& operator=(ScopedSection const&) = delete;
+
+private:
+  Instrumentation* const instrumentation;
+  Section const section;
+  uint64_t const numSamples;
+  uint64_t startTicks = 0;
+};
+
+/**
+ * Sums the executions of sections that run many times within a single call, such as the stages of the IIR
+ * re-samplers, which run once for each tile and each vec buffer, so that they are added to the statistics of an
+ * Instrumentation once per call rather than once per execution. Use it through OVERSIMPLE_ACCUMULATED_SECTION and
+ * OVERSIMPLE_SCOPED_ACCUMULATION. The scope hooks are not called for the accumulated sections, whose executions are
+ * interleaved with each other.
+ */
+class SectionAccumulator final
+{
+public:
+  /**
+   * Adds an execution of a section to the sums of the current call.
+   */
+  void add(Section section, uint64_t numTicks, uint64_t numSamples)
+  {
+    auto& sums = sections[static_cast<uint32_t>(section)];
+    sums.numTicks += numTicks;
+    sums.numSamples += numSamples;
+    sums.isExecuted = true;
+  }
+
+  /**
+   * Records each section executed since the last call as a single execution, and clears the sums.
+   */
+  void record(Instrumentation& instrumentation)
+  {
+    for (uint32_t section = 0; section < static_cast<uint32_t>(Section::numSections); ++section) {
+      auto& sums = sections[section];
+      if (sums.isExecuted) {
+        instrumentation.record(static_cast<Section>(section), sums.numTicks, sums.numSamples);
+        sums = Sums{};
+      }
+    }
+  }
+
+private:
+  struct Sums final
+  {
+    uint64_t numTicks = 0;
+    uint64_t numSamples = 0;
+    bool isExecuted = false;
+  };
+
+  std::array<Sums, static_cast<uint32_t>(Section::numSections)> sections;
+};
+
+/**
+ * Measures an execution of a section from its construction to its destruction and adds it to a SectionAccumulator,
+ * if the Instrumentation is not null. Use it through OVERSIMPLE_ACCUMULATED_SECTION.
+ */
+class AccumulatedSection final
+{
+public:
+  AccumulatedSection(Instrumentation* instrumentation,
+                     SectionAccumulator& accumulator,
+                     Section section,
+                     uint64_t numSamples)
+    : accumulator{ instrumentation ? &accumulator : nullptr }
+    , section{ section }
+    , numSamples{ numSamples }
+  {
+    if (instrumentation) {
+      startTicks = Instrumentation::readTicks();
+    }
+  }
+
+  ~AccumulatedSection()
+  {
+    if (accumulator) {
+      accumulator->add(section, Instrumentation::readTicks() - startTicks, numSamples);
+    }
+  }
+
+  AccumulatedSection(AccumulatedSection const&) = delete;
+  AccumulatedSection& operator=(AccumulatedSection const&) = delete;
+
+private:
+  SectionAccumulator* const accumulator;
+  Section const section;
+  uint64_t const numSamples;
+  uint64_t startTicks = 0;
+};
+
+/**
+ * Records the sections accumulated by a SectionAccumulator when destroyed, at the end of the call that executed them,
+ * if the Instrumentation is not null. Use it through OVERSIMPLE_SCOPED_ACCUMULATION.
+ */
+class ScopedAccumulation final
+{
+public:
+  ScopedAccumulation(Instrumentation* instrumentation, SectionAccumulator& accumulator)
+    : instrumentation{ instrumentation }
+    , accumulator{ accumulator }
+  {}
+
+  ~ScopedAccumulation()
+  {
+    if (instrumentation) {
+      accumulator.record(*instrumentation);
+    }
+  }
+
+  ScopedAccumulation(ScopedAccumulation const&) = delete;
+  ScopedAccumulation& operator=(ScopedAccumulation const&) = delete;
+
+private:
+  Instrumentation* const instrumentation;
+  SectionAccumulator& accumulator;
+};
+
+} // namespace oversimple
+
+#define OVERSIMPLE_CONCATENATE_IMPL(a, b) a##b
+#define OVERSIMPLE_CONCATENATE(a, b) OVERSIMPLE_CONCATENATE_IMPL(a, b)
+
+/**
+ * Measures the rest of the enclosing scope as an execution of a section, with an Instrumentation pointer that can be
+ * null. Expands to nothing, without evaluating its arguments, unless OVERSIMPLE_INSTRUMENTATION is 1.
+ */
+#if OVERSIMPLE_INSTRUMENTATION
+#define OVERSIMPLE_SCOPED_SECTION(instrumentation, section, numSamples)                                                \
+  ::oversimple::ScopedSection OVERSIMPLE_CONCATENATE(oversimpleScopedSection, __LINE__)(                               \
+    instrumentation, section, static_cast<uint64_t>(numSamples))
+#else
+#define OVERSIMPLE_SCOPED_SECTION(instrumentation, section, numSamples) static_cast<void>(0)
+#endif
+
+/**
+ * Measures the rest of the enclosing scope as an execution of a section, adding it to a SectionAccumulator instead of
+ * recording it. Expands to nothing, without evaluating its arguments, unless OVERSIMPLE_INSTRUMENTATION is 1.
+ */
+#if OVERSIMPLE_INSTRUMENTATION
+#define OVERSIMPLE_ACCUMULATED_SECTION(instrumentation, accumulator, section, numSamples)                              \
+  ::oversimple::AccumulatedSection OVERSIMPLE_CONCATENATE(oversimpleAccumulatedSection, __LINE__)(                     \
+    instrumentation, accumulator, section, static_cast<uint64_t>(numSamples))
+#else
+#define OVERSIMPLE_ACCUMULATED_SECTION(instrumentation, accumulator, section, numSamples) static_cast<void>(0)
+#endif
+
+/**
+ * Records the sections accumulated by a SectionAccumulator at the end of the enclosing scope, once each. Expands to
+ * nothing, without evaluating its arguments, unless OVERSIMPLE_INSTRUMENTATION is 1.
+ */
+#if OVERSIMPLE_INSTRUMENTATION
+#define OVERSIMPLE_SCOPED_ACCUMULATION(instrumentation, accumulator)                                                   \
+  ::oversimple::ScopedAccumulation OVERSIMPLE_CONCATENATE(oversimpleScopedAccumulation, __LINE__)(instrumentation,     \
+                                                                                                  accumulator)
+#else
+#define OVERSIMPLE_SCOPED_ACCUMULATION(instrumentation, accumulator) static_cast<void>(0)
+#endif
@@ -0,0 +1,445 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "oversimple/Oversampling.hpp"
+#include "oversimple/TaskExecutor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace oversimple {
+
+/**
+ * A source of samples for TOfflineOversampling, such as a file decoder.
+ */
+template<typename Float>
+class OfflineSource
+{
+public:
+  /**
+   * Reads the next samples of the stream.
+   * @param channels pointers to the memory in which to store each channel, with room for numSamples samples
+   * @param numSamples the number of samples to read
+   * @return the number of samples read, which can be less than numSamples, and is 0 only at the end of the stream
+   */
+  virtual uint32_t read(Float* const* channels, uint32_t numSamples) = 0;
+
+  virtual ~OfflineSource() = default;
+};
+
+/**
+ * A destination of the samples processed by TOfflineOversampling, such as a file encoder.
+ */
+template<typename Float>
+class OfflineSink
+{
+public:
+  /**
+   * Writes the next samples of the stream.
+   * @param channels pointers to each channel of the samples to write
+   * @param numSamples the number of samples to write
+   */
+  virtual void write(Float const* const* channels, uint32_t numSamples) = 0;
+
+  virtual ~OfflineSink() = default;
+};
+
+/**
+ * Settings of the offline processing of TOfflineOversampling.
+ */
+struct OfflineSettings final
+{
+  /**
+   * The number of segments that can be processed in parallel, each by its own TOversampling.
+   */
+  uint32_t numSegments = 1;
+  /**
+   * The number of samples passed to each processing call of the TOversampling objects.
+   */
+  uint32_t blockSize = 4096;
+  /**
+   * The minimum number of samples of a segment. Shorter streams are split in fewer segments, so that the priming of
+   * each segment is a small fraction of its work. It is also the number of samples read from an OfflineSource for each
+   * segment at a time.
+   */
+  uint32_t minSegmentSize = 1 << 16;
+  /**
+   * The number of samples preceding a segment used to bring its filters to the state they would have if the stream
+   * had been processed from the beginning, or 0 to use the latency of the linear phase re-samplers, whose impulse
+   * responses are not longer than that, or getMinimumPhasePrimingSamples for the minimum phase ones.
+   */
+  uint32_t primingSamples = 0;
+};
+
+/**
+ * Computes the number of samples used by default to prime a segment processed with the minimum phase re-samplers, after
+ * which the impulse responses of the IIR antialiasing filters of the up-sampling and of the down-sampling, one after
+ * the other, have decayed below their stopband attenuation.
+ * @param quality the quality of the IIR antialiasing filters
+ * @param order the oversampling order
+ * @return the number of priming samples, at the original rate
+ */
+inline uint32_t getMinimumPhasePrimingSamples(iir::Quality quality, uint32_t order)
+{
+  auto const decayLength = iir::detail::getOversamplingDecayLength(order, iir::detail::getPresetIndex(quality));
+  return (uint32_t)std::ceil(2.0 * decayLength);
+}
+
+/**
+ * Up-samples a whole stream, lets a processor work on the up-sampled signal, and down-samples it, compensating the
+ * latency: the output has as many samples as the input, and its first sample corresponds to the first input sample.
+ * The stream can be in memory, for example a memory mapped file, or be read from an OfflineSource.
+ * The stream is split into segments, which are processed in parallel if an executor is set. Each segment starts with
+ * the priming samples that precede it, whose output is discarded, so the result matches the processing of the whole
+ * stream in a single pass, within the stopband attenuation of the filters, as long as the processor has no memory
+ * longer than the priming. The processor is then called concurrently, from the threads of the executor.
+ */
+template<typename Float>
+class TOfflineOversampling final
+{
+public:
+  /**
+   * Constructor.
+   * @param settings the settings of the oversampling. The input and output buffer types are always plain, the
+   * down-sampler input buffer type is the same as the up-sampler output one, and the maximum number of input samples
+   * is the block size of the offline settings.
+   * @param offlineSettings the settings of the offline processing
+   */
+  explicit TOfflineOversampling(OversamplingSettings settings, OfflineSettings offlineSettings = {})
+    : offlineSettings{ offlineSettings }
+  {
+    assert(offlineSettings.numSegments > 0 && offlineSettings.blockSize > 0);
+    assert(settings.numDownSampledChannels <= settings.numUpSampledChannels);
+    settings.upSampleInputBufferType = BufferType::plain;
+    settings.downSampleOutputBufferType = BufferType::plain;
+    settings.downSampleInputBufferType = settings.upSampleOutputBufferType;
+    settings.maxNumInputSamples = offlineSettings.blockSize;
+    segments.resize(offlineSettings.numSegments);
+    for (auto& segment : segments) {
+      segment.oversampling = std::make_unique<TOversampling<Float>>(settings);
+      segment.input.setNumChannels(settings.numUpSampledChannels);
+      segment.input.setNumSamples(offlineSettings.blockSize);
+      segment.output.setNumChannels(settings.numDownSampledChannels);
+      segment.output.setNumSamples(offlineSettings.blockSize);
+      segment.inputPointers.resize(settings.numUpSampledChannels);
+      segment.outputPointers.resize(settings.numDownSampledChannels);
+    }
+    latency = segments[0].oversampling->getLatency();
+    primingSamples = offlineSettings.primingSamples > 0 ? offlineSettings.primingSamples
+                     : settings.isUsingLinearPhase    ? latency
+                     : getMinimumPhasePrimingSamples(settings.iirQuality, settings.order);
+  }
+
+  /**
+   * Sets the executor used to process the segments in parallel.
+   * @param value the executor to use, or nullptr to process the segments serially on the calling thread. It must
+   * outlive its use by the object.
+   */
+  void setExecutor(TaskExecutor* value)
+  {
+    executor = value;
+  }
+
+  /**
+   * @return the executor used to process the segments in parallel, or nullptr if they are processed serially.
+   */
+  TaskExecutor* getExecutor() const
+  {
+    return executor;
+  }
+
+  /**
+   * Sets the executor used by the FIR re-samplers of the TOversampling objects of all the segments to process the
+   * channels in parallel. It can be the same one set by setExecutor: the jobs of the FIR re-samplers are then started
+   * from within its tasks, so it must support nested calls to run, and WorkerPool runs them serially on the calling
+   * thread while it is busy with the segments, which makes it useful mostly with fewer segments than threads.
+   * @param value the executor to use, or nullptr to process the channels serially. It must outlive its use by the
+   * object.
+   */
+  void setFirExecutor(TaskExecutor* value)
+  {
+    for (auto& segment : segments) {
+      segment.oversampling->setFirExecutor(value);
+    }
+  }
+
+  /**
+   * @return the executor used by the FIR re-samplers of the segments, or nullptr if they process the channels serially.
+   */
+  TaskExecutor* getFirExecutor() const
+  {
+    return segments[0].oversampling->getFirExecutor();
+  }
+
+  /**
+   * @return the latency compensated by the object, in samples at the original rate
+   */
+  uint32_t getLatency() const
+  {
+    return latency;
+  }
+
+  /**
+   * @return the number of samples preceding each segment used to prime its filters
+   */
+  uint32_t getPrimingSamples() const
+  {
+    return primingSamples;
+  }
+
+  /**
+   * @return the settings of the TOversampling objects that process the segments
+   */
+  OversamplingSettings const& getSettings() const
+  {
+    return segments[0].oversampling->getSettings();
+  }
+
+  /**
+   * Processes a whole stream held in memory.
+   * @param input pointers to each channel of the stream, numUpSampledChannels of them
+   * @param output pointers to the memory in which to store each processed channel, numDownSampledChannels of them,
+   * with room for numSamples samples
+   * @param numSamples the number of samples of the stream
+   * @param processor a callable like the one of TOversampling::process. It is called concurrently if an executor is
+   * set.
+   */
+  template<class Processor>
+  void process(Float const* const* input, Float* const* output, uint64_t numSamples, Processor&& processor)
+  {
+    auto const numChunks = getNumChunks(numSamples);
+    Stream const stream{ input, 0, numSamples, true, output, 0 };
+    for (auto& segment : segments) {
+      segment.streamPosition = noStreamPosition;
+    }
+    firstSegment = 0;
+    processChunks(stream, 0, numSamples, numChunks, processor);
+  }
+
+  /**
+   * Processes a whole stream read from an OfflineSource, writing the result to an OfflineSink. The source is read
+   * minSegmentSize samples per segment at a time, plus the samples needed for the priming and the latency, which are
+   * kept from one read to the next.
+   * @param source the source of the stream, with numUpSampledChannels channels
+   * @param sink the destination of the processed stream, with numDownSampledChannels channels
+   * @param processor a callable like the one of TOversampling::process. It is called concurrently if an executor is
+   * set.
+   * @return the number of samples of the stream
+   */
+  template<class Processor>
+  uint64_t process(OfflineSource<Float>& source, OfflineSink<Float>& sink, Processor&& processor)
+  {
+    auto const& settings = getSettings();
+    auto const numNewSamples = (uint64_t)offlineSettings.minSegmentSize * offlineSettings.numSegments;
+    auto const capacity = (uint32_t)(numNewSamples + primingSamples + latency);
+    window.setNumChannels(settings.numUpSampledChannels);
+    window.setNumSamples(capacity);
+    windowOutput.setNumChannels(settings.numDownSampledChannels);
+    windowOutput.setNumSamples(capacity);
+    windowPointers.resize(settings.numUpSampledChannels);
+    windowOutputPointers.resize(settings.numDownSampledChannels);
+    for (auto& segment : segments) {
+      segment.streamPosition = noStreamPosition;
+    }
+    firstSegment = 0;
+
+    // the window holds the samples of the stream from windowStart to windowEnd
+    uint64_t windowStart = 0;
+    uint64_t windowEnd = 0;
+    uint64_t outputPosition = 0;
+    bool isEndOfStream = false;
+    while (!isEndOfStream) {
+      while (!isEndOfStream && windowEnd - windowStart < capacity) {
+        auto const numWindowSamples = (uint32_t)(windowEnd - windowStart);
+        for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+          windowPointers[c] = &window[c][0] + numWindowSamples;
+        }
+        auto const numSamplesRead = source.read(windowPointers.data(), capacity - numWindowSamples);
+        isEndOfStream = numSamplesRead == 0;
+        windowEnd += numSamplesRead;
+      }
+
+      // without the end of the stream, the last latency samples are needed to compute the ones before them
+      auto const outputEnd = isEndOfStream                          ? windowEnd
+                             : windowEnd > outputPosition + latency ? windowEnd - latency
+                                                                    : outputPosition;
+      auto const numOutputSamples = outputEnd - outputPosition;
+      if (numOutputSamples > 0) {
+        for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+          windowPointers[c] = &window[c][0];
+        }
+        for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+          windowOutputPointers[c] = &windowOutput[c][0];
+        }
+        Stream const stream{ windowPointers.data(),    windowStart, windowEnd, isEndOfStream,
+                             windowOutputPointers.data(), outputPosition };
+        auto const numChunks = getNumChunks(numOutputSamples);
+        processChunks(stream, outputPosition, outputEnd, numChunks, processor);
+        firstSegment = (firstSegment + numChunks - 1) % (uint32_t)segments.size();
+        sink.write(windowOutputPointers.data(), (uint32_t)numOutputSamples);
+        outputPosition = outputEnd;
+      }
+
+      // keep the samples needed to prime the next segment
+      auto const keptStart = std::max(outputPosition > primingSamples ? outputPosition - primingSamples : 0, windowStart);
+      for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+        auto const channel = &window[c][0];
+        std::copy(channel + (keptStart - windowStart), channel + (windowEnd - windowStart), channel);
+      }
+      assert(windowEnd - keptStart < capacity || isEndOfStream);
+      windowStart = keptStart;
+    }
+    return windowEnd;
+  }
+
+private:
+  static constexpr uint64_t noStreamPosition = std::numeric_limits<uint64_t>::max();
+
+  /**
+   * A TOversampling and the buffers used to feed it the blocks of a segment.
+   */
+  struct Segment final
+  {
+    std::unique_ptr<TOversampling<Float>> oversampling;
+    Buffer<Float> input;
+    Buffer<Float> output;
+    std::vector<Float*> inputPointers;
+    std::vector<Float*> outputPointers;
+    // the position in the stream of the next sample to feed the TOversampling, if it is processing the stream
+    uint64_t streamPosition = noStreamPosition;
+  };
+
+  /**
+   * The part of a stream available to the segments: input[c][i - inputStart] is the sample i of the channel c, for i
+   * from inputStart to inputEnd, and the samples after the end of the stream are zeros. The sample i of the processed
+   * stream is stored in output[c][i - outputStart].
+   */
+  struct Stream final
+  {
+    Float const* const* input;
+    uint64_t inputStart;
+    uint64_t inputEnd;
+    bool isEndOfStream;
+    Float* const* output;
+    uint64_t outputStart;
+  };
+
+  uint32_t getNumChunks(uint64_t numSamples) const
+  {
+    auto const numChunks = numSamples / std::max(offlineSettings.minSegmentSize, 1u);
+    return (uint32_t)std::clamp(numChunks, (uint64_t)1, (uint64_t)segments.size());
+  }
+
+  /**
+   * Splits the samples from begin to end of the processed stream in chunks, and processes each of them with a segment.
+   * The chunks are assigned to the segments so that the first one is processed by the segment that processed the last
+   * one of the previous call, which can just go on without being primed again.
+   */
+  template<class Processor>
+  void processChunks(Stream const& stream, uint64_t begin, uint64_t end, uint32_t numChunks, Processor& processor)
+  {
+    auto const numSamples = end - begin;
+    auto processChunk = [&](uint32_t chunk) {
+      auto const chunkBegin = begin + numSamples * chunk / numChunks;
+      auto const chunkEnd = begin + numSamples * (chunk + 1) / numChunks;
+      auto& segment = segments[(firstSegment + chunk) % segments.size()];
+      processSegment(segment, stream, chunkBegin, chunkEnd, processor);
+    };
+    if (executor && numChunks > 1) {
+      using ChunkTask = decltype(processChunk);
+      executor->run(
+        numChunks,
+        [](void* context, uint32_t chunk) { (*static_cast<ChunkTask*>(context))(chunk); },
+        &processChunk);
+    }
+    else {
+      for (uint32_t chunk = 0; chunk < numChunks; ++chunk) {
+        processChunk(chunk);
+      }
+    }
+  }
+
+  /**
+   * Computes the samples from begin to end of the processed stream. Unless the segment stopped right where they
+   * start, it is reset and primed with the samples that precede them, from the beginning of the stream if there are
+   * not enough of them. The input is read directly from the stream, and copied only to pad it with zeros at its end.
+   */
+  template<class Processor>
+  void processSegment(Segment& segment, Stream const& stream, uint64_t begin, uint64_t end, Processor& processor)
+  {
+    auto& oversampling = *segment.oversampling;
+    auto const& settings = oversampling.getSettings();
+    // the sample i of the processed stream is output when the sample i + latency is fed to the TOversampling
+    auto position = begin + latency;
+    if (segment.streamPosition != position) {
+      oversampling.reset();
+      position = begin > primingSamples ? begin - primingSamples : 0;
+    }
+    assert(position >= stream.inputStart);
+    auto const streamEnd = end + latency;
+    assert(stream.isEndOfStream || streamEnd <= stream.inputEnd);
+    while (position < streamEnd) {
+      auto const numBlockSamples = (uint32_t)std::min((uint64_t)offlineSettings.blockSize, streamEnd - position);
+      auto const numAvailableSamples =
+        (uint32_t)std::min((uint64_t)numBlockSamples, stream.inputEnd - std::min(position, stream.inputEnd));
+      for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+        auto const channel = stream.input[c] + (position - stream.inputStart);
+        if (numAvailableSamples == numBlockSamples) {
+          segment.inputPointers[c] = const_cast<Float*>(channel);
+        }
+        else {
+          auto const padded = &segment.input[c][0];
+          std::copy(channel, channel + numAvailableSamples, padded);
+          std::fill(padded + numAvailableSamples, padded + numBlockSamples, (Float)0.0);
+          segment.inputPointers[c] = padded;
+        }
+      }
+      for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+        segment.outputPointers[c] = &segment.output[c][0];
+      }
+      oversampling.process(segment.inputPointers.data(), segment.outputPointers.data(), numBlockSamples, processor);
+
+      auto const copyStart = std::max(position, begin + latency);
+      auto const copyEnd = position + numBlockSamples;
+      if (copyEnd > copyStart) {
+        for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+          auto const blockOutput = &segment.output[c][0];
+          std::copy(blockOutput + (copyStart - position),
+                    blockOutput + (copyEnd - position),
+                    stream.output[c] + (copyStart - latency - stream.outputStart));
+        }
+      }
+      position += numBlockSamples;
+    }
+    segment.streamPosition = position;
+  }
+
+  OfflineSettings offlineSettings;
+  std::vector<Segment> segments;
+  uint32_t latency = 0;
+  uint32_t primingSamples = 0;
+  uint32_t firstSegment = 0;
+  TaskExecutor* executor = nullptr;
+  Buffer<Float> window;
+  Buffer<Float> windowOutput;
+  std::vector<Float*> windowPointers;
+  std::vector<Float*> windowOutputPointers;
+};
+
+} // namespace oversimple
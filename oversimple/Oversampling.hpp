@@ -16,7 +16,13 @@ limitations under the License.
 
 #pragma once
 #include "FirOversampling.hpp"
+#include "HalfBandOversampling.hpp"
 #include "IirOversampling.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <variant>
 
 namespace oversimple {
 
@@ -31,12 +37,26 @@ enum class BufferType
   plain
 };
 
+/**
+ * enumeration used to choose between the minimum phase IIR re-samplers and the linear phase FIR re-samplers.
+ * */
+enum class Phase
+{
+  minimum,
+  linear
+};
+
+/**
+ * The highest order of oversampling supported by the re-samplers.
+ */
+constexpr uint32_t maxOversamplingOrder = 5;
+
 /*
  * A struct that contains all settings needed to specify the behaviour of an Oversampling object.
  * */
 struct OversamplingSettings final
 {
-  uint32_t maxOrder = 5;
+  uint32_t maxOrder = maxOversamplingOrder;
   uint32_t numDownSampledChannels = 2;
   uint32_t numUpSampledChannels = 2;
   uint32_t maxNumInputSamples = 128;
@@ -48,6 +68,12 @@ struct OversamplingSettings final
   bool isUsingLinearPhase = false;
   uint32_t fftBlockSize = 1024;
   double firTransitionBand = 4.0;
+  fir::AllocationPolicy firAllocationPolicy = fir::AllocationPolicy::allOrders;
+  fir::Engine firEngine = fir::Engine::r8brain;
+  uint32_t processSubBlockSize = 0;
+  iir::Quality iirQuality = iir::Quality::standard;
+  bool isBypassingSilence = false;
+  double silenceThreshold = 1.0e-7;
 };
 
 /*
@@ -63,10 +89,29 @@ public:
    * */
   explicit TOversampling(OversamplingSettings settings)
     : settings{ settings }
-    , firUpSampler{ settings.numUpSampledChannels, settings.maxOrder }
-    , firDownSampler{ settings.numDownSampledChannels, settings.maxOrder }
-    , iirUpSampler{ settings.numUpSampledChannels, settings.maxOrder }
-    , iirDownSampler{ settings.numDownSampledChannels, settings.maxOrder }
+    , firUpSampler{ settings.maxOrder,
+                    getNumFirChannels(settings.firEngine, settings.numUpSampledChannels),
+                    settings.firTransitionBand,
+                    settings.fftBlockSize,
+                    settings.firAllocationPolicy,
+                    getFirReSamplersEngine(settings.firEngine),
+                    settings.order }
+    , firDownSampler{ settings.maxOrder,
+                      getNumFirChannels(settings.firEngine, settings.numDownSampledChannels),
+                      settings.firTransitionBand,
+                      settings.fftBlockSize,
+                      settings.firAllocationPolicy,
+                      getFirReSamplersEngine(settings.firEngine),
+                      settings.order }
+    , iirUpSampler{ makeIirReSampler<IirUpSampler>(settings.iirQuality,
+                                                   settings.numUpSampledChannels,
+                                                   settings.maxOrder) }
+    , iirDownSampler{ makeIirReSampler<IirDownSampler>(settings.iirQuality,
+                                                       settings.numDownSampledChannels,
+                                                       settings.maxOrder) }
+    , halfBandUpSampler{ getNumHalfBandChannels(settings.firEngine, settings.numUpSampledChannels), settings.maxOrder }
+    , halfBandDownSampler{ getNumHalfBandChannels(settings.firEngine, settings.numDownSampledChannels),
+                           settings.maxOrder }
   {
     setup();
     setOrder(settings.order);
@@ -80,6 +125,49 @@ public:
     return settings;
   }
 
+  /**
+   * Computes the memory allocated by the internal buffers of an object with the supplied settings, which hold the
+   * up-sampled signal, the deinterleaved and interleaved copies of the input and of the output, and the silence of
+   * flush, to budget the memory of many instances. The state and the buffers of the re-samplers are not included.
+   * It is computed from the settings, without building the object, but with the r8brain engine the output length of
+   * each FIR order is queried from a resampler built the first time it is needed, so it should not be called from the
+   * audio thread.
+   * @param settings the settings of the object
+   * @return the number of bytes allocated by the internal buffers
+   * @see fir::ReSamplerBase::computeMaxNumOutputSamples
+   */
+  static std::size_t getInternalBuffersSize(OversamplingSettings const& settings)
+  {
+    auto const layout = getInternalBuffersLayout(settings, false);
+    auto const maxFirUpSampledSamples = getMaxFirUpSampledSamples(settings);
+    auto const capacity = settings.maxNumInputSamples;
+    return getInterleavedBufferSize(layout.numDownSampleInterleavedChannels, capacity) +
+           getPlainBufferSize(layout.numDownSamplePlainOutputChannels, capacity) +
+           getPlainBufferSize(layout.numDownSamplePlainInputChannels, maxFirUpSampledSamples) +
+           getInterleavedBufferSize(layout.numUpSampleOutputInterleavedChannels, maxFirUpSampledSamples) +
+           getPlainBufferSize(
+             layout.numUpSamplePlainChannels,
+             getUpSamplePlainCapacity(settings, layout.isDownSampleInputInUpSampleBuffer, maxFirUpSampledSamples)) +
+           getPlainBufferSize(1, getSilenceCapacity(settings));
+  }
+
+  /**
+   * @return the number of bytes allocated by the internal buffers of the object.
+   * @see getInternalBuffersSize(OversamplingSettings const&)
+   */
+  std::size_t getInternalBuffersSize() const
+  {
+    auto const plainSize = [](Buffer<Float> const& buffer) {
+      return getPlainBufferSize(buffer.getNumChannels(), buffer.getCapacity());
+    };
+    auto const interleavedSize = [](InterleavedBuffer<Float> const& buffer) {
+      return getInterleavedBufferSize(buffer.getNumChannels(), buffer.getCapacity());
+    };
+    return interleavedSize(downSampleBufferInterleaved) + plainSize(downSamplePlainOutputBuffer) +
+           plainSize(downSamplePlainInputBuffer) + interleavedSize(upSampleOutputInterleaved) +
+           plainSize(upSamplePlainBuffer) + plainSize(silence);
+  }
+
   /**
    * Sets the maximum order of oversampling supported, and allocates the necessary resources
    * @param value the maximum order of oversampling
@@ -155,6 +243,168 @@ public:
     }
   }
 
+  /**
+   * Sets the engine used by the FIR re-samplers. Only affects the behaviour of the object when linear phase is enabled.
+   * With fir::Engine::halfBand, the half-band re-samplers are used instead of the FIR ones: only one of the two is
+   * allocated for the channels, so changing from or to it allocates.
+   * @param engine the new engine
+   * @see fir::Engine
+   */
+  void setFirEngine(fir::Engine engine)
+  {
+    if (settings.firEngine != engine) {
+      settings.firEngine = engine;
+      setup();
+    }
+  }
+
+  /**
+   * Sets the executor used by the FIR re-samplers to process the channels in parallel. Only affects the behaviour of
+   * the object when linear phase is enabled.
+   * @param executor the executor to use, or nullptr to process the channels serially on the calling thread. It must
+   * outlive its use by the object.
+   */
+  void setFirExecutor(TaskExecutor* executor)
+  {
+    firUpSampler.setExecutor(executor);
+    firDownSampler.setExecutor(executor);
+  }
+
+  /**
+   * Makes the FIR down-sampling deinterleave its interleaved input into a buffer owned by the caller, instead of one of
+   * the object, so that objects that never process concurrently can share it. It allocates or frees the buffer of the
+   * object, so it must not be called from the audio thread.
+   * @param buffer a buffer with at least numDownSampledChannels channels and a capacity of at least
+   * getMaxNumOutputSamples() with linear phase, which must outlive its use by the object, or nullptr to use a buffer
+   * of the object.
+   */
+  void setSharedDownSampleInputBuffer(Buffer<Float>* buffer)
+  {
+    if (sharedDownSampleInputBuffer != buffer) {
+      sharedDownSampleInputBuffer = buffer;
+      setupInputOutputBuffers();
+      prepareInternalBuffers();
+    }
+  }
+
+  /**
+   * @return the executor used by the FIR re-samplers to process the channels in parallel, or nullptr if they are
+   * processed serially.
+   */
+  TaskExecutor* getFirExecutor() const
+  {
+    return firUpSampler.getExecutor();
+  }
+
+  /**
+   * Sets the Instrumentation that collects the time spent in each section of the up-sampling and of the
+   * down-sampling, by both the FIR and the IIR re-samplers. Only has an effect if OVERSIMPLE_INSTRUMENTATION is 1.
+   * @param value the Instrumentation to use, or nullptr to not collect anything. It must outlive its use by the object.
+   */
+  void setInstrumentation(Instrumentation* value)
+  {
+    instrumentation = value;
+    firUpSampler.setInstrumentation(value);
+    firDownSampler.setInstrumentation(value);
+    std::visit([value](auto& upSampler) { upSampler.setInstrumentation(value); }, iirUpSampler);
+    std::visit([value](auto& downSampler) { downSampler.setInstrumentation(value); }, iirDownSampler);
+    halfBandUpSampler.setInstrumentation(value);
+    halfBandDownSampler.setInstrumentation(value);
+  }
+
+  /**
+   * @return the Instrumentation that collects the time spent by the object, or nullptr if there is none
+   */
+  Instrumentation* getInstrumentation() const
+  {
+    return instrumentation;
+  }
+
+  /**
+   * @return how the channels to up-sample are packed into the SIMD lanes of the IIR antialiasing filters. The lanes
+   * that do not hold a channel are filtered as padding.
+   */
+  iir::ChannelLayout getIirUpSamplerChannelLayout() const
+  {
+    return std::visit([](auto const& upSampler) { return upSampler.getChannelLayout(); }, iirUpSampler);
+  }
+
+  /**
+   * @return how the channels to down-sample are packed into the SIMD lanes of the IIR antialiasing filters. The lanes
+   * that do not hold a channel are filtered as padding.
+   */
+  iir::ChannelLayout getIirDownSamplerChannelLayout() const
+  {
+    return std::visit([](auto const& downSampler) { return downSampler.getChannelLayout(); }, iirDownSampler);
+  }
+
+  /**
+   * Sets the quality tier of the IIR antialiasing filters. Each tier is a different instantiation of the IIR
+   * re-samplers, so changing it allocates new ones. Only affects the behaviour of the object when linear phase is
+   * disabled.
+   * @param quality the quality tier to use
+   * @see iir::Quality
+   */
+  void setIirQuality(iir::Quality quality)
+  {
+    if (settings.iirQuality != quality) {
+      settings.iirQuality = quality;
+      emplaceIirReSampler(iirUpSampler, quality, settings.numUpSampledChannels, settings.maxOrder);
+      emplaceIirReSampler(iirDownSampler, quality, settings.numDownSampledChannels, settings.maxOrder);
+      setInstrumentation(instrumentation);
+      setup();
+      setOrder(settings.order);
+    }
+  }
+
+  /**
+   * @return the quality tier of the IIR antialiasing filters
+   */
+  iir::Quality getIirQuality() const
+  {
+    return settings.iirQuality;
+  }
+
+  /**
+   * Enables or disables the silence bypass of the IIR re-samplers, and of the half-band ones: the channels whose input
+   * is digital silence, and whose output has decayed to the silence threshold, are not processed and output zeros,
+   * until their input is not silent anymore. The uniformly partitioned FIR engine always skips the convolution of
+   * silence once its state is all zeros, which is exact; r8brain processes all the channels anyway.
+   * @param value true to enable the bypass, false to disable it
+   * @see iir::detail::OversamplingChain::setBypassingSilence
+   */
+  void setBypassingSilence(bool value)
+  {
+    settings.isBypassingSilence = value;
+    setupSilenceBypass();
+  }
+
+  /**
+   * @return true if the silence bypass of the IIR re-samplers is enabled, false otherwise
+   */
+  bool getBypassingSilence() const
+  {
+    return settings.isBypassingSilence;
+  }
+
+  /**
+   * Sets the level to which the output of a channel with a silent input has to decay before bypassing it.
+   * @param value the threshold, as an absolute sample value
+   */
+  void setSilenceThreshold(double value)
+  {
+    settings.silenceThreshold = value;
+    setupSilenceBypass();
+  }
+
+  /**
+   * @return the level to which the output of a channel with a silent input has to decay before bypassing it
+   */
+  double getSilenceThreshold() const
+  {
+    return settings.silenceThreshold;
+  }
+
   /**
    * Sets whether the object shoul use the linear phase FIR re-samplers or the minimum-phase IIR re-samplers.
    * @param useLinearPhase true to enable linear phase, false to disable it.
@@ -176,18 +426,55 @@ public:
   }
 
   /**
-   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set
+   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set. The internal
+   * buffers are sized for all the orders up to the maximum one, and it never allocates nor waits, so it can be called
+   * from the audio thread. The FIR re-samplers of the order must be ready, even if linear phase is disabled, as they
+   * switch order too: with fir::AllocationPolicy::activeOrderOnly, prepare the order with prepareFirOrder first,
+   * otherwise the order in use does not change.
    * @value the order to set
-   * @return true if the order was set correctly, false otherwise
+   * @return true if the order was set, false if the FIR re-samplers of the order are not ready
+   * @see isFirOrderReady
    */
-  void setOrder(uint32_t order)
+  bool setOrder(uint32_t order)
   {
-    assert(order > 0 && order <= 5);
+    assert(order > 0 && order <= maxOversamplingOrder);
+    if (!isFirOrderReady(order)) {
+      return false;
+    }
     settings.order = order;
     firUpSampler.setOrder(order);
-    iirUpSampler.setOrder(order);
+    std::visit([order](auto& upSampler) { upSampler.setOrder(order); }, iirUpSampler);
     firDownSampler.setOrder(order);
-    iirDownSampler.setOrder(order);
+    std::visit([order](auto& downSampler) { downSampler.setOrder(order); }, iirDownSampler);
+    halfBandUpSampler.setOrder(order);
+    halfBandDownSampler.setOrder(order);
+    return true;
+  }
+
+  /**
+   * Allocates the FIR re-samplers for the supplied order, if they have not been allocated yet. Only useful if the
+   * FIR allocation policy is fir::AllocationPolicy::activeOrderOnly. It can be called from a background thread while
+   * the object is processing with another order, and concurrently with setOrder, but not concurrently with any other
+   * method that changes the settings of the object. The re-samplers are built with buffers sized for the internal
+   * buffers of the object, and their latency is known as soon as they are built, so once the order is ready, setOrder
+   * only switches to it. It allocates, and waits for the order if another thread is preparing it, so it must not be
+   * called from the audio thread.
+   * @param order the order to prepare
+   * @return true if the order is ready, false if it is greater than the maximum order
+   */
+  bool prepareFirOrder(uint32_t order)
+  {
+    return firUpSampler.prepareOrder(order) && firDownSampler.prepareOrder(order);
+  }
+
+  /**
+   * @return true if the FIR re-samplers for the supplied order have been allocated. It can be called while
+   * prepareFirOrder is running on another thread.
+   * @param order the order to query
+   */
+  bool isFirOrderReady(uint32_t order) const
+  {
+    return firUpSampler.isOrderReady(order) && firDownSampler.isOrderReady(order);
   }
 
   /**
@@ -195,21 +482,37 @@ public:
    */
   void reset()
   {
-    if (settings.isUsingLinearPhase) {
-      firUpSampler.reset();
-      iirUpSampler.reset();
-    }
-    else {
-      firDownSampler.reset();
-      iirDownSampler.reset();
-    }
+    firUpSampler.reset();
+    firDownSampler.reset();
+    std::visit([](auto& upSampler) { upSampler.reset(); }, iirUpSampler);
+    std::visit([](auto& downSampler) { downSampler.reset(); }, iirDownSampler);
+    halfBandUpSampler.reset();
+    halfBandDownSampler.reset();
+  }
+
+  /**
+   * Resets the state of the processor and primes the re-samplers as if they had processed silence for as long as their
+   * latency, so that the up-sampling produces the samples corresponding to its input from the first call, instead of
+   * nothing until getUpSamplingLatency samples have been processed. The latency of the output does not change. The IIR
+   * and the half-band re-samplers and the uniformly partitioned FIR engine are primed by clearing them, and r8brain by
+   * processing the silence through its antialiasing filters only, so priming is much cheaper than processing silence
+   * through the whole chain, for example when seeking or starting playback.
+   */
+  void prime()
+  {
+    firUpSampler.prime();
+    firDownSampler.prime();
+    std::visit([](auto& upSampler) { upSampler.prime(); }, iirUpSampler);
+    std::visit([](auto& downSampler) { downSampler.prime(); }, iirDownSampler);
+    halfBandUpSampler.prime();
+    halfBandDownSampler.prime();
   }
 
   /**
    * @return the number of input samples to the up-sampling call needed before a first output sample is
    * produced by the up-sampling call.
    */
-  uint32_t getUpSamplingLatency()
+  uint32_t getUpSamplingLatency() const
   {
     return getUpSamplingLatency(settings.order, settings.isUsingLinearPhase);
   }
@@ -218,7 +521,7 @@ public:
    * @return the number of input samples to the down-sampling call needed before a first output sample is
    * produced by the down-sampling call.
    */
-  uint32_t getDownSamplingLatency()
+  uint32_t getDownSamplingLatency() const
   {
     return getDownSamplingLatency(settings.order, settings.isUsingLinearPhase);
   }
@@ -227,7 +530,7 @@ public:
    * @return the number of input samples to the up-sampling call needed before a first output sample is
    * produced by the down-sampling call.
    */
-  uint32_t getLatency()
+  uint32_t getLatency() const
   {
     return getLatency(settings.order, settings.isUsingLinearPhase);
   }
@@ -235,15 +538,20 @@ public:
   /**
    * Gets the number of input samples to the up-sampling call needed before a first output sample is
    * produced by the up-sampling call, when the oversampling order and linear phase are set accordingly to the supplied
-   * values.
+   * values. With linear phase, the FIR re-samplers of the order must be ready. It does not change the state of the
+   * re-samplers.
    * @param order the order for which to compute the latency
    * @param linearPhase the order for which to compute the latency
    * @return the latency for the specified order and linear phase
+   * @see isFirOrderReady
    */
-  uint32_t getUpSamplingLatency(uint32_t order, bool linearPhase)
+  uint32_t getUpSamplingLatency(uint32_t order, bool linearPhase) const
   {
     if (linearPhase) {
       if (settings.numUpSampledChannels > 0) {
+        if (isUsingHalfBand()) {
+          return halfBandUpSampler.getLatency(order);
+        }
         return firUpSampler.getNumSamplesBeforeOutputStarts(order);
       }
     }
@@ -253,15 +561,21 @@ public:
   /**
    * Gets the number of input samples to the down-sampling call needed before a first output sample is
    * produced by the down-sampling call, when the oversampling order and linear phase are set accordingly to the
-   * supplied values.
+   * supplied values. With linear phase, the FIR re-samplers of the order must be ready. It does not change the state of
+   * the re-samplers.
    * @param order the order for which to compute the latency
    * @param linearPhase the order for which to compute the latency
    * @return the latency for the specified order and linear phase
+   * @see isFirOrderReady
    */
-  uint32_t getDownSamplingLatency(uint32_t order, bool linearPhase)
+  uint32_t getDownSamplingLatency(uint32_t order, bool linearPhase) const
   {
     if (linearPhase) {
       if (settings.numDownSampledChannels > 0) {
+        // the latency of the half-band down-sampler is a whole number of samples at the original rate
+        if (isUsingHalfBand()) {
+          return halfBandDownSampler.getLatency(order) << order;
+        }
         return firDownSampler.getNumSamplesBeforeOutputStarts(order);
       }
     }
@@ -271,18 +585,23 @@ public:
   /**
    * Gets the number of input samples to the up-sampling call needed before a first output sample is
    * produced by the down-sampling call, when the oversampling order and linear phase are set accordingly to the
-   * supplied values.
+   * supplied values: the latency of the up-sampler, plus the latency of the down-sampler converted to the original
+   * sample rate, as the down-sampler pads the beginning of its output with zeros until the re-sampled samples are
+   * available. With linear phase, the FIR re-samplers of the order must be ready. It does not change the state of the
+   * re-samplers.
    * @param order the order for which to compute the latency
    * @param linearPhase the order for which to compute the latency
    * @return the latency for the specified order and linear phase
+   * @see isFirOrderReady
    */
-  uint32_t getLatency(uint32_t order, bool linearPhase)
+  uint32_t getLatency(uint32_t order, bool linearPhase) const
   {
     assert(order <= settings.maxOrder);
     if (order == 0)
       return 0;
     if (linearPhase) {
-      return latencies[order - 1];
+      assert(isFirOrderReady(order));
+      return getUpSamplingLatency(order, true) + getDownSamplingLatency(order, true) / (1 << order);
     }
     return 0;
   }
@@ -294,7 +613,7 @@ public:
    */
   uint32_t getMaxNumOutputSamples()
   {
-    if (settings.isUsingLinearPhase) {
+    if (isUsingFirReSamplers()) {
       if (settings.numUpSampledChannels > 0) {
         return firUpSampler.getMaxNumOutputSamples();
       }
@@ -324,7 +643,11 @@ public:
    */
   void setUpSampledOutputBufferType(BufferType bufferType)
   {
-    settings.upSampleOutputBufferType = bufferType;
+    if (settings.upSampleOutputBufferType != bufferType) {
+      settings.upSampleOutputBufferType = bufferType;
+      setupInputOutputBuffers();
+      prepareInternalBuffers();
+    }
   }
 
   /**
@@ -333,7 +656,11 @@ public:
    */
   void setDownSampledOutputBufferType(BufferType bufferType)
   {
-    settings.downSampleOutputBufferType = bufferType;
+    if (settings.downSampleOutputBufferType != bufferType) {
+      settings.downSampleOutputBufferType = bufferType;
+      setupInputOutputBuffers();
+      prepareInternalBuffers();
+    }
   }
 
   /**
@@ -342,7 +669,11 @@ public:
    */
   void setDownSampledInputBufferType(BufferType bufferType)
   {
-    settings.downSampleInputBufferType = bufferType;
+    if (settings.downSampleInputBufferType != bufferType) {
+      settings.downSampleInputBufferType = bufferType;
+      setupInputOutputBuffers();
+      prepareInternalBuffers();
+    }
   }
 
   /**
@@ -353,27 +684,31 @@ public:
   uint32_t upSample(Float* const* input, uint32_t numSamples)
   {
     assert(settings.upSampleInputBufferType == BufferType::plain);
-    if (settings.isUsingLinearPhase) {
+    OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::upSampling, numSamples * settings.numUpSampledChannels);
+    if (isUsingFirReSamplers()) {
       auto const numUpSampledSamples = firUpSampler.processBlock(input, numSamples);
       if (settings.upSampleOutputBufferType == BufferType::interleaved) {
         assert(firUpSampler.getOutput().getNumSamples() == numUpSampledSamples);
         assert(upSampleOutputInterleaved.getCapacity() >= numUpSampledSamples);
         upSampleOutputInterleaved.setNumSamples(numUpSampledSamples);
+        OVERSIMPLE_SCOPED_SECTION(
+          instrumentation, Section::interleaving, numUpSampledSamples * settings.numUpSampledChannels);
         bool const ok = upSampleOutputInterleaved.interleave(firUpSampler.getOutput());
         assert(ok);
       }
       return numUpSampledSamples;
     }
     else {
-      iirUpSampler.processBlock(input, numSamples);
-      auto const numUpSampledSamples = numSamples * getOversamplingRate();
       if (settings.upSampleOutputBufferType == BufferType::plain) {
-        assert(numUpSampledSamples == iirUpSampler.getOutput().getNumSamples());
+        auto const numUpSampledSamples = numSamples << settings.order;
         assert(upSamplePlainBuffer.getCapacity() >= numUpSampledSamples);
         upSamplePlainBuffer.setNumSamples(numUpSampledSamples);
-        iirUpSampler.getOutput().deinterleave(upSamplePlainBuffer);
+        visitUpSamplerChain(
+          [&](auto& upSampler) { upSampler.processBlock(input, numSamples, upSamplePlainBuffer.get()); });
+        return numUpSampledSamples;
       }
-      return numUpSampledSamples;
+      visitUpSamplerChain([&](auto& upSampler) { upSampler.processBlock(input, numSamples); });
+      return getUpSamplerChainOutput().getNumSamples();
     }
   }
 
@@ -385,30 +720,72 @@ public:
   {
     assert(settings.upSampleInputBufferType == BufferType::interleaved);
     assert(input.getNumChannels() == settings.numUpSampledChannels);
-    if (settings.isUsingLinearPhase) {
+    OVERSIMPLE_SCOPED_SECTION(
+      instrumentation, Section::upSampling, input.getNumSamples() * settings.numUpSampledChannels);
+    if (isUsingFirReSamplers()) {
       assert(upSamplePlainBuffer.getCapacity() >= input.getNumSamples());
       upSamplePlainBuffer.setNumSamples(input.getNumSamples());
-      input.deinterleave(upSamplePlainBuffer);
+      {
+        OVERSIMPLE_SCOPED_SECTION(
+          instrumentation, Section::interleaving, input.getNumSamples() * settings.numUpSampledChannels);
+        input.deinterleave(upSamplePlainBuffer);
+      }
       auto const numUpSampledSamples = firUpSampler.processBlock(upSamplePlainBuffer);
       if (settings.upSampleOutputBufferType == BufferType::interleaved) {
         assert(firUpSampler.getOutput().getNumSamples() == numUpSampledSamples);
         assert(upSampleOutputInterleaved.getCapacity() >= numUpSampledSamples);
         upSampleOutputInterleaved.setNumSamples(numUpSampledSamples);
+        OVERSIMPLE_SCOPED_SECTION(
+          instrumentation, Section::interleaving, numUpSampledSamples * settings.numUpSampledChannels);
         bool const ok = upSampleOutputInterleaved.interleave(firUpSampler.getOutput());
         assert(ok);
       }
       return numUpSampledSamples;
     }
     else {
-      iirUpSampler.processBlock(input);
-      auto const numUpSampledSamples = iirUpSampler.getOutput().getNumSamples();
       if (settings.upSampleOutputBufferType == BufferType::plain) {
+        auto const numUpSampledSamples = input.getNumSamples() << settings.order;
         assert(upSamplePlainBuffer.getCapacity() >= numUpSampledSamples);
         upSamplePlainBuffer.setNumSamples(numUpSampledSamples);
-        iirUpSampler.getOutput().deinterleave(upSamplePlainBuffer);
+        visitUpSamplerChain([&](auto& upSampler) { upSampler.processBlock(input, upSamplePlainBuffer.get()); });
+        return numUpSampledSamples;
       }
+      visitUpSamplerChain([&](auto& upSampler) { upSampler.processBlock(input); });
+      return getUpSamplerChainOutput().getNumSamples();
+    }
+  }
+
+  /**
+   * Up-samples the input, avoiding to copy the up-sampled samples to a buffer owned by the object when possible: in
+   * double precision with linear phase enabled, the output is read directly from the memory of the FIR re-samplers if
+   * the input fits in a single fft block. Only supported with plain input and output buffers.
+   * @param input pointer to the input buffers
+   * @param numSamples the number of samples in each channel of the input buffer
+   * @return the number of up-sampled samples
+   * @see getUpSampleOutputView
+   */
+  uint32_t upSampleWithoutCopy(Float* const* input, uint32_t numSamples)
+  {
+    assert(settings.upSampleInputBufferType == BufferType::plain);
+    assert(settings.upSampleOutputBufferType == BufferType::plain);
+    if (isUsingFirReSamplers()) {
+      OVERSIMPLE_SCOPED_SECTION(instrumentation, Section::upSampling, numSamples * settings.numUpSampledChannels);
+      auto const numUpSampledSamples = firUpSampler.processBlockWithoutCopy(input, numSamples);
+      upSampleOutputView = firUpSampler.getOutputView();
       return numUpSampledSamples;
     }
+    auto const numUpSampledSamples = upSample(input, numSamples);
+    upSampleOutputView = upSamplePlainBuffer.get();
+    return numUpSampledSamples;
+  }
+
+  /**
+   * @return pointers to each channel of the output of the last call to upSampleWithoutCopy. They are only valid
+   * until the next up-sampling or reset call.
+   */
+  Float* const* getUpSampleOutputView() const
+  {
+    return upSampleOutputView;
   }
 
   /**
@@ -417,10 +794,10 @@ public:
   InterleavedBuffer<Float>& getUpSampleOutputInterleaved()
   {
     assert(settings.upSampleOutputBufferType == BufferType::interleaved);
-    if (settings.isUsingLinearPhase)
+    if (isUsingFirReSamplers())
       return upSampleOutputInterleaved;
     else
-      return iirUpSampler.getOutput();
+      return getUpSamplerChainOutput();
   }
 
   /**
@@ -429,7 +806,7 @@ public:
   Buffer<Float>& getUpSampleOutput()
   {
     assert(settings.upSampleOutputBufferType == BufferType::plain);
-    if (settings.isUsingLinearPhase)
+    if (isUsingFirReSamplers())
       return firUpSampler.getOutput();
     return upSamplePlainBuffer;
   }
@@ -440,10 +817,10 @@ public:
   InterleavedBuffer<Float> const& getUpSampleOutputInterleaved() const
   {
     assert(settings.upSampleOutputBufferType == BufferType::interleaved);
-    if (settings.isUsingLinearPhase)
+    if (isUsingFirReSamplers())
       return upSampleOutputInterleaved;
     else
-      return iirUpSampler.getOutput();
+      return getUpSamplerChainOutput();
   }
 
   /**
@@ -452,7 +829,7 @@ public:
   Buffer<Float> const& getUpSampleOutput() const
   {
     assert(settings.upSampleOutputBufferType == BufferType::plain);
-    if (settings.isUsingLinearPhase)
+    if (isUsingFirReSamplers())
       return firUpSampler.getOutput();
     return upSamplePlainBuffer;
   }
@@ -469,17 +846,17 @@ public:
   {
     assert(settings.downSampleOutputBufferType == BufferType::plain);
     assert(settings.downSampleInputBufferType == BufferType::plain);
-    if (settings.isUsingLinearPhase) {
+    OVERSIMPLE_SCOPED_SECTION(
+      instrumentation, Section::downSampling, numInputSamples * settings.numDownSampledChannels);
+    if (isUsingFirReSamplers()) {
       firDownSampler.processBlock(input, numInputSamples, output, numOutputSamples);
     }
     else {
       assert(numOutputSamples * (1 << settings.order) == numInputSamples);
-      assert(downSampleBufferInterleaved.getCapacity() >= numInputSamples);
-      downSampleBufferInterleaved.setNumSamples(numInputSamples);
-      bool const ok = downSampleBufferInterleaved.interleave(input, settings.numDownSampledChannels, numInputSamples);
-      assert(ok);
-      iirDownSampler.processBlock(downSampleBufferInterleaved);
-      iirDownSampler.getOutput().deinterleave(output, settings.numDownSampledChannels, numOutputSamples);
+      visitDownSamplerChain([&](auto& downSampler) { downSampler.processBlock(input, numInputSamples); });
+      OVERSIMPLE_SCOPED_SECTION(
+        instrumentation, Section::interleaving, numOutputSamples * settings.numDownSampledChannels);
+      getDownSamplerChainOutput().deinterleave(output, settings.numDownSampledChannels, numOutputSamples);
     }
   }
 
@@ -493,17 +870,27 @@ public:
   {
     assert(settings.downSampleOutputBufferType == BufferType::plain);
     assert(settings.downSampleInputBufferType == BufferType::interleaved);
-    if (settings.isUsingLinearPhase) {
+    OVERSIMPLE_SCOPED_SECTION(
+      instrumentation, Section::downSampling, input.getNumSamples() * settings.numDownSampledChannels);
+    if (isUsingFirReSamplers()) {
       auto const numInputSamples = input.getNumSamples();
-      assert(downSamplePlainInputBuffer.getCapacity() >= numInputSamples);
-      downSamplePlainInputBuffer.setNumSamples(numInputSamples);
-      input.deinterleave(downSamplePlainInputBuffer);
-      firDownSampler.processBlock(downSamplePlainInputBuffer, output, numOutputSamples);
+      auto& plainInput = getDownSamplePlainInputBuffer();
+      assert(plainInput.getNumChannels() >= settings.numDownSampledChannels);
+      assert(plainInput.getCapacity() >= numInputSamples);
+      plainInput.setNumSamples(numInputSamples);
+      {
+        OVERSIMPLE_SCOPED_SECTION(
+          instrumentation, Section::interleaving, numInputSamples * settings.numDownSampledChannels);
+        input.deinterleave(plainInput.get(), settings.numDownSampledChannels, numInputSamples);
+      }
+      firDownSampler.processBlock(plainInput.get(), numInputSamples, output, numOutputSamples);
     }
     else {
       assert(numOutputSamples * (1 << settings.order) == input.getNumSamples());
-      iirDownSampler.processBlock(input);
-      iirDownSampler.getOutput().deinterleave(output, settings.numDownSampledChannels, numOutputSamples);
+      visitDownSamplerChain([&](auto& downSampler) { downSampler.processBlock(input); });
+      OVERSIMPLE_SCOPED_SECTION(
+        instrumentation, Section::interleaving, numOutputSamples * settings.numDownSampledChannels);
+      getDownSamplerChainOutput().deinterleave(output, settings.numDownSampledChannels, numOutputSamples);
     }
   }
 
@@ -518,23 +905,23 @@ public:
   {
     assert(settings.downSampleOutputBufferType == BufferType::interleaved);
     assert(settings.downSampleInputBufferType == BufferType::plain);
-    if (settings.isUsingLinearPhase) {
+    OVERSIMPLE_SCOPED_SECTION(
+      instrumentation, Section::downSampling, numInputSamples * settings.numDownSampledChannels);
+    if (isUsingFirReSamplers()) {
       assert(downSamplePlainOutputBuffer.getCapacity() >= numOutputSamples);
       assert(downSampleBufferInterleaved.getCapacity() >= numOutputSamples);
       downSamplePlainOutputBuffer.setNumSamples(numOutputSamples);
       downSampleBufferInterleaved.setNumSamples(numOutputSamples);
       firDownSampler.processBlock(input, numInputSamples, downSamplePlainOutputBuffer.get(), numOutputSamples);
       downSampleBufferInterleaved.setNumSamples(numOutputSamples);
+      OVERSIMPLE_SCOPED_SECTION(
+        instrumentation, Section::interleaving, numOutputSamples * settings.numDownSampledChannels);
       bool const ok = downSampleBufferInterleaved.interleave(downSamplePlainOutputBuffer);
       assert(ok);
     }
     else {
       assert(numOutputSamples * (1 << settings.order) == numInputSamples);
-      assert(downSampleBufferInterleaved.getCapacity() >= numOutputSamples);
-      downSampleBufferInterleaved.setNumSamples(numInputSamples);
-      bool const ok = downSampleBufferInterleaved.interleave(input, settings.numDownSampledChannels, numInputSamples);
-      assert(ok);
-      iirDownSampler.processBlock(downSampleBufferInterleaved);
+      visitDownSamplerChain([&](auto& downSampler) { downSampler.processBlock(input, numInputSamples); });
     }
   }
 
@@ -547,21 +934,33 @@ public:
   {
     assert(settings.downSampleOutputBufferType == BufferType::interleaved);
     assert(settings.downSampleInputBufferType == BufferType::interleaved);
-    if (settings.isUsingLinearPhase) {
-      assert(downSamplePlainInputBuffer.getCapacity() >= input.getNumSamples());
+    OVERSIMPLE_SCOPED_SECTION(
+      instrumentation, Section::downSampling, input.getNumSamples() * settings.numDownSampledChannels);
+    if (isUsingFirReSamplers()) {
+      auto const numInputSamples = input.getNumSamples();
+      auto& plainInput = getDownSamplePlainInputBuffer();
+      assert(plainInput.getNumChannels() >= settings.numDownSampledChannels);
+      assert(plainInput.getCapacity() >= numInputSamples);
       assert(downSamplePlainOutputBuffer.getCapacity() >= numOutputSamples);
       assert(downSampleBufferInterleaved.getCapacity() >= numOutputSamples);
-      downSamplePlainInputBuffer.setNumSamples(input.getNumSamples());
+      plainInput.setNumSamples(numInputSamples);
       downSamplePlainOutputBuffer.setNumSamples(numOutputSamples);
-      input.deinterleave(downSamplePlainInputBuffer);
-      firDownSampler.processBlock(downSamplePlainInputBuffer, downSamplePlainOutputBuffer, numOutputSamples);
+      {
+        OVERSIMPLE_SCOPED_SECTION(
+          instrumentation, Section::interleaving, numInputSamples * settings.numDownSampledChannels);
+        input.deinterleave(plainInput.get(), settings.numDownSampledChannels, numInputSamples);
+      }
+      firDownSampler.processBlock(
+        plainInput.get(), numInputSamples, downSamplePlainOutputBuffer.get(), numOutputSamples);
       downSampleBufferInterleaved.setNumSamples(numOutputSamples);
+      OVERSIMPLE_SCOPED_SECTION(
+        instrumentation, Section::interleaving, numOutputSamples * settings.numDownSampledChannels);
       bool const ok = downSampleBufferInterleaved.interleave(downSamplePlainOutputBuffer);
       assert(ok);
     }
     else {
       assert(numOutputSamples * (1 << settings.order) == input.getNumSamples());
-      iirDownSampler.processBlock(input);
+      visitDownSamplerChain([&](auto& downSampler) { downSampler.processBlock(input); });
     }
   }
 
@@ -571,10 +970,10 @@ public:
   InterleavedBuffer<Float>& getDownSampleOutputInterleaved()
   {
     assert(settings.downSampleOutputBufferType == BufferType::interleaved);
-    if (settings.isUsingLinearPhase)
+    if (isUsingFirReSamplers())
       return downSampleBufferInterleaved;
     else
-      return iirDownSampler.getOutput();
+      return getDownSamplerChainOutput();
   }
 
   /**
@@ -583,178 +982,515 @@ public:
   InterleavedBuffer<Float> const& getDownSampleOutputInterleaved() const
   {
     assert(settings.downSampleOutputBufferType == BufferType::interleaved);
-    if (settings.isUsingLinearPhase)
+    if (isUsingFirReSamplers())
       return downSampleBufferInterleaved;
     else
-      return iirDownSampler.getOutput();
+      return getDownSamplerChainOutput();
+  }
+
+  /**
+   * Up-samples the input, lets the processor work on the up-sampled signal, and down-samples it to the output, one
+   * sub-block at a time, so that the up-sampled signal stays in cache between the three steps. The input and the
+   * output buffer types must be plain, and the down-sampler input buffer type must be the same as the up-sampler
+   * output one. The processor works on the first numDownSampledChannels channels of the up-sampled signal in place.
+   * @param input pointer to the input buffers
+   * @param output pointer to the output buffers
+   * @param numSamples the number of samples in each channel of the input and output buffers, which can be more than
+   * the maximum number of input samples the object is prepared for.
+   * @param processor a callable taking the up-sampled signal of a sub-block, as a Buffer<Float>& if the up-sampler
+   * output buffer type is plain or as an InterleavedBuffer<Float>& if it is interleaved, and the number of up-sampled
+   * samples as an uint32_t. As the buffer type is a runtime setting, the callable must accept both, for example being a
+   * generic lambda; TFixedOversampling takes a callable accepting only the buffer type it is instantiated with.
+   * @see getProcessSubBlockSize
+   */
+  template<class Processor>
+  void process(Float* const* input, Float** output, uint32_t numSamples, Processor&& processor)
+  {
+    static_assert(std::is_invocable_v<Processor, Buffer<Float>&, uint32_t> &&
+                    std::is_invocable_v<Processor, InterleavedBuffer<Float>&, uint32_t>,
+                  "the processor must accept both a Buffer<Float>& and an InterleavedBuffer<Float>&, as the up-sampler "
+                  "output buffer type is only known at runtime: use TFixedOversampling to set it at compile time");
+    assert(settings.upSampleInputBufferType == BufferType::plain);
+    assert(settings.downSampleOutputBufferType == BufferType::plain);
+    assert(settings.downSampleInputBufferType == settings.upSampleOutputBufferType);
+    assert(settings.numDownSampledChannels <= settings.numUpSampledChannels);
+    assert(processInput.size() == settings.numUpSampledChannels);
+    assert(processOutput.size() == settings.numDownSampledChannels);
+    auto const subBlockSize = getProcessSubBlockSize();
+    for (uint32_t offset = 0; offset < numSamples; offset += subBlockSize) {
+      auto const numSubBlockSamples = std::min(subBlockSize, numSamples - offset);
+      for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+        processInput[c] = input[c] + offset;
+      }
+      for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+        processOutput[c] = output[c] + offset;
+      }
+      auto const numUpSampledSamples = upSample(processInput.data(), numSubBlockSamples);
+      if (settings.upSampleOutputBufferType == BufferType::plain) {
+        auto& upSampled = getUpSampleOutput();
+        processor(upSampled, numUpSampledSamples);
+        downSample(upSampled.get(), numUpSampledSamples, processOutput.data(), numSubBlockSamples);
+      }
+      else {
+        auto& upSampled = getUpSampleOutputInterleaved();
+        processor(upSampled, numUpSampledSamples);
+        downSample(upSampled, processOutput.data(), numSubBlockSamples);
+      }
+    }
+  }
+
+  /**
+   * Outputs the last getLatency() samples of the processed signal, which are still in the re-samplers after the last
+   * input sample. The up-sampler is drained first, by up-sampling silence until its output has no more of the signal:
+   * its output is the up-sampled end of the signal, which the processor works on before it is down-sampled, as in
+   * process. Then the down-sampler is drained by down-sampling silence directly, without up-sampling it nor calling
+   * the processor. The
+   * uniformly partitioned engine does not transform the silence, only the spectra of the past input, r8brain only
+   * runs its filters, and the half-band re-samplers run their stages as when down-sampling. After it, the output holds all the processed input, and the processor should be reset before
+   * processing new input. The buffer types must be the ones required by process. Nothing is output by the IIR
+   * re-samplers, which have no latency.
+   * @param output pointer to the output buffers, each with room for getLatency() samples
+   * @param processor a callable working on the up-sampled signal, as the one passed to process. It only sees the
+   * up-sampled end of the signal.
+   * @return the number of samples written in each channel of the output, which is getLatency()
+   */
+  template<class Processor>
+  uint32_t flush(Float** output, Processor&& processor)
+  {
+    assert(flushOutput.size() == settings.numDownSampledChannels);
+    auto const numTailSamples = getLatency();
+    if (numTailSamples == 0) {
+      return 0;
+    }
+    auto const maxNumSamples = std::max(settings.maxNumInputSamples, 1u);
+    auto const setFlushOutput = [&](uint32_t offset) {
+      for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+        flushOutput[c] = output[c] + offset;
+      }
+    };
+    // the samples held by the up-sampler, which are processed. The FIR filters are linear phase, so the response to the
+    // last input sample ends at most one latency of the up-sampler after it is output.
+    auto const numUpSamplerTailSamples = std::min(2 * getUpSamplingLatency(settings.order, true), numTailSamples);
+    for (uint32_t offset = 0; offset < numUpSamplerTailSamples; offset += maxNumSamples) {
+      setFlushOutput(offset);
+      process(silenceInput.data(),
+              flushOutput.data(),
+              std::min(maxNumSamples, numUpSamplerTailSamples - offset),
+              processor);
+    }
+    // the samples held by the down-sampler, which have already been processed
+    auto const rate = 1u << settings.order;
+    auto const maxNumDrainedSamples = std::min(maxNumSamples, std::max(silence.getNumSamples() / rate, 1u));
+    for (uint32_t offset = numUpSamplerTailSamples; offset < numTailSamples; offset += maxNumDrainedSamples) {
+      auto const numDrainedSamples = std::min(maxNumDrainedSamples, numTailSamples - offset);
+      setFlushOutput(offset);
+      OVERSIMPLE_SCOPED_SECTION(
+        instrumentation, Section::downSampling, numDrainedSamples * rate * settings.numDownSampledChannels);
+      if (isUsingFirReSamplers()) {
+        firDownSampler.processBlock(
+          silenceInput.data(), numDrainedSamples * rate, flushOutput.data(), numDrainedSamples);
+      }
+      else {
+        halfBandDownSampler.processBlock(silenceInput.data(), numDrainedSamples * rate);
+        halfBandDownSampler.getOutput().deinterleave(
+          flushOutput.data(), settings.numDownSampledChannels, numDrainedSamples);
+      }
+    }
+    return numTailSamples;
+  }
+
+  /**
+   * Outputs the last getLatency() samples of the up-sampled and down-sampled signal, without processing it.
+   * @see flush(Float**, Processor&&)
+   */
+  uint32_t flush(Float** output)
+  {
+    return flush(output, [](auto&, uint32_t) {});
+  }
+
+  /**
+   * @return the number of input samples in each sub-block processed by process: the value set in the settings, or by
+   * default one such that the up-sampled signal of all channels takes about 32 KiB when using the IIR or the half-band
+   * re-samplers, and the maximum number of input samples when using the FIR re-samplers, which output their samples in
+   * bursts of fft blocks anyway. It is never more than the maximum number of input samples.
+   */
+  uint32_t getProcessSubBlockSize() const
+  {
+    auto const maxSubBlockSize = std::max(settings.maxNumInputSamples, 1u);
+    if (settings.processSubBlockSize > 0) {
+      return std::min(settings.processSubBlockSize, maxSubBlockSize);
+    }
+    if (isUsingFirReSamplers()) {
+      return maxSubBlockSize;
+    }
+    auto const numChannels = std::max(settings.numUpSampledChannels, 1u);
+    auto const upSampledBytesPerInputSample = (uint32_t)sizeof(Float) * numChannels * (1u << settings.order);
+    auto const subBlockSize = std::max(processSubBlockBytes / upSampledBytesPerInputSample, 1u);
+    return std::min(subBlockSize, maxSubBlockSize);
   }
 
 private:
+  static constexpr uint32_t processSubBlockBytes = 32768;
+
   void setup()
   {
-    iirUpSampler.setNumChannels(settings.numUpSampledChannels);
-    iirUpSampler.setMaxOrder(settings.maxOrder);
+    std::visit(
+      [&](auto& upSampler) {
+        upSampler.setNumChannels(settings.numUpSampledChannels);
+        upSampler.setMaxOrder(settings.maxOrder);
+      },
+      iirUpSampler);
 
-    iirDownSampler.setNumChannels(settings.numDownSampledChannels);
-    iirDownSampler.setMaxOrder(settings.maxOrder);
+    std::visit(
+      [&](auto& downSampler) {
+        downSampler.setNumChannels(settings.numDownSampledChannels);
+        downSampler.setMaxOrder(settings.maxOrder);
+      },
+      iirDownSampler);
+
+    halfBandUpSampler.setNumChannels(getNumHalfBandChannels(settings.firEngine, settings.numUpSampledChannels));
+    halfBandUpSampler.setMaxOrder(settings.maxOrder);
+    halfBandDownSampler.setNumChannels(getNumHalfBandChannels(settings.firEngine, settings.numDownSampledChannels));
+    halfBandDownSampler.setMaxOrder(settings.maxOrder);
+
+    setupSilenceBypass();
 
     firUpSampler.setTransitionBand(settings.firTransitionBand);
+    firUpSampler.setEngine(getFirReSamplersEngine(settings.firEngine));
     firUpSampler.setFftSamplesPerBlock(settings.fftBlockSize);
-    firUpSampler.setNumChannels(settings.numUpSampledChannels);
+    firUpSampler.setNumChannels(getNumFirChannels(settings.firEngine, settings.numUpSampledChannels));
     firUpSampler.setMaxOrder(settings.maxOrder);
 
     firDownSampler.setTransitionBand(settings.firTransitionBand);
+    firDownSampler.setEngine(getFirReSamplersEngine(settings.firEngine));
     firDownSampler.setFftSamplesPerBlock(settings.fftBlockSize);
-    firDownSampler.setNumChannels(settings.numDownSampledChannels);
+    firDownSampler.setNumChannels(getNumFirChannels(settings.firEngine, settings.numDownSampledChannels));
     firDownSampler.setMaxOrder(settings.maxOrder);
 
     setupInputOutputBuffers();
     prepareInternalBuffers();
-    computeLatencies();
+  }
+
+  void setupSilenceBypass()
+  {
+    auto const setup = [&](auto& reSampler) {
+      reSampler.setBypassingSilence(settings.isBypassingSilence);
+      reSampler.setSilenceThreshold((Float)settings.silenceThreshold);
+    };
+    std::visit(setup, iirUpSampler);
+    std::visit(setup, iirDownSampler);
+    setup(halfBandUpSampler);
+    setup(halfBandDownSampler);
   }
 
   void prepareInternalBuffers()
   {
-    iirUpSampler.prepareBuffers(settings.maxNumInputSamples);
-    iirDownSampler.prepareBuffers(settings.maxNumInputSamples);
+    std::visit([&](auto& upSampler) { upSampler.prepareBuffers(settings.maxNumInputSamples); }, iirUpSampler);
+    std::visit([&](auto& downSampler) { downSampler.prepareBuffers(settings.maxNumInputSamples); }, iirDownSampler);
+    halfBandUpSampler.prepareBuffers(settings.maxNumInputSamples);
+    halfBandDownSampler.prepareBuffers(settings.maxNumInputSamples);
     firUpSampler.prepareBuffers(settings.maxNumInputSamples);
-    auto const maxFirUpSampledSamples = firUpSampler.getMaxNumOutputSamples();
+    // the buffers are sized for all the orders, also the ones that are not allocated yet, so that an order prepared
+    // later by prepareFirOrder fits in them
+    auto const maxFirUpSampledSamples = firUpSampler.getMaxNumOutputSamplesOfAllOrders();
     firDownSampler.prepareBuffers(maxFirUpSampledSamples, settings.maxNumInputSamples);
-    auto const maxSamplesUpSampled = settings.maxNumInputSamples * (1 << settings.maxOrder);
-    auto const maxSamples = std::max(maxFirUpSampledSamples, maxSamplesUpSampled);
-    downSampleBufferInterleaved.reserve(maxSamples);
-    downSamplePlainOutputBuffer.reserve(maxSamples);
-    downSamplePlainInputBuffer.reserve(maxSamples);
-    upSampleOutputInterleaved.reserve(maxSamples);
-    upSamplePlainBuffer.reserve(maxSamples);
+    // each buffer is sized for the re-samplers that use it: the FIR ones for the interleaved up-sampled signal and the
+    // deinterleaved input of the down-sampling, the IIR ones for the plain up-sampled signal
+    downSampleBufferInterleaved.reserve(settings.maxNumInputSamples);
+    downSamplePlainOutputBuffer.reserve(settings.maxNumInputSamples);
+    downSamplePlainInputBuffer.reserve(maxFirUpSampledSamples);
+    upSampleOutputInterleaved.reserve(maxFirUpSampledSamples);
+    upSamplePlainBuffer.reserve(
+      getUpSamplePlainCapacity(settings, isDownSampleInputInUpSampleBuffer, maxFirUpSampledSamples));
+    // the silence is also down-sampled by flush, so it holds at least the up-sampled samples of an input sample
+    silence.setNumSamples(getSilenceCapacity(settings));
+    silence.fill((Float)0.0);
+    silenceInput.assign(std::max(settings.numUpSampledChannels, settings.numDownSampledChannels), silence.get()[0]);
   }
 
   void setupInputOutputBuffers()
   {
+    processInput.assign(settings.numUpSampledChannels, nullptr);
+    processOutput.assign(settings.numDownSampledChannels, nullptr);
+    flushOutput.assign(settings.numDownSampledChannels, nullptr);
+    // all the channels read the same silent channel
+    silence.setNumChannels(1);
+    auto const layout = getInternalBuffersLayout(settings, sharedDownSampleInputBuffer != nullptr);
+    upSampleOutputInterleaved.setNumChannels(layout.numUpSampleOutputInterleavedChannels);
+    upSamplePlainBuffer.setNumChannels(layout.numUpSamplePlainChannels);
+    downSampleBufferInterleaved.setNumChannels(layout.numDownSampleInterleavedChannels);
+    downSamplePlainInputBuffer.setNumChannels(layout.numDownSamplePlainInputChannels);
+    downSamplePlainOutputBuffer.setNumChannels(layout.numDownSamplePlainOutputChannels);
+    isDownSampleInputInUpSampleBuffer = layout.isDownSampleInputInUpSampleBuffer;
+  }
+
+  // the number of channels of each internal buffer, which depends on the buffer types of the settings
+  struct InternalBuffersLayout final
+  {
+    uint32_t numUpSampleOutputInterleavedChannels = 0;
+    uint32_t numUpSamplePlainChannels = 0;
+    uint32_t numDownSampleInterleavedChannels = 0;
+    uint32_t numDownSamplePlainInputChannels = 0;
+    uint32_t numDownSamplePlainOutputChannels = 0;
+    bool isDownSampleInputInUpSampleBuffer = false;
+  };
+
+  static InternalBuffersLayout getInternalBuffersLayout(OversamplingSettings const& settings,
+                                                        bool isDownSampleInputShared)
+  {
+    InternalBuffersLayout layout;
     if (settings.upSampleOutputBufferType == BufferType::interleaved) {
-      upSampleOutputInterleaved.setNumChannels(settings.numUpSampledChannels);
-    }
-    else {
-      upSampleOutputInterleaved.setNumChannels(0);
+      layout.numUpSampleOutputInterleavedChannels = settings.numUpSampledChannels;
     }
     if (settings.upSampleOutputBufferType == BufferType::plain ||
         settings.upSampleInputBufferType == BufferType::interleaved)
     {
-      upSamplePlainBuffer.setNumChannels(settings.numUpSampledChannels);
-    }
-    else {
-      upSamplePlainBuffer.setNumChannels(0);
+      layout.numUpSamplePlainChannels = settings.numUpSampledChannels;
     }
-    if (settings.downSampleOutputBufferType == BufferType::plain &&
-        settings.downSampleInputBufferType == BufferType::plain) {
-      downSampleBufferInterleaved.setNumChannels(settings.numDownSampledChannels);
-      downSamplePlainInputBuffer.setNumChannels(0);
-      downSamplePlainOutputBuffer.setNumChannels(0);
+    if (settings.downSampleOutputBufferType == BufferType::interleaved) {
+      layout.numDownSampleInterleavedChannels = settings.numDownSampledChannels;
     }
-    else if (settings.downSampleOutputBufferType == BufferType::interleaved &&
-             settings.downSampleInputBufferType == BufferType::interleaved)
-    {
-      downSampleBufferInterleaved.setNumChannels(settings.numDownSampledChannels);
-      downSamplePlainInputBuffer.setNumChannels(settings.numDownSampledChannels);
-      downSamplePlainOutputBuffer.setNumChannels(settings.numDownSampledChannels);
+    // the buffer supplied by setSharedDownSampleInputBuffer replaces the one of the object
+    if (settings.downSampleInputBufferType == BufferType::interleaved && !isDownSampleInputShared) {
+      layout.numDownSamplePlainInputChannels = settings.numDownSampledChannels;
     }
-    else if (settings.downSampleOutputBufferType == BufferType::plain &&
-             settings.downSampleInputBufferType == BufferType::interleaved)
+    if (settings.downSampleOutputBufferType == BufferType::interleaved ||
+        settings.downSampleInputBufferType == BufferType::interleaved)
     {
-      downSampleBufferInterleaved.setNumChannels(0);
-      downSamplePlainInputBuffer.setNumChannels(settings.numDownSampledChannels);
-      downSamplePlainOutputBuffer.setNumChannels(settings.numDownSampledChannels);
+      layout.numDownSamplePlainOutputChannels = settings.numDownSampledChannels;
     }
-    else if (settings.downSampleOutputBufferType == BufferType::interleaved &&
-             settings.downSampleInputBufferType == BufferType::plain)
-    {
-      downSampleBufferInterleaved.setNumChannels(settings.numDownSampledChannels);
-      downSamplePlainInputBuffer.setNumChannels(0);
-      downSamplePlainOutputBuffer.setNumChannels(settings.numDownSampledChannels);
+    // when the up-sampled signal is interleaved, the plain buffer of the up-sampling only holds the deinterleaved input
+    // during upSample, and the plain input buffer of the down-sampling only holds the deinterleaved input during
+    // downSample, so they share the same memory if only one of them is used, or if they have the same channels
+    layout.isDownSampleInputInUpSampleBuffer =
+      settings.upSampleOutputBufferType == BufferType::interleaved && layout.numDownSamplePlainInputChannels > 0 &&
+      (layout.numUpSamplePlainChannels == 0 ||
+       layout.numUpSamplePlainChannels == layout.numDownSamplePlainInputChannels);
+    if (layout.isDownSampleInputInUpSampleBuffer) {
+      layout.numUpSamplePlainChannels = layout.numDownSamplePlainInputChannels;
+      layout.numDownSamplePlainInputChannels = 0;
     }
+    return layout;
   }
 
-  void computeLatencies()
+  static uint32_t getSilenceCapacity(OversamplingSettings const& settings)
   {
-    prepareBuffers(settings.maxNumInputSamples);
-    if (settings.numUpSampledChannels == 0 && settings.numDownSampledChannels == 0) {
-      for (uint32_t order = 1; order <= settings.maxOrder; ++order) {
-        setOrder(order);
-        latencies[order - 1] = 0;
-      }
-      return;
-    }
-    if (settings.numUpSampledChannels == 0) {
-      for (uint32_t order = 1; order <= settings.maxOrder; ++order) {
-        setOrder(order);
-        latencies[order - 1] = (uint64_t)((double)getDownSamplingLatency(order, true) / ((double)(1 << order)));
-      }
-      return;
-    }
-    if (settings.numDownSampledChannels == 0) {
-      for (uint32_t order = 1; order <= settings.maxOrder; ++order) {
-        setOrder(order);
-        latencies[order - 1] = getUpSamplingLatency(order, true);
-      }
-      return;
-    }
-    auto const computeLatency = [&] {
-      uint32_t latency = 0;
-      auto input = Buffer<Float>(settings.numUpSampledChannels, settings.maxNumInputSamples);
-      auto output = Buffer<Float>(settings.numDownSampledChannels, settings.maxNumInputSamples);
-      input.fill(1.0);
-      for (;;) {
-        output.fill(0.0);
-        firUpSampler.processBlock(input);
-        auto upSampledCopy = firUpSampler.getOutput();
-        upSampledCopy.setNumChannels(settings.numDownSampledChannels);
-        firDownSampler.processBlock(upSampledCopy, output, output.getNumSamples());
-        auto const& channel = output[0];
-        auto const itToFirstSample =
-          std::find_if(channel.begin(), channel.end(), [](Float const& element) { return element != 0.0; });
-        if (itToFirstSample != channel.end()) {
-          auto const indexOfFirstSample = std::distance(channel.begin(), itToFirstSample);
-          latency += indexOfFirstSample;
-          return latency;
-        }
-        else {
-          latency += (uint32_t)channel.size();
-        }
-      }
-    };
-    auto const wasLinearPhase = settings.isUsingLinearPhase;
-    auto const previousOrder = settings.order;
-    setUseLinearPhase(true);
-    for (uint32_t order = 1; order <= settings.maxOrder; ++order) {
-      setOrder(order);
-      latencies[order - 1] = computeLatency();
-    }
-    setUseLinearPhase(wasLinearPhase);
-    setOrder(previousOrder);
+    return std::max(settings.maxNumInputSamples, 1u << settings.maxOrder);
   }
 
-  OversamplingSettings settings;
+  static uint32_t getMaxFirUpSampledSamples(OversamplingSettings const& settings)
+  {
+    return fir::TUpSamplerPreAllocated<Float>::computeMaxNumOutputSamplesOfAllOrders(
+      settings.maxOrder,
+      settings.firTransitionBand,
+      settings.fftBlockSize,
+      getFirReSamplersEngine(settings.firEngine),
+      settings.maxNumInputSamples);
+  }
 
-  fir::TUpSamplerPreAllocated<Float> firUpSampler;
-  fir::TDownSamplerPreAllocated<Float> firDownSampler;
-  iir::UpSampler<Float> iirUpSampler;
-  iir::DownSampler<Float> iirDownSampler;
+  bool isUsingHalfBand() const
+  {
+    return settings.firEngine == fir::Engine::halfBand;
+  }
 
-  InterleavedBuffer<Float> downSampleBufferInterleaved;
-  Buffer<Float> downSamplePlainOutputBuffer;
-  Buffer<Float> downSamplePlainInputBuffer;
-  InterleavedBuffer<Float> upSampleOutputInterleaved;
-  Buffer<Float> upSamplePlainBuffer;
+  // with fir::Engine::halfBand, the linear phase path uses the half-band re-samplers, which have the interface of the
+  // IIR ones and take the same path
+  bool isUsingFirReSamplers() const
+  {
+    return settings.isUsingLinearPhase && !isUsingHalfBand();
+  }
 
-  std::array<uint32_t, 5> latencies;
-};
+  // only the re-samplers of the selected engine have channels, the others are kept empty
+  static uint32_t getNumFirChannels(fir::Engine engine, uint32_t numChannels)
+  {
+    return engine == fir::Engine::halfBand ? 0 : numChannels;
+  }
 
-/*
- * A class that wraps a TOversampling<float> and a TOversampling<double>
- * */
-class Oversampling final
-{
-public:
+  static uint32_t getNumHalfBandChannels(fir::Engine engine, uint32_t numChannels)
+  {
+    return engine == fir::Engine::halfBand ? numChannels : 0;
+  }
+
+  // the FIR re-samplers do not support the half-band engine, and have no channels when it is used: the uniformly
+  // partitioned engine computes their buffer sizes without building anything
+  static fir::Engine getFirReSamplersEngine(fir::Engine engine)
+  {
+    return engine == fir::Engine::halfBand ? fir::Engine::uniformPartitioned : engine;
+  }
+
+  // the plain buffer of the up-sampling holds the up-sampled signal of the IIR re-samplers, the deinterleaved input,
+  // and the deinterleaved input of the FIR down-sampler when it is shared
+  static uint32_t getUpSamplePlainCapacity(OversamplingSettings const& settings,
+                                           bool isDownSampleInputInUpSampleBuffer,
+                                           uint32_t maxFirUpSampledSamples)
+  {
+    auto const maxSamplesUpSampled = settings.maxNumInputSamples * (1 << settings.maxOrder);
+    return std::max({ maxSamplesUpSampled,
+                      settings.maxNumInputSamples,
+                      isDownSampleInputInUpSampleBuffer ? maxFirUpSampledSamples : 0u });
+  }
+
+  Buffer<Float>& getDownSamplePlainInputBuffer()
+  {
+    if (sharedDownSampleInputBuffer) {
+      return *sharedDownSampleInputBuffer;
+    }
+    return isDownSampleInputInUpSampleBuffer ? upSamplePlainBuffer : downSamplePlainInputBuffer;
+  }
+
+  static std::size_t getPlainBufferSize(uint32_t numChannels, uint32_t capacity)
+  {
+    return (std::size_t)numChannels * capacity * sizeof(Float);
+  }
+
+  static std::size_t getInterleavedBufferSize(uint32_t numChannels, uint32_t capacity)
+  {
+    uint32_t numVecBuffers2 = 0;
+    uint32_t numVecBuffers4 = 0;
+    uint32_t numVecBuffers8 = 0;
+    avec::getNumOfVecBuffersUsedByInterleavedBuffer<Float>(numChannels, numVecBuffers2, numVecBuffers4, numVecBuffers8);
+    auto const numLanes = 2 * numVecBuffers2 + 4 * numVecBuffers4 + 8 * numVecBuffers8;
+    return (std::size_t)numLanes * capacity * sizeof(Float);
+  }
+
+  OversamplingSettings settings;
+
+  fir::TUpSamplerPreAllocated<Float> firUpSampler;
+  fir::TDownSamplerPreAllocated<Float> firDownSampler;
+  // the IIR re-samplers hold one alternative for each iir::Quality, in the same order
+  using IirUpSampler = std::variant<iir::UpSampler<Float, iir::Quality::low>,
+                                    iir::UpSampler<Float, iir::Quality::standard>,
+                                    iir::UpSampler<Float, iir::Quality::high>>;
+  using IirDownSampler = std::variant<iir::DownSampler<Float, iir::Quality::low>,
+                                      iir::DownSampler<Float, iir::Quality::standard>,
+                                      iir::DownSampler<Float, iir::Quality::high>>;
+
+  template<class IirReSampler>
+  static IirReSampler makeIirReSampler(iir::Quality quality, uint32_t numChannels, uint32_t maxOrder)
+  {
+    switch (quality) {
+      case iir::Quality::low:
+        return IirReSampler{ std::in_place_index<0>, numChannels, maxOrder };
+      case iir::Quality::high:
+        return IirReSampler{ std::in_place_index<2>, numChannels, maxOrder };
+      case iir::Quality::standard:
+      default:
+        return IirReSampler{ std::in_place_index<1>, numChannels, maxOrder };
+    }
+  }
+
+  template<class IirReSampler>
+  static void emplaceIirReSampler(IirReSampler& reSampler, iir::Quality quality, uint32_t numChannels, uint32_t maxOrder)
+  {
+    switch (quality) {
+      case iir::Quality::low:
+        reSampler.template emplace<0>(numChannels, maxOrder);
+        break;
+      case iir::Quality::high:
+        reSampler.template emplace<2>(numChannels, maxOrder);
+        break;
+      case iir::Quality::standard:
+      default:
+        reSampler.template emplace<1>(numChannels, maxOrder);
+        break;
+    }
+  }
+
+  // calls the function with the re-sampler of the minimum phase path, or of the linear phase one with the half-band
+  // engine, which share the interface of the IIR re-samplers
+  template<class Function>
+  decltype(auto) visitUpSamplerChain(Function&& function)
+  {
+    assert(!isUsingFirReSamplers());
+    if (settings.isUsingLinearPhase) {
+      return function(halfBandUpSampler);
+    }
+    return std::visit(function, iirUpSampler);
+  }
+
+  template<class Function>
+  decltype(auto) visitUpSamplerChain(Function&& function) const
+  {
+    assert(!isUsingFirReSamplers());
+    if (settings.isUsingLinearPhase) {
+      return function(halfBandUpSampler);
+    }
+    return std::visit(function, iirUpSampler);
+  }
+
+  template<class Function>
+  decltype(auto) visitDownSamplerChain(Function&& function)
+  {
+    assert(!isUsingFirReSamplers());
+    if (settings.isUsingLinearPhase) {
+      return function(halfBandDownSampler);
+    }
+    return std::visit(function, iirDownSampler);
+  }
+
+  template<class Function>
+  decltype(auto) visitDownSamplerChain(Function&& function) const
+  {
+    assert(!isUsingFirReSamplers());
+    if (settings.isUsingLinearPhase) {
+      return function(halfBandDownSampler);
+    }
+    return std::visit(function, iirDownSampler);
+  }
+
+  InterleavedBuffer<Float>& getUpSamplerChainOutput()
+  {
+    return visitUpSamplerChain([](auto& upSampler) -> InterleavedBuffer<Float>& { return upSampler.getOutput(); });
+  }
+
+  InterleavedBuffer<Float> const& getUpSamplerChainOutput() const
+  {
+    return visitUpSamplerChain(
+      [](auto const& upSampler) -> InterleavedBuffer<Float> const& { return upSampler.getOutput(); });
+  }
+
+  InterleavedBuffer<Float>& getDownSamplerChainOutput()
+  {
+    return visitDownSamplerChain(
+      [](auto& downSampler) -> InterleavedBuffer<Float>& { return downSampler.getOutput(); });
+  }
+
+  InterleavedBuffer<Float> const& getDownSamplerChainOutput() const
+  {
+    return visitDownSamplerChain(
+      [](auto const& downSampler) -> InterleavedBuffer<Float> const& { return downSampler.getOutput(); });
+  }
+
+  IirUpSampler iirUpSampler;
+  IirDownSampler iirDownSampler;
+  // the linear phase re-samplers used instead of the FIR ones with fir::Engine::halfBand
+  fir::HalfBandUpSampler<Float> halfBandUpSampler;
+  fir::HalfBandDownSampler<Float> halfBandDownSampler;
+
+  InterleavedBuffer<Float> downSampleBufferInterleaved;
+  Buffer<Float> downSamplePlainOutputBuffer;
+  Buffer<Float> downSamplePlainInputBuffer;
+  InterleavedBuffer<Float> upSampleOutputInterleaved;
+  Buffer<Float> upSamplePlainBuffer;
+  // whether the deinterleaved input of the FIR down-sampling is held by upSamplePlainBuffer
+  bool isDownSampleInputInUpSampleBuffer = false;
+  Buffer<Float>* sharedDownSampleInputBuffer = nullptr;
+  Float* const* upSampleOutputView = nullptr;
+  std::vector<Float*> processInput;
+  std::vector<Float*> processOutput;
+  // the input and the output pointers of flush
+  Buffer<Float> silence;
+  std::vector<Float*> silenceInput;
+  std::vector<Float*> flushOutput;
+  Instrumentation* instrumentation = nullptr;
+};
+
+/*
+ * A class that wraps a TOversampling<float> and a TOversampling<double>
+ * */
+class Oversampling final
+{
+public:
   /**
    * Constructor
    * @param settings the settings to initialize the object with.
@@ -772,6 +1508,17 @@ public:
     return oversampling32.getSettings();
   }
 
+  /**
+   * @return the number of bytes allocated by the internal buffers of an object with the supplied settings, for both
+   * precisions.
+   * @see TOversampling::getInternalBuffersSize
+   */
+  static std::size_t getInternalBuffersSize(OversamplingSettings const& settings)
+  {
+    return TOversampling<float>::getInternalBuffersSize(settings) +
+           TOversampling<double>::getInternalBuffersSize(settings);
+  }
+
   /**
    * Sets the maximum order of oversampling supported, and allocates the necessary resources
    * @param value the maximum order of oversampling
@@ -835,6 +1582,134 @@ public:
     oversampling64.setFirTransitionBand(transitionBand);
   }
 
+  /**
+   * Sets the engine used by the FIR re-samplers. Only affects the behaviour of the object when linear phase is enabled.
+   * @param engine the new engine
+   * @see fir::Engine
+   */
+  void setFirEngine(fir::Engine engine)
+  {
+    oversampling32.setFirEngine(engine);
+    oversampling64.setFirEngine(engine);
+  }
+
+  /**
+   * Sets the executor used by the FIR re-samplers to process the channels in parallel. Only affects the behaviour of
+   * the object when linear phase is enabled.
+   * @param executor the executor to use, or nullptr to process the channels serially on the calling thread. It must
+   * outlive its use by the object.
+   */
+  void setFirExecutor(TaskExecutor* executor)
+  {
+    oversampling32.setFirExecutor(executor);
+    oversampling64.setFirExecutor(executor);
+  }
+
+  /**
+   * @return the executor used by the FIR re-samplers to process the channels in parallel, or nullptr if they are
+   * processed serially.
+   */
+  TaskExecutor* getFirExecutor() const
+  {
+    return oversampling32.getFirExecutor();
+  }
+
+  /**
+   * Sets the Instrumentation that collects the time spent in each section of the up-sampling and of the
+   * down-sampling. Only has an effect if OVERSIMPLE_INSTRUMENTATION is 1.
+   * @param instrumentation the Instrumentation to use, or nullptr to not collect anything. It must outlive its use by
+   * the object.
+   */
+  void setInstrumentation(Instrumentation* instrumentation)
+  {
+    oversampling32.setInstrumentation(instrumentation);
+    oversampling64.setInstrumentation(instrumentation);
+  }
+
+  /**
+   * @return the Instrumentation that collects the time spent by the object, or nullptr if there is none
+   */
+  Instrumentation* getInstrumentation() const
+  {
+    return oversampling32.getInstrumentation();
+  }
+
+  /**
+   * @return how the channels to up-sample are packed into the SIMD lanes of the IIR antialiasing filters.
+   * @see TOversampling::getIirUpSamplerChannelLayout
+   */
+  template<class Float>
+  iir::ChannelLayout getIirUpSamplerChannelLayout() const
+  {
+    return get<Float>().getIirUpSamplerChannelLayout();
+  }
+
+  /**
+   * @return how the channels to down-sample are packed into the SIMD lanes of the IIR antialiasing filters.
+   * @see TOversampling::getIirDownSamplerChannelLayout
+   */
+  template<class Float>
+  iir::ChannelLayout getIirDownSamplerChannelLayout() const
+  {
+    return get<Float>().getIirDownSamplerChannelLayout();
+  }
+
+  /**
+   * Sets the quality tier of the IIR antialiasing filters.
+   * @param quality the quality tier to use
+   * @see TOversampling::setIirQuality
+   */
+  void setIirQuality(iir::Quality quality)
+  {
+    oversampling32.setIirQuality(quality);
+    oversampling64.setIirQuality(quality);
+  }
+
+  /**
+   * Enables or disables the silence bypass of the IIR re-samplers.
+   * @param value true to enable the bypass, false to disable it
+   * @see TOversampling::setBypassingSilence
+   */
+  void setBypassingSilence(bool value)
+  {
+    oversampling32.setBypassingSilence(value);
+    oversampling64.setBypassingSilence(value);
+  }
+
+  /**
+   * @return true if the silence bypass of the IIR re-samplers is enabled, false otherwise
+   */
+  bool getBypassingSilence() const
+  {
+    return oversampling32.getBypassingSilence();
+  }
+
+  /**
+   * Sets the level to which the output of a channel with a silent input has to decay before bypassing it.
+   * @param value the threshold, as an absolute sample value
+   */
+  void setSilenceThreshold(double value)
+  {
+    oversampling32.setSilenceThreshold(value);
+    oversampling64.setSilenceThreshold(value);
+  }
+
+  /**
+   * @return the level to which the output of a channel with a silent input has to decay before bypassing it
+   */
+  double getSilenceThreshold() const
+  {
+    return oversampling32.getSilenceThreshold();
+  }
+
+  /**
+   * @return the quality tier of the IIR antialiasing filters
+   */
+  iir::Quality getIirQuality() const
+  {
+    return oversampling32.getIirQuality();
+  }
+
   /**
    * Sets whether the object shoul use the linear phase FIR re-samplers or the minimum-phase IIR re-samplers.
    * @param useLinearPhase true to enable linear phase, false to disable it.
@@ -854,14 +1729,43 @@ public:
   }
 
   /**
-   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set
+   * Sets the order of oversampling to be used. It must be less or equal to the maximum order set, and its FIR
+   * re-samplers must be ready in both precisions. It never allocates nor waits.
    * @value the order to set
-   * @return true if the order was set correctly, false otherwise
+   * @return true if the order was set, false if the FIR re-samplers of the order are not ready
+   * @see TOversampling::setOrder
    */
-  void setOrder(uint32_t order)
+  bool setOrder(uint32_t order)
   {
+    if (!isFirOrderReady(order)) {
+      return false;
+    }
     oversampling32.setOrder(order);
     oversampling64.setOrder(order);
+    return true;
+  }
+
+  /**
+   * Allocates the FIR re-samplers for the supplied order, if they have not been allocated yet. Only useful if the
+   * FIR allocation policy is fir::AllocationPolicy::activeOrderOnly. It can be called from a background thread while
+   * the object is processing with another order, but not concurrently with any other method that changes the
+   * settings of the object.
+   * @param order the order to prepare
+   * @return true if the order is ready, false if it is greater than the maximum order
+   */
+  bool prepareFirOrder(uint32_t order)
+  {
+    return oversampling32.prepareFirOrder(order) && oversampling64.prepareFirOrder(order);
+  }
+
+  /**
+   * @return true if the FIR re-samplers for the supplied order have been allocated. It can be called while
+   * prepareFirOrder is running on another thread.
+   * @param order the order to query
+   */
+  bool isFirOrderReady(uint32_t order) const
+  {
+    return oversampling32.isFirOrderReady(order) && oversampling64.isFirOrderReady(order);
   }
 
   /**
@@ -873,11 +1777,22 @@ public:
     oversampling64.reset();
   }
 
+  /**
+   * Resets the state of the processor and primes the re-samplers, so that the up-sampling produces its output from the
+   * first call.
+   * @see TOversampling::prime
+   */
+  void prime()
+  {
+    oversampling32.prime();
+    oversampling64.prime();
+  }
+
   /**
    * @return the number of input samples to the up-sampling call needed before a first output sample is
    * produced by the up-sampling call.
    */
-  uint32_t getUpSamplingLatency()
+  uint32_t getUpSamplingLatency() const
   {
     return oversampling32.getUpSamplingLatency();
   }
@@ -886,7 +1801,7 @@ public:
    * @return the number of input samples to the down-sampling call needed before a first output sample is
    * produced by the down-sampling call.
    */
-  uint32_t getDownSamplingLatency()
+  uint32_t getDownSamplingLatency() const
   {
     return oversampling32.getDownSamplingLatency();
   }
@@ -895,7 +1810,7 @@ public:
    * @return the number of input samples to the up-sampling call needed before a first output sample is
    * produced by the down-sampling call.
    */
-  uint32_t getLatency()
+  uint32_t getLatency() const
   {
     return oversampling32.getLatency();
   }
@@ -908,7 +1823,7 @@ public:
    * @param linearPhase the order for which to compute the latency
    * @return the latency for the specified order and linear phase
    */
-  uint32_t getUpSamplingLatency(uint32_t order, bool linearPhase)
+  uint32_t getUpSamplingLatency(uint32_t order, bool linearPhase) const
   {
     return oversampling32.getUpSamplingLatency(order, linearPhase);
   }
@@ -921,7 +1836,7 @@ public:
    * @param linearPhase the order for which to compute the latency
    * @return the latency for the specified order and linear phase
    */
-  uint32_t getDownSamplingLatency(uint32_t order, bool linearPhase)
+  uint32_t getDownSamplingLatency(uint32_t order, bool linearPhase) const
   {
     return oversampling32.getDownSamplingLatency(order, linearPhase);
   }
@@ -934,7 +1849,7 @@ public:
    * @param linearPhase the order for which to compute the latency
    * @return the latency for the specified order and linear phase
    */
-  uint32_t getLatency(uint32_t order, bool linearPhase)
+  uint32_t getLatency(uint32_t order, bool linearPhase) const
   {
     return oversampling32.getLatency(order, linearPhase);
   }
@@ -1016,6 +1931,28 @@ public:
     return get<Float>().upSample(input);
   }
 
+  /**
+   * Up-samples the input, avoiding to copy the up-sampled samples to a buffer owned by the object when possible.
+   * @param input pointer to the input buffers
+   * @param numSamples the number of samples in each channel of the input buffer
+   * @see TOversampling::upSampleWithoutCopy
+   */
+  template<class Float>
+  uint32_t upSampleWithoutCopy(Float* const* input, uint32_t numSamples)
+  {
+    return get<Float>().upSampleWithoutCopy(input, numSamples);
+  }
+
+  /**
+   * @return pointers to each channel of the output of the last call to upSampleWithoutCopy, valid until the next
+   * up-sampling or reset call.
+   */
+  template<class Float>
+  Float* const* getUpSampleOutputView() const
+  {
+    return get<Float>().getUpSampleOutputView();
+  }
+
   /**
    * @return an interleaved buffer that holds the output of the up-sampling.
    */
@@ -1120,6 +2057,48 @@ public:
     return get<Float>().getDownSampleOutputInterleaved();
   }
 
+  /**
+   * Up-samples the input, lets the processor work on the up-sampled signal, and down-samples it to the output, one
+   * sub-block at a time, so that the up-sampled signal stays in cache between the three steps.
+   * @see TOversampling::process
+   */
+  template<class Float, class Processor>
+  void process(Float* const* input, Float** output, uint32_t numSamples, Processor&& processor)
+  {
+    get<Float>().process(input, output, numSamples, std::forward<Processor>(processor));
+  }
+
+  /**
+   * Outputs the last getLatency() samples of the processed signal, which are still in the re-samplers, by draining
+   * them.
+   * @see TOversampling::flush
+   */
+  template<class Float, class Processor>
+  uint32_t flush(Float** output, Processor&& processor)
+  {
+    return get<Float>().flush(output, std::forward<Processor>(processor));
+  }
+
+  /**
+   * Outputs the last getLatency() samples of the up-sampled and down-sampled signal, without processing it.
+   * @see TOversampling::flush
+   */
+  template<class Float>
+  uint32_t flush(Float** output)
+  {
+    return get<Float>().flush(output);
+  }
+
+  /**
+   * @return the number of input samples in each sub-block processed by process.
+   * @see TOversampling::getProcessSubBlockSize
+   */
+  template<class Float>
+  uint32_t getProcessSubBlockSize() const
+  {
+    return get<Float>().getProcessSubBlockSize();
+  }
+
 private:
   template<class Float>
   oversimple::TOversampling<Float>& get();
@@ -1155,4 +2134,770 @@ inline oversimple::TOversampling<double> const& Oversampling::get() const
   return oversampling64;
 }
 
+namespace detail {
+struct NoBuffer final
+{};
+
+// the type of a buffer member that is only needed by some configurations of TFixedOversampling
+template<bool isNeeded, class BufferClass>
+using OptionalBuffer = std::conditional_t<isNeeded, BufferClass, NoBuffer>;
+} // namespace detail
+
+/*
+ * A variant of TOversampling whose order of oversampling, phase and buffer types are fixed at compile time. It only
+ * holds the re-samplers and the buffers that its configuration uses, and its processing methods do not branch on the
+ * settings: with minimum phase, the HIIR stages of the order are called directly.
+ * @tparam order the order of oversampling
+ * @tparam phase Phase::minimum to use the IIR re-samplers, Phase::linear to use the FIR ones
+ * @tparam bufferType the buffer type of the signal at the original sample rate: the input of the up-sampling and the
+ * output of the down-sampling
+ * @tparam upSampledBufferType the buffer type of the up-sampled signal: the output of the up-sampling and the input of
+ * the down-sampling
+ * @tparam iirQuality the quality tier of the IIR antialiasing filters, only used with minimum phase
+ * @tparam firEngine the engine of the linear phase re-samplers, only used with linear phase. With
+ * fir::Engine::halfBand, the half-band re-samplers are used instead of the FIR ones, and take the same path as the IIR
+ * ones.
+ * */
+template<class Float,
+         uint32_t order,
+         Phase phase,
+         BufferType bufferType = BufferType::plain,
+         BufferType upSampledBufferType = BufferType::plain,
+         iir::Quality iirQuality = iir::Quality::standard,
+         fir::Engine firEngine = fir::Engine::r8brain>
+class TFixedOversampling final
+{
+  static_assert(order >= 1 && order <= maxOversamplingOrder, "unsupported order of oversampling");
+
+  static constexpr bool isLinearPhase = phase == Phase::linear;
+  static constexpr bool isHalfBand = isLinearPhase && firEngine == fir::Engine::halfBand;
+  // the half-band re-samplers have the interface of the IIR ones, so only the FIR ones take the linear phase path
+  static constexpr bool isFir = isLinearPhase && !isHalfBand;
+  static constexpr bool isPlain = bufferType == BufferType::plain;
+  static constexpr bool isUpSampledPlain = upSampledBufferType == BufferType::plain;
+
+  using UpSampler =
+    std::conditional_t<isFir,
+                       fir::TUpSampler<Float>,
+                       std::conditional_t<isHalfBand,
+                                          fir::HalfBandUpSampler<Float>,
+                                          iir::FixedOrderUpSampler<Float, order, iirQuality>>>;
+  using DownSampler =
+    std::conditional_t<isFir,
+                       fir::TDownSampler<Float>,
+                       std::conditional_t<isHalfBand,
+                                          fir::HalfBandDownSampler<Float>,
+                                          iir::FixedOrderDownSampler<Float, order, iirQuality>>>;
+
+public:
+  /**
+   * Constructor
+   * @param settings the settings to initialize the object with. The order, the maximum order, the phase, the
+   * buffer types, the IIR quality and the FIR engine are overridden by the template arguments.
+   * */
+  explicit TFixedOversampling(OversamplingSettings settings_)
+    : settings{ makeSettings(settings_) }
+    , upSampler{ makeUpSampler(settings) }
+    , downSampler{ makeDownSampler(settings) }
+  {
+    setupInputOutputBuffers();
+    prepareInternalBuffers();
+  }
+
+  /**
+   * @return the current settings of the object
+   */
+  OversamplingSettings const& getSettings() const
+  {
+    return settings;
+  }
+
+  /**
+   * Prepare the up-samplers to work with the supplied number of channels.
+   * @param numChannels the new number of channels to prepare the up-samplers for.
+   */
+  void setNumChannelsToUpSample(uint32_t numChannels)
+  {
+    if (settings.numUpSampledChannels != numChannels) {
+      settings.numUpSampledChannels = numChannels;
+      upSampler.setNumChannels(numChannels);
+      setupInputOutputBuffers();
+      prepareInternalBuffers();
+    }
+  }
+
+  /**
+   * Prepare the down-samplers to work with the supplied number of channels.
+   * @param numChannels the new number of channels to prepare the down-samplers for.
+   */
+  void setNumChannelsToDownSample(uint32_t numChannels)
+  {
+    if (settings.numDownSampledChannels != numChannels) {
+      settings.numDownSampledChannels = numChannels;
+      downSampler.setNumChannels(numChannels);
+      setupInputOutputBuffers();
+      prepareInternalBuffers();
+    }
+  }
+
+  /**
+   * Allocates resources to process up to maxNumInputSamples input.
+   * @param maxNumInputSamples the expected maximum number input samples
+   */
+  void prepareBuffers(uint32_t maxNumInputSamples)
+  {
+    if (settings.maxNumInputSamples != maxNumInputSamples) {
+      settings.maxNumInputSamples = maxNumInputSamples;
+      prepareInternalBuffers();
+    }
+  }
+
+  /**
+   * Sets the executor used by the FIR re-samplers to process the channels in parallel. Only available with linear
+   * phase.
+   * @param executor the executor to use, or nullptr to process the channels serially on the calling thread. It must
+   * outlive its use by the object.
+   */
+  void setFirExecutor(TaskExecutor* executor)
+  {
+    static_assert(isFir, "only the FIR re-samplers use an executor");
+    upSampler.setExecutor(executor);
+    downSampler.setExecutor(executor);
+  }
+
+  /**
+   * Resets the state of the processor, clearing the buffers.
+   */
+  void reset()
+  {
+    upSampler.reset();
+    downSampler.reset();
+  }
+
+  /**
+   * @return the number of input samples to the up-sampling call needed before a first output sample is
+   * produced by the up-sampling call.
+   */
+  uint32_t getUpSamplingLatency() const
+  {
+    return upSamplingLatency;
+  }
+
+  /**
+   * @return the number of input samples to the down-sampling call needed before a first output sample is
+   * produced by the down-sampling call.
+   */
+  uint32_t getDownSamplingLatency() const
+  {
+    return downSamplingLatency;
+  }
+
+  /**
+   * @return the number of input samples to the up-sampling call needed before a first output sample is
+   * produced by the down-sampling call.
+   */
+  uint32_t getLatency() const
+  {
+    return upSamplingLatency + downSamplingLatency / getOversamplingRate();
+  }
+
+  /**
+   * @return the maximum number of samples that can be produced by an up-sampling call, assuming it is never called
+   * with more samples than those passed to prepareBuffers.
+   */
+  uint32_t getMaxNumOutputSamples() const
+  {
+    if constexpr (isFir) {
+      if (settings.numUpSampledChannels > 0) {
+        return upSampler.getMaxNumOutputSamples();
+      }
+    }
+    return settings.maxNumInputSamples * getOversamplingRate();
+  }
+
+  /**
+   * @return the oversampling order.
+   */
+  static constexpr uint32_t getOversamplingOrder()
+  {
+    return order;
+  }
+
+  /**
+   * @return the oversampling rate.
+   */
+  static constexpr uint32_t getOversamplingRate()
+  {
+    return 1 << order;
+  }
+
+  /**
+   * Up-samples the input to a buffer owned by the object. Only available with plain buffers at the original sample
+   * rate.
+   * @param input pointer to the input buffers
+   * @param numSamples the number of samples in each channel of the input buffer
+   * @return the number of up-sampled samples
+   */
+  uint32_t upSample(Float* const* input, uint32_t numSamples)
+  {
+    static_assert(isPlain, "the input of the up-sampling is an InterleavedBuffer");
+    if constexpr (isFir) {
+      auto const numUpSampledSamples = upSampler.processBlock(input, numSamples);
+      if constexpr (!isUpSampledPlain) {
+        interleaveFirOutput(numUpSampledSamples);
+      }
+      return numUpSampledSamples;
+    }
+    else {
+      auto const numUpSampledSamples = numSamples << order;
+      if constexpr (isUpSampledPlain) {
+        assert(upSamplePlainBuffer.getCapacity() >= numUpSampledSamples);
+        upSamplePlainBuffer.setNumSamples(numUpSampledSamples);
+        upSampler.processBlock(input, numSamples, upSamplePlainBuffer.get());
+      }
+      else {
+        upSampler.processBlock(input, numSamples);
+      }
+      return numUpSampledSamples;
+    }
+  }
+
+  /**
+   * Up-samples the input to a buffer owned by the object. Only available with interleaved buffers at the original
+   * sample rate.
+   * @param input pointer to the input buffers
+   * @return the number of up-sampled samples
+   */
+  uint32_t upSample(InterleavedBuffer<Float> const& input)
+  {
+    static_assert(!isPlain, "the input of the up-sampling is a plain buffer");
+    assert(input.getNumChannels() == settings.numUpSampledChannels);
+    if constexpr (isFir) {
+      assert(upSamplePlainBuffer.getCapacity() >= input.getNumSamples());
+      upSamplePlainBuffer.setNumSamples(input.getNumSamples());
+      input.deinterleave(upSamplePlainBuffer);
+      auto const numUpSampledSamples = upSampler.processBlock(upSamplePlainBuffer);
+      if constexpr (!isUpSampledPlain) {
+        interleaveFirOutput(numUpSampledSamples);
+      }
+      return numUpSampledSamples;
+    }
+    else {
+      auto const numUpSampledSamples = input.getNumSamples() << order;
+      if constexpr (isUpSampledPlain) {
+        assert(upSamplePlainBuffer.getCapacity() >= numUpSampledSamples);
+        upSamplePlainBuffer.setNumSamples(numUpSampledSamples);
+        upSampler.processBlock(input, upSamplePlainBuffer.get());
+      }
+      else {
+        upSampler.processBlock(input);
+      }
+      return numUpSampledSamples;
+    }
+  }
+
+  /**
+   * @return the buffer that holds the output of the up-sampling: a Buffer<Float> if the up-sampled buffer type is
+   * plain, an InterleavedBuffer<Float> otherwise.
+   */
+  auto& getUpSampleOutput()
+  {
+    if constexpr (isFir) {
+      if constexpr (isUpSampledPlain) {
+        return upSampler.getOutput();
+      }
+      else {
+        return upSampleOutputInterleaved;
+      }
+    }
+    else {
+      if constexpr (isUpSampledPlain) {
+        return upSamplePlainBuffer;
+      }
+      else {
+        return upSampler.getOutput();
+      }
+    }
+  }
+
+  /**
+   * @return the const buffer that holds the output of the up-sampling: a Buffer<Float> if the up-sampled buffer type
+   * is plain, an InterleavedBuffer<Float> otherwise.
+   */
+  auto const& getUpSampleOutput() const
+  {
+    return const_cast<TFixedOversampling*>(this)->getUpSampleOutput();
+  }
+
+  /**
+   * Down-samples the input. Only available with plain buffers.
+   * @param input pointer to the input buffer.
+   * @param numInputSamples the number of samples of each channel of the input buffer.
+   * @param output pointer to the memory in which to store the down-sampled data.
+   * @param numOutputSamples the number of samples needed as output
+   */
+  void downSample(Float* const* input, uint32_t numInputSamples, Float** output, uint32_t numOutputSamples)
+  {
+    static_assert(isUpSampledPlain, "the input of the down-sampling is an InterleavedBuffer");
+    static_assert(isPlain, "the output of the down-sampling is an InterleavedBuffer");
+    downSamplePlainInput(input, numInputSamples, output, numOutputSamples);
+  }
+
+  /**
+   * Down-samples the input. Only available with interleaved up-sampled buffers and plain buffers at the original
+   * sample rate.
+   * @param input an interleaved buffer holding the input.
+   * @param output pointer to the memory in which to store the down-sampled data.
+   * @param numOutputSamples the number of samples needed as output
+   */
+  void downSample(InterleavedBuffer<Float> const& input, Float** output, uint32_t numOutputSamples)
+  {
+    static_assert(!isUpSampledPlain, "the input of the down-sampling is a plain buffer");
+    static_assert(isPlain, "the output of the down-sampling is an InterleavedBuffer");
+    downSampleInterleavedInput(input, output, numOutputSamples);
+  }
+
+  /**
+   * Down-samples the input to an InterleavedBuffer owned by the object. Only available with plain up-sampled buffers
+   * and interleaved buffers at the original sample rate.
+   * @param input pointer to the input buffer.
+   * @param numInputSamples the number of samples of each channel of the input buffer.
+   * @param numOutputSamples the number of samples needed as output
+   */
+  void downSample(Float* const* input, uint32_t numInputSamples, uint32_t numOutputSamples)
+  {
+    static_assert(isUpSampledPlain, "the input of the down-sampling is an InterleavedBuffer");
+    static_assert(!isPlain, "the output of the down-sampling is a plain buffer");
+    downSamplePlainInput(input, numInputSamples, nullptr, numOutputSamples);
+  }
+
+  /**
+   * Down-samples the input to an InterleavedBuffer owned by the object. Only available with interleaved buffers.
+   * @param input an interleaved buffer holding the input.
+   * @param numOutputSamples the number of samples needed as output
+   */
+  void downSample(InterleavedBuffer<Float> const& input, uint32_t numOutputSamples)
+  {
+    static_assert(!isUpSampledPlain, "the input of the down-sampling is a plain buffer");
+    static_assert(!isPlain, "the output of the down-sampling is a plain buffer");
+    downSampleInterleavedInput(input, nullptr, numOutputSamples);
+  }
+
+  /**
+   * @return an interleaved buffer that holds the output of the down-sampling. Only available with interleaved buffers
+   * at the original sample rate.
+   */
+  InterleavedBuffer<Float>& getDownSampleOutputInterleaved()
+  {
+    static_assert(!isPlain, "the output of the down-sampling is written to plain buffers");
+    if constexpr (isFir) {
+      return downSampleBufferInterleaved;
+    }
+    else {
+      return downSampler.getOutput();
+    }
+  }
+
+  /**
+   * @return a const interleaved buffer that holds the output of the down-sampling. Only available with interleaved
+   * buffers at the original sample rate.
+   */
+  InterleavedBuffer<Float> const& getDownSampleOutputInterleaved() const
+  {
+    return const_cast<TFixedOversampling*>(this)->getDownSampleOutputInterleaved();
+  }
+
+  /**
+   * Up-samples the input, lets the processor work on the up-sampled signal, and down-samples it to the output, one
+   * sub-block at a time, so that the up-sampled signal stays in cache between the three steps. Only available with
+   * plain buffers at the original sample rate. The processor works on the first numDownSampledChannels channels of
+   * the up-sampled signal in place.
+   * @param input pointer to the input buffers
+   * @param output pointer to the output buffers
+   * @param numSamples the number of samples in each channel of the input and output buffers, which can be more than
+   * the maximum number of input samples the object is prepared for.
+   * @param processor a callable taking the buffer returned by getUpSampleOutput, holding the up-sampled signal of a
+   * sub-block, and the number of up-sampled samples as an uint32_t.
+   * @see TOversampling::process
+   */
+  template<class Processor>
+  void process(Float* const* input, Float** output, uint32_t numSamples, Processor&& processor)
+  {
+    static_assert(isPlain, "process works with plain input and output buffers");
+    assert(settings.numDownSampledChannels <= settings.numUpSampledChannels);
+    auto const subBlockSize = getProcessSubBlockSize();
+    for (uint32_t offset = 0; offset < numSamples; offset += subBlockSize) {
+      auto const numSubBlockSamples = std::min(subBlockSize, numSamples - offset);
+      for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+        processInput[c] = input[c] + offset;
+      }
+      for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+        processOutput[c] = output[c] + offset;
+      }
+      auto const numUpSampledSamples = upSample(processInput.data(), numSubBlockSamples);
+      auto& upSampled = getUpSampleOutput();
+      processor(upSampled, numUpSampledSamples);
+      if constexpr (isUpSampledPlain) {
+        downSample(upSampled.get(), numUpSampledSamples, processOutput.data(), numSubBlockSamples);
+      }
+      else {
+        downSample(upSampled, processOutput.data(), numSubBlockSamples);
+      }
+    }
+  }
+
+  /**
+   * @return the number of input samples in each sub-block processed by process.
+   * @see TOversampling::getProcessSubBlockSize
+   */
+  uint32_t getProcessSubBlockSize() const
+  {
+    auto const maxSubBlockSize = std::max(settings.maxNumInputSamples, 1u);
+    if (settings.processSubBlockSize > 0) {
+      return std::min(settings.processSubBlockSize, maxSubBlockSize);
+    }
+    if constexpr (isFir) {
+      return maxSubBlockSize;
+    }
+    auto const numChannels = std::max(settings.numUpSampledChannels, 1u);
+    auto const upSampledBytesPerInputSample = (uint32_t)sizeof(Float) * numChannels * getOversamplingRate();
+    auto const subBlockSize = std::max(processSubBlockBytes / upSampledBytesPerInputSample, 1u);
+    return std::min(subBlockSize, maxSubBlockSize);
+  }
+
+private:
+  static constexpr uint32_t processSubBlockBytes = 32768;
+
+  static OversamplingSettings makeSettings(OversamplingSettings settings)
+  {
+    settings.order = order;
+    settings.maxOrder = order;
+    settings.isUsingLinearPhase = isLinearPhase;
+    settings.upSampleInputBufferType = bufferType;
+    settings.downSampleOutputBufferType = bufferType;
+    settings.upSampleOutputBufferType = upSampledBufferType;
+    settings.downSampleInputBufferType = upSampledBufferType;
+    settings.iirQuality = iirQuality;
+    settings.firEngine = firEngine;
+    return settings;
+  }
+
+  static UpSampler makeUpSampler(OversamplingSettings const& settings)
+  {
+    if constexpr (isFir) {
+      return UpSampler{ settings.numUpSampledChannels,
+                        settings.firTransitionBand,
+                        settings.fftBlockSize,
+                        (double)getOversamplingRate(),
+                        settings.firEngine };
+    }
+    else if constexpr (isHalfBand) {
+      auto upSampler = UpSampler{ settings.numUpSampledChannels, order };
+      upSampler.setOrder(order);
+      return upSampler;
+    }
+    else {
+      return UpSampler{ settings.numUpSampledChannels };
+    }
+  }
+
+  static DownSampler makeDownSampler(OversamplingSettings const& settings)
+  {
+    if constexpr (isFir) {
+      return DownSampler{ settings.numDownSampledChannels,
+                          settings.firTransitionBand,
+                          settings.fftBlockSize,
+                          (double)getOversamplingRate(),
+                          settings.firEngine };
+    }
+    else if constexpr (isHalfBand) {
+      auto downSampler = DownSampler{ settings.numDownSampledChannels, order };
+      downSampler.setOrder(order);
+      return downSampler;
+    }
+    else {
+      return DownSampler{ settings.numDownSampledChannels };
+    }
+  }
+
+  // the output pointers are only used if the buffer type at the original sample rate is plain
+  void downSamplePlainInput(Float* const* input, uint32_t numInputSamples, Float** output, uint32_t numOutputSamples)
+  {
+    if constexpr (isFir) {
+      downSampleFir(input, numInputSamples, output, numOutputSamples);
+    }
+    else {
+      assert(numOutputSamples * getOversamplingRate() == numInputSamples);
+      downSampler.processBlock(input, numInputSamples);
+      deinterleaveIirOutput(output, numOutputSamples);
+    }
+  }
+
+  void downSampleInterleavedInput(InterleavedBuffer<Float> const& input, Float** output, uint32_t numOutputSamples)
+  {
+    assert(input.getNumChannels() == settings.numDownSampledChannels);
+    if constexpr (isFir) {
+      auto const numInputSamples = input.getNumSamples();
+      assert(downSamplePlainInputBuffer.getCapacity() >= numInputSamples);
+      downSamplePlainInputBuffer.setNumSamples(numInputSamples);
+      input.deinterleave(downSamplePlainInputBuffer);
+      downSampleFir(downSamplePlainInputBuffer.get(), numInputSamples, output, numOutputSamples);
+    }
+    else {
+      assert(numOutputSamples * getOversamplingRate() == input.getNumSamples());
+      downSampler.processBlock(input);
+      deinterleaveIirOutput(output, numOutputSamples);
+    }
+  }
+
+  void interleaveFirOutput(uint32_t numUpSampledSamples)
+  {
+    assert(upSampler.getOutput().getNumSamples() == numUpSampledSamples);
+    assert(upSampleOutputInterleaved.getCapacity() >= numUpSampledSamples);
+    upSampleOutputInterleaved.setNumSamples(numUpSampledSamples);
+    bool const ok = upSampleOutputInterleaved.interleave(upSampler.getOutput());
+    assert(ok);
+  }
+
+  void downSampleFir(Float* const* input, uint32_t numInputSamples, Float** output, uint32_t numOutputSamples)
+  {
+    if constexpr (isPlain) {
+      downSampler.processBlock(input, numInputSamples, output, numOutputSamples);
+    }
+    else {
+      assert(downSamplePlainOutputBuffer.getCapacity() >= numOutputSamples);
+      assert(downSampleBufferInterleaved.getCapacity() >= numOutputSamples);
+      downSamplePlainOutputBuffer.setNumSamples(numOutputSamples);
+      downSampler.processBlock(input, numInputSamples, downSamplePlainOutputBuffer.get(), numOutputSamples);
+      downSampleBufferInterleaved.setNumSamples(numOutputSamples);
+      bool const ok = downSampleBufferInterleaved.interleave(downSamplePlainOutputBuffer);
+      assert(ok);
+    }
+  }
+
+  void deinterleaveIirOutput(Float** output, uint32_t numOutputSamples)
+  {
+    if constexpr (isPlain) {
+      downSampler.getOutput().deinterleave(output, settings.numDownSampledChannels, numOutputSamples);
+    }
+  }
+
+  void prepareInternalBuffers()
+  {
+    auto const maxSamplesUpSampled = settings.maxNumInputSamples * getOversamplingRate();
+    if constexpr (isFir) {
+      upSampler.prepareBuffers(settings.maxNumInputSamples);
+      auto const maxFirUpSampledSamples = upSampler.getMaxNumOutputSamples();
+      downSampler.prepareBuffers(maxFirUpSampledSamples, settings.maxNumInputSamples);
+      auto const maxSamples = std::max(maxFirUpSampledSamples, maxSamplesUpSampled);
+      if constexpr (!isPlain) {
+        upSamplePlainBuffer.reserve(settings.maxNumInputSamples);
+        downSamplePlainOutputBuffer.reserve(settings.maxNumInputSamples);
+        downSampleBufferInterleaved.reserve(settings.maxNumInputSamples);
+      }
+      if constexpr (!isUpSampledPlain) {
+        upSampleOutputInterleaved.reserve(maxSamples);
+        downSamplePlainInputBuffer.reserve(maxSamples);
+      }
+    }
+    else {
+      upSampler.prepareBuffers(settings.maxNumInputSamples);
+      downSampler.prepareBuffers(settings.maxNumInputSamples);
+      if constexpr (isUpSampledPlain) {
+        upSamplePlainBuffer.reserve(maxSamplesUpSampled);
+      }
+    }
+    updateLatencies();
+  }
+
+  void updateLatencies()
+  {
+    if constexpr (isFir) {
+      upSamplingLatency = settings.numUpSampledChannels > 0 ? upSampler.getNumSamplesBeforeOutputStarts() : 0;
+      downSamplingLatency = settings.numDownSampledChannels > 0 ? downSampler.getNumSamplesBeforeOutputStarts() : 0;
+    }
+    else if constexpr (isHalfBand) {
+      upSamplingLatency = settings.numUpSampledChannels > 0 ? upSampler.getLatency() : 0;
+      downSamplingLatency = settings.numDownSampledChannels > 0 ? downSampler.getLatency() << order : 0;
+    }
+  }
+
+  void setupInputOutputBuffers()
+  {
+    processInput.assign(settings.numUpSampledChannels, nullptr);
+    processOutput.assign(settings.numDownSampledChannels, nullptr);
+    if constexpr (isUsingUpSamplePlainBuffer) {
+      upSamplePlainBuffer.setNumChannels(settings.numUpSampledChannels);
+    }
+    if constexpr (isFir && !isUpSampledPlain) {
+      upSampleOutputInterleaved.setNumChannels(settings.numUpSampledChannels);
+      downSamplePlainInputBuffer.setNumChannels(settings.numDownSampledChannels);
+    }
+    if constexpr (isFir && !isPlain) {
+      downSamplePlainOutputBuffer.setNumChannels(settings.numDownSampledChannels);
+      downSampleBufferInterleaved.setNumChannels(settings.numDownSampledChannels);
+    }
+  }
+
+  // with the FIR re-samplers, it holds the deinterleaved input; with the IIR and the half-band ones, the up-sampled
+  // signal
+  static constexpr bool isUsingUpSamplePlainBuffer = isFir ? !isPlain : isUpSampledPlain;
+
+  OversamplingSettings settings;
+  UpSampler upSampler;
+  DownSampler downSampler;
+  // the latencies of the linear phase re-samplers, updated when the channels or the buffers change, zero with minimum
+  // phase
+  uint32_t upSamplingLatency = 0;
+  uint32_t downSamplingLatency = 0;
+
+  detail::OptionalBuffer<isUsingUpSamplePlainBuffer, Buffer<Float>> upSamplePlainBuffer;
+  detail::OptionalBuffer<isFir && !isUpSampledPlain, InterleavedBuffer<Float>> upSampleOutputInterleaved;
+  detail::OptionalBuffer<isFir && !isUpSampledPlain, Buffer<Float>> downSamplePlainInputBuffer;
+  detail::OptionalBuffer<isFir && !isPlain, Buffer<Float>> downSamplePlainOutputBuffer;
+  detail::OptionalBuffer<isFir && !isPlain, InterleavedBuffer<Float>> downSampleBufferInterleaved;
+  std::vector<Float*> processInput;
+  std::vector<Float*> processOutput;
+};
+
+/**
+ * Holds the oversampling object used by the audio thread, and lets another thread replace it with a new one built
+ * with different settings, so that settings that require allocations can be changed without locks or allocations on
+ * the audio thread.
+ * The new object is built by the calling thread and handed to the audio thread with an atomic pointer exchange. The
+ * audio thread switches to it at the beginning of a block, and the object it replaced is destroyed by the other
+ * thread with collectGarbage, or by the next replacement request.
+ * The switch is immediate, without a crossfade: the new object starts from a cleared state, so its output fades in
+ * over its latency, and if the latency changes the output jumps by the difference. A crossfade would need both
+ * objects, and the processor, to run on the same blocks, so it is left to the caller, which can mute or ramp the
+ * output around the switch if the jump is audible.
+ * @tparam OversamplingClass either TOversampling<float>, TOversampling<double> or Oversampling
+ */
+template<class OversamplingClass>
+class TDoubleBufferedOversampling final
+{
+public:
+  /**
+   * Constructor
+   * @param settings the settings to initialize the oversampling object with.
+   * @param firExecutor the executor used by the FIR re-samplers of the oversampling object, and of the ones built by
+   * requestSettings, or nullptr to process the channels serially. It must outlive its use by the objects.
+   * @param instrumentation the Instrumentation of the oversampling object, and of the ones built by requestSettings,
+   * or nullptr to not collect anything. It must outlive its use by the objects.
+   */
+  explicit TDoubleBufferedOversampling(OversamplingSettings const& settings,
+                                       TaskExecutor* firExecutor = nullptr,
+                                       Instrumentation* instrumentation = nullptr)
+    : current{ new OversamplingClass(settings) }
+    , settings{ settings }
+    , firExecutor{ firExecutor }
+    , instrumentation{ instrumentation }
+  {
+    current->setFirExecutor(firExecutor);
+    current->setInstrumentation(instrumentation);
+  }
+
+  ~TDoubleBufferedOversampling()
+  {
+    delete pending.exchange(nullptr, std::memory_order_acquire);
+    delete retired.exchange(nullptr, std::memory_order_acquire);
+    delete current;
+  }
+
+  TDoubleBufferedOversampling(TDoubleBufferedOversampling const&) = delete;
+  TDoubleBufferedOversampling& operator=(TDoubleBufferedOversampling const&) = delete;
+
+  /**
+   * Builds a new oversampling object with the supplied settings, and schedules it to replace the current one. The new
+   * object uses the same FIR executor and Instrumentation as the last requested one. It allocates, so it must not be
+   * called from the audio thread, nor concurrently with itself or with collectGarbage.
+   * @param newSettings the settings for the new oversampling object
+   */
+  void requestSettings(OversamplingSettings const& newSettings)
+  {
+    auto replacement = std::make_unique<OversamplingClass>(newSettings);
+    replacement->setFirExecutor(firExecutor);
+    replacement->setInstrumentation(instrumentation);
+    requestReplacement(std::move(replacement));
+  }
+
+  /**
+   * Schedules the supplied oversampling object to replace the current one. It must not be called from the audio
+   * thread, nor concurrently with itself or with collectGarbage. If a previous replacement has not been picked up by
+   * the audio thread yet, it is discarded.
+   * @param replacement the new oversampling object, already set up. Its FIR executor and Instrumentation are the ones
+   * that the next calls to requestSettings carry over.
+   */
+  void requestReplacement(std::unique_ptr<OversamplingClass> replacement)
+  {
+    assert(replacement);
+    collectGarbage();
+    settings = replacement->getSettings();
+    firExecutor = replacement->getFirExecutor();
+    instrumentation = replacement->getInstrumentation();
+    delete pending.exchange(replacement.release(), std::memory_order_acq_rel);
+  }
+
+  /**
+   * Destroys the oversampling object replaced by the audio thread, if any. It must not be called from the audio
+   * thread. The audio thread does not switch to a new object until the one it replaced has been collected.
+   */
+  void collectGarbage()
+  {
+    delete retired.exchange(nullptr, std::memory_order_acquire);
+  }
+
+  /**
+   * @return true if there is a replacement that has not been picked up by the audio thread yet.
+   */
+  bool isReplacementPending() const
+  {
+    return pending.load(std::memory_order_acquire) != nullptr;
+  }
+
+  /**
+   * @return the settings of the last oversampling object that was requested. It must not be called from the audio
+   * thread.
+   */
+  OversamplingSettings const& getSettings() const
+  {
+    return settings;
+  }
+
+  /**
+   * To be called by the audio thread at the beginning of each block: if a replacement is pending and the previously
+   * replaced object has been collected, it becomes the current oversampling object. It does not lock nor allocate.
+   * @return the oversampling object to use for the block.
+   */
+  OversamplingClass& beginBlock()
+  {
+    if (retired.load(std::memory_order_acquire) == nullptr) {
+      if (auto const replacement = pending.exchange(nullptr, std::memory_order_acq_rel)) {
+        retired.store(current, std::memory_order_release);
+        current = replacement;
+      }
+    }
+    return *current;
+  }
+
+  /**
+   * @return the oversampling object currently used by the audio thread. It must only be called from the audio thread.
+   */
+  OversamplingClass& get()
+  {
+    return *current;
+  }
+
+private:
+  OversamplingClass* current;
+  std::atomic<OversamplingClass*> pending{ nullptr };
+  std::atomic<OversamplingClass*> retired{ nullptr };
+  // the settings, the executor and the Instrumentation of the last requested object, only used by the other thread
+  OversamplingSettings settings;
+  TaskExecutor* firExecutor = nullptr;
+  Instrumentation* instrumentation = nullptr;
+};
+
+using DoubleBufferedOversampling = TDoubleBufferedOversampling<Oversampling>;
+
 } // namespace oversimple
@@ -0,0 +1,202 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace oversimple {
+
+/**
+ * Interface used by the re-samplers to process independent channels in parallel. Implement it to use the job system
+ * of the host, or use WorkerPool.
+ */
+class TaskExecutor
+{
+public:
+  /**
+   * A task, called with the context supplied to run and with the index of the task.
+   */
+  using Task = void (*)(void* context, uint32_t taskIndex);
+
+  /**
+   * Executes task(context, i) for each i in [0, numTasks), possibly concurrently and from other threads, and returns
+   * only when all of them have been completed. It is called from the audio thread, so it should not lock or allocate.
+   * An executor shared by several re-samplers can be called concurrently from different threads, and from within one
+   * of its own tasks, so it must support both.
+   * @param numTasks the number of tasks to execute
+   * @param task the function to call for each task
+   * @param context the pointer to pass to each call
+   */
+  virtual void run(uint32_t numTasks, Task task, void* context) = 0;
+
+  virtual ~TaskExecutor() = default;
+};
+
+/**
+ * A TaskExecutor that uses a fixed set of worker threads. The thread calling run takes part in the execution of the
+ * tasks, and never waits on a lock: tasks are claimed with atomic operations, so if the workers are sleeping, the
+ * calling thread just executes more tasks by itself. Idle workers yield for a while, then sleep for short periods.
+ * The workers run one job at a time: a call to run made while another one is in progress, from another thread or from
+ * within a task, executes its tasks serially on its calling thread.
+ * The calling thread waits, yielding, for the tasks claimed by the workers to complete, so if the operating system
+ * preempts a worker in the middle of a task, run takes as long as the preemption: the time it takes is not bounded.
+ * Give the workers a real-time priority to make that unlikely.
+ */
+class WorkerPool final : public TaskExecutor
+{
+public:
+  /**
+   * Constructor.
+   * @param numWorkers the number of worker threads to start, besides the thread calling run.
+   * @param numSpinsBeforeSleeping the number of times an idle worker yields before starting to sleep.
+   * @param sleepTime how long an idle worker sleeps before checking for new tasks.
+   */
+  explicit WorkerPool(uint32_t numWorkers,
+                      uint32_t numSpinsBeforeSleeping = 4096,
+                      std::chrono::microseconds sleepTime = std::chrono::microseconds(100))
+    : numSpinsBeforeSleeping{ numSpinsBeforeSleeping }
+    , sleepTime{ sleepTime }
+  {
+    workers.reserve(numWorkers);
+    for (uint32_t i = 0; i < numWorkers; ++i) {
+      workers.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ~WorkerPool() override
+  {
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  WorkerPool(WorkerPool const&) = delete;
+  WorkerPool& operator=(WorkerPool const&) = delete;
+
+  /**
+   * @return the number of worker threads.
+   */
+  uint32_t getNumWorkers() const
+  {
+    return static_cast<uint32_t>(workers.size());
+  }
+
+  void run(uint32_t numTasks, Task task_, void* context_) override
+  {
+    assert(numTasks <= maxNumTasks);
+    if (numTasks == 0) {
+      return;
+    }
+    if (workers.empty() || numTasks == 1 || isBusy.exchange(true, std::memory_order_acquire)) {
+      for (uint32_t i = 0; i < numTasks; ++i) {
+        task_(context_, i);
+      }
+      return;
+    }
+    task = task_;
+    context = context_;
+    numCompletedTasks.store(0, std::memory_order_relaxed);
+    generation = (generation + 1) & 0xffff;
+    state.store(packState(generation, numTasks, 0), std::memory_order_release);
+    executeTasks(generation);
+    while (numCompletedTasks.load(std::memory_order_acquire) < numTasks) {
+      std::this_thread::yield();
+    }
+    isBusy.store(false, std::memory_order_release);
+  }
+
+private:
+  // the state packs the generation of the current job in the upper 16 bits, the number of tasks in the next 16 bits,
+  // and the index of the next task to claim in the lower 32 bits, so that a claim is valid only for its own job.
+  static constexpr uint32_t maxNumTasks = 0xffff;
+
+  static uint64_t packState(uint64_t generation, uint64_t numTasks, uint64_t nextTask)
+  {
+    return (generation << 48) | (numTasks << 32) | nextTask;
+  }
+
+  static uint32_t getGeneration(uint64_t state)
+  {
+    return static_cast<uint32_t>(state >> 48);
+  }
+
+  static uint32_t getNumTasks(uint64_t state)
+  {
+    return static_cast<uint32_t>((state >> 32) & 0xffff);
+  }
+
+  static uint32_t getNextTask(uint64_t state)
+  {
+    return static_cast<uint32_t>(state & 0xffffffff);
+  }
+
+  void executeTasks(uint32_t jobGeneration)
+  {
+    auto current = state.load(std::memory_order_acquire);
+    for (;;) {
+      if (getGeneration(current) != jobGeneration || getNextTask(current) >= getNumTasks(current)) {
+        return;
+      }
+      if (state.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        task(context, getNextTask(current));
+        numCompletedTasks.fetch_add(1, std::memory_order_release);
+        current = state.load(std::memory_order_acquire);
+      }
+    }
+  }
+
+  void workerLoop()
+  {
+    uint32_t lastGeneration = 0;
+    uint32_t numIdleSpins = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto const jobGeneration = getGeneration(state.load(std::memory_order_acquire));
+      if (jobGeneration != lastGeneration) {
+        lastGeneration = jobGeneration;
+        executeTasks(jobGeneration);
+        numIdleSpins = 0;
+      }
+      else if (numIdleSpins < numSpinsBeforeSleeping) {
+        ++numIdleSpins;
+        std::this_thread::yield();
+      }
+      else {
+        std::this_thread::sleep_for(sleepTime);
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::atomic<uint64_t> state{ 0 };
+  std::atomic<uint32_t> numCompletedTasks{ 0 };
+  std::atomic<bool> stop{ false };
+  // set while a job is in progress, so that the job of another call does not overwrite it
+  std::atomic<bool> isBusy{ false };
+  uint32_t generation = 0;
+  Task task = nullptr;
+  void* context = nullptr;
+  uint32_t const numSpinsBeforeSleeping;
+  std::chrono::microseconds const sleepTime;
+};
+
+} // namespace oversimple
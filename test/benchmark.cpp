@@ -0,0 +1,342 @@
+/*
+Copyright 2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * Measures the throughput of TOversampling::upSample and TOversampling::downSample, sweeping the oversampling order,
+ * the number of channels, the block size, the precision, IIR and FIR re-sampling, the quality tier of the IIR filters,
+ * the engine of the linear phase re-samplers, and plain and interleaved buffers.
+ * The results are printed to the standard output as JSON, the progress to the standard error.
+ * Usage: oversimple-bench [--quick] [--min-time seconds]
+ * Each result reports the time and the cycles spent for each sample of each channel at the original sample rate, and
+ * the time spent by the slowest call, which shows how evenly the work is spread across the calls.
+ * The cycles are read from the time stamp counter, so they are only available on x86, and are reference cycles.
+ * The IIR and half-band results also report the fraction of the SIMD lanes of the antialiasing filters that hold a
+ * channel.
+ * */
+
+#include "oversimple/CpuFeatures.hpp"
+#include "oversimple/IirDispatch.hpp"
+#include "oversimple/Oversampling.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define OVERSIMPLE_BENCH_HAS_CYCLE_COUNTER 1
+#else
+#define OVERSIMPLE_BENCH_HAS_CYCLE_COUNTER 0
+#endif
+
+using namespace oversimple;
+using namespace std;
+
+namespace {
+
+uint64_t readCycleCounter()
+{
+#if OVERSIMPLE_BENCH_HAS_CYCLE_COUNTER
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct BenchmarkConfig final
+{
+  uint32_t order;
+  uint32_t numChannels;
+  uint32_t blockSize;
+  bool linearPhase;
+  BufferType bufferType;
+  iir::Quality iirQuality;
+  fir::Engine firEngine;
+};
+
+struct Measure final
+{
+  double seconds = 0.0;
+  double maxSeconds = 0.0;
+  uint64_t cycles = 0;
+
+  template<class Function>
+  void operator()(Function&& function)
+  {
+    auto const startTime = chrono::steady_clock::now();
+    auto const startCycles = readCycleCounter();
+    function();
+    cycles += readCycleCounter() - startCycles;
+    auto const callSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    seconds += callSeconds;
+    maxSeconds = std::max(maxSeconds, callSeconds);
+  }
+};
+
+struct Result final
+{
+  std::string operation;
+  std::string precision;
+  BenchmarkConfig config;
+  uint64_t iterations;
+  Measure measure;
+  double laneUtilization;
+};
+
+template<class ProcessBlock>
+void measureBlocks(BenchmarkConfig const& config,
+                   double minTime,
+                   Measure& upSampleMeasure,
+                   Measure& downSampleMeasure,
+                   uint64_t& iterations,
+                   ProcessBlock&& processBlock)
+{
+  // warm up caches and filter states, then time until both operations have run for at least minTime seconds
+  auto const numWarmUpBlocks = std::max(4u, 4096u / config.blockSize);
+  for (uint32_t i = 0; i < numWarmUpBlocks; ++i) {
+    processBlock();
+  }
+  upSampleMeasure = Measure{};
+  downSampleMeasure = Measure{};
+  iterations = 0;
+  auto const startTime = chrono::steady_clock::now();
+  while (iterations < 8 || chrono::duration<double>(chrono::steady_clock::now() - startTime).count() < minTime) {
+    processBlock();
+    ++iterations;
+  }
+}
+
+template<typename Float>
+std::vector<Result> runBenchmark(BenchmarkConfig const& config, double minTime)
+{
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = config.order;
+  settings.order = config.order;
+  settings.numUpSampledChannels = config.numChannels;
+  settings.numDownSampledChannels = config.numChannels;
+  settings.maxNumInputSamples = config.blockSize;
+  settings.isUsingLinearPhase = config.linearPhase;
+  settings.iirQuality = config.iirQuality;
+  settings.firEngine = config.firEngine;
+  if (config.firEngine == fir::Engine::uniformPartitioned) {
+    // the partitions match the blocks, so that each call does the same work
+    settings.fftBlockSize = config.blockSize;
+  }
+  settings.upSampleInputBufferType = config.bufferType;
+  settings.upSampleOutputBufferType = config.bufferType;
+  settings.downSampleInputBufferType = config.bufferType;
+  settings.downSampleOutputBufferType = config.bufferType;
+  auto oversampling = TOversampling<Float>{ settings };
+
+  auto input = Buffer<Float>(config.numChannels, config.blockSize);
+  for (uint32_t c = 0; c < config.numChannels; ++c) {
+    for (uint32_t i = 0; i < config.blockSize; ++i) {
+      input[c][i] = (Float)sin(2.0 * M_PI * 0.0123 * (double)(i + c));
+    }
+  }
+  auto inputInterleaved = InterleavedBuffer<Float>(config.numChannels, config.blockSize);
+  inputInterleaved.interleave(input);
+  auto output = Buffer<Float>(config.numChannels, config.blockSize);
+  auto inputPointers = std::vector<Float*>(input.get(), input.get() + config.numChannels);
+  auto outputPointers = std::vector<Float*>(output.get(), output.get() + config.numChannels);
+
+  auto upSampleMeasure = Measure{};
+  auto downSampleMeasure = Measure{};
+  uint64_t iterations = 0;
+  measureBlocks(config, minTime, upSampleMeasure, downSampleMeasure, iterations, [&] {
+    if (config.bufferType == BufferType::plain) {
+      uint32_t numUpSampledSamples = 0;
+      upSampleMeasure([&] { numUpSampledSamples = oversampling.upSample(inputPointers.data(), config.blockSize); });
+      auto const& upSampled = oversampling.getUpSampleOutput();
+      downSampleMeasure([&] {
+        oversampling.downSample(upSampled.get(), numUpSampledSamples, outputPointers.data(), config.blockSize);
+      });
+    }
+    else {
+      upSampleMeasure([&] { oversampling.upSample(inputInterleaved); });
+      auto const& upSampled = oversampling.getUpSampleOutputInterleaved();
+      downSampleMeasure([&] { oversampling.downSample(upSampled, config.blockSize); });
+    }
+  });
+
+  auto const precision = std::string(std::is_same_v<Float, float> ? "float" : "double");
+  auto const upSampleLaneUtilization = oversampling.getIirUpSamplerChannelLayout().getLaneUtilization();
+  auto const downSampleLaneUtilization = oversampling.getIirDownSamplerChannelLayout().getLaneUtilization();
+  return { Result{ "upSample", precision, config, iterations, upSampleMeasure, upSampleLaneUtilization },
+           Result{ "downSample", precision, config, iterations, downSampleMeasure, downSampleLaneUtilization } };
+}
+
+char const* getEngineName(fir::Engine engine)
+{
+  switch (engine) {
+    case fir::Engine::uniformPartitioned:
+      return "uniformPartitioned";
+    case fir::Engine::halfBand:
+      return "halfBand";
+    case fir::Engine::r8brain:
+    default:
+      return "r8brain";
+  }
+}
+
+char const* getQualityName(iir::Quality quality)
+{
+  switch (quality) {
+    case iir::Quality::low:
+      return "low";
+    case iir::Quality::high:
+      return "high";
+    case iir::Quality::standard:
+    default:
+      return "standard";
+  }
+}
+
+std::string toJson(Result const& result)
+{
+  auto const& config = result.config;
+  auto const filter = config.linearPhase ? "fir" : "iir";
+  auto const bufferType = config.bufferType == BufferType::plain ? "plain" : "interleaved";
+  auto const numSamples = (double)result.iterations * (double)config.blockSize * (double)config.numChannels;
+  std::ostringstream name;
+  name << result.operation << "/" << filter;
+  if (config.linearPhase) {
+    name << "/engine:" << getEngineName(config.firEngine);
+  }
+  else {
+    name << "/quality:" << getQualityName(config.iirQuality);
+  }
+  name << "/" << result.precision << "/" << bufferType << "/order:" << config.order
+       << "/channels:" << config.numChannels << "/block:" << config.blockSize;
+  std::ostringstream json;
+  json << "{ \"name\": \"" << name.str() << "\", \"operation\": \"" << result.operation << "\", \"filter\": \""
+       << filter << "\", \"precision\": \"" << result.precision << "\", \"buffer_type\": \"" << bufferType
+       << "\", \"order\": " << config.order << ", \"channels\": " << config.numChannels
+       << ", \"block_size\": " << config.blockSize << ", \"iterations\": " << result.iterations
+       << ", \"ns_per_sample\": " << 1.0e9 * result.measure.seconds / numSamples
+       << ", \"max_ns_per_call\": " << 1.0e9 * result.measure.maxSeconds << ", \"cycles_per_sample\": ";
+  if (OVERSIMPLE_BENCH_HAS_CYCLE_COUNTER) {
+    json << (double)result.measure.cycles / numSamples;
+  }
+  else {
+    json << "null";
+  }
+  if (config.linearPhase) {
+    json << ", \"engine\": \"" << getEngineName(config.firEngine) << "\"";
+    if (config.firEngine == fir::Engine::halfBand) {
+      json << ", \"lane_utilization\": " << result.laneUtilization;
+    }
+  }
+  else {
+    json << ", \"quality\": \"" << getQualityName(config.iirQuality) << "\"";
+    json << ", \"lane_utilization\": " << result.laneUtilization;
+  }
+  json << " }";
+  return json.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  bool quick = false;
+  double minTime = 0.05;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--quick") == 0) {
+      quick = true;
+    }
+    else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      minTime = std::atof(argv[++i]);
+    }
+    else {
+      cerr << "usage: " << argv[0] << " [--quick] [--min-time seconds]\n";
+      return 1;
+    }
+  }
+
+  auto const orders = quick ? std::vector<uint32_t>{ 1, 3, 5 } : std::vector<uint32_t>{ 1, 2, 3, 4, 5 };
+  auto const channelCounts = quick ? std::vector<uint32_t>{ 2, 8 } : std::vector<uint32_t>{ 1, 2, 3, 6, 8, 32 };
+  auto const blockSizes =
+    quick ? std::vector<uint32_t>{ 64, 1024 } : std::vector<uint32_t>{ 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+
+  // the quality tiers only apply to the IIR filters, and the engines only to the FIR ones
+  auto const iirQualities = std::vector<iir::Quality>{ iir::Quality::low, iir::Quality::standard, iir::Quality::high };
+  auto const firEngines =
+    std::vector<fir::Engine>{ fir::Engine::r8brain, fir::Engine::uniformPartitioned, fir::Engine::halfBand };
+  struct FilterConfig final
+  {
+    bool linearPhase;
+    iir::Quality iirQuality;
+    fir::Engine firEngine;
+  };
+  std::vector<FilterConfig> filterConfigs;
+  for (auto iirQuality : iirQualities) {
+    filterConfigs.push_back({ false, iirQuality, fir::Engine::r8brain });
+  }
+  for (auto firEngine : firEngines) {
+    filterConfigs.push_back({ true, iir::Quality::standard, firEngine });
+  }
+
+  std::vector<Result> results;
+  for (auto const& filter : filterConfigs) {
+    for (auto bufferType : { BufferType::plain, BufferType::interleaved }) {
+      for (auto order : orders) {
+        for (auto numChannels : channelCounts) {
+          for (auto blockSize : blockSizes) {
+            auto const config = BenchmarkConfig{ order,
+                                                 numChannels,
+                                                 blockSize,
+                                                 filter.linearPhase,
+                                                 bufferType,
+                                                 filter.iirQuality,
+                                                 filter.firEngine };
+            for (auto&& result : runBenchmark<float>(config, minTime)) {
+              results.push_back(result);
+            }
+            for (auto&& result : runBenchmark<double>(config, minTime)) {
+              results.push_back(result);
+            }
+            cerr << "\r" << results.size() << " benchmarks completed" << std::flush;
+          }
+        }
+      }
+    }
+  }
+  cerr << "\n";
+
+  cout << "{\n";
+  cout << "  \"context\": { \"simd\": \"" << getInstructionSetName(getCompiledInstructionSet())
+       << "\", \"cpu_simd\": \"" << getInstructionSetName(detectInstructionSet())
+       << "\", \"dispatched_simd\": \"" << getInstructionSetName(iir::getDispatchedInstructionSet())
+       << "\", \"cycle_counter\": "
+       << (OVERSIMPLE_BENCH_HAS_CYCLE_COUNTER ? "\"tsc\"" : "null") << ", \"min_time\": " << minTime
+       << ", \"time_unit\": \"ns\" },\n";
+  cout << "  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    cout << "    " << toJson(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  cout << "  ]\n";
+  cout << "}\n";
+  return 0;
+}
@@ -14,7 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#define OVERSIMPLE_WRITING_IIR_PRESETS
 #include "oversimple/Hiir.hpp"
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -22,14 +25,78 @@ limitations under the License.
 using namespace std;
 using namespace oversimple;
 
-int main()
+static std::string toCode(double value)
 {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.17g", value);
+  return text;
+}
+
+// designs the presets at runtime and writes the precomputed tables used by getOversamplingPreset
+static void writePresetTables(std::string const& path)
+{
+  using namespace oversimple::iir::detail;
+  constexpr uint32_t numStages = 5;
+  ofstream file(path);
+  file << "/*\n"
+          "Copyright 2021 Dario Mambro\n"
+          "\n"
+          "Licensed under the Apache License, Version 2.0 (the \"License\");\n"
+          "you may not use this file except in compliance with the License.\n"
+          "You may obtain a copy of the License at\n"
+          "\n"
+          "        http://www.apache.org/licenses/LICENSE-2.0\n"
+          "\n"
+          "Unless required by applicable law or agreed to in writing, software\n"
+          "distributed under the License is distributed on an \"AS IS\" BASIS,\n"
+          "WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.\n"
+          "See the License for the specific language governing permissions and\n"
+          "limitations under the License.\n"
+          "*/\n"
+          "\n"
+          "// generated by running iir-design --write-presets with the presetDesignParameters of Hiir.hpp, do not edit\n"
+          "\n"
+          "#pragma once\n"
+          "\n"
+          "#include \"oversimple/IirOversamplingDesigner.hpp\"\n"
+          "\n"
+          "namespace oversimple::iir::detail {\n"
+          "\n"
+          "inline constexpr OversamplingDesigner::PrecomputedStage precomputedPresets[]["
+       << numStages << "] = {\n";
+  for (auto const& parameters : presetDesignParameters) {
+    auto const designer = OversamplingDesigner(parameters.attenuation, parameters.transition, numStages);
+    file << "  {\n";
+    for (auto const& stage : designer.getStages()) {
+      file << "    { " << toCode(stage.attenuation) << ",\n";
+      file << "      " << toCode(stage.transition) << ",\n";
+      file << "      " << stage.numCoefs << ",\n";
+      file << "      {\n";
+      for (auto coef : stage.getCoefs()) {
+        file << "        " << toCode(coef) << ",\n";
+      }
+      file << "      } },\n";
+    }
+    file << "  },\n";
+  }
+  file << "};\n"
+          "\n"
+          "} // namespace oversimple::iir::detail\n";
+}
+
+int main(int argc, char** argv)
+{
+  if (argc == 3 && std::string(argv[1]) == "--write-presets") {
+    writePresetTables(argv[2]);
+    return 0;
+  }
+  WorkerPool workerPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
   for (int i = 0; i < 2; ++i) {
     auto preset = oversimple::iir::detail::getOversamplingPreset(i);
     cout << "preset " << i << ":\n";
     cout << preset.print();
     cout << "\n\n";
-    auto groupDelay = preset.getGroupDelayGraph(20050).getGraph();
+    auto groupDelay = preset.getGroupDelayGraph(20050, &workerPool).getGraph();
     ofstream file("groupDelay_" + std::to_string(i) + ".json");
     file << "{ \"groupDelay\": [ ";
     for (int i = 0; i < groupDelay.size(); ++i) {
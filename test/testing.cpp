@@ -15,12 +15,22 @@ limitations under the License.
 */
 
 #include "oversimple/FirOversampling.hpp"
+#include "oversimple/GroupedOversampling.hpp"
+#include "oversimple/HalfBandOversampling.hpp"
+#include "oversimple/IirDispatch.hpp"
 #include "oversimple/IirOversampling.hpp"
+#include "oversimple/OfflineOversampling.hpp"
 #include "oversimple/Oversampling.hpp"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <thread>
+#include <vector>
 
 // macro-paranoia macro
 #ifdef _MSC_VER
@@ -41,12 +51,47 @@ limitations under the License.
 using namespace oversimple;
 using namespace std;
 
+char const* getEngineName(fir::Engine engine)
+{
+  switch (engine) {
+    case fir::Engine::uniformPartitioned:
+      return "uniformly partitioned";
+    case fir::Engine::halfBand:
+      return "half-band";
+    case fir::Engine::r8brain:
+    default:
+      return "r8brain";
+  }
+}
+
+// calls function on each of the first numSamples samples of each channel of the up-sampled signal, plain or interleaved
+template<typename Float, class Function>
+void forEachUpSampledSample(Buffer<Float>& upSampled, uint32_t numSamples, Function&& function)
+{
+  for (uint32_t c = 0; c < upSampled.getNumChannels(); ++c) {
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      function(upSampled[c][i]);
+    }
+  }
+}
+
+template<typename Float, class Function>
+void forEachUpSampledSample(InterleavedBuffer<Float>& upSampled, uint32_t numSamples, Function&& function)
+{
+  for (uint32_t c = 0; c < upSampled.getNumChannels(); ++c) {
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      function(*upSampled.at(c, i));
+    }
+  }
+}
+
 template<typename Float>
 void testFirOversampling(uint64_t numChannels,
                          uint64_t numSamples,
                          uint64_t fftSamplesPerBlock,
                          uint64_t oversamplingOrder,
-                         double transitionBand)
+                         double transitionBand,
+                         WorkerPool* workerPool = nullptr)
 {
   cout << "\n";
   cout << "\n";
@@ -54,10 +99,15 @@ void testFirOversampling(uint64_t numChannels,
        << " channels and " << numSamples << " samples per block"
        << " and " << fftSamplesPerBlock << " samples per fft block "
        << " and transitionBand = " << transitionBand << "%. with "
-       << (std::is_same_v<Float, float> ? "single" : "double") << " precision"
-       << "\n";
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision";
+  if (workerPool) {
+    cout << " and " << workerPool->getNumWorkers() << " worker threads";
+  }
+  cout << "\n";
   auto firUpSampler = fir::TUpSamplerPreAllocated<Float>(oversamplingOrder, 1, transitionBand, fftSamplesPerBlock);
   auto firDownSampler = fir::TDownSamplerPreAllocated<Float>(oversamplingOrder, 1, transitionBand, fftSamplesPerBlock);
+  firUpSampler.setExecutor(workerPool);
+  firDownSampler.setExecutor(workerPool);
   firUpSampler.setNumChannels(numChannels);
   firUpSampler.setOrder(oversamplingOrder);
   firUpSampler.prepareBuffers(numSamples);
@@ -128,17 +178,105 @@ void testFirOversampling(uint64_t numChannels,
 }
 
 template<typename Float>
+void testFirOversamplingWithSmallBlocks(uint64_t numChannels,
+                                        uint64_t maxNumSamples,
+                                        uint64_t fftSamplesPerBlock,
+                                        uint64_t oversamplingOrder,
+                                        double transitionBand,
+                                        fir::Engine engine = fir::Engine::r8brain)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing Fir Oversampling with oversampling order " << oversamplingOrder << " and " << numChannels
+       << " channels and up to " << maxNumSamples << " samples per block of varying size"
+       << " and " << fftSamplesPerBlock << " samples per fft block "
+       << " and transitionBand = " << transitionBand << "%. with "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision"
+       << (engine == fir::Engine::r8brain ? "" : " and the uniformly partitioned engine") << "\n";
+  assert(maxNumSamples < fftSamplesPerBlock);
+  auto firUpSampler = fir::TUpSamplerPreAllocated<Float>(
+    oversamplingOrder, 1, transitionBand, fftSamplesPerBlock, fir::AllocationPolicy::allOrders, engine);
+  auto firDownSampler = fir::TDownSamplerPreAllocated<Float>(
+    oversamplingOrder, 1, transitionBand, fftSamplesPerBlock, fir::AllocationPolicy::allOrders, engine);
+  firUpSampler.setNumChannels(numChannels);
+  firUpSampler.setOrder(oversamplingOrder);
+  firUpSampler.prepareBuffers(maxNumSamples);
+  auto const maxUpSampledSamples = firUpSampler.getMaxNumOutputSamples();
+  firDownSampler.setNumChannels(numChannels);
+  firDownSampler.setOrder(oversamplingOrder);
+  firDownSampler.prepareBuffers(maxUpSampledSamples, maxNumSamples);
+  uint64_t upSampleLatency = firUpSampler.getNumSamplesBeforeOutputStarts();
+  uint64_t downSampleLatency = firDownSampler.getNumSamplesBeforeOutputStarts();
+  uint64_t latency = upSampleLatency + downSampleLatency / (1 << oversamplingOrder);
+  cout << "latency  = " << latency << "\n";
+  auto const totSamples = latency + 8 * fftSamplesPerBlock;
+  Buffer<Float> input(numChannels, totSamples);
+  Buffer<Float> output(numChannels, totSamples);
+  input.fill(0.0);
+  output.fill(0.0);
+
+  for (uint64_t c = 0; c < numChannels; ++c) {
+    for (uint64_t i = 0; i < input[c].size(); ++i) {
+      input[c][i] = sin(2.0 * M_PI * 0.125 * (Float)i);
+    }
+  }
+
+  // the host block sizes cycle through values that are all smaller than the fft block, and that do not divide it
+  auto const blockSizes = std::array<uint64_t, 5>{ maxNumSamples, 1, maxNumSamples / 3 + 1, 17, maxNumSamples / 2 };
+  auto in = std::vector<Float*>(input.get(), input.get() + numChannels);
+  auto out = std::vector<Float*>(output.get(), output.get() + numChannels);
+  uint64_t processedSamples = 0;
+  for (uint64_t i = 0; processedSamples < totSamples; ++i) {
+    auto const numSamples = std::min(blockSizes[i % blockSizes.size()], totSamples - processedSamples);
+    uint64_t numUpSampledSamples = firUpSampler.processBlock(in.data(), numSamples);
+    auto const& upSampled = firUpSampler.getOutput().get();
+    CHECK_MEMORY;
+    firDownSampler.processBlock(upSampled, numUpSampledSamples, out.data(), numSamples);
+    CHECK_MEMORY;
+    for (auto c = 0; c < numChannels; ++c) {
+      in[c] += numSamples;
+      out[c] += numSamples;
+    }
+    processedSamples += numSamples;
+  }
+
+  auto const measureSnr = [&](uint64_t from, uint64_t to, const char* text) {
+    for (uint64_t c = 0; c < numChannels; ++c) {
+      double noisePower = 0.0;
+      double signalPower = 0.0;
+      for (uint64_t i = from; i < to; ++i) {
+        double in = input[c][i];
+        double out = output[c][i + latency];
+        double diff = in - out;
+        signalPower += in * in;
+        noisePower += diff * diff;
+      }
+
+      cout << text << ": channel " << c << " snr = " << 10.0 * log10(signalPower / noisePower) << " dB\n";
+    }
+  };
+
+  measureSnr(0, fftSamplesPerBlock, "snr first block");
+  measureSnr(fftSamplesPerBlock, totSamples - latency, "snr after first block");
+
+  cout << "completed testing Fir Oversampling with oversampling order " << oversamplingOrder << " and " << numChannels
+       << " channels and up to " << maxNumSamples << " samples per block of varying size"
+       << "\n";
+}
+
+template<typename Float, iir::Quality quality = iir::Quality::standard>
 void testIirOversampling(uint64_t numChannels, uint64_t order, uint64_t numSamples)
 {
   cout << "\n";
   cout << "\n";
-  auto const preset = iir::detail::getOversamplingPreset(0);
+  auto const preset = iir::detail::getOversamplingPreset(iir::detail::getPresetIndex(quality));
   double const groupDelay = 2 * preset.getGroupDelay(0, order);
 
   auto const factor = (uint64_t)std::pow(2, order);
   cout << "beginning to test " << factor << "x "
        << "IirOversampling with " << numChannels << "channels and "
-       << (typeid(Float) == typeid(float) ? "single" : "double") << " precision\n";
+       << (typeid(Float) == typeid(float) ? "single" : "double") << " precision and quality "
+       << (int)quality << "\n";
 
   cout << "group delay at DC is " << groupDelay << "\n";
   auto const offset = 20 * (uint32_t)std::ceil(groupDelay);
@@ -147,9 +285,9 @@ void testIirOversampling(uint64_t numChannels, uint64_t order, uint64_t numSampl
   auto in = Buffer<Float>(numChannels, samplesPerBlock);
   in.fill(1.0);
   // Oversampling test
-  auto upSampling = iir::UpSampler<Float>(1, order);
+  auto upSampling = iir::UpSampler<Float, quality>(1, order);
   upSampling.setNumChannels(numChannels);
-  auto downSampling = iir::DownSampler<Float>(1, order);
+  auto downSampling = iir::DownSampler<Float, quality>(1, order);
   downSampling.setNumChannels(numChannels);
   bool const upSamplingOk = upSampling.setOrder(order);
   assert(upSamplingOk);
@@ -499,6 +637,1316 @@ void testOversampling(uint64_t order, uint64_t numSamples, bool linearPhase)
   }
 }
 
+template<typename Float>
+void testFusedProcessing(uint64_t order, uint64_t maxNumSamples, bool linearPhase)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing fused processing with order " << order << " and up to " << maxNumSamples
+       << " samples per block with " << (linearPhase ? "linear" : "minimum") << " phase and "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = linearPhase;
+  auto reference = TOversampling<Float>{ settings };
+  auto fused = TOversampling<Float>{ settings };
+  cout << "sub-block size = " << fused.getProcessSubBlockSize() << "\n";
+
+  auto const numBlocks = 16;
+  auto const totSamples = maxNumSamples * numBlocks;
+  Buffer<Float> input(settings.numUpSampledChannels, totSamples);
+  Buffer<Float> referenceOutput(settings.numDownSampledChannels, totSamples);
+  Buffer<Float> fusedOutput(settings.numDownSampledChannels, totSamples);
+  for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+    for (uint64_t i = 0; i < input[c].size(); ++i) {
+      input[c][i] = sin(2.0 * M_PI * 0.0125 * (Float)i);
+    }
+  }
+  auto const halve = [](auto& upSampled, uint32_t numUpSampledSamples) {
+    forEachUpSampledSample(upSampled, numUpSampledSamples, [](Float& sample) { sample *= 0.5; });
+  };
+
+  // the reference uses separate up-sampling and down-sampling calls, the fused object gets the whole signal at once
+  auto in = std::vector<Float*>(input.get(), input.get() + settings.numUpSampledChannels);
+  auto out = std::vector<Float*>(referenceOutput.get(), referenceOutput.get() + settings.numDownSampledChannels);
+  for (auto i = 0; i < numBlocks; ++i) {
+    auto const numUpSampledSamples = reference.upSample(in.data(), maxNumSamples);
+    auto& upSampled = reference.getUpSampleOutput();
+    halve(upSampled, numUpSampledSamples);
+    reference.downSample(upSampled.get(), numUpSampledSamples, out.data(), maxNumSamples);
+    for (auto& channel : in) {
+      channel += maxNumSamples;
+    }
+    for (auto& channel : out) {
+      channel += maxNumSamples;
+    }
+  }
+  fused.process(input.get(), fusedOutput.get(), totSamples, halve);
+  CHECK_MEMORY;
+
+  for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+    double noisePower = 0.0;
+    double signalPower = 0.0;
+    for (uint64_t i = 0; i < totSamples; ++i) {
+      double diff = referenceOutput[c][i] - fusedOutput[c][i];
+      signalPower += referenceOutput[c][i] * referenceOutput[c][i];
+      noisePower += diff * diff;
+    }
+    cout << "fused processing against separate calls: channel " << c
+         << " snr = " << 10.0 * log10(signalPower / noisePower) << " dB\n";
+  }
+}
+
+template<typename Float>
+void testIirVoiceBank(uint32_t numVoices, uint32_t order, uint32_t numSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing iir voice bank with " << numVoices << " voices, order " << order << " and "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto upSamplerBank = iir::UpSamplerVoiceBank<Float>(numVoices, order);
+  auto downSamplerBank = iir::DownSamplerVoiceBank<Float>(numVoices, order);
+  upSamplerBank.prepareBuffers(numSamples);
+  downSamplerBank.prepareBuffers(numSamples);
+  upSamplerBank.setOrder(order);
+  downSamplerBank.setOrder(order);
+  for (uint32_t v = 0; v < numVoices; ++v) {
+    upSamplerBank.addVoice();
+    downSamplerBank.addVoice();
+  }
+
+  // each voice is compared against a mono re-sampler restarted at the same time
+  auto upSamplers = std::vector<std::unique_ptr<iir::UpSampler<Float>>>(numVoices);
+  auto downSamplers = std::vector<std::unique_ptr<iir::DownSampler<Float>>>(numVoices);
+  for (uint32_t v = 0; v < numVoices; ++v) {
+    upSamplers[v] = std::make_unique<iir::UpSampler<Float>>(1, order);
+    downSamplers[v] = std::make_unique<iir::DownSampler<Float>>(1, order);
+    upSamplers[v]->prepareBuffers(numSamples);
+    downSamplers[v]->prepareBuffers(numSamples);
+    upSamplers[v]->setOrder(order);
+    downSamplers[v]->setOrder(order);
+  }
+
+  auto const numUpSampledSamples = numSamples << order;
+  Buffer<Float> input(numVoices, numSamples);
+  Buffer<Float> upSampled(numVoices, numUpSampledSamples);
+  Buffer<Float> output(numVoices, numSamples);
+  Buffer<Float> referenceUpSampled(1, numUpSampledSamples);
+  Buffer<Float> referenceOutput(1, numSamples);
+  auto signalPower = std::vector<double>(numVoices, 0.0);
+  auto noisePower = std::vector<double>(numVoices, 0.0);
+
+  auto const numBlocks = 8;
+  for (auto b = 0; b < numBlocks; ++b) {
+    if (b == numBlocks / 2) {
+      // restarts the last voice, the others keep playing
+      upSamplerBank.removeVoice(numVoices - 1);
+      downSamplerBank.removeVoice(numVoices - 1);
+      upSamplerBank.addVoice();
+      downSamplerBank.addVoice();
+      upSamplers[numVoices - 1]->reset();
+      downSamplers[numVoices - 1]->reset();
+    }
+    for (uint32_t v = 0; v < numVoices; ++v) {
+      for (uint32_t i = 0; i < numSamples; ++i) {
+        input[v][i] = sin(2.0 * M_PI * 0.0125 * (Float)(v + 1) * (Float)(b * numSamples + i));
+      }
+    }
+    upSamplerBank.processBlock(input.get(), numSamples, upSampled.get());
+    downSamplerBank.processBlock(upSampled.get(), numUpSampledSamples, output.get());
+    for (uint32_t v = 0; v < numVoices; ++v) {
+      Float* voiceInput = input.get()[v];
+      Float* voiceUpSampled = referenceUpSampled.get()[0];
+      upSamplers[v]->processBlock(&voiceInput, numSamples, &voiceUpSampled);
+      downSamplers[v]->processBlock(&voiceUpSampled, numUpSampledSamples);
+      downSamplers[v]->getOutput().deinterleave(referenceOutput.get(), 1, numSamples);
+      for (uint32_t i = 0; i < numSamples; ++i) {
+        double diff = referenceOutput[0][i] - output[v][i];
+        signalPower[v] += referenceOutput[0][i] * referenceOutput[0][i];
+        noisePower[v] += diff * diff;
+      }
+    }
+  }
+  CHECK_MEMORY;
+
+  for (uint32_t v = 0; v < numVoices; ++v) {
+    cout << "voice bank against mono re-samplers: voice " << v
+         << " snr = " << 10.0 * log10(signalPower[v] / noisePower[v]) << " dB\n";
+  }
+}
+
+template<typename Float>
+void testDispatchedIirOversampling(uint32_t numChannels, uint32_t order, uint32_t numSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the dispatched iir re-samplers with " << numChannels << " channels, order " << order << " and "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision, on a cpu supporting "
+       << getInstructionSetName(detectInstructionSet()) << "\n";
+
+  // the reference is the IIR engine compiled for the architecture of the test
+  auto upSampler = iir::UpSampler<Float>(numChannels, order);
+  auto downSampler = iir::DownSampler<Float>(numChannels, order);
+  upSampler.prepareBuffers(numSamples);
+  downSampler.prepareBuffers(numSamples);
+  upSampler.setOrder(order);
+  downSampler.setOrder(order);
+
+  auto const numUpSampledSamples = numSamples << order;
+  Buffer<Float> input(numChannels, numSamples);
+  Buffer<Float> upSampled(numChannels, numUpSampledSamples);
+  Buffer<Float> output(numChannels, numSamples);
+  Buffer<Float> referenceUpSampled(numChannels, numUpSampledSamples);
+  Buffer<Float> referenceOutput(numChannels, numSamples);
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      input[c][i] = sin(2.0 * M_PI * 0.0125 * (Float)(c + 1) * (Float)i);
+    }
+  }
+  upSampler.processBlock(input.get(), numSamples, referenceUpSampled.get());
+  downSampler.processBlock(referenceUpSampled.get(), numUpSampledSamples);
+  downSampler.getOutput().deinterleave(referenceOutput.get(), numChannels, numSamples);
+
+  auto const instructionSets = std::array<InstructionSet, 5>{ InstructionSet::none,
+                                                              InstructionSet::sse2,
+                                                              InstructionSet::avx,
+                                                              InstructionSet::avx2,
+                                                              InstructionSet::avx512 };
+  for (auto instructionSet : instructionSets) {
+    if (static_cast<int>(instructionSet) > static_cast<int>(detectInstructionSet())) {
+      continue;
+    }
+    auto dispatchedUpSampler =
+      iir::DispatchedUpSampler<Float>(numChannels, order, iir::Quality::standard, instructionSet);
+    auto dispatchedDownSampler =
+      iir::DispatchedDownSampler<Float>(numChannels, order, iir::Quality::standard, instructionSet);
+    assert(dispatchedUpSampler.getChannelLayout().numChannels == numChannels);
+    dispatchedUpSampler.prepareBuffers(numSamples);
+    dispatchedDownSampler.prepareBuffers(numSamples);
+    dispatchedUpSampler.setOrder(order);
+    dispatchedDownSampler.setOrder(order);
+    dispatchedUpSampler.processBlock(input.get(), numSamples, upSampled.get());
+    dispatchedDownSampler.processBlock(upSampled.get(), numUpSampledSamples, output.get());
+    CHECK_MEMORY;
+
+    double maxUpSampledDifference = 0.0;
+    double maxDifference = 0.0;
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < numUpSampledSamples; ++i) {
+        maxUpSampledDifference =
+          std::max(maxUpSampledDifference, (double)std::abs(upSampled[c][i] - referenceUpSampled[c][i]));
+      }
+      for (uint32_t i = 0; i < numSamples; ++i) {
+        maxDifference = std::max(maxDifference, (double)std::abs(output[c][i] - referenceOutput[c][i]));
+      }
+    }
+    cout << "dispatched to " << getInstructionSetName(dispatchedUpSampler.getInstructionSet())
+         << ": max difference against the compiled re-samplers: up-sampled " << maxUpSampledDifference << ", output "
+         << maxDifference << "\n";
+    assert(dispatchedUpSampler.getInstructionSet() == dispatchedDownSampler.getInstructionSet());
+    assert(maxUpSampledDifference < 1.e-4 && maxDifference < 1.e-4);
+  }
+}
+
+template<typename Float,
+         uint32_t order,
+         Phase phase,
+         BufferType upSampledBufferType,
+         fir::Engine engine = fir::Engine::r8brain>
+void testFixedOversampling(uint64_t maxNumSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing fixed oversampling with order " << order << " and up to " << maxNumSamples
+       << " samples per block with " << (phase == Phase::linear ? "linear" : "minimum") << " phase, "
+       << (phase == Phase::linear ? getEngineName(engine) : "IIR") << " re-samplers, "
+       << (upSampledBufferType == BufferType::plain ? "plain" : "interleaved") << " up-sampled buffers and "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = phase == Phase::linear;
+  settings.firEngine = engine;
+  settings.upSampleOutputBufferType = upSampledBufferType;
+  settings.downSampleInputBufferType = upSampledBufferType;
+  auto reference = TOversampling<Float>{ settings };
+  auto fixed = TFixedOversampling<Float,
+                                  order,
+                                  phase,
+                                  BufferType::plain,
+                                  upSampledBufferType,
+                                  iir::Quality::standard,
+                                  engine>{ settings };
+  cout << "object size = " << sizeof(fixed) << " bytes, against " << sizeof(reference) << " bytes\n";
+
+  auto const totSamples = maxNumSamples * 16;
+  Buffer<Float> input(settings.numUpSampledChannels, totSamples);
+  Buffer<Float> referenceOutput(settings.numDownSampledChannels, totSamples);
+  Buffer<Float> fixedOutput(settings.numDownSampledChannels, totSamples);
+  for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+    for (uint64_t i = 0; i < input[c].size(); ++i) {
+      input[c][i] = sin(2.0 * M_PI * 0.0125 * (Float)i);
+    }
+  }
+  auto const doNothing = [](auto& upSampled, uint32_t numUpSampledSamples) {};
+  auto const halfSamples = totSamples / 2;
+  reference.process(input.get(), referenceOutput.get(), halfSamples, doNothing);
+  fixed.process(input.get(), fixedOutput.get(), halfSamples, doNothing);
+  // querying the latency while processing must not disturb the state
+  auto const& constFixed = fixed;
+  if (constFixed.getLatency() != reference.getLatency()) {
+    cout << "latency = " << constFixed.getLatency() << ", WRONG, expected " << reference.getLatency() << "\n";
+  }
+  std::vector<Float*> inputSecondHalf(settings.numUpSampledChannels);
+  std::vector<Float*> referenceOutputSecondHalf(settings.numDownSampledChannels);
+  std::vector<Float*> fixedOutputSecondHalf(settings.numDownSampledChannels);
+  for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+    inputSecondHalf[c] = &input[c][halfSamples];
+  }
+  for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+    referenceOutputSecondHalf[c] = &referenceOutput[c][halfSamples];
+    fixedOutputSecondHalf[c] = &fixedOutput[c][halfSamples];
+  }
+  reference.process(
+    inputSecondHalf.data(), referenceOutputSecondHalf.data(), totSamples - halfSamples, doNothing);
+  fixed.process(inputSecondHalf.data(), fixedOutputSecondHalf.data(), totSamples - halfSamples, doNothing);
+  CHECK_MEMORY;
+
+  for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+    double noisePower = 0.0;
+    double signalPower = 0.0;
+    for (uint64_t i = 0; i < totSamples; ++i) {
+      double diff = referenceOutput[c][i] - fixedOutput[c][i];
+      signalPower += referenceOutput[c][i] * referenceOutput[c][i];
+      noisePower += diff * diff;
+    }
+    cout << "fixed oversampling against TOversampling: channel " << c
+         << " snr = " << 10.0 * log10(signalPower / noisePower) << " dB\n";
+  }
+}
+
+template<typename Float>
+void testIirTaps(uint32_t numChannels, uint32_t numSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing iir taps with " << numChannels << " channels and "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  // one up-sampler at 8x with a tap at 2x, against a separate up-sampler at 2x
+  auto upSampler = iir::UpSampler<Float>(numChannels, 3);
+  auto upSampler2x = iir::UpSampler<Float>(numChannels, 1);
+  upSampler.prepareBuffers(numSamples);
+  upSampler2x.prepareBuffers(numSamples);
+  upSampler.setOrder(3);
+  upSampler2x.setOrder(1);
+  upSampler.setTapEnabled(1, true);
+  // one down-sampler taking the 8x signal and the 2x one as a tap, against the sum of two separate down-samplers
+  auto downSampler = iir::DownSampler<Float>(numChannels, 3);
+  auto downSampler8x = iir::DownSampler<Float>(numChannels, 3);
+  auto downSampler2x = iir::DownSampler<Float>(numChannels, 1);
+  for (auto d : { &downSampler, &downSampler8x, &downSampler2x }) {
+    d->prepareBuffers(numSamples);
+  }
+  downSampler8x.setOrder(3);
+  downSampler2x.setOrder(1);
+  downSampler.setTapInput(1, &upSampler.getTapOutput(1));
+
+  Buffer<Float> input(numChannels, numSamples);
+  auto tapSignalPower = 0.0;
+  auto tapNoisePower = 0.0;
+  auto downSignalPower = 0.0;
+  auto downNoisePower = 0.0;
+  for (auto b = 0; b < 8; ++b) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < numSamples; ++i) {
+        input[c][i] = sin(2.0 * M_PI * 0.0125 * (Float)(c + 1) * (Float)(b * numSamples + i));
+      }
+    }
+    upSampler.processBlock(input);
+    upSampler2x.processBlock(input);
+    auto const& tap = upSampler.getTapOutput(1);
+    auto const& reference2x = upSampler2x.getOutput();
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < 2 * numSamples; ++i) {
+        double diff = *reference2x.at(c, i) - *tap.at(c, i);
+        tapSignalPower += *reference2x.at(c, i) * *reference2x.at(c, i);
+        tapNoisePower += diff * diff;
+      }
+    }
+    downSampler.processBlock(upSampler.getOutput(), 3);
+    downSampler8x.processBlock(upSampler.getOutput());
+    downSampler2x.processBlock(tap);
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < numSamples; ++i) {
+        double reference = *downSampler8x.getOutput().at(c, i) + *downSampler2x.getOutput().at(c, i);
+        double diff = reference - *downSampler.getOutput().at(c, i);
+        downSignalPower += reference * reference;
+        downNoisePower += diff * diff;
+      }
+    }
+  }
+  CHECK_MEMORY;
+
+  cout << "2x tap against 2x up-sampler: snr = " << 10.0 * log10(tapSignalPower / tapNoisePower) << " dB\n";
+  cout << "8x down-sampling with 2x tap input against separate down-samplers: snr = "
+       << 10.0 * log10(downSignalPower / downNoisePower) << " dB\n";
+}
+
+template<typename Float>
+void testHalfBandOversampling(uint32_t numChannels, uint32_t order, uint32_t maxNumSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing half-band FIR oversampling with oversampling order " << order << " and " << numChannels
+       << " channels and up to " << maxNumSamples << " samples per block of varying size with "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto upSampler = fir::HalfBandUpSampler<Float>(numChannels, order);
+  auto downSampler = fir::HalfBandDownSampler<Float>(numChannels, order);
+  upSampler.setOrder(order);
+  downSampler.setOrder(order);
+  upSampler.prepareBuffers(maxNumSamples);
+  downSampler.prepareBuffers(maxNumSamples);
+  auto const latency = upSampler.getLatency() + downSampler.getLatency();
+  cout << "latency  = " << latency << "\n";
+  auto const totSamples = latency + 8 * maxNumSamples;
+  Buffer<Float> input(numChannels, totSamples);
+  Buffer<Float> output(numChannels, totSamples);
+  Buffer<Float> upSampled(numChannels, maxNumSamples << order);
+  output.fill(0.0);
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t i = 0; i < totSamples; ++i) {
+      input[c][i] = sin(2.0 * M_PI * (0.01 + 0.02 * c) * (Float)i);
+    }
+  }
+
+  // every other block goes through plain buffers, to test the alignment delay on both paths
+  auto const blockSizes = std::array<uint32_t, 4>{ maxNumSamples, 1, maxNumSamples / 3 + 1, 17 };
+  auto in = std::vector<Float*>(numChannels);
+  uint32_t processedSamples = 0;
+  for (uint32_t i = 0; processedSamples < totSamples; ++i) {
+    auto const numSamples = std::min(blockSizes[i % blockSizes.size()], totSamples - processedSamples);
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      in[c] = input.get()[c] + processedSamples;
+    }
+    if (i % 2 == 0) {
+      upSampler.processBlock(in.data(), numSamples);
+      downSampler.processBlock(upSampler.getOutput());
+    }
+    else {
+      upSampler.processBlock(in.data(), numSamples, upSampled.get());
+      downSampler.processBlock(upSampled.get(), numSamples << order);
+    }
+    CHECK_MEMORY;
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t s = 0; s < numSamples; ++s) {
+        output[c][processedSamples + s] = *downSampler.getOutput().at(c, s);
+      }
+    }
+    processedSamples += numSamples;
+  }
+
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    double noisePower = 0.0;
+    double signalPower = 0.0;
+    // the onset of the sine is not band limited, so its first samples are skipped
+    for (uint32_t i = latency; i < totSamples - latency; ++i) {
+      double in = input[c][i];
+      double diff = in - output[c][i + latency];
+      signalPower += in * in;
+      noisePower += diff * diff;
+    }
+    cout << "channel " << c << " snr = " << 10.0 * log10(signalPower / noisePower) << " dB\n";
+  }
+}
+
+template<typename Float>
+void testHalfBandEngine(uint32_t order, uint32_t maxNumSamples, BufferType upSampledBufferType)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing TOversampling with the half-band engine with order " << order << ", " << maxNumSamples
+       << " samples per block, " << (upSampledBufferType == BufferType::plain ? "plain" : "interleaved")
+       << " up-sampled buffers and " << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = true;
+  settings.upSampleOutputBufferType = upSampledBufferType;
+  settings.downSampleInputBufferType = upSampledBufferType;
+  // the engine is changed at runtime, from an object built with the r8brain one
+  auto oversampling = TOversampling<Float>{ settings };
+  oversampling.setFirEngine(fir::Engine::halfBand);
+  auto const numChannels = settings.numUpSampledChannels;
+  auto upSampler = fir::HalfBandUpSampler<Float>(numChannels, order);
+  auto downSampler = fir::HalfBandDownSampler<Float>(numChannels, order);
+  upSampler.setOrder(order);
+  downSampler.setOrder(order);
+  upSampler.prepareBuffers(maxNumSamples);
+  downSampler.prepareBuffers(maxNumSamples);
+  auto const latency = oversampling.getLatency();
+  auto const expectedLatency = upSampler.getLatency() + downSampler.getLatency();
+  cout << "latency = " << latency << (latency == expectedLatency ? "" : ", WRONG") << ", up-sampling latency = "
+       << oversampling.getUpSamplingLatency() << ", down-sampling latency = " << oversampling.getDownSamplingLatency()
+       << "\n";
+
+  auto const numSamples = maxNumSamples * 8;
+  Buffer<Float> input(numChannels, maxNumSamples);
+  Buffer<Float> output(numChannels, numSamples);
+  double maxDifference = 0.0;
+  std::vector<Float*> out(numChannels);
+  for (uint32_t offset = 0; offset < numSamples; offset += maxNumSamples) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = sin(2.0 * M_PI * 0.0125 * (double)(offset + i) + (double)c);
+      }
+      out[c] = &output[c][offset];
+    }
+    oversampling.process(input.get(), out.data(), maxNumSamples, [](auto&, uint32_t) {});
+    upSampler.processBlock(input.get(), maxNumSamples);
+    downSampler.processBlock(upSampler.getOutput());
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        maxDifference =
+          std::max(maxDifference, std::abs((double)output[c][offset + i] - (double)*downSampler.getOutput().at(c, i)));
+      }
+    }
+  }
+  CHECK_MEMORY;
+  cout << "max difference against the half-band re-samplers = " << maxDifference << "\n";
+  // the minimum phase path is still available, and has no latency
+  oversampling.setUseLinearPhase(false);
+  cout << "latency with minimum phase = " << oversampling.getLatency()
+       << (oversampling.getLatency() == 0 ? "" : ", WRONG") << "\n";
+}
+
+void testHalfBandDesign()
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the stopband attenuation of the half-band FIR filters\n";
+  auto const designer = fir::detail::getHalfBandDesigner();
+  auto transition = fir::detail::halfBandTransition;
+  for (uint32_t s = 0; s < designer.getStages().size(); ++s) {
+    auto const& coefs = designer.getStages()[s].getCoefs();
+    auto maxStopbandGain = 0.0;
+    for (uint32_t i = 0; i <= 4096; ++i) {
+      auto const frequency = 0.25 + 0.5 * transition + (0.25 - 0.5 * transition) * i / 4096.0;
+      auto gain = 0.5;
+      for (uint32_t k = 0; k < coefs.size(); ++k) {
+        gain += 2.0 * coefs[k] * cos(2.0 * M_PI * frequency * (2 * k + 1));
+      }
+      maxStopbandGain = std::max(maxStopbandGain, std::abs(gain));
+    }
+    cout << "stage " << s << ": " << coefs.size() << " coefficients, attenuation = "
+         << -20.0 * log10(maxStopbandGain) << " dB, required = " << designer.getAttenuation() << " dB\n";
+    transition = 0.5 * (0.5 + transition);
+  }
+}
+
+template<typename Float>
+void testSilenceBypass(uint32_t order, uint32_t maxNumSamples, bool linearPhase)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing silence bypass with order " << order << ", " << maxNumSamples << " samples per block, "
+       << (linearPhase ? "linear" : "minimum") << " phase and " << (std::is_same_v<Float, float> ? "single" : "double")
+       << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.numUpSampledChannels = 5;
+  settings.numDownSampledChannels = 5;
+  settings.isUsingLinearPhase = linearPhase;
+  settings.firEngine = fir::Engine::uniformPartitioned;
+  settings.fftBlockSize = 64;
+  auto reference = TOversampling<Float>{ settings };
+  settings.isBypassingSilence = true;
+  auto bypassing = TOversampling<Float>{ settings };
+
+  // a channel always playing, one playing a few bursts, one never playing, and two starting after a while
+  auto const numChannels = settings.numUpSampledChannels;
+  auto signal = [](uint32_t c, uint32_t i) {
+    bool const isPlaying = c == 0 || (c == 1 && (i < 1000 || (i > 5003 && i < 7000) || i == 9001)) || (c > 2 && i > 8191);
+    return isPlaying ? (Float)sin(2.0 * M_PI * 0.0125 * (double)i + (double)c) : (Float)0.0;
+  };
+  auto const numBlocks = 12000 / maxNumSamples;
+  Buffer<Float> input(numChannels, maxNumSamples);
+  Buffer<Float> referenceOutput(numChannels, maxNumSamples);
+  Buffer<Float> bypassingOutput(numChannels, maxNumSamples);
+  std::vector<double> maxDifference(numChannels, 0.0);
+  double silentChannelPeak = 0.0;
+  for (uint32_t block = 0; block < numBlocks; ++block) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = signal(c, block * maxNumSamples + i);
+      }
+    }
+    reference.process(input.get(), referenceOutput.get(), maxNumSamples, [](auto&, uint32_t) {});
+    bypassing.process(input.get(), bypassingOutput.get(), maxNumSamples, [](auto&, uint32_t) {});
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        maxDifference[c] =
+          std::max(maxDifference[c], std::abs((double)referenceOutput[c][i] - (double)bypassingOutput[c][i]));
+      }
+    }
+    for (uint32_t i = 0; i < maxNumSamples; ++i) {
+      silentChannelPeak = std::max(silentChannelPeak, std::abs((double)bypassingOutput[2][i]));
+    }
+  }
+  CHECK_MEMORY;
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    cout << "channel " << c << ": max difference against processing without bypass = " << maxDifference[c] << "\n";
+  }
+  cout << "peak of the silent channel = " << silentChannelPeak << (silentChannelPeak == 0.0 ? "" : ", NOT SILENT")
+       << "\n";
+}
+
+template<typename Float>
+void testPrimeAndFlush(uint32_t order, uint32_t maxNumSamples, fir::Engine engine)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing prime and flush with order " << order << ", " << maxNumSamples << " samples per block, "
+       << getEngineName(engine) << " engine and " << (std::is_same_v<Float, float> ? "single" : "double")
+       << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = true;
+  settings.firEngine = engine;
+  settings.fftBlockSize = 256;
+  auto oversampling = TOversampling<Float>{ settings };
+  auto const latency = oversampling.getLatency();
+  cout << "latency = " << latency << "\n";
+
+  auto const numSamples = maxNumSamples * 16;
+  Buffer<Float> input(settings.numUpSampledChannels, maxNumSamples);
+  Buffer<Float> output(settings.numDownSampledChannels, numSamples + latency);
+  auto signal = [](uint64_t c, uint32_t i) { return (Float)sin(2.0 * M_PI * 0.0125 * (double)i + (double)c); };
+
+  oversampling.prime();
+  // once primed, the up-sampler outputs the samples corresponding to its input from the first call
+  for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+    for (uint32_t i = 0; i < maxNumSamples; ++i) {
+      input[c][i] = signal(c, i);
+    }
+  }
+  auto const numFirstUpSampledSamples = oversampling.upSample(input.get(), maxNumSamples);
+  cout << "up-sampled samples of the first block after priming = " << numFirstUpSampledSamples << ", expected "
+       << maxNumSamples * (1u << order) << "\n";
+
+  oversampling.prime();
+  std::vector<Float*> out(settings.numDownSampledChannels);
+  for (uint32_t offset = 0; offset < numSamples; offset += maxNumSamples) {
+    for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = signal(c, offset + i);
+      }
+    }
+    for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+      out[c] = &output[c][offset];
+    }
+    oversampling.process(input.get(), out.data(), maxNumSamples, [](auto&, uint32_t) {});
+  }
+  for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+    out[c] = &output[c][numSamples];
+  }
+  // the processor only works on the up-sampled end of the signal, held by the up-sampler
+  uint32_t numProcessedTailSamples = 0;
+  auto const numFlushedSamples =
+    oversampling.flush(out.data(), [&](auto&, uint32_t numUpSampledSamples) {
+      numProcessedTailSamples += numUpSampledSamples;
+    });
+  CHECK_MEMORY;
+  cout << "flushed samples = " << numFlushedSamples << (numFlushedSamples == latency ? "" : ", WRONG LENGTH") << "\n";
+  auto const expectedProcessedTailSamples = std::min(2 * oversampling.getUpSamplingLatency(order, true), latency)
+                                            << order;
+  cout << "up-sampled samples processed by flush = " << numProcessedTailSamples << ", expected "
+       << expectedProcessedTailSamples << "\n";
+
+  // with the tail, the output holds all the input, delayed by the latency
+  for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+    double noisePower = 0.0;
+    double signalPower = 0.0;
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      double diff = output[c][i + latency] - signal(c, i);
+      signalPower += signal(c, i) * signal(c, i);
+      noisePower += diff * diff;
+    }
+    cout << "primed and flushed output: channel " << c << " snr = " << 10.0 * log10(signalPower / noisePower)
+         << " dB\n";
+  }
+}
+
+template<typename Float>
+void testFirOrderOnDemand(uint32_t maxOrder, uint32_t maxNumSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing FIR orders prepared on demand with max order " << maxOrder << ", " << maxNumSamples
+       << " samples per block and " << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = maxOrder;
+  settings.order = 1;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = true;
+  settings.firEngine = fir::Engine::uniformPartitioned;
+  settings.fftBlockSize = 64;
+  settings.firAllocationPolicy = fir::AllocationPolicy::activeOrderOnly;
+  auto onDemand = TOversampling<Float>{ settings };
+  settings.firAllocationPolicy = fir::AllocationPolicy::allOrders;
+  auto allOrders = TOversampling<Float>{ settings };
+
+  Buffer<Float> input(settings.numUpSampledChannels, maxNumSamples);
+  Buffer<Float> onDemandOutput(settings.numDownSampledChannels, maxNumSamples);
+  Buffer<Float> allOrdersOutput(settings.numDownSampledChannels, maxNumSamples);
+  auto signal = [](uint64_t c, uint32_t i) { return (Float)sin(2.0 * M_PI * 0.0125 * (double)i + (double)c); };
+  uint32_t offset = 0;
+  auto processBlock = [&] {
+    for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = signal(c, offset + i);
+      }
+    }
+    offset += maxNumSamples;
+    onDemand.process(input.get(), onDemandOutput.get(), maxNumSamples, [](auto&, uint32_t) {});
+    allOrders.process(input.get(), allOrdersOutput.get(), maxNumSamples, [](auto&, uint32_t) {});
+  };
+
+  // an order that is not ready is not set, as setOrder does not allocate
+  if (onDemand.setOrder(maxOrder) || onDemand.getOversamplingOrder() != 1) {
+    cout << "order " << maxOrder << " WRONGLY SET before being prepared\n";
+  }
+
+  // the max order is prepared on another thread while the object processes with the first one
+  auto preparation = std::thread([&] { onDemand.prepareFirOrder(maxOrder); });
+  for (int i = 0; i < 8; ++i) {
+    processBlock();
+  }
+  preparation.join();
+  if (!onDemand.isFirOrderReady(maxOrder)) {
+    cout << "order " << maxOrder << " NOT READY after prepareFirOrder\n";
+  }
+  if (!onDemand.setOrder(maxOrder) || !allOrders.setOrder(maxOrder)) {
+    cout << "order " << maxOrder << " NOT SET after prepareFirOrder\n";
+  }
+  onDemand.reset();
+  allOrders.reset();
+  CHECK_MEMORY;
+  if (onDemand.getLatency() != allOrders.getLatency()) {
+    cout << "latency of the prepared order = " << onDemand.getLatency() << ", WRONG, expected "
+         << allOrders.getLatency() << "\n";
+  }
+
+  double maxDiff = 0.0;
+  for (int b = 0; b < 16; ++b) {
+    processBlock();
+    for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        maxDiff = std::max(maxDiff, (double)std::abs(onDemandOutput[c][i] - allOrdersOutput[c][i]));
+      }
+    }
+  }
+  cout << "max difference from the object with all the orders allocated = " << maxDiff << "\n";
+
+  // the output length of the orders that are not allocated is computed without building them
+  for (auto engine : { fir::Engine::r8brain, fir::Engine::uniformPartitioned }) {
+    auto onDemandUpSampler = fir::TUpSamplerPreAllocated<Float>(
+      maxOrder, 2, settings.firTransitionBand, settings.fftBlockSize, fir::AllocationPolicy::activeOrderOnly, engine);
+    auto allOrdersUpSampler = fir::TUpSamplerPreAllocated<Float>(
+      maxOrder, 2, settings.firTransitionBand, settings.fftBlockSize, fir::AllocationPolicy::allOrders, engine);
+    onDemandUpSampler.prepareBuffers(maxNumSamples);
+    allOrdersUpSampler.prepareBuffers(maxNumSamples);
+    auto const computed = onDemandUpSampler.getMaxNumOutputSamplesOfAllOrders();
+    auto const built = allOrdersUpSampler.getMaxNumOutputSamplesOfAllOrders();
+    uint32_t numReadyOrders = 0;
+    for (uint32_t order = 1; order <= maxOrder; ++order) {
+      numReadyOrders += onDemandUpSampler.isOrderReady(order) ? 1 : 0;
+    }
+    cout << (engine == fir::Engine::r8brain ? "r8brain" : "uniformly partitioned")
+         << " max output samples of all the orders: computed = " << computed << ", built = " << built
+         << (computed == built ? "" : ", WRONG") << ", ready orders = " << numReadyOrders
+         << (numReadyOrders == 1 ? "" : ", WRONG") << "\n";
+  }
+}
+
+template<typename Float>
+void testPartitionedWorkPerCall(uint32_t order, uint32_t maxNumSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the work of each call of the uniformly partitioned engine with order " << order << ", "
+       << maxNumSamples << " samples per block and " << (std::is_same_v<Float, float> ? "single" : "double")
+       << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = true;
+  settings.firEngine = fir::Engine::uniformPartitioned;
+  // longer than the blocks: the partitions follow the blocks anyway
+  settings.fftBlockSize = 1024;
+  auto oversampling = TOversampling<Float>{ settings };
+  cout << "latency = " << oversampling.getLatency() << "\n";
+
+  Buffer<Float> input(settings.numUpSampledChannels, maxNumSamples);
+  Buffer<Float> output(settings.numDownSampledChannels, maxNumSamples);
+  uint32_t offset = 0;
+  auto processBlock = [&] {
+    for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = (Float)sin(2.0 * M_PI * 0.0125 * (double)(offset + i) + (double)c);
+      }
+    }
+    offset += maxNumSamples;
+    oversampling.process(input.get(), output.get(), maxNumSamples, [](auto&, uint32_t) {});
+  };
+  for (int b = 0; b < 64; ++b) {
+    processBlock();
+  }
+  // each call completes exactly one partition, so the slowest calls, apart from the preempted ones, take about as long
+  // as the typical one, while with partitions spanning several calls one call in every few would do all the ffts
+  auto const numBlocks = 2048;
+  std::vector<double> durations;
+  durations.reserve(numBlocks);
+  for (int b = 0; b < numBlocks; ++b) {
+    auto const start = std::chrono::steady_clock::now();
+    processBlock();
+    durations.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  CHECK_MEMORY;
+  std::sort(durations.begin(), durations.end());
+  auto const median = durations[numBlocks / 2];
+  auto const slow = durations[numBlocks * 95 / 100];
+  cout << "median call = " << median << " us, 95th percentile = " << slow << " us"
+       << (slow > 4.0 * median ? ", WORK NOT SPREAD ACROSS THE CALLS" : "") << "\n";
+}
+
+template<typename Float>
+void testInternalBuffersSize(uint32_t order, uint32_t maxNumSamples)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the size of the internal buffers with order " << order << ", " << maxNumSamples
+       << " samples per block and " << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.isUsingLinearPhase = true;
+  settings.firEngine = fir::Engine::uniformPartitioned;
+  settings.fftBlockSize = 256;
+  auto interleavedSettings = settings;
+  interleavedSettings.upSampleOutputBufferType = BufferType::interleaved;
+  interleavedSettings.downSampleInputBufferType = BufferType::interleaved;
+  auto allInterleavedSettings = interleavedSettings;
+  allInterleavedSettings.upSampleInputBufferType = BufferType::interleaved;
+  allInterleavedSettings.downSampleOutputBufferType = BufferType::interleaved;
+  // the size computed from the settings must be the one allocated by an object
+  for (auto const& [name, sizeSettings] : { std::make_pair("plain buffers", settings),
+                                            std::make_pair("interleaved up-sampled buffers", interleavedSettings),
+                                            std::make_pair("all buffers interleaved", allInterleavedSettings) })
+  {
+    auto const computedSize = TOversampling<Float>::getInternalBuffersSize(sizeSettings);
+    auto const allocatedSize = TOversampling<Float>{ sizeSettings }.getInternalBuffersSize();
+    cout << "internal buffers size with " << name << " = " << computedSize << " bytes, allocated = " << allocatedSize
+         << " bytes" << (computedSize == allocatedSize ? "" : ", WRONG") << "\n";
+  }
+
+  // the deinterleaved input of the down-sampling shares the buffer of the up-sampling, which must not change the output
+  auto plain = TOversampling<Float>{ settings };
+  auto interleaved = TOversampling<Float>{ interleavedSettings };
+  Buffer<Float> input(settings.numUpSampledChannels, maxNumSamples);
+  Buffer<Float> plainOutput(settings.numDownSampledChannels, maxNumSamples);
+  Buffer<Float> interleavedOutput(settings.numDownSampledChannels, maxNumSamples);
+  double maxDiff = 0.0;
+  for (uint32_t b = 0; b < 16; ++b) {
+    for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = (Float)sin(2.0 * M_PI * 0.0125 * (double)(b * maxNumSamples + i) + (double)c);
+      }
+    }
+    plain.process(input.get(), plainOutput.get(), maxNumSamples, [](auto&, uint32_t) {});
+    interleaved.process(input.get(), interleavedOutput.get(), maxNumSamples, [](auto&, uint32_t) {});
+    for (uint64_t c = 0; c < settings.numDownSampledChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        maxDiff = std::max(maxDiff, (double)std::abs(plainOutput[c][i] - interleavedOutput[c][i]));
+      }
+    }
+  }
+  CHECK_MEMORY;
+  cout << "max difference between plain and interleaved up-sampled buffers = " << maxDiff << "\n";
+}
+
+template<typename Float>
+void testGroupedOversampling(uint32_t maxNumSamples, BufferType upSampledBufferType, fir::Engine engine)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing grouped oversampling with " << maxNumSamples << " samples per block, "
+       << (upSampledBufferType == BufferType::plain ? "plain" : "interleaved") << " up-sampled buffers, the "
+       << getEngineName(engine) << " engine and " << (std::is_same_v<Float, float> ? "single" : "double")
+       << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxNumInputSamples = maxNumSamples;
+  settings.upSampleOutputBufferType = upSampledBufferType;
+  settings.firEngine = engine;
+  settings.fftBlockSize = 64;
+  // the first and the last group share a configuration, and are packed in the same re-samplers
+  auto const groups = std::vector<ChannelGroup>{ { 2, 2, false }, { 1, 1, true }, { 1, 2, false }, { 2, 3, true } };
+  auto grouped = TGroupedOversampling<Float>{ settings, groups };
+  auto const numChannels = grouped.getNumChannels();
+  auto const latency = grouped.getLatency();
+  cout << "channels = " << numChannels << ", configurations = " << grouped.getNumConfigurations()
+       << (grouped.getNumConfigurations() == 3 ? "" : ", WRONG NUMBER OF CONFIGURATIONS") << ", latency = " << latency
+       << "\n";
+  // the same groups, with the configurations and the channels of the FIR re-samplers processed by a shared pool
+  auto parallel = TGroupedOversampling<Float>{ settings, groups };
+  WorkerPool workerPool(2);
+  parallel.setExecutor(&workerPool);
+  parallel.setFirExecutor(&workerPool);
+
+  // each channel is compared with a single channel TOversampling with the order and phase of its group
+  std::vector<std::unique_ptr<TOversampling<Float>>> references;
+  std::vector<uint32_t> delays;
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    auto referenceSettings = settings;
+    referenceSettings.numUpSampledChannels = 1;
+    referenceSettings.numDownSampledChannels = 1;
+    referenceSettings.maxOrder = grouped.getChannelOrder(c);
+    referenceSettings.order = grouped.getChannelOrder(c);
+    referenceSettings.isUsingLinearPhase = grouped.isChannelUsingLinearPhase(c);
+    referenceSettings.downSampleInputBufferType = upSampledBufferType;
+    references.push_back(std::make_unique<TOversampling<Float>>(referenceSettings));
+    delays.push_back(latency - references.back()->getLatency());
+  }
+
+  auto const numSamples = maxNumSamples * 24;
+  auto signal = [](uint32_t c, uint32_t i) { return (Float)sin(2.0 * M_PI * 0.0125 * (double)i + (double)c); };
+  Buffer<Float> input(numChannels, maxNumSamples);
+  Buffer<Float> output(numChannels, numSamples);
+  Buffer<Float> referenceOutput(numChannels, numSamples);
+  Buffer<Float> parallelOutput(numChannels, numSamples);
+  std::vector<Float*> out(numChannels);
+  std::vector<Float*> parallelOut(numChannels);
+  std::vector<uint32_t> numProcessorCalls(numChannels, 0);
+  auto processor = [&](auto&, uint32_t, std::vector<uint32_t> const& channels) {
+    for (auto channel : channels) {
+      ++numProcessorCalls[channel];
+    }
+  };
+  for (uint32_t offset = 0; offset < numSamples; offset += maxNumSamples) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < maxNumSamples; ++i) {
+        input[c][i] = signal(c, offset + i);
+      }
+      out[c] = &output[c][offset];
+      parallelOut[c] = &parallelOutput[c][offset];
+    }
+    grouped.process(input.get(), out.data(), maxNumSamples, processor);
+    // the configurations hold different channels, so the processor can be called concurrently
+    parallel.process(
+      input.get(), parallelOut.data(), maxNumSamples, [](auto&, uint32_t, std::vector<uint32_t> const&) {});
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      Float* referenceInput = &input[c][0];
+      Float* referenceOut = &referenceOutput[c][offset];
+      references[c]->process(&referenceInput, &referenceOut, maxNumSamples, [](auto&, uint32_t) {});
+    }
+  }
+  CHECK_MEMORY;
+  // with the compensation of the latency, all the channels are aligned with the slowest configuration
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    double maxDifference = 0.0;
+    for (uint32_t i = delays[c]; i < numSamples; ++i) {
+      maxDifference =
+        std::max(maxDifference, std::abs((double)output[c][i] - (double)referenceOutput[c][i - delays[c]]));
+    }
+    for (uint32_t i = 0; i < delays[c]; ++i) {
+      maxDifference = std::max(maxDifference, std::abs((double)output[c][i]));
+    }
+    double maxParallelDifference = 0.0;
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      maxParallelDifference =
+        std::max(maxParallelDifference, std::abs((double)output[c][i] - (double)parallelOutput[c][i]));
+    }
+    cout << "channel " << c << ": order " << grouped.getChannelOrder(c) << ", "
+         << (grouped.isChannelUsingLinearPhase(c) ? "linear" : "minimum") << " phase, delay " << delays[c]
+         << ", max difference against a single channel TOversampling = " << maxDifference
+         << ", max difference with an executor = " << maxParallelDifference << ", processor calls = " << numProcessorCalls[c] << (numProcessorCalls[c] > 0 ? "" : ", NOT PROCESSED")
+         << "\n";
+  }
+}
+
+template<typename Float>
+void testOfflineOversampling(uint32_t order,
+                             bool linearPhase,
+                             uint32_t numSegments,
+                             uint64_t numSamples,
+                             fir::Engine engine = fir::Engine::r8brain)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing offline oversampling of " << numSamples << " samples with order " << order << ", "
+       << (linearPhase ? "linear" : "minimum") << " phase, " << (linearPhase ? getEngineName(engine) : "IIR")
+       << " re-samplers, " << numSegments << " segments and " << (std::is_same_v<Float, float> ? "single" : "double")
+       << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.isUsingLinearPhase = linearPhase;
+  settings.firEngine = engine;
+  auto offlineSettings = OfflineSettings{};
+  offlineSettings.blockSize = 1024;
+  offlineSettings.minSegmentSize = 8192;
+  auto serial = TOfflineOversampling<Float>{ settings, offlineSettings };
+  offlineSettings.numSegments = numSegments;
+  auto parallel = TOfflineOversampling<Float>{ settings, offlineSettings };
+  WorkerPool workerPool(numSegments - 1);
+  parallel.setExecutor(&workerPool);
+  // the FIR re-samplers of the segments start their jobs from within the tasks of the pool
+  parallel.setFirExecutor(&workerPool);
+  cout << "latency = " << parallel.getLatency() << ", priming samples = " << parallel.getPrimingSamples() << "\n";
+
+  auto const numChannels = settings.numUpSampledChannels;
+  std::vector<std::vector<Float>> input(numChannels, std::vector<Float>(numSamples));
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint64_t i = 0; i < numSamples; ++i) {
+      input[c][i] = sin(2.0 * M_PI * 0.0125 * (Float)i + c);
+    }
+  }
+  // a memoryless processor, so that the segments can be processed independently
+  auto const saturate = [](auto& upSampled, uint32_t numUpSampledSamples) {
+    forEachUpSampledSample(upSampled, numUpSampledSamples, [](Float& sample) { sample = std::tanh(sample); });
+  };
+
+  auto getPointers = [](std::vector<std::vector<Float>>& channels) {
+    std::vector<Float*> pointers;
+    for (auto& channel : channels) {
+      pointers.push_back(channel.data());
+    }
+    return pointers;
+  };
+  auto inputPointers = getPointers(input);
+  std::vector<std::vector<Float>> serialOutput(settings.numDownSampledChannels, std::vector<Float>(numSamples));
+  std::vector<std::vector<Float>> parallelOutput(settings.numDownSampledChannels, std::vector<Float>(numSamples));
+  serial.process(inputPointers.data(), getPointers(serialOutput).data(), numSamples, saturate);
+  parallel.process(inputPointers.data(), getPointers(parallelOutput).data(), numSamples, saturate);
+
+  // the same stream read and written in chunks of a different size than the segments
+  class VectorSource final : public OfflineSource<Float>
+  {
+  public:
+    explicit VectorSource(std::vector<std::vector<Float>> const& channels)
+      : channels{ channels }
+    {}
+    uint32_t read(Float* const* destination, uint32_t numSamplesToRead) override
+    {
+      auto const numSamplesRead =
+        (uint32_t)std::min((uint64_t)std::min(numSamplesToRead, 3000u), channels[0].size() - position);
+      for (uint32_t c = 0; c < channels.size(); ++c) {
+        std::copy(&channels[c][position], &channels[c][position] + numSamplesRead, destination[c]);
+      }
+      position += numSamplesRead;
+      return numSamplesRead;
+    }
+
+  private:
+    std::vector<std::vector<Float>> const& channels;
+    uint64_t position = 0;
+  };
+  class VectorSink final : public OfflineSink<Float>
+  {
+  public:
+    explicit VectorSink(uint32_t numChannels)
+      : channels(numChannels)
+    {}
+    void write(Float const* const* source, uint32_t numSamplesToWrite) override
+    {
+      for (uint32_t c = 0; c < channels.size(); ++c) {
+        channels[c].insert(channels[c].end(), source[c], source[c] + numSamplesToWrite);
+      }
+    }
+    std::vector<std::vector<Float>> channels;
+  };
+  VectorSource source{ input };
+  VectorSink sink{ settings.numDownSampledChannels };
+  auto const numStreamedSamples = parallel.process(source, sink, saturate);
+  CHECK_MEMORY;
+  cout << "streamed samples = " << numStreamedSamples << (numStreamedSamples == numSamples ? "" : ", WRONG LENGTH")
+       << "\n";
+
+  auto const printSnr = [&](char const* name, std::vector<std::vector<Float>> const& output) {
+    for (uint32_t c = 0; c < settings.numDownSampledChannels; ++c) {
+      double noisePower = 0.0;
+      double signalPower = 0.0;
+      for (uint64_t i = 0; i < std::min((uint64_t)output[c].size(), numSamples); ++i) {
+        double diff = serialOutput[c][i] - output[c][i];
+        signalPower += serialOutput[c][i] * serialOutput[c][i];
+        noisePower += diff * diff;
+      }
+      cout << name << " against serial processing: channel " << c
+           << " snr = " << 10.0 * log10(signalPower / noisePower) << " dB\n";
+    }
+  };
+  printSnr("parallel segments", parallelOutput);
+  printSnr("streamed parallel segments", sink.channels);
+}
+
+template<typename Float>
+void testInstrumentation(uint32_t order, uint32_t numSamples, bool linearPhase)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the instrumentation with order " << order << ", " << (linearPhase ? "linear" : "minimum")
+       << " phase and " << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  if constexpr (!Instrumentation::isEnabled) {
+    cout << "the instrumentation is not compiled, build with OVERSIMPLE_INSTRUMENTATION=1 to test it\n";
+    return;
+  }
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = order;
+  settings.order = order;
+  settings.maxNumInputSamples = numSamples;
+  settings.isUsingLinearPhase = linearPhase;
+  auto oversampling = TOversampling<Float>{ settings };
+
+  // the hooks count the open sections, as a profiler would open and close its zones
+  struct HookState final
+  {
+    std::atomic<int64_t> numOpenSections{ 0 };
+    std::atomic<uint64_t> numBegins{ 0 };
+  } hookState;
+  ScopeHooks hooks;
+  hooks.context = &hookState;
+  hooks.begin = [](void* context, Section, char const*) {
+    auto& state = *static_cast<HookState*>(context);
+    state.numOpenSections.fetch_add(1);
+    state.numBegins.fetch_add(1);
+  };
+  hooks.end = [](void* context, Section) { static_cast<HookState*>(context)->numOpenSections.fetch_sub(1); };
+  Instrumentation instrumentation;
+  instrumentation.setScopeHooks(hooks);
+  oversampling.setInstrumentation(&instrumentation);
+
+  Buffer<Float> input(settings.numUpSampledChannels, numSamples);
+  Buffer<Float> output(settings.numDownSampledChannels, numSamples);
+  for (uint32_t c = 0; c < settings.numUpSampledChannels; ++c) {
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      input[c][i] = sin(2.0 * M_PI * 0.0125 * (Float)i);
+    }
+  }
+  auto const numBlocks = 8;
+  for (auto i = 0; i < numBlocks; ++i) {
+    auto const numUpSampledSamples = oversampling.upSample(input.get(), numSamples);
+    oversampling.downSample(
+      oversampling.getUpSampleOutput().get(), numUpSampledSamples, output.get(), numSamples);
+  }
+  CHECK_MEMORY;
+
+  auto const ticksPerSecond = Instrumentation::measureTicksPerSecond();
+  uint64_t numCalls = 0;
+  for (uint32_t s = 0; s < static_cast<uint32_t>(Section::numSections); ++s) {
+    auto const section = static_cast<Section>(s);
+    auto const stats = instrumentation.getStats(section);
+    numCalls += stats.numCalls;
+    if (stats.numCalls > 0) {
+      cout << getSectionName(section) << ": calls = " << stats.numCalls << ", samples = " << stats.numSamples
+           << ", ticks per sample = " << (double)stats.numTicks / (double)std::max(stats.numSamples, (uint64_t)1)
+           << ", max time = " << 1.0e6 * (double)stats.maxTicks / ticksPerSecond << " us\n";
+    }
+  }
+  auto const upSamplingCalls = instrumentation.getStats(Section::upSampling).numCalls;
+  auto const downSamplingCalls = instrumentation.getStats(Section::downSampling).numCalls;
+  cout << "up-sampling calls = " << upSamplingCalls << ", down-sampling calls = " << downSamplingCalls
+       << (upSamplingCalls == numBlocks && downSamplingCalls == numBlocks ? "" : ", WRONG NUMBER OF CALLS") << "\n";
+  // the stages and the conversions of the tiles are recorded once per call, whatever the number of tiles and vec
+  // buffers, and without calling the hooks
+  uint64_t numStageCalls = 0;
+  bool areStagesRecordedOncePerCall = true;
+  for (uint32_t stage = 0; stage < numInstrumentedStages; ++stage) {
+    for (auto isUpSampling : { true, false }) {
+      auto const stageCalls = instrumentation.getStats(getStageSection(isUpSampling, stage)).numCalls;
+      numStageCalls += stageCalls;
+      auto const expectedStageCalls = !linearPhase && stage < order ? numBlocks : 0;
+      areStagesRecordedOncePerCall = areStagesRecordedOncePerCall && stageCalls == expectedStageCalls;
+    }
+  }
+  auto const interleavingCalls = instrumentation.getStats(Section::interleaving).numCalls;
+  cout << "stage calls = " << numStageCalls << ", interleaving calls = " << interleavingCalls
+       << (areStagesRecordedOncePerCall && interleavingCalls <= 4 * numBlocks ? ""
+                                                                               : ", WRONG NUMBER OF ACCUMULATED CALLS")
+       << "\n";
+  cout << "hook begins = " << hookState.numBegins.load() << ", open sections = " << hookState.numOpenSections.load()
+       << (hookState.numBegins.load() <= numCalls - numStageCalls && hookState.numOpenSections.load() == 0
+             ? ""
+             : ", UNBALANCED HOOKS")
+       << "\n";
+  instrumentation.reset();
+  cout << "calls after reset = " << instrumentation.getStats(Section::upSampling).numCalls << "\n";
+}
+
+template<typename Float>
+void testDoubleBufferedOversampling(uint32_t maxNumSamples, uint32_t numRequests)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing double buffered oversampling with " << numRequests << " requests from another thread and "
+       << (std::is_same_v<Float, float> ? "single" : "double") << " precision\n";
+  auto settings = OversamplingSettings{};
+  settings.maxOrder = 3;
+  settings.order = 1;
+  settings.maxNumInputSamples = maxNumSamples;
+  WorkerPool workerPool(1);
+  Instrumentation instrumentation;
+  TDoubleBufferedOversampling<TOversampling<Float>> doubleBuffered(settings, &workerPool, &instrumentation);
+
+  // the other thread requests new settings while the audio thread processes
+  std::atomic<bool> isDone{ false };
+  auto requests = std::thread([&] {
+    auto newSettings = settings;
+    for (uint32_t r = 0; r < numRequests; ++r) {
+      newSettings.order = 1 + r % 3;
+      newSettings.isUsingLinearPhase = r % 2 == 1;
+      doubleBuffered.requestSettings(newSettings);
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      doubleBuffered.collectGarbage();
+    }
+    isDone.store(true);
+  });
+
+  Buffer<Float> input(settings.numUpSampledChannels, maxNumSamples);
+  Buffer<Float> output(settings.numDownSampledChannels, maxNumSamples);
+  for (uint64_t c = 0; c < settings.numUpSampledChannels; ++c) {
+    for (uint32_t i = 0; i < maxNumSamples; ++i) {
+      input[c][i] = (Float)sin(2.0 * M_PI * 0.0125 * (double)i);
+    }
+  }
+  TOversampling<Float>* previous = nullptr;
+  uint32_t numSwitches = 0;
+  uint32_t numWrongObjects = 0;
+  while (!isDone.load()) {
+    auto& oversampling = doubleBuffered.beginBlock();
+    if (&oversampling != previous) {
+      ++numSwitches;
+      previous = &oversampling;
+    }
+    // the replacements built by requestSettings keep the executor and the instrumentation
+    if (oversampling.getFirExecutor() != &workerPool || oversampling.getInstrumentation() != &instrumentation) {
+      ++numWrongObjects;
+    }
+    oversampling.process(input.get(), output.get(), maxNumSamples, [](auto&, uint32_t) {});
+  }
+  requests.join();
+  CHECK_MEMORY;
+  cout << "switches = " << numSwitches << (numSwitches > 1 ? "" : ", NO SWITCH HAPPENED")
+       << ", objects without the executor or the instrumentation = " << numWrongObjects << "\n";
+}
+
+void testIirDesignerGroupDelay(uint32_t resolution)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the group delay of the iir designer at " << resolution << " frequencies\n";
+  auto const preset = iir::detail::getOversamplingPreset(0);
+  auto const order = static_cast<uint32_t>(preset.getStages().size());
+  auto const serialGraph = preset.getGroupDelayGraph(resolution).getGraph();
+  auto parallelGraph = std::vector<double>{};
+  {
+    WorkerPool workerPool(3);
+    parallelGraph = preset.getGroupDelayGraph(resolution, &workerPool).getGraph();
+  }
+  std::vector<double> frequencies(resolution);
+  std::vector<double> batchedGroupDelay(resolution);
+  for (uint32_t i = 0; i < resolution; ++i) {
+    frequencies[i] = i * (0.5 / resolution);
+  }
+  preset.getGroupDelay(frequencies.data(), batchedGroupDelay.data(), resolution, order);
+  auto graphError = 0.0;
+  auto batchedError = 0.0;
+  for (uint32_t i = 0; i < resolution; ++i) {
+    auto const reference = preset.getGroupDelay(frequencies[i], order);
+    graphError = std::max(graphError, std::abs(reference - serialGraph[i]));
+    graphError = std::max(graphError, std::abs(serialGraph[i] - parallelGraph[i]));
+    batchedError = std::max(batchedError, std::abs(reference - batchedGroupDelay[i]));
+  }
+  cout << "serial and parallel graphs against single frequency evaluation: max error = " << graphError << "\n";
+  cout << "batched evaluation against single frequency evaluation: max error = " << batchedError << "\n";
+}
+
+void testSharedWorkerPool(uint32_t numCallers, uint32_t numJobs)
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing a worker pool shared by " << numCallers << " threads, with nested jobs\n";
+  WorkerPool workerPool(3);
+  struct Caller final
+  {
+    WorkerPool* workerPool = nullptr;
+    std::atomic<uint64_t> numTasks{ 0 };
+  };
+  std::vector<Caller> callers(numCallers);
+  // each job runs 16 tasks, the first of which runs a nested job of 4 tasks
+  auto const task = [](void* context, uint32_t taskIndex) {
+    auto caller = static_cast<Caller*>(context);
+    caller->numTasks.fetch_add(1, std::memory_order_relaxed);
+    if (taskIndex == 0) {
+      auto const nestedTask = [](void* nestedContext, uint32_t) {
+        static_cast<Caller*>(nestedContext)->numTasks.fetch_add(1, std::memory_order_relaxed);
+      };
+      caller->workerPool->run(4, nestedTask, context);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (auto& caller : callers) {
+    caller.workerPool = &workerPool;
+    threads.emplace_back([&caller, numJobs, task] {
+      for (uint32_t job = 0; job < numJobs; ++job) {
+        caller.workerPool->run(16, task, &caller);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (uint32_t c = 0; c < numCallers; ++c) {
+    auto const numTasks = callers[c].numTasks.load();
+    cout << "caller " << c << ": executed tasks = " << numTasks
+         << (numTasks == uint64_t{ 20 } * numJobs ? "" : ", WRONG NUMBER OF TASKS") << "\n";
+  }
+}
+
+void testIirPresetTables()
+{
+  cout << "\n";
+  cout << "\n";
+  cout << "testing the precomputed iir presets against their runtime design\n";
+  for (uint32_t p = 0; p < std::size(iir::detail::presetDesignParameters); ++p) {
+    auto const& parameters = iir::detail::presetDesignParameters[p];
+    auto const preset = iir::detail::getOversamplingPreset(p);
+    auto const designed = iir::detail::OversamplingDesigner(parameters.attenuation, parameters.transition);
+    auto maxError = 0.0;
+    bool isNumCoefsMatching = true;
+    for (uint32_t s = 0; s < preset.getStages().size(); ++s) {
+      auto const& presetCoefs = preset.getStages()[s].getCoefs();
+      auto const& designedCoefs = designed.getStages()[s].getCoefs();
+      if (presetCoefs.size() != designedCoefs.size()) {
+        isNumCoefsMatching = false;
+        continue;
+      }
+      for (uint32_t i = 0; i < presetCoefs.size(); ++i) {
+        maxError = std::max(maxError, std::abs(presetCoefs[i] - designedCoefs[i]));
+      }
+    }
+    cout << "preset " << p << ": " << (isNumCoefsMatching ? "" : "NUMBER OF COEFFICIENTS MISMATCH, ")
+         << "max coefficient error = " << maxError << "\n";
+  }
+}
+
 int main()
 {
   if constexpr (AVEC_AVX512) {
@@ -522,14 +1970,87 @@ int main()
 
   testIirOversampling<double>(2, 4, 1024);
   testIirOversampling<float>(2, 4, 1024);
+  testIirOversampling<float, iir::Quality::low>(2, 4, 1024);
+  testIirOversampling<double, iir::Quality::high>(3, 5, 1024);
   testFirOversampling<float>(2, 128, 1024, 4, 4.0);
   testFirOversampling<float>(2, 1024, 512, 4, 4.0);
   testFirOversampling<double>(2, 128, 1024, 4, 4.0);
   testFirOversampling<double>(2, 1024, 512, 4, 4.0);
+  {
+    WorkerPool workerPool(3);
+    testFirOversampling<float>(4, 128, 1024, 4, 4.0, &workerPool);
+    testFirOversampling<double>(4, 1024, 512, 4, 4.0, &workerPool);
+  }
+  testFirOversamplingWithSmallBlocks<float>(2, 64, 1024, 4, 4.0);
+  testFirOversamplingWithSmallBlocks<double>(2, 64, 1024, 4, 4.0);
+  testFirOversamplingWithSmallBlocks<double>(3, 200, 256, 2, 4.0);
+  testFirOversamplingWithSmallBlocks<float>(2, 64, 128, 3, 4.0, fir::Engine::uniformPartitioned);
+  testFirOversamplingWithSmallBlocks<double>(3, 48, 64, 1, 4.0, fir::Engine::uniformPartitioned);
+
+  testHalfBandOversampling<float>(9, 3, 128);
+  testHalfBandOversampling<double>(3, 5, 64);
+  testHalfBandOversampling<double>(2, 1, 256);
+  testHalfBandDesign();
+  testHalfBandEngine<float>(3, 128, BufferType::plain);
+  testHalfBandEngine<double>(2, 100, BufferType::interleaved);
 
   testOversampling<float>(4, 1024, false);
   testOversampling<float>(4, 1024, true);
   testOversampling<double>(4, 1024, false);
   testOversampling<double>(4, 1024, true);
+
+  testFusedProcessing<float>(4, 1024, false);
+  testFusedProcessing<double>(5, 512, false);
+  testFusedProcessing<float>(4, 1024, true);
+
+  testIirVoiceBank<float>(6, 2, 256);
+  testIirVoiceBank<double>(3, 3, 256);
+
+  testDispatchedIirOversampling<float>(5, 3, 256);
+  testDispatchedIirOversampling<double>(3, 2, 200);
+
+  testIirTaps<float>(2, 256);
+  testIirTaps<double>(3, 256);
+
+  testFixedOversampling<float, 2, Phase::minimum, BufferType::plain>(512);
+  testFixedOversampling<double, 3, Phase::minimum, BufferType::interleaved>(512);
+  testFixedOversampling<float, 2, Phase::linear, BufferType::plain>(512);
+  testFixedOversampling<double, 3, Phase::linear, BufferType::interleaved, fir::Engine::halfBand>(512);
+
+  testSilenceBypass<float>(2, 128, false);
+  testSilenceBypass<double>(3, 100, false);
+  testSilenceBypass<double>(2, 64, true);
+
+  testPrimeAndFlush<float>(2, 256, fir::Engine::r8brain);
+  testPrimeAndFlush<double>(3, 128, fir::Engine::uniformPartitioned);
+  testPrimeAndFlush<float>(3, 100, fir::Engine::halfBand);
+
+  testFirOrderOnDemand<float>(3, 128);
+  testFirOrderOnDemand<double>(4, 100);
+
+  testPartitionedWorkPerCall<float>(2, 64);
+  testPartitionedWorkPerCall<double>(3, 100);
+
+  testInternalBuffersSize<float>(2, 128);
+  testInternalBuffersSize<double>(3, 100);
+
+  testGroupedOversampling<float>(128, BufferType::plain, fir::Engine::uniformPartitioned);
+  testGroupedOversampling<double>(100, BufferType::interleaved, fir::Engine::uniformPartitioned);
+  testGroupedOversampling<float>(100, BufferType::interleaved, fir::Engine::halfBand);
+
+  testOfflineOversampling<float>(2, true, 4, 100000);
+  testOfflineOversampling<double>(3, false, 3, 100000);
+  testOfflineOversampling<float>(2, true, 3, 100000, fir::Engine::halfBand);
+
+  testInstrumentation<float>(3, 256, false);
+  testInstrumentation<double>(2, 256, true);
+
+  testDoubleBufferedOversampling<float>(128, 200);
+  testDoubleBufferedOversampling<double>(64, 200);
+
+  testIirDesignerGroupDelay(20050);
+  testIirPresetTables();
+
+  testSharedWorkerPool(3, 2000);
   return 0;
 }
\ No newline at end of file